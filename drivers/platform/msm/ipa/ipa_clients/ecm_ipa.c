@@ -92,6 +92,15 @@ static void *ipa_ecm_logbuf;
 #define IPV6_IS_UDP(iph) (((struct ipv6hdr *)iph)->nexthdr == IPPROTO_UDP)
 #define IPV4_DELTA 40
 #define IPV6_DELTA 60
+#define ECM_IPA_RX_QUEUE_MAX 1000
+
+/*
+ * Deliver Rx packets from the netdev NAPI context with GRO instead of
+ * handing each one to the stack from the IPA notify callback.
+ */
+static bool rx_napi = true;
+module_param(rx_napi, bool, 0444);
+MODULE_PARM_DESC(rx_napi, "Receive through a NAPI instance with GRO");
 
 static struct qmap_hdr qmap_template_hdr = {
 	.pad = 0,
@@ -178,6 +187,11 @@ enum ecm_ipa_operation {
  * @netif_rx_function: holds the correct network stack API, needed for NAPI
  * @is_ulso_mode: indicator for ulso support
  * @empty_hdr_hdl: header handle of empty header
+ * @napi: Rx NAPI instance, used when rx_napi is set
+ * @rx_queue: Rx packets waiting for the NAPI poll
+ * @rx_napi_budget: max packets delivered per NAPI poll
+ * @rx_gro_merged: number of Rx packets merged by GRO
+ * @rx_gro_normal: number of Rx packets passed up by GRO unmerged
  */
 struct ecm_ipa_dev {
 	struct net_device *net;
@@ -198,6 +212,11 @@ struct ecm_ipa_dev {
 	int (*netif_rx_function)(struct sk_buff *skb);
 	bool is_ulso_mode;
 	u32 empty_hdr_hdl;
+	struct napi_struct napi;
+	struct sk_buff_head rx_queue;
+	u32 rx_napi_budget;
+	u32 rx_gro_merged;
+	u32 rx_gro_normal;
 };
 
 static int ecm_ipa_open(struct net_device *net);
@@ -214,6 +233,7 @@ static void ecm_ipa_tx_timeout(struct net_device *net);
 #endif
 
 static int ecm_ipa_stop(struct net_device *net);
+static int ecm_ipa_napi_poll(struct napi_struct *napi, int budget);
 static void ecm_ipa_enable_data_path(struct ecm_ipa_dev *ecm_ipa_ctx);
 static int ecm_ipa_rules_cfg
 	(struct ecm_ipa_dev *ecm_ipa_ctx, const void *dst_mac,
@@ -323,6 +343,8 @@ int ecm_ipa_init(struct ecm_ipa_params *params)
 	ecm_ipa_ctx->outstanding_high = DEFAULT_OUTSTANDING_HIGH;
 	ecm_ipa_ctx->outstanding_low = DEFAULT_OUTSTANDING_LOW;
 	atomic_set(&ecm_ipa_ctx->outstanding_pkts, 0);
+	ecm_ipa_ctx->rx_napi_budget = NAPI_POLL_WEIGHT;
+	skb_queue_head_init(&ecm_ipa_ctx->rx_queue);
 	snprintf(net->name, sizeof(net->name), "%s%%d", "ecm");
 	net->netdev_ops = &ecm_ipa_netdev_ops;
 	net->watchdog_timeo = TX_TIMEOUT;
@@ -396,6 +418,13 @@ int ecm_ipa_init(struct ecm_ipa_params *params)
 	}
 	ECM_IPA_DEBUG("register_netdev succeeded\n");
 
+	if (rx_napi) {
+		netif_napi_add(net, &ecm_ipa_ctx->napi, ecm_ipa_napi_poll,
+			NAPI_POLL_WEIGHT);
+		napi_enable(&ecm_ipa_ctx->napi);
+		ECM_IPA_DEBUG("Rx NAPI with GRO enabled\n");
+	}
+
 	if (ecm_ipa_ctx->is_vlan_mode)
 		qmap_template_hdr.additional_hdr_size =
 			VLAN_ETH_HLEN - ETH_HLEN;
@@ -764,12 +793,68 @@ static void ecm_ipa_packet_receive_notify
 	skb->dev = ecm_ipa_ctx->net;
 	skb->protocol = eth_type_trans(skb, ecm_ipa_ctx->net);
 
-	ecm_ipa_ctx->netif_rx_function(skb);
+	if (rx_napi) {
+		if (unlikely(skb_queue_len(&ecm_ipa_ctx->rx_queue) >=
+			ECM_IPA_RX_QUEUE_MAX)) {
+			ECM_IPA_DEBUG("Rx queue full, drop packet\n");
+			ecm_ipa_ctx->net->stats.rx_dropped++;
+			dev_kfree_skb_any(skb);
+			return;
+		}
+		skb_queue_tail(&ecm_ipa_ctx->rx_queue, skb);
+		/* runs pending softirqs when called from process context */
+		local_bh_disable();
+		napi_schedule(&ecm_ipa_ctx->napi);
+		local_bh_enable();
+	} else {
+		ecm_ipa_ctx->netif_rx_function(skb);
+	}
 
 	ecm_ipa_ctx->net->stats.rx_packets++;
 	ecm_ipa_ctx->net->stats.rx_bytes += packet_len;
 }
 
+/**
+ * ecm_ipa_napi_poll() - NAPI poll delivering queued Rx packets via GRO
+ * @napi: the driver NAPI instance
+ * @budget: NAPI budget, further limited by rx_napi_budget
+ *
+ * Returns the number of packets delivered
+ */
+static int ecm_ipa_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct ecm_ipa_dev *ecm_ipa_ctx =
+		container_of(napi, struct ecm_ipa_dev, napi);
+	struct sk_buff *skb;
+	int quota = clamp_t(int, ecm_ipa_ctx->rx_napi_budget, 1, budget);
+	int done = 0;
+
+	while (done < quota &&
+		(skb = skb_dequeue(&ecm_ipa_ctx->rx_queue)) != NULL) {
+		switch (napi_gro_receive(napi, skb)) {
+		case GRO_MERGED:
+		case GRO_MERGED_FREE:
+			ecm_ipa_ctx->rx_gro_merged++;
+			break;
+		default:
+			ecm_ipa_ctx->rx_gro_normal++;
+			break;
+		}
+		done++;
+	}
+
+	/* stay scheduled while packets are left over */
+	if (done == budget || (done == quota &&
+		!skb_queue_empty(&ecm_ipa_ctx->rx_queue)))
+		return budget;
+
+	if (napi_complete_done(napi, done) &&
+		!skb_queue_empty(&ecm_ipa_ctx->rx_queue))
+		napi_schedule(napi);
+
+	return done;
+}
+
 /** ecm_ipa_stop() - called when network device transitions to the down
  *     state.
  *  @net: the network device being stopped.
@@ -917,6 +1002,12 @@ void ecm_ipa_cleanup(void *priv)
 	ecm_ipa_rules_destroy(ecm_ipa_ctx);
 	ecm_ipa_debugfs_destroy(ecm_ipa_ctx);
 
+	if (rx_napi) {
+		napi_disable(&ecm_ipa_ctx->napi);
+		netif_napi_del(&ecm_ipa_ctx->napi);
+		skb_queue_purge(&ecm_ipa_ctx->rx_queue);
+	}
+
 	unregister_netdev(ecm_ipa_ctx->net);
 	free_netdev(ecm_ipa_ctx->net);
 
@@ -1409,6 +1500,16 @@ static void ecm_ipa_debugfs_init(struct ecm_ipa_dev *ecm_ipa_ctx)
 		goto fail_file;
 	}
 
+	debugfs_create_u32
+		("rx_napi_budget", flags_read_write,
+		ecm_ipa_ctx->directory, &ecm_ipa_ctx->rx_napi_budget);
+	debugfs_create_u32
+		("rx_gro_merged", flags_read_only,
+		ecm_ipa_ctx->directory, &ecm_ipa_ctx->rx_gro_merged);
+	debugfs_create_u32
+		("rx_gro_normal", flags_read_only,
+		ecm_ipa_ctx->directory, &ecm_ipa_ctx->rx_gro_normal);
+
 	ECM_IPA_DEBUG("debugfs entries were created\n");
 	ECM_IPA_LOG_EXIT();
 
@@ -67,7 +67,7 @@
 			IPA_GSB_DRV_NAME " %s:%d " fmt, ## args); \
 	} while (0)
 
-#define IPA_GSB_MAX_MSG_LEN 512
+#define IPA_GSB_MAX_MSG_LEN 2048
 
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *dent;
@@ -79,7 +79,17 @@ static char dbg_buff[IPA_GSB_MAX_MSG_LEN];
 #define IPA_GSB_SKB_DUMMY_HEADER 42
 #define IPA_GSB_AGGR_BYTE_LIMIT 14
 #define IPA_GSB_AGGR_TIME_LIMIT 1000 /* 1000 us */
+#define IPA_GSB_COPYBREAK 128
 
+/*
+ * Deaggregate into per packet skbs holding page frags of the RX buffer
+ * instead of clones of the whole aggregate. Off by default since the
+ * resulting skbs are non linear.
+ */
+static bool frag_deaggr;
+module_param(frag_deaggr, bool, 0644);
+MODULE_PARM_DESC(frag_deaggr,
+	"Deliver DL packets as page frags of the aggregated buffer");
 
 /**
  * struct stats - driver statistics,
@@ -87,11 +97,19 @@ static char dbg_buff[IPA_GSB_MAX_MSG_LEN];
  * @num_dl_packets: number of downlink packets
  * @num_insufficient_headroom_packets: number of
 	packets with insufficient headroom
+ * @num_dl_batches: number of downlink batches handed to send_dl_skb
+ * @max_dl_batch: largest downlink batch
+ * @num_dl_frag_packets: number of downlink packets delivered as page frags
+ * @num_dl_copied_packets: number of short downlink packets copied
  */
 struct stats {
 	u64 num_ul_packets;
 	u64 num_dl_packets;
 	u64 num_insufficient_headroom_packets;
+	u64 num_dl_batches;
+	u64 max_dl_batch;
+	u64 num_dl_frag_packets;
+	u64 num_dl_copied_packets;
 };
 
 /**
@@ -206,6 +224,18 @@ static ssize_t ipa_gsb_debugfs_stats(struct file *file,
 				IPA_GSB_MAX_MSG_LEN - nbytes,
 				"packets with insufficient headroom: %lld\n",
 				iface_stats.num_insufficient_headroom_packets);
+
+			nbytes += scnprintf(&dbg_buff[nbytes],
+				IPA_GSB_MAX_MSG_LEN - nbytes,
+				"DL batches: %lld (max %lld pkts)\n",
+				iface_stats.num_dl_batches,
+				iface_stats.max_dl_batch);
+
+			nbytes += scnprintf(&dbg_buff[nbytes],
+				IPA_GSB_MAX_MSG_LEN - nbytes,
+				"DL frag packets: %lld copied packets: %lld\n",
+				iface_stats.num_dl_frag_packets,
+				iface_stats.num_dl_copied_packets);
 		}
 	}
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
@@ -670,14 +700,80 @@ static int ipa_bridge_cleanup_internal(u32 hdl)
 	return 0;
 }
 
+/*
+ * Build a DL skb for one packet of the aggregate without cloning it: short
+ * packets are copied, longer ones get only the ETH header copied and the
+ * rest attached as a frag of the aggregate page, so GRO can use its frag0
+ * fast path and only the pages still referenced stay pinned.
+ */
+static struct sk_buff *ipa_gsb_build_frag_skb(u8 *pkt, unsigned int len,
+	struct stats *stats)
+{
+	struct sk_buff *skb;
+	struct page *page;
+	unsigned int copy;
+
+	copy = (len <= IPA_GSB_COPYBREAK) ? len : ETH_HLEN;
+	skb = alloc_skb(IPA_GSB_SKB_HEADROOM + IPA_GSB_COPYBREAK, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+	skb_reserve(skb, IPA_GSB_SKB_HEADROOM);
+	skb_put_data(skb, pkt, copy);
+
+	if (copy == len) {
+		stats->num_dl_copied_packets++;
+		return skb;
+	}
+
+	page = virt_to_head_page(pkt);
+	get_page(page);
+	skb_add_rx_frag(skb, 0, page, pkt + copy - (u8 *)page_address(page),
+		len - copy, SKB_DATA_ALIGN(len - copy));
+	stats->num_dl_frag_packets++;
+
+	return skb;
+}
+
+static void ipa_gsb_deliver_batch(u8 hdl, struct sk_buff_head *batch,
+	struct stats *frag_stats)
+{
+	struct ipa_gsb_iface_info *iface;
+	struct sk_buff *skb;
+	u32 n = skb_queue_len(batch);
+
+	spin_lock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
+	iface = ipa_gsb_ctx->iface[hdl];
+	if (iface == NULL) {
+		spin_unlock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
+		IPA_GSB_ERR("Invalid hdl: %d, drop %u skbs\n", hdl, n);
+		__skb_queue_purge(batch);
+		return;
+	}
+	while ((skb = __skb_dequeue(batch)) != NULL)
+		iface->send_dl_skb(iface->priv, skb);
+	iface->iface_stats.num_dl_packets += n;
+	iface->iface_stats.num_dl_frag_packets +=
+		frag_stats->num_dl_frag_packets;
+	iface->iface_stats.num_dl_copied_packets +=
+		frag_stats->num_dl_copied_packets;
+	iface->iface_stats.num_dl_batches++;
+	if (n > iface->iface_stats.max_dl_batch)
+		iface->iface_stats.max_dl_batch = n;
+	spin_unlock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
+}
+
 static void ipa_gsb_cons_cb(void *priv, enum ipa_dp_evt_type evt,
 	unsigned long data)
 {
 	struct sk_buff *skb;
 	struct sk_buff *skb2;
 	struct ipa_gsb_mux_hdr *mux_hdr;
+	struct sk_buff_head batch[MAX_SUPPORTED_IFACE];
+	struct stats frag_stats[MAX_SUPPORTED_IFACE];
 	u16 pkt_size, pad_byte;
 	u8 hdl;
+	bool frag_mode;
+	int i;
 
 	if (evt != IPA_RECEIVE) {
 		IPA_GSB_ERR("unexpected event\n");
@@ -693,6 +789,12 @@ static void ipa_gsb_cons_cb(void *priv, enum ipa_dp_evt_type evt,
 		return;
 	}
 
+	/* frags can only point into a page backed linear buffer */
+	frag_mode = frag_deaggr && skb->head_frag && !skb_is_nonlinear(skb);
+	for (i = 0; i < MAX_SUPPORTED_IFACE; i++)
+		__skb_queue_head_init(&batch[i]);
+	memset(frag_stats, 0, sizeof(frag_stats));
+
 	while (skb->len) {
 		mux_hdr = (struct ipa_gsb_mux_hdr *)skb->data;
 		pkt_size = mux_hdr->pkt_size;
@@ -711,27 +813,37 @@ static void ipa_gsb_cons_cb(void *priv, enum ipa_dp_evt_type evt,
 
 		/* remove 4 byte mux header AND dummy header*/
 		skb_pull(skb, sizeof(*mux_hdr) + IPA_GSB_SKB_DUMMY_HEADER);
-
-		skb2 = skb_clone(skb, GFP_KERNEL);
-		if (!skb2) {
-			IPA_GSB_ERR("skb_clone failed\n");
-			WARN_ON(1);
+		if (skb->len < pkt_size + ETH_HLEN) {
+			IPA_GSB_ERR("truncated pkt: %d > %d\n",
+				pkt_size + ETH_HLEN, skb->len);
 			break;
 		}
-		skb_trim(skb2, pkt_size + ETH_HLEN);
-		spin_lock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
-		if (ipa_gsb_ctx->iface[hdl] != NULL) {
-			ipa_gsb_ctx->iface[hdl]->send_dl_skb(
-				ipa_gsb_ctx->iface[hdl]->priv, skb2);
-			ipa_gsb_ctx->iface[hdl]->iface_stats.num_dl_packets++;
-			spin_unlock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
-			skb_pull(skb, pkt_size + ETH_HLEN + pad_byte);
+
+		if (frag_mode) {
+			skb2 = ipa_gsb_build_frag_skb(skb->data,
+				pkt_size + ETH_HLEN, &frag_stats[hdl]);
+			if (!skb2) {
+				IPA_GSB_ERR("fail to alloc skb\n");
+				break;
+			}
 		} else {
-			IPA_GSB_ERR("Invalid hdl: %d, drop the skb\n", hdl);
-			spin_unlock_bh(&ipa_gsb_ctx->iface_spinlock[hdl]);
-			dev_kfree_skb_any(skb2);
-			break;
+			skb2 = skb_clone(skb, GFP_KERNEL);
+			if (!skb2) {
+				IPA_GSB_ERR("skb_clone failed\n");
+				WARN_ON(1);
+				break;
+			}
+			skb_trim(skb2, pkt_size + ETH_HLEN);
 		}
+		__skb_queue_tail(&batch[hdl], skb2);
+		skb_pull(skb, min_t(unsigned int, skb->len,
+			pkt_size + ETH_HLEN + pad_byte));
+	}
+
+	/* one lock round trip per interface, packets kept in order */
+	for (i = 0; i < MAX_SUPPORTED_IFACE; i++) {
+		if (!skb_queue_empty(&batch[i]))
+			ipa_gsb_deliver_batch(i, &batch[i], &frag_stats[i]);
 	}
 
 	if (skb) {
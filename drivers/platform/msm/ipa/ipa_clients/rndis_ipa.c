@@ -119,6 +119,15 @@ static void *ipa_rndis_logbuf;
 #define IPV6_IS_UDP(iph) (((struct ipv6hdr *)iph)->nexthdr == IPPROTO_UDP)
 #define IPV4_DELTA 40
 #define IPV6_DELTA 60
+#define RNDIS_IPA_RX_QUEUE_MAX 1000
+
+/*
+ * Deliver Rx packets from the netdev NAPI context with GRO instead of
+ * handing each one to the stack from the IPA notify callback.
+ */
+static bool rx_napi = true;
+module_param(rx_napi, bool, 0444);
+MODULE_PARM_DESC(rx_napi, "Receive through a NAPI instance with GRO");
 
 /**
  * enum rndis_ipa_state - specify the current driver internal state
@@ -207,6 +216,17 @@ enum rndis_ipa_operation {
  * @netif_rx_function: holds the correct network stack API, needed for NAPI
  * @is_ulso_mode: indicator for ulso support
  * @rndis_hdr_hdl: hdr handle of rndis header
+ * @hw_hdr_insertion: let IPA insert the RNDIS header of TCP/UDP packets
+ *  (ulso mode only) even when TSO/GSO features are off
+ * @tx_expand_copies: number of Tx packets whose head had to be reallocated
+ *  to fit the RNDIS/QMAP header
+ * @tx_hw_hdr_pkts: number of Tx packets sent for IPA RNDIS header insertion
+ * @tx_sw_hdr_pkts: number of Tx packets encapsulated by the driver
+ * @napi: Rx NAPI instance, used when rx_napi is set
+ * @rx_queue: Rx packets waiting for the NAPI poll
+ * @rx_napi_budget: max packets delivered per NAPI poll
+ * @rx_gro_merged: number of Rx packets merged by GRO
+ * @rx_gro_normal: number of Rx packets passed up by GRO unmerged
  */
 struct rndis_ipa_dev {
 	struct net_device *net;
@@ -239,6 +259,15 @@ struct rndis_ipa_dev {
 	int (*netif_rx_function)(struct sk_buff *skb);
 	bool is_ulso_mode;
 	u32 rndis_hdr_hdl;
+	bool hw_hdr_insertion;
+	u32 tx_expand_copies;
+	u32 tx_hw_hdr_pkts;
+	u32 tx_sw_hdr_pkts;
+	struct napi_struct napi;
+	struct sk_buff_head rx_queue;
+	u32 rx_napi_budget;
+	u32 rx_gro_merged;
+	u32 rx_gro_normal;
 };
 
 /**
@@ -271,9 +300,12 @@ static void rndis_ipa_tx_timeout(struct net_device *net);
 #endif
 
 static int rndis_ipa_stop(struct net_device *net);
+static int rndis_ipa_napi_poll(struct napi_struct *napi, int budget);
 static void rndis_ipa_enable_data_path(struct rndis_ipa_dev *rndis_ipa_ctx);
 static struct sk_buff *rndis_encapsulate_skb(struct sk_buff *skb,
 	struct rndis_ipa_dev *rndis_ipa_ctx);
+static int rndis_ipa_cow_head(struct sk_buff *skb, unsigned int len,
+	struct rndis_ipa_dev *rndis_ipa_ctx);
 static void rndis_ipa_xmit_error(struct sk_buff *skb);
 static void rndis_ipa_xmit_error_aftercare_wq(struct work_struct *work);
 static void rndis_ipa_prepare_header_insertion
@@ -602,6 +634,12 @@ int rndis_ipa_init(struct ipa_usb_init_params *params)
 	rndis_ipa_ctx->icmp_filter = true;
 	rndis_ipa_ctx->tx_dropped = 0;
 	rndis_ipa_ctx->rx_dropped = 0;
+	rndis_ipa_ctx->hw_hdr_insertion = false;
+	rndis_ipa_ctx->tx_expand_copies = 0;
+	rndis_ipa_ctx->tx_hw_hdr_pkts = 0;
+	rndis_ipa_ctx->tx_sw_hdr_pkts = 0;
+	rndis_ipa_ctx->rx_napi_budget = NAPI_POLL_WEIGHT;
+	skb_queue_head_init(&rndis_ipa_ctx->rx_queue);
 	rndis_ipa_ctx->tx_dump_enable = false;
 	rndis_ipa_ctx->rx_dump_enable = false;
 	rndis_ipa_ctx->deaggregation_enable = false;
@@ -633,7 +671,8 @@ int rndis_ipa_init(struct ipa_usb_init_params *params)
 	net->netdev_ops = &rndis_ipa_netdev_ops;
 	net->watchdog_timeo = TX_TIMEOUT;
 
-	net->needed_headroom = sizeof(rndis_template_hdr);
+	net->needed_headroom = max(sizeof(rndis_template_hdr),
+		sizeof(qmap_template_hdr));
 	RNDIS_IPA_DEBUG
 		("Needed headroom for RNDIS header set to %d\n",
 		net->needed_headroom);
@@ -712,6 +751,13 @@ int rndis_ipa_init(struct ipa_usb_init_params *params)
 		RNDIS_IPA_DEBUG("LAN RX NAPI enabled = False");
 	}
 
+	if (rx_napi) {
+		netif_napi_add(net, &rndis_ipa_ctx->napi, rndis_ipa_napi_poll,
+			NAPI_POLL_WEIGHT);
+		napi_enable(&rndis_ipa_ctx->napi);
+		RNDIS_IPA_DEBUG("Rx NAPI with GRO enabled\n");
+	}
+
 	if (rndis_ipa_ctx->is_vlan_mode)
 		qmap_template_hdr.additional_hdr_size =
 			VLAN_ETH_HLEN - ETH_HLEN;
@@ -1054,8 +1100,10 @@ static netdev_tx_t rndis_ipa_start_xmit(struct sk_buff *skb,
 	}
 
 	if (rndis_ipa_ctx->is_ulso_mode &&
-		(net->features & (NETIF_F_ALL_TSO | NETIF_F_GSO_UDP_L4))){
+		(rndis_ipa_ctx->hw_hdr_insertion ||
+		(net->features & (NETIF_F_ALL_TSO | NETIF_F_GSO_UDP_L4)))) {
 		struct iphdr *iph = NULL;
+		unsigned int delta = 0;
 		/*
 		 * gso_size must be set here because tx feature must be on
 		 * meanning that in case of a small packet its checksum will
@@ -1064,21 +1112,23 @@ static netdev_tx_t rndis_ipa_start_xmit(struct sk_buff *skb,
 		 * set gso_size to non 0 value. It is only used internally by
 		 * the ipa driver so, there is no significance which non-0 value
 		 * is set.
+		 * The RNDIS header of such packets is inserted by IPA using
+		 * the hpc header set in rndis_ipa_hdrs_hpc_cfg().
 		 */
 		if (ntohs(skb->protocol) == ETH_P_IP) {
 			iph = ip_hdr(skb);
-			if (IPV4_IS_TCP(iph) || IPV4_IS_UDP(iph)) {
-				skb = qmap_encapsulate_skb(skb, &qmap_template_hdr);
-				skb_shinfo(skb)->gso_size =
-					net->mtu - IPV4_DELTA;
-			}
+			if (IPV4_IS_TCP(iph) || IPV4_IS_UDP(iph))
+				delta = IPV4_DELTA;
 		} else if (ntohs(skb->protocol) == ETH_P_IPV6) {
 			iph = ip_hdr(skb);
-			if (IPV6_IS_TCP(iph) || IPV6_IS_UDP(iph)) {
-				skb = qmap_encapsulate_skb(skb, &qmap_template_hdr);
-				skb_shinfo(skb)->gso_size =
-					net->mtu - IPV6_DELTA;
-			}
+			if (IPV6_IS_TCP(iph) || IPV6_IS_UDP(iph))
+				delta = IPV6_DELTA;
+		}
+		if (delta && !rndis_ipa_cow_head(skb,
+			sizeof(qmap_template_hdr), rndis_ipa_ctx)) {
+			skb = qmap_encapsulate_skb(skb, &qmap_template_hdr);
+			skb_shinfo(skb)->gso_size = net->mtu - delta;
+			rndis_ipa_ctx->tx_hw_hdr_pkts++;
 		}
 	} else {
 		skb = rndis_encapsulate_skb(skb, rndis_ipa_ctx);
@@ -1290,12 +1340,68 @@ static void rndis_ipa_packet_receive_notify(
 	}
 
 	trace_rndis_netif_ni(skb->protocol);
-	rndis_ipa_ctx->netif_rx_function(skb);
+	if (rx_napi) {
+		if (unlikely(skb_queue_len(&rndis_ipa_ctx->rx_queue) >=
+			RNDIS_IPA_RX_QUEUE_MAX)) {
+			RNDIS_IPA_ERROR_RL("Rx queue full, drop packet\n");
+			rndis_ipa_ctx->rx_dropped++;
+			dev_kfree_skb_any(skb);
+			return;
+		}
+		skb_queue_tail(&rndis_ipa_ctx->rx_queue, skb);
+		/* runs pending softirqs when called from process context */
+		local_bh_disable();
+		napi_schedule(&rndis_ipa_ctx->napi);
+		local_bh_enable();
+	} else {
+		rndis_ipa_ctx->netif_rx_function(skb);
+	}
 
 	rndis_ipa_ctx->net->stats.rx_packets++;
 	rndis_ipa_ctx->net->stats.rx_bytes += packet_len;
 }
 
+/**
+ * rndis_ipa_napi_poll() - NAPI poll delivering queued Rx packets via GRO
+ * @napi: the driver NAPI instance
+ * @budget: NAPI budget, further limited by rx_napi_budget
+ *
+ * Returns the number of packets delivered
+ */
+static int rndis_ipa_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct rndis_ipa_dev *rndis_ipa_ctx =
+		container_of(napi, struct rndis_ipa_dev, napi);
+	struct sk_buff *skb;
+	int quota = clamp_t(int, rndis_ipa_ctx->rx_napi_budget, 1, budget);
+	int done = 0;
+
+	while (done < quota &&
+		(skb = skb_dequeue(&rndis_ipa_ctx->rx_queue)) != NULL) {
+		switch (napi_gro_receive(napi, skb)) {
+		case GRO_MERGED:
+		case GRO_MERGED_FREE:
+			rndis_ipa_ctx->rx_gro_merged++;
+			break;
+		default:
+			rndis_ipa_ctx->rx_gro_normal++;
+			break;
+		}
+		done++;
+	}
+
+	/* stay scheduled while packets are left over */
+	if (done == budget || (done == quota &&
+		!skb_queue_empty(&rndis_ipa_ctx->rx_queue)))
+		return budget;
+
+	if (napi_complete_done(napi, done) &&
+		!skb_queue_empty(&rndis_ipa_ctx->rx_queue))
+		napi_schedule(napi);
+
+	return done;
+}
+
 /** rndis_ipa_stop() - notify the network interface to stop
  *   sending/receiving data
  *  @net: the network device being stopped.
@@ -1525,6 +1631,12 @@ void rndis_ipa_cleanup(void *private)
 	rndis_ipa_debugfs_destroy(rndis_ipa_ctx);
 	RNDIS_IPA_DEBUG("debugfs remove was done\n");
 
+	if (rx_napi) {
+		napi_disable(&rndis_ipa_ctx->napi);
+		netif_napi_del(&rndis_ipa_ctx->napi);
+		skb_queue_purge(&rndis_ipa_ctx->rx_queue);
+	}
+
 	unregister_netdev(rndis_ipa_ctx->net);
 	RNDIS_IPA_DEBUG("netdev unregistered\n");
 
@@ -2024,20 +2136,9 @@ static struct sk_buff *rndis_encapsulate_skb(struct sk_buff *skb,
 	struct rndis_pkt_hdr *rndis_hdr;
 	int payload_byte_len = skb->len;
 
-	/* if there is no room in this skb, allocate a new one */
-	if (unlikely(skb_headroom(skb) < sizeof(rndis_template_hdr))) {
-		struct sk_buff *new_skb = skb_copy_expand(skb,
-			sizeof(rndis_template_hdr), 0, GFP_ATOMIC);
-
-		if (!new_skb) {
-			RNDIS_IPA_ERROR_RL("no memory for skb expand\n");
-			return skb;
-		}
-		RNDIS_IPA_DEBUG("skb expanded. old %pK new %pK\n",
-			skb, new_skb);
-		dev_kfree_skb_any(skb);
-		skb = new_skb;
-	}
+	if (rndis_ipa_cow_head(skb, sizeof(rndis_template_hdr),
+		rndis_ipa_ctx))
+		return skb;
 
 	if (rndis_ipa_ctx->is_vlan_mode)
 		if (unlikely(skb->protocol != htons(ETH_P_8021Q)))
@@ -2052,10 +2153,39 @@ static struct sk_buff *rndis_encapsulate_skb(struct sk_buff *skb,
 	memcpy(rndis_hdr, &rndis_template_hdr, sizeof(*rndis_hdr));
 	rndis_hdr->msg_len +=  payload_byte_len;
 	rndis_hdr->data_len +=  payload_byte_len;
+	rndis_ipa_ctx->tx_sw_hdr_pkts++;
 
 	return skb;
 }
 
+/**
+ * rndis_ipa_cow_head() - make sure a header can be pushed in place
+ * @skb: packet about to be encapsulated
+ * @len: length of the header to push
+ * @rndis_ipa_ctx: main driver context
+ *
+ * The netdev advertises needed_headroom, but forwarded and cloned skbs may
+ * still lack a private headroom. Only the linear head is reallocated then,
+ * paged data stays shared, and the event is counted in tx_expand_copies.
+ *
+ * Returns negative errno, or zero on success
+ */
+static int rndis_ipa_cow_head(struct sk_buff *skb, unsigned int len,
+	struct rndis_ipa_dev *rndis_ipa_ctx)
+{
+	if (likely(skb_headroom(skb) >= len && !skb_header_cloned(skb)))
+		return 0;
+
+	rndis_ipa_ctx->tx_expand_copies++;
+	if (skb_cow_head(skb, len)) {
+		RNDIS_IPA_ERROR_RL("no memory for skb expand\n");
+		return -ENOMEM;
+	}
+	RNDIS_IPA_DEBUG("skb head expanded by %u\n", len);
+
+	return 0;
+}
+
 /**
  * rx_filter() - logic that decide if the current skb is to be filtered out
  * @skb: skb that may be sent up to the network stack
@@ -2400,6 +2530,34 @@ static void rndis_ipa_debugfs_init(struct rndis_ipa_dev *rndis_ipa_ctx)
 		("rx_dropped", flags_read_only,
 		rndis_ipa_ctx->directory, &rndis_ipa_ctx->rx_dropped);
 
+	debugfs_create_bool
+		("hw_hdr_insertion", flags_read_write,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->hw_hdr_insertion);
+
+	debugfs_create_u32
+		("tx_expand_copies", flags_read_only,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->tx_expand_copies);
+
+	debugfs_create_u32
+		("tx_hw_hdr_pkts", flags_read_only,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->tx_hw_hdr_pkts);
+
+	debugfs_create_u32
+		("tx_sw_hdr_pkts", flags_read_only,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->tx_sw_hdr_pkts);
+
+	debugfs_create_u32
+		("rx_napi_budget", flags_read_write,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->rx_napi_budget);
+
+	debugfs_create_u32
+		("rx_gro_merged", flags_read_only,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->rx_gro_merged);
+
+	debugfs_create_u32
+		("rx_gro_normal", flags_read_only,
+		rndis_ipa_ctx->directory, &rndis_ipa_ctx->rx_gro_normal);
+
 	aggr_directory = debugfs_create_dir
 		(DEBUGFS_AGGR_DIR_NAME,
 		rndis_ipa_ctx->directory);
@@ -72,6 +72,7 @@
 #define CREATE_TRACE_POINTS
 #include "ipa_trace.h"
 #include "ipa_odl.h"
+#include "ipa_xsk.h"
 
 #define IPA_SUSPEND_BUSY_TIMEOUT (msecs_to_jiffies(10))
 
@@ -172,6 +173,7 @@ static int ipa3_ioctl_mdfy_flt_rule_v2(unsigned long arg);
 static int ipa3_ioctl_fnr_counter_alloc(unsigned long arg);
 static int ipa3_ioctl_fnr_counter_query(unsigned long arg);
 static int ipa3_ioctl_fnr_counter_set(unsigned long arg);
+static int ipa3_ioctl_batch(unsigned long arg);
 
 static struct ipa3_plat_drv_res ipa3_res = {0, };
 
@@ -2533,6 +2535,321 @@ static int ipa3_ioctl_fnr_counter_set(unsigned long arg)
 	return 0;
 }
 
+/* payload of a batch op, copied in before ipa3_ctx->lock is taken */
+union ipa3_batch_pyld {
+	struct ipa_hdr_add hdr;
+	struct ipa_hdr_proc_ctx_add proc_ctx;
+	struct ipa_rt_rule_add_i rt;
+	struct ipa_flt_rule_add_i flt;
+};
+
+static int ipa3_batch_copy_one(struct ipa_ioc_batch_op *ops, u32 idx,
+	union ipa3_batch_pyld *pyld)
+{
+	struct ipa_ioc_batch_op *op = &ops[idx];
+	struct ipa_ioc_batch_op *ref = NULL;
+	u32 max_size;
+
+	if (op->ref != IPA_BATCH_NO_REF) {
+		if (op->ref >= idx) {
+			IPAERR_RL("op %u refers to later op %u\n", idx, op->ref);
+			return -EINVAL;
+		}
+		ref = &ops[op->ref];
+	}
+
+	switch (op->type) {
+	case IPA_BATCH_OP_ADD_HDR:
+		if (ref || op->pyld_size != sizeof(pyld->hdr))
+			return -EINVAL;
+		break;
+	case IPA_BATCH_OP_ADD_HDR_PROC_CTX:
+		if ((ref && ref->type != IPA_BATCH_OP_ADD_HDR) ||
+			op->pyld_size != sizeof(pyld->proc_ctx))
+			return -EINVAL;
+		break;
+	case IPA_BATCH_OP_ADD_RT_RULE:
+		max_size = sizeof(pyld->rt);
+		if ((ref && ref->type != IPA_BATCH_OP_ADD_HDR &&
+			ref->type != IPA_BATCH_OP_ADD_HDR_PROC_CTX) ||
+			op->ip >= IPA_IP_MAX || !op->pyld_size ||
+			op->pyld_size > max_size)
+			return -EINVAL;
+		break;
+	case IPA_BATCH_OP_ADD_FLT_RULE:
+		max_size = sizeof(pyld->flt);
+		if ((ref && (ref->type != IPA_BATCH_OP_ADD_RT_RULE ||
+			ref->ip != op->ip)) ||
+			op->ip >= IPA_IP_MAX || op->ep >= IPA_CLIENT_MAX ||
+			!op->pyld_size || op->pyld_size > max_size)
+			return -EINVAL;
+		break;
+	default:
+		IPAERR_RL("op %u unknown type %u\n", idx, op->type);
+		return -EINVAL;
+	}
+
+	if (copy_from_user(pyld, u64_to_user_ptr(op->pyld), op->pyld_size))
+		return -EFAULT;
+
+	return 0;
+}
+
+/* called with ipa3_ctx->lock held */
+static int ipa3_batch_rt_tbl_hdl(u32 rt_rule_hdl, u32 *rt_tbl_hdl)
+{
+	struct ipa3_rt_entry *entry;
+
+	entry = ipa3_id_find(rt_rule_hdl);
+	if (!entry || entry->cookie != IPA_RT_RULE_COOKIE || !entry->tbl)
+		return -EINVAL;
+
+	*rt_tbl_hdl = entry->tbl->id;
+	return 0;
+}
+
+/* called with ipa3_ctx->lock held, the op was checked by ipa3_batch_copy_one */
+static int ipa3_batch_add_one(struct ipa_ioc_batch_op *ops, u32 idx,
+	union ipa3_batch_pyld *pyld)
+{
+	struct ipa_ioc_batch_op *op = &ops[idx];
+	struct ipa_ioc_batch_op *ref = NULL;
+	int ret;
+
+	if (op->ref != IPA_BATCH_NO_REF)
+		ref = &ops[op->ref];
+
+	switch (op->type) {
+	case IPA_BATCH_OP_ADD_HDR:
+		ret = __ipa_add_hdr(&pyld->hdr, true, NULL);
+		if (!ret)
+			op->hdl = pyld->hdr.hdr_hdl;
+		break;
+	case IPA_BATCH_OP_ADD_HDR_PROC_CTX:
+		if (ref)
+			pyld->proc_ctx.hdr_hdl = ref->hdl;
+		ret = __ipa_add_hdr_proc_ctx(&pyld->proc_ctx, true, true);
+		if (!ret)
+			op->hdl = pyld->proc_ctx.proc_ctx_hdl;
+		break;
+	case IPA_BATCH_OP_ADD_RT_RULE:
+		if (ref && ref->type == IPA_BATCH_OP_ADD_HDR) {
+			pyld->rt.rule.hdr_hdl = ref->hdl;
+			pyld->rt.rule.hdr_proc_ctx_hdl = 0;
+		} else if (ref) {
+			pyld->rt.rule.hdr_hdl = 0;
+			pyld->rt.rule.hdr_proc_ctx_hdl = ref->hdl;
+		}
+		/* if hashing not supported, all tables are non-hash tables */
+		if (ipa3_ctx->ipa_fltrt_not_hashable)
+			pyld->rt.rule.hashable = false;
+		op->rt_tbl_name[IPA_RESOURCE_NAME_MAX - 1] = '\0';
+		ret = __ipa_add_rt_rule(op->ip, op->rt_tbl_name,
+			&pyld->rt.rule, pyld->rt.at_rear,
+			&pyld->rt.rt_rule_hdl, 0, true);
+		if (!ret)
+			op->hdl = pyld->rt.rt_rule_hdl;
+		break;
+	case IPA_BATCH_OP_ADD_FLT_RULE:
+		if (ref) {
+			ret = ipa3_batch_rt_tbl_hdl(ref->hdl,
+				&pyld->flt.rule.rt_tbl_hdl);
+			if (ret)
+				break;
+		}
+		/* if hashing not supported, all tables are non-hash tables */
+		if (ipa3_ctx->ipa_fltrt_not_hashable)
+			pyld->flt.rule.hashable = false;
+		ret = __ipa_add_ep_flt_rule(op->ip, op->ep, &pyld->flt.rule,
+			pyld->flt.at_rear, &pyld->flt.flt_rule_hdl, true);
+		if (!ret)
+			op->hdl = pyld->flt.flt_rule_hdl;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	return ret;
+}
+
+/*
+ * Undo an applied op in SW only, with ipa3_ctx->lock held. The caller
+ * takes care of the commit.
+ */
+static void ipa3_batch_del_one(struct ipa_ioc_batch_op *op)
+{
+	int ret;
+
+	switch (op->type) {
+	case IPA_BATCH_OP_ADD_HDR:
+		ret = __ipa3_del_hdr(op->hdl, true);
+		break;
+	case IPA_BATCH_OP_ADD_HDR_PROC_CTX:
+		ret = __ipa3_del_hdr_proc_ctx(op->hdl, true, true);
+		break;
+	case IPA_BATCH_OP_ADD_RT_RULE:
+		ret = __ipa3_del_rt_rule(op->hdl);
+		break;
+	case IPA_BATCH_OP_ADD_FLT_RULE:
+		ret = __ipa_del_flt_rule(op->hdl);
+		break;
+	default:
+		ret = 0;
+		break;
+	}
+
+	if (ret)
+		IPAERR("failed to roll back op type %u hdl %u: %d\n",
+			op->type, op->hdl, ret);
+}
+
+/*
+ * Commit everything a batch touched, with ipa3_ctx->lock held, in the
+ * dependency order of ipa3_commit_hdr() and ipa3_commit_rt(): filtering
+ * rules point to routing tables which point to headers.
+ */
+static int ipa3_batch_commit(bool hdr, bool *rt, bool *flt)
+{
+	enum ipa_ip_type ip;
+
+	for (ip = IPA_IP_v4; ip < IPA_IP_MAX; ip++) {
+		if ((hdr || rt[ip] || flt[ip]) &&
+			ipa3_ctx->ctrl->ipa3_commit_flt(ip)) {
+			IPAERR("fail to commit flt ip %d\n", ip);
+			return -EPERM;
+		}
+		if ((hdr || rt[ip]) && ipa3_ctx->ctrl->ipa3_commit_rt(ip)) {
+			IPAERR("fail to commit rt ip %d\n", ip);
+			return -EPERM;
+		}
+	}
+	if (hdr && ipa3_ctx->ctrl->ipa3_commit_hdr()) {
+		IPAERR("fail to commit hdr\n");
+		return -EPERM;
+	}
+
+	return 0;
+}
+
+/**
+ * ipa3_ioctl_batch() - IPA_IOC_BATCH handler
+ * @arg: user pointer to struct ipa_ioc_batch
+ *
+ * Copies in every payload, then, under a single hold of ipa3_ctx->lock,
+ * applies the ops in order without committing, resolving references to
+ * handles created earlier in the batch, and commits the touched tables
+ * once. If an op or the commit fails, the applied ops are removed again in
+ * reverse order and, after a failed commit, the previous tables are
+ * recommitted. Holding the lock throughout keeps any other commit from
+ * publishing part of the batch.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+static int ipa3_ioctl_batch(unsigned long arg)
+{
+	struct ipa_ioc_batch batch;
+	struct ipa_ioc_batch_op *ops;
+	union ipa3_batch_pyld *pylds;
+	bool hdr = false;
+	bool rt[IPA_IP_MAX] = { false };
+	bool flt[IPA_IP_MAX] = { false };
+	u32 i, n;
+	int ret = 0;
+
+	if (copy_from_user(&batch, (const void __user *)arg, sizeof(batch))) {
+		IPAERR_RL("copy_from_user fails\n");
+		return -EFAULT;
+	}
+
+	if (!batch.num_ops || batch.num_ops > IPA_BATCH_MAX_OPS ||
+		!batch.ops) {
+		IPAERR_RL("bad batch num_ops %u\n", batch.num_ops);
+		return -EINVAL;
+	}
+
+	ops = memdup_user(u64_to_user_ptr(batch.ops),
+		batch.num_ops * sizeof(*ops));
+	if (IS_ERR(ops))
+		return PTR_ERR(ops);
+
+	pylds = kvcalloc(batch.num_ops, sizeof(*pylds), GFP_KERNEL);
+	if (!pylds) {
+		kfree(ops);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < batch.num_ops; i++) {
+		ops[i].hdl = 0;
+		ops[i].status = -1;
+	}
+	batch.failed_op = IPA_BATCH_NO_REF;
+
+	for (n = 0; n < batch.num_ops; n++) {
+		ret = ipa3_batch_copy_one(ops, n, &pylds[n]);
+		if (ret) {
+			IPAERR_RL("batch op %u type %u bad %d\n",
+				n, ops[n].type, ret);
+			batch.failed_op = n;
+			goto copy_out;
+		}
+	}
+
+	mutex_lock(&ipa3_ctx->lock);
+
+	for (n = 0; n < batch.num_ops; n++) {
+		ret = ipa3_batch_add_one(ops, n, &pylds[n]);
+		if (ret) {
+			IPAERR_RL("batch op %u type %u failed %d\n",
+				n, ops[n].type, ret);
+			batch.failed_op = n;
+			break;
+		}
+		ops[n].status = 0;
+
+		if (ops[n].type == IPA_BATCH_OP_ADD_HDR ||
+			ops[n].type == IPA_BATCH_OP_ADD_HDR_PROC_CTX)
+			hdr = true;
+		else if (ops[n].type == IPA_BATCH_OP_ADD_RT_RULE)
+			rt[ops[n].ip] = true;
+		else
+			flt[ops[n].ip] = true;
+	}
+
+	if (!ret) {
+		ret = ipa3_batch_commit(hdr, rt, flt);
+		if (ret)
+			batch.failed_op = batch.num_ops;
+	}
+
+	if (ret) {
+		/* newest first, so rules go before what they point to */
+		for (i = n; i-- > 0; ) {
+			ipa3_batch_del_one(&ops[i]);
+			ops[i].hdl = 0;
+			ops[i].status = -1;
+		}
+		if (batch.failed_op == batch.num_ops &&
+			ipa3_batch_commit(hdr, rt, flt))
+			IPAERR("failed to restore tables after batch\n");
+	}
+
+	mutex_unlock(&ipa3_ctx->lock);
+
+copy_out:
+	IPADBG("batch of %u ops done, failed_op %u ret %d\n",
+		batch.num_ops, batch.failed_op, ret);
+
+	if (copy_to_user(u64_to_user_ptr(batch.ops), ops,
+		batch.num_ops * sizeof(*ops)) ||
+		copy_to_user((void __user *)arg, &batch, sizeof(batch)))
+		ret = -EFAULT;
+
+	kvfree(pylds);
+	kfree(ops);
+	return ret;
+}
+
 static int proc_sram_info_rqst(
 	unsigned long arg)
 {
@@ -4003,6 +4320,10 @@ static long ipa3_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		retval = ipa3_ioctl_mdfy_flt_rule_v2(arg);
 		break;
 
+	case IPA_IOC_BATCH:
+		retval = ipa3_ioctl_batch(arg);
+		break;
+
 	case IPA_IOC_FNR_COUNTER_ALLOC:
 		if (ipa3_ctx->ipa_hw_type < IPA_HW_v4_5) {
 			IPAERR("FNR stats not supported on IPA ver %d",
@@ -6609,6 +6930,7 @@ long compat_ipa3_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case IPA_IOC_PUT_HDR:
 	case IPA_IOC_SET_FLT:
 	case IPA_IOC_QUERY_EP_MAPPING:
+	case IPA_IOC_BATCH:
 		break;
 	default:
 		return -ENOIOCTLCMD;
@@ -6624,6 +6946,7 @@ static const struct file_operations ipa3_drv_fops = {
 	.owner = THIS_MODULE,
 	.open = ipa3_open,
 	.read = ipa3_read,
+	.poll = ipa3_poll,
 	.write = ipa3_write,
 	.unlocked_ioctl = ipa3_ioctl,
 #ifdef CONFIG_COMPAT
@@ -9664,6 +9987,14 @@ static int ipa3_pre_init(const struct ipa3_plat_drv_res *resource_p,
 		result = -ENOMEM;
 		goto fail_rx_pkt_wrapper_cache;
 	}
+	ipa3_ctx->push_msg_cache =
+	   kmem_cache_create("IPA_PUSH_MSG",
+			   sizeof(struct ipa3_push_msg), 0, 0, NULL);
+	if (!ipa3_ctx->push_msg_cache) {
+		IPAERR(":ipa push msg cache create failed\n");
+		result = -ENOMEM;
+		goto fail_push_msg_cache;
+	}
 
 	/* Init the various list heads for both SRAM/DDR */
 	for (hdr_tbl = HDR_TBL_LCL; hdr_tbl < HDR_TBLS_TOTAL; hdr_tbl++) {
@@ -9673,6 +10004,7 @@ static int ipa3_pre_init(const struct ipa3_plat_drv_res *resource_p,
 			INIT_LIST_HEAD(&ipa3_ctx->hdr_tbl[hdr_tbl].head_free_offset_list[i]);
 		}
 	}
+	hash_init(ipa3_ctx->hdr_name_hash);
 	INIT_LIST_HEAD(&ipa3_ctx->hdr_proc_ctx_tbl.head_proc_ctx_entry_list);
 	for (i = 0; i < IPA_HDR_PROC_CTX_BIN_MAX; i++) {
 		INIT_LIST_HEAD(
@@ -9681,8 +10013,10 @@ static int ipa3_pre_init(const struct ipa3_plat_drv_res *resource_p,
 			&ipa3_ctx->hdr_proc_ctx_tbl.head_free_offset_list[i]);
 	}
 	INIT_LIST_HEAD(&ipa3_ctx->rt_tbl_set[IPA_IP_v4].head_rt_tbl_list);
+	hash_init(ipa3_ctx->rt_tbl_set[IPA_IP_v4].name_hash);
 	idr_init(&ipa3_ctx->rt_tbl_set[IPA_IP_v4].rule_ids);
 	INIT_LIST_HEAD(&ipa3_ctx->rt_tbl_set[IPA_IP_v6].head_rt_tbl_list);
+	hash_init(ipa3_ctx->rt_tbl_set[IPA_IP_v6].name_hash);
 	idr_init(&ipa3_ctx->rt_tbl_set[IPA_IP_v6].rule_ids);
 
 	rset = &ipa3_ctx->reap_rt_tbl_set[IPA_IP_v4];
@@ -9812,6 +10146,11 @@ static int ipa3_pre_init(const struct ipa3_plat_drv_res *resource_p,
 		}
 	}
 
+	/* zero-copy RX sockets are optional, keep going without them */
+	result = ipa3_xsk_init();
+	if (result)
+		IPAERR("XSK init failed %d\n", result);
+
 	/*
 	 * for IPA 4.0 offline charge is not needed and we need to prevent
 	 * power collapse until IPA uC is loaded.
@@ -9878,6 +10217,7 @@ fail_rmnet_ctl_init:
 	ipa3_wwan_cleanup();
 fail_wwan_init:
 	ipa3_disable_napi_netdev();
+	ipa3_xsk_cleanup();
 	if (ipa3_ctx->ipa_hw_type >= IPA_HW_v4_1)
 		ipa_odl_cleanup();
 fail_odl_init:
@@ -9902,6 +10242,8 @@ fail_alloc_chrdev_region:
 	idr_destroy(&rset->rule_ids);
 	idr_destroy(&ipa3_ctx->rt_tbl_set[IPA_IP_v6].rule_ids);
 	idr_destroy(&ipa3_ctx->rt_tbl_set[IPA_IP_v4].rule_ids);
+	kmem_cache_destroy(ipa3_ctx->push_msg_cache);
+fail_push_msg_cache:
 	kmem_cache_destroy(ipa3_ctx->rx_pkt_wrapper_cache);
 fail_rx_pkt_wrapper_cache:
 	kmem_cache_destroy(ipa3_ctx->tx_pkt_wrapper_cache);
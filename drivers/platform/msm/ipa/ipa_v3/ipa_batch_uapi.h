@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-only WITH Linux-syscall-note
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#ifndef _IPA_BATCH_UAPI_H_
+#define _IPA_BATCH_UAPI_H_
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+#include <linux/msm_ipa.h>
+
+/*
+ * IPA_IOC_BATCH - add headers, processing contexts, routing and filtering
+ * rules in one call and commit them together. Not part of msm_ipa.h yet,
+ * so the ABI lives here until the UAPI header carries it; the guard keeps
+ * the two from clashing once it does.
+ */
+#ifndef IPA_IOC_BATCH
+#define IPA_IOCTL_BATCH 0xF0
+#define IPA_BATCH_MAX_OPS 256
+#define IPA_BATCH_NO_REF 0xFFFFFFFF
+
+/**
+ * enum ipa_batch_op_type - operations of IPA_IOC_BATCH
+ * @IPA_BATCH_OP_ADD_HDR: payload is struct ipa_hdr_add
+ * @IPA_BATCH_OP_ADD_HDR_PROC_CTX: payload is struct ipa_hdr_proc_ctx_add,
+ *  @ref may name an ADD_HDR op whose handle becomes hdr_hdl
+ * @IPA_BATCH_OP_ADD_RT_RULE: payload is struct ipa_rt_rule_add_v2 layout,
+ *  @ref may name an ADD_HDR or ADD_HDR_PROC_CTX op whose handle becomes
+ *  hdr_hdl or hdr_proc_ctx_hdl
+ * @IPA_BATCH_OP_ADD_FLT_RULE: payload is struct ipa_flt_rule_add_v2 layout,
+ *  @ref may name an ADD_RT_RULE op whose table becomes rt_tbl_hdl
+ */
+enum ipa_batch_op_type {
+	IPA_BATCH_OP_ADD_HDR = 1,
+	IPA_BATCH_OP_ADD_HDR_PROC_CTX,
+	IPA_BATCH_OP_ADD_RT_RULE,
+	IPA_BATCH_OP_ADD_FLT_RULE,
+};
+
+/**
+ * struct ipa_ioc_batch_op - one operation of IPA_IOC_BATCH
+ * @type: enum ipa_batch_op_type
+ * @ip: IP family of RT and FLT rules
+ * @ref: index of an earlier op of the same batch, or IPA_BATCH_NO_REF
+ * @pyld_size: size of the payload, RT and FLT payloads may be shorter than
+ *  the kernel structure like with the _V2 ioctls
+ * @rt_tbl_name: routing table of an ADD_RT_RULE op
+ * @ep: pipe of an ADD_FLT_RULE op
+ * @hdl: output, handle of the added object
+ * @status: output, 0 when the op is applied
+ * @reserved: must be zero
+ * @pyld: user pointer to the payload
+ */
+struct ipa_ioc_batch_op {
+	__u32 type;
+	__u32 ip;
+	__u32 ref;
+	__u32 pyld_size;
+	char rt_tbl_name[IPA_RESOURCE_NAME_MAX];
+	__u32 ep;
+	__u32 hdl;
+	__s32 status;
+	__u32 reserved;
+	__u64 pyld;
+};
+
+/**
+ * struct ipa_ioc_batch - IPA_IOC_BATCH argument
+ * @num_ops: number of entries in @ops, up to IPA_BATCH_MAX_OPS
+ * @failed_op: output, index of the op that failed, num_ops if the commit
+ *  failed, IPA_BATCH_NO_REF on success
+ * @ops: user pointer to an array of struct ipa_ioc_batch_op
+ *
+ * Either every op is applied and committed, or none is. The batch holds
+ * the driver lock throughout, so no other commit can publish part of it.
+ */
+struct ipa_ioc_batch {
+	__u32 num_ops;
+	__u32 failed_op;
+	__u64 ops;
+};
+
+#define IPA_IOC_BATCH _IOWR(IPA_IOC_MAGIC, \
+				IPA_IOCTL_BATCH, \
+				struct ipa_ioc_batch)
+#endif
+
+#endif /* _IPA_BATCH_UAPI_H_ */
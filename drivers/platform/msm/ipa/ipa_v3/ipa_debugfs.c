@@ -1272,6 +1272,63 @@ bail:
 	return res;
 }
 
+static ssize_t ipa3_read_hdr_stats(struct file *file, char __user *ubuf,
+		size_t count, loff_t *ppos)
+{
+	int nbytes = 0;
+	int i;
+	struct ipa3_hdr_entry *entry;
+	struct ipa_hdr_offset_entry *offset_entry;
+	struct ipa3_hdr_alloc_stats *stats = &ipa3_ctx->hdr_alloc_stats;
+	enum hdr_tbl_storage hdr_tbl;
+	u32 used, hdrs, refs;
+	u32 tbl_refs[HDR_TBLS_TOTAL] = {0};
+	u32 total_refs;
+
+	mutex_lock(&ipa3_ctx->lock);
+
+	for (hdr_tbl = HDR_TBL_LCL; hdr_tbl < HDR_TBLS_TOTAL; hdr_tbl++) {
+		used = 0;
+		for (i = 0; i < IPA_HDR_BIN_MAX; i++)
+			list_for_each_entry(offset_entry,
+				&ipa3_ctx->hdr_tbl[hdr_tbl].head_offset_list[i],
+				link)
+				used += ipa3_get_hdr_bin_size(i);
+
+		hdrs = 0;
+		refs = 0;
+		list_for_each_entry(entry,
+			&ipa3_ctx->hdr_tbl[hdr_tbl].head_hdr_entry_list, link) {
+			if (entry->cookie != IPA_HDR_COOKIE)
+				continue;
+			hdrs++;
+			/* the own reference is the only one which is not a rule */
+			refs += entry->ref_cnt ? entry->ref_cnt - 1 : 0;
+		}
+		tbl_refs[hdr_tbl] = refs;
+
+		nbytes += scnprintf(dbg_buff + nbytes, IPA_MAX_MSG_LEN - nbytes,
+			"%s: hdrs=%u rule_refs=%u used=%u end=%u size=%u\n",
+			hdr_tbl == HDR_TBL_LCL ? "SRAM" : "DDR",
+			hdrs, refs, used, ipa3_ctx->hdr_tbl[hdr_tbl].end,
+			hdr_tbl == HDR_TBL_LCL ? IPA_MEM_PART(apps_hdr_size) :
+			IPA_MEM_PART(apps_hdr_size_ddr));
+	}
+
+	total_refs = tbl_refs[HDR_TBL_LCL] + tbl_refs[HDR_TBL_SYS];
+	nbytes += scnprintf(dbg_buff + nbytes, IPA_MAX_MSG_LEN - nbytes,
+		"local hit rate=%u%%\n"
+		"best_fit=%u spilled=%u migrated=%u rebinned=%u\n"
+		"rt_recommit=%u retired=%u\n",
+		total_refs ? tbl_refs[HDR_TBL_LCL] * 100 / total_refs : 100,
+		stats->best_fit, stats->spilled, stats->migrated,
+		stats->rebinned, stats->rt_recommit, stats->retired);
+
+	mutex_unlock(&ipa3_ctx->lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
+
 static ssize_t ipa3_read_proc_ctx(struct file *file, char __user *ubuf,
 		size_t count, loff_t *ppos)
 {
@@ -1631,6 +1688,23 @@ static ssize_t ipa3_read_odlstats(struct file *file, char __user *ubuf,
 
 	cnt += nbytes;
 
+	mutex_lock(&ipa3_odl_ctx->adpl_msg_lock);
+	if (ipa3_odl_ctx->adpl_ring) {
+		struct ipa_odl_ring_ctrl *ctrl = ipa3_odl_ctx->adpl_ring->ctrl;
+
+		nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"ODL ring size =%u\n"
+			"ODL ring used bytes =%llu\n"
+			"ODL ring produced pkt =%llu\n"
+			"ODL ring dropped pkt =%llu\n",
+			ipa3_odl_ctx->adpl_ring->data_size,
+			READ_ONCE(ctrl->head) - READ_ONCE(ctrl->tail),
+			ctrl->produced_pkts,
+			ctrl->dropped_pkts);
+		cnt += nbytes;
+	}
+	mutex_unlock(&ipa3_odl_ctx->adpl_msg_lock);
+
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
 
@@ -1684,6 +1758,35 @@ static ssize_t ipa3_read_page_recycle_stats(struct file *file,
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
 
+static ssize_t ipa3_read_rx_hook_stats(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct ipa3_sys_context *sys;
+	int nbytes;
+	int cnt = 0, i;
+
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		sys = ipa3_ctx->ep[i].sys;
+		if (!ipa3_ctx->ep[i].valid || !sys ||
+			!IPA_CLIENT_IS_CONS(ipa3_ctx->ep[i].client) ||
+			!sys->page_recycle_repl)
+			continue;
+
+		nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"%s: hook=%s pass=%llu drop=%llu tx=%llu tx_err=%llu aborted=%llu\n",
+			ipa_clients_strings[ipa3_ctx->ep[i].client],
+			rcu_access_pointer(sys->rx_hook) ? "on" : "off",
+			sys->rx_hook_pass,
+			sys->rx_hook_drop,
+			sys->rx_hook_tx,
+			sys->rx_hook_tx_err,
+			sys->rx_hook_aborted);
+		cnt += nbytes;
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
 static ssize_t ipa3_read_lan_coal_stats(
 	struct file *file,
 	char __user *ubuf,
@@ -3751,6 +3854,10 @@ static const struct ipa3_debugfs_file debugfs_files[] = {
 		"hdr", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_hdr,
 		}
+	}, {
+		"hdr_stats", IPA_READ_ONLY_MODE, NULL, {
+			.read = ipa3_read_hdr_stats,
+		}
 	}, {
 		"proc_ctx", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_proc_ctx,
@@ -3811,6 +3918,10 @@ static const struct ipa3_debugfs_file debugfs_files[] = {
 		"page_recycle_stats", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_page_recycle_stats,
 		}
+	}, {
+		"rx_hook_stats", IPA_READ_ONLY_MODE, NULL, {
+			.read = ipa3_read_rx_hook_stats,
+		}
 	}, {
 		"lan_coal_stats", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_lan_coal_stats,
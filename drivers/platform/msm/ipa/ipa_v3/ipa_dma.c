@@ -23,6 +23,7 @@
 #define IPA_DMA_MAX_PKT_SZ 0xFFFF
 #define IPA_DMA_DUMMY_BUFF_SZ 8
 #define IPA_DMA_PREFETCH_WA_THRESHOLD 9
+#define IPA_DMA_BATCH_MAX_SEGS 512
 
 #define IPADMA_DRV_NAME "ipa_dma"
 
@@ -89,6 +90,8 @@ static void ipa3_dma_debugfs_destroy(void) {}
  * @total_sync_memcpy: total number of sync memcpy (statistics)
  * @total_async_memcpy: total number of async memcpy (statistics)
  * @total_uc_memcpy: total number of uc memcpy (statistics)
+ * @total_batch_memcpy: total number of completed async memcpy batches
+ *  (statistics)
  */
 struct ipa3_dma_ctx {
 	unsigned int enable_ref_cnt;
@@ -109,6 +112,7 @@ struct ipa3_dma_ctx {
 	atomic_t total_sync_memcpy;
 	atomic_t total_async_memcpy;
 	atomic_t total_uc_memcpy;
+	atomic_t total_batch_memcpy;
 	struct ipa_mem_buffer ipa_dma_dummy_src_sync;
 	struct ipa_mem_buffer ipa_dma_dummy_dst_sync;
 	struct ipa_mem_buffer ipa_dma_dummy_src_async;
@@ -266,6 +270,7 @@ int ipa3_dma_init(void)
 	atomic_set(&ipa_dma_ctx_t->total_async_memcpy, 0);
 	atomic_set(&ipa_dma_ctx_t->total_sync_memcpy, 0);
 	atomic_set(&ipa_dma_ctx_t->total_uc_memcpy, 0);
+	atomic_set(&ipa_dma_ctx_t->total_batch_memcpy, 0);
 
 	sync_sz = IPA_SYS_DESC_FIFO_SZ;
 	async_sz = IPA_DMA_SYS_DESC_MAX_FIFO_SZ;
@@ -947,6 +952,285 @@ fail_mem_alloc:
 	return res;
 }
 
+/**
+ * struct ipa3_dma_batch - completion context of a batched async memcpy
+ * @entries: client entries, status is set on completion
+ * @num: number of entries
+ * @user_cb: client completion callback
+ * @user1: cookie for user_cb
+ */
+struct ipa3_dma_batch {
+	struct ipa3_dma_memcpy_entry *entries;
+	u32 num;
+	void (*user_cb)(void *user1, struct ipa3_dma_memcpy_entry *entries,
+		u32 num);
+	void *user1;
+};
+
+static int ipa3_dma_batch_validate(struct ipa3_dma_memcpy_entry *entries,
+	u32 num, u32 *num_segs)
+{
+	u32 i;
+	int res = 0;
+
+	*num_segs = 0;
+	for (i = 0; i < num; i++) {
+		entries[i].status = 0;
+		if (!entries[i].len ||
+			(max(entries[i].src, entries[i].dest) -
+			min(entries[i].src, entries[i].dest)) < entries[i].len) {
+			IPADMA_ERR("invalid entry %u len %u\n",
+				i, entries[i].len);
+			entries[i].status = -EINVAL;
+			res = -EINVAL;
+			continue;
+		}
+		*num_segs += DIV_ROUND_UP(entries[i].len, IPA_DMA_MAX_PKT_SZ);
+	}
+
+	if (!res && *num_segs > IPA_DMA_BATCH_MAX_SEGS) {
+		IPADMA_ERR("too many segments %u\n", *num_segs);
+		res = -EINVAL;
+	}
+
+	return res;
+}
+
+static void ipa3_dma_batch_done(void *user1)
+{
+	struct ipa3_dma_batch *batch = user1;
+
+	atomic_inc(&ipa3_dma_ctx->total_batch_memcpy);
+	batch->user_cb(batch->user1, batch->entries, batch->num);
+	kfree(batch);
+}
+
+/**
+ * ipa3_dma_async_memcpy_batch()- Perform a list of asynchronous memcpy
+ * using IPA with a single doorbell per pipe.
+ *
+ * @entries: copies to perform, must stay valid until user_cb is called.
+ *	Entries longer than the max IPADMA packet size are split.
+ * @num: number of entries.
+ * @user_cb: callback function to notify the client when all the copies
+ *	were done, called once per batch.
+ * @user_param: cookie for user_cb.
+ *
+ * Each entry status is set to -EINVAL if the entry is rejected, in which
+ * case nothing is queued, or to 0 before user_cb is called.
+ *
+ * Return codes: 0: success
+ *		-EINVAL: invalid params
+ *		-EPERM: operation not permitted as ipa_dma isn't enable or
+ *			initialized
+ *		-gsi_status : on GSI failures
+ *		-EFAULT: pipes are not mapped
+ */
+int ipa3_dma_async_memcpy_batch(struct ipa3_dma_memcpy_entry *entries,
+	u32 num, void (*user_cb)(void *user1,
+	struct ipa3_dma_memcpy_entry *entries, u32 num), void *user_param)
+{
+	int ep_idx;
+	int res;
+	u32 num_segs;
+	u32 i, n = 0, nc = 0, np = 0;
+	u32 off, seg = 0;
+	struct ipa3_dma_batch *batch = NULL;
+	struct ipa3_dma_xfer_wrapper **xfer_descr = NULL;
+	struct ipa3_sys_context *prod_sys;
+	struct ipa3_sys_context *cons_sys;
+	struct gsi_xfer_elem *cons_elem = NULL;
+	struct gsi_xfer_elem *prod_elem = NULL;
+	unsigned long flags;
+	bool prefetch_wa;
+
+	IPADMA_FUNC_ENTRY();
+	if (ipa3_dma_ctx == NULL) {
+		IPADMA_ERR("IPADMA isn't initialized, can't memcpy\n");
+		return -EPERM;
+	}
+	if (!entries || !num || !user_cb) {
+		IPADMA_ERR("invalid params entries=%pK num=%u user_cb=%pK\n",
+			entries, num, user_cb);
+		return -EINVAL;
+	}
+	res = ipa3_dma_batch_validate(entries, num, &num_segs);
+	if (res)
+		return res;
+	IPADMA_DBG_LOW("num = %u, num_segs = %u\n", num, num_segs);
+
+	spin_lock_irqsave(&ipa3_dma_ctx->pending_lock, flags);
+	if (!ipa3_dma_ctx->enable_ref_cnt) {
+		IPADMA_ERR("can't memcpy, IPA_DMA isn't enabled\n");
+		spin_unlock_irqrestore(&ipa3_dma_ctx->pending_lock, flags);
+		return -EPERM;
+	}
+	atomic_add(num_segs, &ipa3_dma_ctx->async_memcpy_pending_cnt);
+	spin_unlock_irqrestore(&ipa3_dma_ctx->pending_lock, flags);
+
+	ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_MEMCPY_DMA_ASYNC_CONS);
+	if (-1 == ep_idx) {
+		IPADMA_ERR("Client %u is not mapped\n",
+			IPA_CLIENT_MEMCPY_DMA_ASYNC_CONS);
+		res = -EFAULT;
+		goto fail_mem_alloc;
+	}
+	cons_sys = ipa3_ctx->ep[ep_idx].sys;
+
+	ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_MEMCPY_DMA_ASYNC_PROD);
+	if (-1 == ep_idx) {
+		IPADMA_ERR("Client %u is not mapped\n",
+			IPA_CLIENT_MEMCPY_DMA_ASYNC_PROD);
+		res = -EFAULT;
+		goto fail_mem_alloc;
+	}
+	prod_sys = ipa3_ctx->ep[ep_idx].sys;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	xfer_descr = kcalloc(num_segs, sizeof(*xfer_descr), GFP_KERNEL);
+	/* prefetch WA may chain a dummy element to every segment */
+	cons_elem = kcalloc(num_segs * 2, sizeof(*cons_elem), GFP_KERNEL);
+	prod_elem = kcalloc(num_segs * 2, sizeof(*prod_elem), GFP_KERNEL);
+	if (!batch || !xfer_descr || !cons_elem || !prod_elem) {
+		res = -ENOMEM;
+		goto fail_mem_alloc;
+	}
+	batch->entries = entries;
+	batch->num = num;
+	batch->user_cb = user_cb;
+	batch->user1 = user_param;
+
+	for (n = 0; n < num_segs; n++) {
+		xfer_descr[n] = kmem_cache_zalloc(
+			ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache, GFP_KERNEL);
+		if (!xfer_descr[n]) {
+			res = -ENOMEM;
+			goto fail_mem_alloc;
+		}
+	}
+
+	n = 0;
+	for (i = 0; i < num; i++) {
+		for (off = 0; off < entries[i].len; off += seg) {
+			seg = min_t(u32, entries[i].len - off,
+				IPA_DMA_MAX_PKT_SZ);
+			xfer_descr[n]->phys_addr_dest = entries[i].dest + off;
+			xfer_descr[n]->phys_addr_src = entries[i].src + off;
+			xfer_descr[n]->len = seg;
+
+			/* same chaining as ipa3_dma_async_memcpy() */
+			prefetch_wa = ((ipa_get_hw_type() == IPA_HW_v3_5) &&
+				seg < IPA_DMA_PREFETCH_WA_THRESHOLD);
+
+			cons_elem[nc].addr = entries[i].dest + off;
+			cons_elem[nc].len = seg;
+			cons_elem[nc].type = GSI_XFER_ELEM_DATA;
+			cons_elem[nc].flags = GSI_XFER_FLAG_EOT;
+			prod_elem[np].addr = entries[i].src + off;
+			prod_elem[np].len = seg;
+			prod_elem[np].type = GSI_XFER_ELEM_DATA;
+			if (prefetch_wa) {
+				prod_elem[np++].flags = GSI_XFER_FLAG_CHAIN;
+				nc++;
+				cons_elem[nc].addr =
+				ipa3_dma_ctx->ipa_dma_dummy_dst_async.phys_base;
+				cons_elem[nc].len = IPA_DMA_DUMMY_BUFF_SZ;
+				cons_elem[nc].type = GSI_XFER_ELEM_DATA;
+				cons_elem[nc].flags = GSI_XFER_FLAG_EOT;
+				prod_elem[np].addr =
+				ipa3_dma_ctx->ipa_dma_dummy_src_async.phys_base;
+				prod_elem[np].len = IPA_DMA_DUMMY_BUFF_SZ;
+				prod_elem[np].type = GSI_XFER_ELEM_DATA;
+			}
+			cons_elem[nc++].xfer_user_data = xfer_descr[n++];
+			prod_elem[np++].flags = GSI_XFER_FLAG_EOT;
+		}
+	}
+	xfer_descr[num_segs - 1]->callback = ipa3_dma_batch_done;
+	xfer_descr[num_segs - 1]->user1 = batch;
+
+	spin_lock_irqsave(&ipa3_dma_ctx->async_lock, flags);
+	for (n = 0; n < num_segs; n++)
+		list_add_tail(&xfer_descr[n]->link, &cons_sys->head_desc_list);
+	cons_sys->len += num_segs;
+
+	res = gsi_queue_xfer(cons_sys->ep->gsi_chan_hdl, nc, cons_elem, true);
+	if (res) {
+		IPADMA_ERR("Failed: gsi_queue_xfer on dest descrs res: %d\n",
+			res);
+		goto fail_send;
+	}
+	res = gsi_queue_xfer(prod_sys->ep->gsi_chan_hdl, np, prod_elem, true);
+	if (res) {
+		IPADMA_ERR("Failed: gsi_queue_xfer on src descrs res: %d\n",
+			res);
+		ipa_assert();
+		goto fail_send;
+	}
+	spin_unlock_irqrestore(&ipa3_dma_ctx->async_lock, flags);
+
+	kfree(prod_elem);
+	kfree(cons_elem);
+	kfree(xfer_descr);
+	IPADMA_FUNC_EXIT();
+	return 0;
+
+fail_send:
+	for (n = 0; n < num_segs; n++)
+		list_del(&xfer_descr[n]->link);
+	cons_sys->len -= num_segs;
+	spin_unlock_irqrestore(&ipa3_dma_ctx->async_lock, flags);
+fail_mem_alloc:
+	if (xfer_descr) {
+		for (i = 0; i < n; i++)
+			kmem_cache_free(
+				ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache,
+				xfer_descr[i]);
+	}
+	kfree(prod_elem);
+	kfree(cons_elem);
+	kfree(xfer_descr);
+	kfree(batch);
+	atomic_sub(num_segs, &ipa3_dma_ctx->async_memcpy_pending_cnt);
+	if (ipa3_dma_ctx->destroy_pending && !ipa3_dma_work_pending())
+		complete(&ipa3_dma_ctx->done);
+	return res;
+}
+
+static void ipa3_dma_memcpy_sg_cb(void *user1,
+	struct ipa3_dma_memcpy_entry *entries, u32 num)
+{
+	complete((struct completion *)user1);
+}
+
+/**
+ * ipa3_dma_memcpy_sg()- Perform a list of memcpy using IPA and wait for
+ * all of them to complete.
+ *
+ * @entries: copies to perform, entries longer than the max IPADMA packet
+ *	size are split.
+ * @num: number of entries.
+ *
+ * The list is queued with ipa3_dma_async_memcpy_batch() and the caller
+ * sleeps once for the whole list instead of polling per copy.
+ *
+ * Return codes: same as ipa3_dma_async_memcpy_batch()
+ */
+int ipa3_dma_memcpy_sg(struct ipa3_dma_memcpy_entry *entries, u32 num)
+{
+	struct completion done;
+	int res;
+
+	init_completion(&done);
+	res = ipa3_dma_async_memcpy_batch(entries, num,
+		ipa3_dma_memcpy_sg_cb, &done);
+	if (res)
+		return res;
+
+	wait_for_completion(&done);
+	return 0;
+}
+
 /**
  * ipa3_dma_uc_memcpy() - Perform a memcpy action using IPA uC
  * @dest: physical address to store the copied data.
@@ -1109,7 +1393,9 @@ void ipa3_dma_async_memcpy_notify_cb(void *priv
 	spin_unlock_irqrestore(&ipa3_dma_ctx->async_lock, flags);
 	atomic_inc(&ipa3_dma_ctx->total_async_memcpy);
 	atomic_dec(&ipa3_dma_ctx->async_memcpy_pending_cnt);
-	xfer_descr_expected->callback(xfer_descr_expected->user1);
+	/* only the last segment of a batch carries a callback */
+	if (xfer_descr_expected->callback)
+		xfer_descr_expected->callback(xfer_descr_expected->user1);
 
 	kmem_cache_free(ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache,
 		xfer_descr_expected);
@@ -1209,6 +1495,10 @@ static ssize_t ipa3_dma_debugfs_read(struct file *file, char __user *ubuf,
 			IPADMA_MAX_MSG_LEN - nbytes,
 			"total uc memcpy: %d\n	",
 			atomic_read(&ipa3_dma_ctx->total_uc_memcpy));
+		nbytes += scnprintf(&dbg_buff[nbytes],
+			IPADMA_MAX_MSG_LEN - nbytes,
+			"total async memcpy batches: %d\n	",
+			atomic_read(&ipa3_dma_ctx->total_batch_memcpy));
 		nbytes += scnprintf(&dbg_buff[nbytes],
 			IPADMA_MAX_MSG_LEN - nbytes,
 			"pending sync memcpy jobs: %d\n	",
@@ -1246,6 +1536,7 @@ static ssize_t ipa3_dma_debugfs_reset_statistics(struct file *file,
 
 		atomic_set(&ipa3_dma_ctx->total_async_memcpy, 0);
 		atomic_set(&ipa3_dma_ctx->total_sync_memcpy, 0);
+		atomic_set(&ipa3_dma_ctx->total_batch_memcpy, 0);
 		break;
 	default:
 		IPADMA_ERR("invalid argument: To reset statistics echo 0\n");
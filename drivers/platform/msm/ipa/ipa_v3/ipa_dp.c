@@ -27,6 +27,7 @@
 #include "ipahal.h"
 #include "ipahal_fltrt.h"
 #include "ipa_stats.h"
+#include "ipa_xsk.h"
 
 #define IPA_GSI_EVENT_RP_SIZE 8
 #define IPA_WAN_NAPI_MAX_FRAMES (NAPI_WEIGHT / IPA_WAN_AGGR_PKT_CNT)
@@ -1114,6 +1115,8 @@ static int ipa3_handle_rx_core(struct ipa3_sys_context *sys, bool process_all,
 
 		if (IPA_CLIENT_IS_MEMCPY_DMA_CONS(sys->ep->client))
 			ipa3_dma_memcpy_notify(sys);
+		else if (sys->xsk)
+			ipa3_xsk_rx(sys, &notify);
 		else if (IPA_CLIENT_IS_WLAN_CONS(sys->ep->client))
 			ipa3_wlan_wq_rx_common(sys, &notify);
 		else
@@ -1449,20 +1452,8 @@ static void ipa3_tasklet_find_freepage(unsigned long data)
 
 }
 
-/**
- * ipa3_setup_sys_pipe() - Setup an IPA GPI pipe and perform
- * IPA EP configuration
- * @sys_in:	[in] input needed to setup the pipe and configure EP
- * @clnt_hdl:	[out] client handle
- *
- *  - configure the end-point registers with the supplied
- *    parameters from the user.
- *  - Creates a GPI connection with IPA.
- *  - allocate descriptor FIFO
- *
- * Returns:	0 on success, negative on failure
- */
-int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
+static int __ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in,
+	u32 *clnt_hdl, struct ipa3_xsk_pool *xsk)
 {
 	struct ipa3_ep_context *ep;
 	int i, ipa_ep_idx;
@@ -1677,6 +1668,7 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	}
 
 	ep->client = sys_in->client;
+	ep->sys->xsk = xsk;
 	ep->sys->ext_ioctl_v2 = sys_in->ext_ioctl_v2;
 	ep->sys->int_modt = sys_in->int_modt;
 	ep->sys->int_modc = sys_in->int_modc;
@@ -1827,7 +1819,9 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	}
 
 	if (IPA_CLIENT_IS_CONS(sys_in->client)) {
-		if ((IPA_CLIENT_IS_WAN_CONS(sys_in->client) ||
+		if (ep->sys->xsk) {
+			ipa3_xsk_replenish(ep->sys);
+		} else if ((IPA_CLIENT_IS_WAN_CONS(sys_in->client) ||
 			sys_in->client ==
 			IPA_CLIENT_APPS_WAN_LOW_LAT_DATA_CONS) &&
 			ipa3_ctx->ipa_wan_skb_page) {
@@ -1965,6 +1959,47 @@ fail_gen:
 	return result;
 }
 
+/**
+ * ipa3_setup_sys_pipe() - Setup an IPA GPI pipe and perform
+ * IPA EP configuration
+ * @sys_in:	[in] input needed to setup the pipe and configure EP
+ * @clnt_hdl:	[out] client handle
+ *
+ *  - configure the end-point registers with the supplied
+ *    parameters from the user.
+ *  - Creates a GPI connection with IPA.
+ *  - allocate descriptor FIFO
+ *
+ * Returns:	0 on success, negative on failure
+ */
+int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
+{
+	return __ipa3_setup_sys_pipe(sys_in, clnt_hdl, NULL);
+}
+
+/**
+ * ipa3_setup_xsk_pipe() - Setup a consumer pipe whose RX buffers are the
+ * frames of a zero-copy RX socket
+ * @sys_in:	[in] input needed to setup the pipe and configure EP
+ * @xsk:	[in] pool providing the RX frames
+ * @clnt_hdl:	[out] client handle
+ *
+ * Completions are posted to the pool's RX ring instead of being turned
+ * into skbs. Tear the pipe down with ipa3_teardown_sys_pipe().
+ *
+ * Returns:	0 on success, negative on failure
+ */
+int ipa3_setup_xsk_pipe(struct ipa_sys_connect_params *sys_in,
+	struct ipa3_xsk_pool *xsk, u32 *clnt_hdl)
+{
+	if (!xsk || !sys_in || !IPA_CLIENT_IS_CONS(sys_in->client)) {
+		IPAERR("bad parm\n");
+		return -EINVAL;
+	}
+
+	return __ipa3_setup_sys_pipe(sys_in, clnt_hdl, xsk);
+}
+
 static void delete_avail_tx_wrapper_list(struct ipa3_ep_context *ep)
 {
 	struct ipa3_tx_pkt_wrapper *tx_pkt_iterator = NULL;
@@ -5338,6 +5373,108 @@ static struct sk_buff *handle_skb_completion(
 	return rx_skb;
 }
 
+/**
+ * ipa3_rx_page_drop() - return an RX page without building an skb
+ * @rx_pkt: rx wrapper that owns the page, already unlinked
+ *
+ * Recycled pages go back to the head of the page cache so they are
+ * reused first; temporary pages are unmapped and freed.
+ */
+static void ipa3_rx_page_drop(struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	struct ipa_rx_page_data rx_page = rx_pkt->page_data;
+
+	if (!rx_page.is_tmp_alloc) {
+		init_page_count(rx_page.page);
+		spin_lock_bh(&rx_pkt->sys->common_sys->spinlock);
+		/* Add the element to head. */
+		list_add(&rx_pkt->link,
+			&rx_pkt->sys->page_recycle_repl->page_repl_head);
+		spin_unlock_bh(&rx_pkt->sys->common_sys->spinlock);
+	} else {
+		dma_unmap_page(ipa3_ctx->pdev, rx_page.dma_addr,
+				rx_pkt->len, DMA_FROM_DEVICE);
+		__free_pages(rx_page.page, rx_page.page_order);
+	}
+	rx_pkt->sys->free_rx_wrapper(rx_pkt);
+}
+
+/**
+ * ipa3_rx_hook_run() - run the pipe RX hook on a single-page transfer
+ * @sys: consumer pipe context
+ * @rx_pkt: rx wrapper of the completed transfer, still on the pending list
+ * @offset: [out] offset of the (possibly trimmed) data in the page
+ * @tx_client: [out] producer pipe for IPA_RX_HOOK_TX
+ *
+ * Runs before any skb is allocated. On IPA_RX_HOOK_DROP, or when the hook
+ * hands back a buffer outside the received data, the page is recycled
+ * here and the caller must not touch @rx_pkt again.
+ *
+ * Return: the verdict the caller should apply
+ */
+static enum ipa_rx_hook_verdict ipa3_rx_hook_run(
+	struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt,
+	u32 *offset,
+	enum ipa_client_type *tx_client)
+{
+	struct ipa_rx_hook_buff buff;
+	enum ipa_rx_hook_verdict verdict;
+	ipa_rx_hook_fn hook;
+	void *va;
+
+	rcu_read_lock();
+	hook = rcu_dereference(sys->rx_hook);
+	if (!hook) {
+		rcu_read_unlock();
+		return IPA_RX_HOOK_PASS;
+	}
+
+	dma_sync_single_for_cpu(ipa3_ctx->pdev, rx_pkt->page_data.dma_addr,
+		rx_pkt->len, DMA_FROM_DEVICE);
+	va = page_address(rx_pkt->page_data.page);
+	buff.data = va;
+	buff.len = rx_pkt->data_len;
+	buff.tx_client = IPA_CLIENT_MAX;
+	verdict = hook(sys->rx_hook_priv, &buff);
+	rcu_read_unlock();
+
+	if (verdict == IPA_RX_HOOK_DROP)
+		goto drop;
+
+	if (unlikely(buff.data < va || buff.len == 0 ||
+		buff.data + buff.len > va + rx_pkt->data_len)) {
+		IPAERR_RL("rx hook returned bad buffer on %s\n",
+			ipa_clients_strings[sys->ep->client]);
+		sys->rx_hook_aborted++;
+		goto drop_page;
+	}
+
+	if (verdict == IPA_RX_HOOK_TX) {
+		if (unlikely(buff.tx_client >= IPA_CLIENT_MAX ||
+			!IPA_CLIENT_IS_PROD(buff.tx_client))) {
+			IPAERR_RL("rx hook bad tx client %d\n", buff.tx_client);
+			sys->rx_hook_aborted++;
+			goto drop_page;
+		}
+		*tx_client = buff.tx_client;
+		sys->rx_hook_tx++;
+	} else {
+		sys->rx_hook_pass++;
+	}
+
+	*offset = buff.data - va;
+	rx_pkt->data_len = buff.len;
+	return verdict;
+
+drop:
+	sys->rx_hook_drop++;
+drop_page:
+	list_del_init(&rx_pkt->link);
+	ipa3_rx_page_drop(rx_pkt);
+	return IPA_RX_HOOK_DROP;
+}
+
 /**
  * handle_page_completion()- Handle event completion EOB or EOT
  * and prep the skb
@@ -5357,6 +5494,10 @@ static struct sk_buff *handle_page_completion(struct gsi_chan_xfer_notify
 	struct list_head *head;
 	struct ipa3_sys_context *sys;
 	struct ipa_rx_page_data rx_page;
+	enum ipa_rx_hook_verdict verdict = IPA_RX_HOOK_PASS;
+	enum ipa_client_type tx_client = IPA_CLIENT_MAX;
+	bool hook_ran = false;
+	u32 offset = 0;
 	int size;
 
 	sys = (struct ipa3_sys_context *) notify->chan_user_data;
@@ -5376,19 +5517,7 @@ static struct sk_buff *handle_page_completion(struct gsi_chan_xfer_notify
 
 	if (notify->veid >= GSI_VEID_MAX) {
 		IPAERR("notify->veid > GSI_VEID_MAX\n");
-		if (!rx_page.is_tmp_alloc) {
-			init_page_count(rx_page.page);
-			spin_lock_bh(&rx_pkt->sys->common_sys->spinlock);
-			/* Add the element to head. */
-			list_add(&rx_pkt->link,
-				&rx_pkt->sys->page_recycle_repl->page_repl_head);
-			spin_unlock_bh(&rx_pkt->sys->common_sys->spinlock);
-		} else {
-			dma_unmap_page(ipa3_ctx->pdev, rx_page.dma_addr,
-					rx_pkt->len, DMA_FROM_DEVICE);
-			__free_pages(rx_pkt->page_data.page, rx_pkt->page_data.page_order);
-		}
-		rx_pkt->sys->free_rx_wrapper(rx_pkt);
+		ipa3_rx_page_drop(rx_pkt);
 		IPA_STATS_INC_CNT(ipa3_ctx->stats.rx_page_drop_cnt);
 		return NULL;
 	}
@@ -5401,6 +5530,19 @@ static struct sk_buff *handle_page_completion(struct gsi_chan_xfer_notify
 	/* Check added for handling LAN consumer packet without EOT flag */
 	if (notify->evt_id == GSI_CHAN_EVT_EOT ||
 		sys->ep->client == IPA_CLIENT_APPS_LAN_CONS) {
+		/*
+		 * The hook only sees complete single-page transfers, so a
+		 * dropped packet never costs an skb allocation.
+		 */
+		if (unlikely(rcu_access_pointer(sys->rx_hook)) &&
+			list_is_singular(head)) {
+			verdict = ipa3_rx_hook_run(sys, rx_pkt, &offset,
+				&tx_client);
+			if (verdict == IPA_RX_HOOK_DROP)
+				return NULL;
+			hook_ran = true;
+		}
+
 		rx_skb = alloc_skb(0, GFP_ATOMIC);
 		if (unlikely(!rx_skb)) {
 			IPAERR("skb alloc failure, free all pending pages\n");
@@ -5439,15 +5581,17 @@ static struct sk_buff *handle_page_completion(struct gsi_chan_xfer_notify
 				list_add_tail(&rx_pkt->link,
 					&rx_pkt->sys->page_recycle_repl->page_repl_head);
 				spin_unlock_bh(&rx_pkt->sys->common_sys->spinlock);
-				dma_sync_single_for_cpu(ipa3_ctx->pdev,
-					rx_page.dma_addr,
-					rx_pkt->len, DMA_FROM_DEVICE);
+				/* already synced if the rx hook looked at it */
+				if (!hook_ran)
+					dma_sync_single_for_cpu(ipa3_ctx->pdev,
+						rx_page.dma_addr,
+						rx_pkt->len, DMA_FROM_DEVICE);
 			}
 			rx_pkt->sys->free_rx_wrapper(rx_pkt);
 
 			skb_add_rx_frag(rx_skb,
 				skb_shinfo(rx_skb)->nr_frags,
-				rx_page.page, 0,
+				rx_page.page, offset,
 				size,
 				PAGE_SIZE << rx_page.page_order);
 
@@ -5458,6 +5602,14 @@ static struct sk_buff *handle_page_completion(struct gsi_chan_xfer_notify
 	} else {
 		return NULL;
 	}
+
+	if (verdict == IPA_RX_HOOK_TX) {
+		if (ipa3_tx_dp(tx_client, rx_skb, NULL)) {
+			sys->rx_hook_tx_err++;
+			dev_kfree_skb_any(rx_skb);
+		}
+		return NULL;
+	}
 	return rx_skb;
 }
 
@@ -5748,6 +5900,22 @@ static int ipa3_assign_policy(struct ipa_sys_connect_params *in,
 			INIT_WORK(&sys->work, ipa3_send_nop_desc);
 			atomic_set(&sys->workqueue_flushed, 0);
 		}
+	} else if (sys->xsk) {
+		/* one packet per UMEM frame, no status */
+		sys->ep->status.status_en = false;
+		sys->policy = IPA_POLICY_INTR_POLL_MODE;
+		INIT_WORK(&sys->work, ipa3_wq_handle_rx);
+		INIT_DELAYED_WORK(&sys->switch_to_intr_work,
+			ipa3_switch_to_intr_rx_work_func);
+		INIT_DELAYED_WORK(&sys->replenish_rx_work,
+			ipa3_replenish_rx_work_func);
+		atomic_set(&sys->curr_polling_state, 0);
+		in->ipa_ep_cfg.aggr.aggr_en = IPA_BYPASS_AGGR;
+		sys->rx_buff_sz = PAGE_SIZE;
+		sys->free_rx_wrapper = ipa3_free_rx_wrapper;
+		sys->repl_hdlr = ipa3_xsk_replenish;
+		sys->rx_pool_sz = in->desc_fifo_sz /
+			IPA_FIFO_ELEMENT_SIZE - 1;
 	} else {
 		if (IPA_CLIENT_IS_LAN_CONS(in->client) ||
 		    IPA_CLIENT_IS_WAN_CONS(in->client) ||
@@ -6146,6 +6314,93 @@ void ipa3_free_skb(struct ipa_rx_data *data)
 	spin_unlock_bh(&ipa3_ctx->wc_memb.wlan_spinlock);
 }
 
+/**
+ * ipa3_register_rx_hook() - attach an RX hook to a page-mode consumer pipe
+ * @client: consumer pipe the hook runs on
+ * @hook: callback run on each completed single-page transfer
+ * @priv: opaque pointer passed to @hook
+ *
+ * The hook runs in NAPI context before an skb is allocated and decides
+ * whether the packet is passed up, dropped or sent out on a producer pipe.
+ * Only one hook may be attached to a pipe at a time.
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+int ipa3_register_rx_hook(enum ipa_client_type client, ipa_rx_hook_fn hook,
+	void *priv)
+{
+	struct ipa3_sys_context *sys;
+	int ipa_ep_idx;
+	int result = 0;
+
+	if (!hook || client >= IPA_CLIENT_MAX || !IPA_CLIENT_IS_CONS(client)) {
+		IPAERR("bad parm client %d hook %pK\n", client, hook);
+		return -EINVAL;
+	}
+
+	if (!IPA_CLIENT_IS_MAPPED_VALID(client, ipa_ep_idx)) {
+		IPAERR("%s not connected\n", ipa_clients_strings[client]);
+		return -ENODEV;
+	}
+
+	sys = ipa3_ctx->ep[ipa_ep_idx].sys;
+	if (!sys || !sys->page_recycle_repl) {
+		IPAERR("%s is not a page mode pipe\n",
+			ipa_clients_strings[client]);
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&ipa3_ctx->lock);
+	if (rcu_access_pointer(sys->rx_hook)) {
+		IPAERR("%s already has an rx hook\n",
+			ipa_clients_strings[client]);
+		result = -EBUSY;
+		goto bail;
+	}
+	sys->rx_hook_priv = priv;
+	rcu_assign_pointer(sys->rx_hook, hook);
+	IPADBG("rx hook attached to %s\n", ipa_clients_strings[client]);
+bail:
+	mutex_unlock(&ipa3_ctx->lock);
+	return result;
+}
+
+/**
+ * ipa3_deregister_rx_hook() - detach the RX hook from a consumer pipe
+ * @client: consumer pipe the hook was attached to
+ *
+ * Waits for hook invocations in flight to finish, so @priv may be freed
+ * once this returns.
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+int ipa3_deregister_rx_hook(enum ipa_client_type client)
+{
+	struct ipa3_sys_context *sys;
+	int ipa_ep_idx;
+
+	if (client >= IPA_CLIENT_MAX || !IPA_CLIENT_IS_CONS(client)) {
+		IPAERR("bad parm client %d\n", client);
+		return -EINVAL;
+	}
+
+	if (!IPA_CLIENT_IS_MAPPED(client, ipa_ep_idx) ||
+		!ipa3_ctx->ep[ipa_ep_idx].sys) {
+		IPAERR("%s not connected\n", ipa_clients_strings[client]);
+		return -ENODEV;
+	}
+
+	sys = ipa3_ctx->ep[ipa_ep_idx].sys;
+	mutex_lock(&ipa3_ctx->lock);
+	RCU_INIT_POINTER(sys->rx_hook, NULL);
+	mutex_unlock(&ipa3_ctx->lock);
+	synchronize_net();
+	sys->rx_hook_priv = NULL;
+	IPADBG("rx hook detached from %s\n", ipa_clients_strings[client]);
+
+	return 0;
+}
+
 /* Functions added to support kernel tests */
 
 int ipa3_sys_setup(struct ipa_sys_connect_params *sys_in,
@@ -6912,6 +7167,10 @@ static int ipa_gsi_setup_transfer_ring(struct ipa3_ep_context *ep,
 		(ep->client == IPA_CLIENT_APPS_WAN_LOW_LAT_DATA_CONS)))
 		gsi_channel_props.cleanup_cb = free_rx_page;
 
+	/* UMEM frames belong to user-space, only free the wrappers */
+	if (ep->sys->xsk)
+		gsi_channel_props.cleanup_cb = ipa3_xsk_free_rx_pkt;
+
 	result = gsi_alloc_channel(&gsi_channel_props, ipa3_ctx->gsi_dev_hdl,
 		&ep->gsi_chan_hdl);
 	if (result != GSI_STATUS_SUCCESS) {
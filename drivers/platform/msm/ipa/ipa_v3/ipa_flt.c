@@ -1117,7 +1117,7 @@ error:
 	return -EPERM;
 }
 
-static int __ipa_del_flt_rule(u32 rule_hdl)
+int __ipa_del_flt_rule(u32 rule_hdl)
 {
 	struct ipa3_flt_entry *entry;
 	int id;
@@ -1212,7 +1212,7 @@ static int __ipa_add_flt_get_ep_idx(enum ipa_client_type ep, int *ipa_ep_idx)
 	return 0;
 }
 
-static int __ipa_add_ep_flt_rule(enum ipa_ip_type ip, enum ipa_client_type ep,
+int __ipa_add_ep_flt_rule(enum ipa_ip_type ip, enum ipa_client_type ep,
 				 const struct ipa_flt_rule_i *rule, u8 add_rear,
 				 u32 *rule_hdl, bool user)
 {
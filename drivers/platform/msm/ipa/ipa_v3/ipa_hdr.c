@@ -16,6 +16,8 @@ static const u32 ipa_hdr_proc_ctx_bin_sz[IPA_HDR_PROC_CTX_BIN_MAX] = { 32, 64};
 #define HDR_PROC_TYPE_IS_VALID(type) \
 	((type) >= 0 && (type) < IPA_HDR_PROC_MAX)
 
+static struct ipa3_hdr_entry *__ipa_find_hdr(const char *name);
+
 /**
  * ipa3_generate_hdr_hw_tbl() - generates the headers table
  * @loc:	[in] storage type of the header table buffer (local or system)
@@ -26,6 +28,7 @@ static const u32 ipa_hdr_proc_ctx_bin_sz[IPA_HDR_PROC_CTX_BIN_MAX] = { 32, 64};
 static int ipa3_generate_hdr_hw_tbl(enum hdr_tbl_storage loc, struct ipa_mem_buffer *mem)
 {
 	struct ipa3_hdr_entry *entry;
+	enum hdr_tbl_storage old_loc;
 	gfp_t flag = GFP_KERNEL;
 
 	mem->size = (ipa3_ctx->hdr_tbl[loc].end) ? ipa3_ctx->hdr_tbl[loc].end : ipa_hdr_bin_sz[0];
@@ -55,6 +58,27 @@ alloc:
 				entry->hdr, entry->hdr_len);
 	}
 
+	/*
+	 * Relocated headers stay valid at their old slot until the routing
+	 * rules pointing there are recommitted.
+	 */
+	if (!ipa3_ctx->hdr_alloc_stats.retired)
+		return 0;
+
+	for (old_loc = HDR_TBL_LCL; old_loc < HDR_TBLS_TOTAL; old_loc++) {
+		list_for_each_entry(entry,
+			&ipa3_ctx->hdr_tbl[old_loc].head_hdr_entry_list, link) {
+			if (!entry->old_offset_entry ||
+				entry->old_is_lcl != (loc == HDR_TBL_LCL))
+				continue;
+			IPADBG_LOW("retired hdr of len %d ofst=%d\n",
+				entry->hdr_len, entry->old_offset_entry->offset);
+			ipahal_cp_hdr_to_hw_buff(mem->base,
+				entry->old_offset_entry->offset,
+				entry->hdr, entry->hdr_len);
+		}
+	}
+
 	return 0;
 }
 
@@ -169,6 +193,235 @@ alloc:
 	return ret;
 }
 
+/**
+ * ipa3_hdr_get_bin() - find the smallest bin that fits a header
+ * @hdr_len:	[in] header length
+ *
+ * Returns:	bin index on success, negative on failure
+ */
+static int ipa3_hdr_get_bin(u32 hdr_len)
+{
+	int bin;
+
+	for (bin = IPA_HDR_BIN0; bin < IPA_HDR_BIN_MAX; bin++) {
+		/* Starting from IPA4.5, HW supports larger headers. */
+		if (bin == IPA_HDR_BIN5 &&
+			ipa3_ctx->ipa_hw_type < IPA_HW_v4_5)
+			break;
+		if (hdr_len <= ipa_hdr_bin_sz[bin])
+			return bin;
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * ipa3_hdr_get_free_lcl_ofst() - take a free SRAM slot for a header
+ * @first_bin:	[in] smallest acceptable bin
+ * @last_bin:	[in] largest acceptable bin
+ *
+ * Picks the free slot of the smallest bin in [first_bin, last_bin] and moves
+ * it to the used list. The slot keeps its own bin so it returns to the right
+ * free list once released.
+ *
+ * Returns:	the offset entry, NULL if no slot is free
+ */
+static struct ipa_hdr_offset_entry *ipa3_hdr_get_free_lcl_ofst(u32 first_bin,
+	u32 last_bin)
+{
+	struct ipa3_hdr_tbl *htbl = &ipa3_ctx->hdr_tbl[HDR_TBL_LCL];
+	struct ipa_hdr_offset_entry *offset;
+	u32 bin;
+
+	for (bin = first_bin; bin <= last_bin && bin < IPA_HDR_BIN_MAX; bin++) {
+		if (list_empty(&htbl->head_free_offset_list[bin]))
+			continue;
+		offset = list_first_entry(&htbl->head_free_offset_list[bin],
+			struct ipa_hdr_offset_entry, link);
+		list_move(&offset->link, &htbl->head_offset_list[bin]);
+		return offset;
+	}
+
+	return NULL;
+}
+
+/**
+ * ipa3_hdr_alloc_lcl_ofst() - allocate an SRAM slot for a header
+ * @bin:	[in] bin fitting the header
+ *
+ * Prefers a free slot of the exact bin, then growing the table, then the
+ * best fitting free slot of a larger bin.
+ *
+ * Returns:	the offset entry, NULL if SRAM has no room
+ */
+static struct ipa_hdr_offset_entry *ipa3_hdr_alloc_lcl_ofst(u32 bin)
+{
+	struct ipa3_hdr_tbl *htbl = &ipa3_ctx->hdr_tbl[HDR_TBL_LCL];
+	struct ipa_hdr_offset_entry *offset;
+
+	offset = ipa3_hdr_get_free_lcl_ofst(bin, bin);
+	if (offset)
+		return offset;
+
+	if (htbl->end + ipa_hdr_bin_sz[bin] <= IPA_MEM_PART(apps_hdr_size)) {
+		offset = kmem_cache_zalloc(ipa3_ctx->hdr_offset_cache,
+			GFP_KERNEL);
+		if (!offset)
+			return NULL;
+		INIT_LIST_HEAD(&offset->link);
+		offset->offset = htbl->end;
+		offset->bin = bin;
+		htbl->end += ipa_hdr_bin_sz[bin];
+		list_add(&offset->link, &htbl->head_offset_list[bin]);
+		return offset;
+	}
+
+	offset = ipa3_hdr_get_free_lcl_ofst(bin + 1, IPA_HDR_BIN_MAX - 1);
+	if (offset)
+		ipa3_ctx->hdr_alloc_stats.best_fit++;
+
+	return offset;
+}
+
+/**
+ * ipa3_hdr_put_old_ofst() - release the slot a header was relocated from
+ * @entry:	[in] header entry
+ */
+static void ipa3_hdr_put_old_ofst(struct ipa3_hdr_entry *entry)
+{
+	struct ipa3_hdr_tbl *htbl;
+
+	if (!entry->old_offset_entry)
+		return;
+
+	htbl = entry->old_is_lcl ? &ipa3_ctx->hdr_tbl[HDR_TBL_LCL] :
+		&ipa3_ctx->hdr_tbl[HDR_TBL_SYS];
+	entry->old_offset_entry->ipacm_installed = false;
+	list_move(&entry->old_offset_entry->link,
+		&htbl->head_free_offset_list[entry->old_offset_entry->bin]);
+	entry->old_offset_entry = NULL;
+	if (!--ipa3_ctx->hdr_alloc_stats.retired)
+		ipa3_ctx->hdr_alloc_stats.retired_rt_ref = false;
+}
+
+static bool ipa3_hdr_can_relocate(struct ipa3_hdr_entry *entry)
+{
+	return entry->cookie == IPA_HDR_COOKIE && !entry->ddr_only &&
+		!entry->ofst_pinned && !entry->old_offset_entry &&
+		entry->offset_entry && entry->offset_entry->offset;
+}
+
+static void ipa3_hdr_relocate(struct ipa3_hdr_entry *entry,
+	struct ipa_hdr_offset_entry *offset)
+{
+	struct ipa3_hdr_tbl *lcl = &ipa3_ctx->hdr_tbl[HDR_TBL_LCL];
+	struct ipa3_hdr_tbl *sys = &ipa3_ctx->hdr_tbl[HDR_TBL_SYS];
+
+	IPADBG("relocate hdr %s from %s ofst=%d to SRAM ofst=%d\n",
+		entry->name, entry->is_lcl ? "SRAM" : "DDR",
+		entry->offset_entry->offset, offset->offset);
+
+	offset->ipacm_installed = entry->ipacm_installed;
+	entry->old_offset_entry = entry->offset_entry;
+	entry->old_is_lcl = entry->is_lcl;
+	entry->offset_entry = offset;
+	ipa3_ctx->hdr_alloc_stats.retired++;
+	/* the own reference is the only one which is not a rule */
+	if (entry->ref_cnt > 1)
+		ipa3_ctx->hdr_alloc_stats.retired_rt_ref = true;
+
+	if (!entry->is_lcl) {
+		entry->is_lcl = true;
+		list_move(&entry->link, &lcl->head_hdr_entry_list);
+		sys->hdr_cnt--;
+		lcl->hdr_cnt++;
+	}
+}
+
+/**
+ * ipa3_hdr_compact() - relocate headers to better SRAM slots
+ *
+ * First moves SRAM headers sitting in a larger bin than needed to a free slot
+ * of a fitting bin, then moves DDR headers into free SRAM space. Headers
+ * which are partial, forced to DDR, or whose offset was handed out are left
+ * in place. The old slots are released by ipa3_hdr_release_retired().
+ *
+ * Note:	Should be called with ipa3_ctx->lock held
+ */
+static void ipa3_hdr_compact(void)
+{
+	struct ipa3_hdr_tbl *lcl = &ipa3_ctx->hdr_tbl[HDR_TBL_LCL];
+	struct ipa3_hdr_tbl *sys = &ipa3_ctx->hdr_tbl[HDR_TBL_SYS];
+	struct ipa3_hdr_entry *entry, *next;
+	struct ipa_hdr_offset_entry *offset;
+	int bin;
+
+	if (!IPA_MEM_PART(apps_hdr_size) || !IPA_MEM_PART(apps_hdr_size_ddr))
+		return;
+
+	list_for_each_entry(entry, &lcl->head_hdr_entry_list, link) {
+		if (!ipa3_hdr_can_relocate(entry))
+			continue;
+		bin = ipa3_hdr_get_bin(entry->hdr_len);
+		if (bin < 0 || bin >= entry->offset_entry->bin)
+			continue;
+		offset = ipa3_hdr_get_free_lcl_ofst(bin,
+			entry->offset_entry->bin - 1);
+		if (!offset)
+			continue;
+		ipa3_hdr_relocate(entry, offset);
+		ipa3_ctx->hdr_alloc_stats.rebinned++;
+	}
+
+	list_for_each_entry_safe(entry, next, &sys->head_hdr_entry_list, link) {
+		if (!ipa3_hdr_can_relocate(entry))
+			continue;
+		bin = ipa3_hdr_get_bin(entry->hdr_len);
+		if (bin < 0)
+			continue;
+		offset = ipa3_hdr_alloc_lcl_ofst(bin);
+		if (!offset)
+			continue;
+		ipa3_hdr_relocate(entry, offset);
+		ipa3_ctx->hdr_alloc_stats.migrated++;
+	}
+}
+
+/**
+ * ipa3_hdr_release_retired() - release slots of relocated headers
+ *
+ * Called once the header tables holding both copies are in HW. Routing rules
+ * carry the raw header offset, so if any of them may point at an old slot
+ * the routing tables are recommitted first.
+ *
+ * Note:	Should be called with ipa3_ctx->lock held
+ */
+static void ipa3_hdr_release_retired(void)
+{
+	struct ipa3_hdr_alloc_stats *stats = &ipa3_ctx->hdr_alloc_stats;
+	struct ipa3_hdr_entry *entry;
+	enum hdr_tbl_storage loc;
+
+	if (!stats->retired)
+		return;
+
+	if (stats->retired_rt_ref) {
+		if (ipa3_ctx->ctrl->ipa3_commit_rt(IPA_IP_v4) ||
+			ipa3_ctx->ctrl->ipa3_commit_rt(IPA_IP_v6)) {
+			IPAERR("fail to commit rt, keep %u retired hdr slots\n",
+				stats->retired);
+			return;
+		}
+		stats->rt_recommit++;
+		stats->retired_rt_ref = false;
+	}
+
+	for (loc = HDR_TBL_LCL; loc < HDR_TBLS_TOTAL; loc++)
+		list_for_each_entry(entry,
+			&ipa3_ctx->hdr_tbl[loc].head_hdr_entry_list, link)
+			ipa3_hdr_put_old_ofst(entry);
+}
+
 /**
  * __ipa_commit_hdr_v3_0() - Commits the header table from memory to HW
  *
@@ -199,6 +452,8 @@ int __ipa_commit_hdr_v3_0(void)
 
 	memset(desc, 0, 3 * sizeof(struct ipa3_desc));
 
+	ipa3_hdr_compact();
+
 	/* Generate structures for both SRAM and DDR header tables */
 	for (loc = HDR_TBL_LCL; loc < HDR_TBLS_TOTAL; loc++) {
 		hdr_tbl_size = (loc == HDR_TBL_LCL) ?
@@ -360,6 +615,9 @@ int __ipa_commit_hdr_v3_0(void)
 	else
 		rc = 0;
 
+	if (!rc)
+		ipa3_hdr_release_retired();
+
 	if (!rc && hdr_mem[HDR_TBL_SYS].base) {
 		if (ipa3_ctx->hdr_sys_mem.phys_base) {
 			dma_free_coherent(ipa3_ctx->pdev,
@@ -425,7 +683,7 @@ end:
 	return rc;
 }
 
-static int __ipa_add_hdr_proc_ctx(struct ipa_hdr_proc_ctx_add *proc_ctx,
+int __ipa_add_hdr_proc_ctx(struct ipa_hdr_proc_ctx_add *proc_ctx,
 	bool add_ref_hdr, bool user_only)
 {
 	struct ipa3_hdr_entry *hdr_entry;
@@ -559,16 +817,15 @@ bad_len:
 	return -EPERM;
 }
 
-static int __ipa_add_hdr(struct ipa_hdr_add *hdr, bool user,
+int __ipa_add_hdr(struct ipa_hdr_add *hdr, bool user,
 	struct ipa3_hdr_entry **entry_out)
 {
-	struct ipa3_hdr_entry *entry, *entry_t, *next;
+	struct ipa3_hdr_entry *entry, *entry_t;
 	struct ipa_hdr_offset_entry *offset = NULL;
-	u32 bin;
+	int bin;
 	struct ipa3_hdr_tbl *htbl;
 	int id;
 	int mem_size;
-	enum hdr_tbl_storage hdr_tbl_loc;
 
 	if (hdr->hdr_len > IPA_HDR_MAX_SIZE) {
 		IPAERR_RL("bad param\n");
@@ -595,45 +852,28 @@ static int __ipa_add_hdr(struct ipa_hdr_add *hdr, bool user,
 	entry->eth2_ofst = hdr->eth2_ofst;
 	entry->cookie = IPA_HDR_COOKIE;
 	entry->ipacm_installed = user;
-	entry->is_lcl = ((IPA_MEM_PART(apps_hdr_size_ddr) &&
-			 (entry->is_partial || (hdr->status == IPA_HDR_TO_DDR_PATTERN))) ||
-			 !IPA_MEM_PART(apps_hdr_size)) ? false : true;
+	entry->ddr_only = IPA_MEM_PART(apps_hdr_size_ddr) &&
+			  (entry->is_partial || (hdr->status == IPA_HDR_TO_DDR_PATTERN));
+	entry->is_lcl = (entry->ddr_only || !IPA_MEM_PART(apps_hdr_size)) ?
+			false : true;
 
 	/* check to see if adding header entry with duplicate name */
-	for (hdr_tbl_loc = HDR_TBL_LCL; hdr_tbl_loc < HDR_TBLS_TOTAL; hdr_tbl_loc++) {
-		list_for_each_entry_safe(entry_t, next,
-			&ipa3_ctx->hdr_tbl[hdr_tbl_loc].head_hdr_entry_list, link) {
-
-			/* return if adding the same name */
-			if (!strcmp(entry_t->name, entry->name) && (user == true)) {
-				IPAERR("IPACM Trying to add hdr %s len=%d, duplicate entry, return old one\n",
-					entry->name, entry->hdr_len);
+	entry_t = user ? __ipa_find_hdr(entry->name) : NULL;
+	if (entry_t) {
+		/* return if adding the same name */
+		IPAERR("IPACM Trying to add hdr %s len=%d, duplicate entry, return old one\n",
+			entry->name, entry->hdr_len);
 
-				/* return the original entry */
-				if (entry_out)
-					*entry_out = entry_t;
+		/* return the original entry */
+		if (entry_out)
+			*entry_out = entry_t;
 
-				kmem_cache_free(ipa3_ctx->hdr_cache, entry);
-				return 0;
-			}
-		}
+		kmem_cache_free(ipa3_ctx->hdr_cache, entry);
+		return 0;
 	}
 
-	if (hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN0])
-		bin = IPA_HDR_BIN0;
-	else if (hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN1])
-		bin = IPA_HDR_BIN1;
-	else if (hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN2])
-		bin = IPA_HDR_BIN2;
-	else if (hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN3])
-		bin = IPA_HDR_BIN3;
-	else if (hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN4])
-		bin = IPA_HDR_BIN4;
-	/* Starting from IPA4.5, HW supports larger headers. */
-	else if ((hdr->hdr_len <= ipa_hdr_bin_sz[IPA_HDR_BIN5]) &&
-		 (ipa3_ctx->ipa_hw_type >= IPA_HW_v4_5))
-		 bin = IPA_HDR_BIN5;
-	else {
+	bin = ipa3_hdr_get_bin(hdr->hdr_len);
+	if (bin < 0) {
 		IPAERR_RL("unexpected hdr len %d\n", hdr->hdr_len);
 		goto bad_hdr_len;
 	}
@@ -651,7 +891,18 @@ static int __ipa_add_hdr(struct ipa_hdr_add *hdr, bool user,
 		 */
 		while (htbl->end + ipa_hdr_bin_sz[bin] > mem_size) {
 			if (entry->is_lcl) {
+				/* use the best fitting larger SRAM slot before DDR */
+				offset = ipa3_hdr_get_free_lcl_ofst(bin + 1,
+					IPA_HDR_BIN_MAX - 1);
+				if (offset) {
+					ipa3_ctx->hdr_alloc_stats.best_fit++;
+					entry->offset_entry = offset;
+					offset->ipacm_installed = user;
+					goto free_list;
+				}
+
 				/* if header does not fit to SRAM table, place it in DDR */
+				ipa3_ctx->hdr_alloc_stats.spilled++;
 				IPADBG_LOW("SRAM header table was full allocting DDR header table! Requested: %d Left: %d name %s, end %d\n",
 						ipa_hdr_bin_sz[bin], mem_size - htbl->end, entry->name, htbl->end);
 				htbl = &ipa3_ctx->hdr_tbl[HDR_TBL_SYS];
@@ -711,6 +962,8 @@ create_entry:
 free_list:
 
 	list_add(&entry->link, &htbl->head_hdr_entry_list);
+	hash_add(ipa3_ctx->hdr_name_hash, &entry->name_node,
+		ipa3_name_hash(entry->name));
 	htbl->hdr_cnt++;
 	IPADBG("add hdr of sz=%d hdr_cnt=%d ofst=%d to %s table\n",
 			hdr->hdr_len,
@@ -738,6 +991,7 @@ ipa_insert_failed:
 			  &htbl->head_free_offset_list[offset->bin]);
 	entry->offset_entry = NULL;
 	htbl->hdr_cnt--;
+	hash_del(&entry->name_node);
 	list_del(&entry->link);
 
 bad_hdr_len:
@@ -747,7 +1001,7 @@ error:
 	return -EPERM;
 }
 
-static int __ipa3_del_hdr_proc_ctx(u32 proc_ctx_hdl,
+int __ipa3_del_hdr_proc_ctx(u32 proc_ctx_hdl,
 	bool release_hdr, bool by_user)
 {
 	struct ipa3_hdr_proc_ctx_entry *entry;
@@ -872,6 +1126,8 @@ int __ipa3_del_hdr(u32 hdr_hdl, bool by_user)
 		/* move the offset entry to appropriate free list */
 		list_move(&entry->offset_entry->link,
 			&htbl->head_free_offset_list[entry->offset_entry->bin]);
+	ipa3_hdr_put_old_ofst(entry);
+	hash_del(&entry->name_node);
 	list_del(&entry->link);
 	htbl->hdr_cnt--;
 	entry->cookie = 0;
@@ -1326,6 +1582,7 @@ int ipa3_reset_hdr(bool user_only)
 					entry->proc_ctx->hdr = NULL;
 					entry->proc_ctx = NULL;
 				}
+				ipa3_hdr_put_old_ofst(entry);
 				/* move the offset entry to free list */
 				entry->offset_entry->ipacm_installed = false;
 				list_move(&entry->offset_entry->link,
@@ -1333,6 +1590,7 @@ int ipa3_reset_hdr(bool user_only)
 					entry->offset_entry->bin]);
 
 				/* delete the hdr entry from headers list */
+				hash_del(&entry->name_node);
 				list_del(&entry->link);
 				ipa3_ctx->hdr_tbl[hdr_tbl_loc].hdr_cnt--;
 				entry->ref_cnt = 0;
@@ -1439,25 +1697,31 @@ int ipa3_reset_hdr(bool user_only)
 	return 0;
 }
 
+/*
+ * Names are unique for IPACM installed headers only, kernel clients may
+ * add duplicates. In that case an SRAM entry wins over a DDR one, as it
+ * did with the plain list walk of the SRAM table followed by the DDR one.
+ */
 static struct ipa3_hdr_entry *__ipa_find_hdr(const char *name)
 {
 	struct ipa3_hdr_entry *entry;
-	enum hdr_tbl_storage hdr_tbl_loc;
+	struct ipa3_hdr_entry *sys_entry = NULL;
 
 	if (strnlen(name, IPA_RESOURCE_NAME_MAX) == IPA_RESOURCE_NAME_MAX) {
 		IPAERR_RL("Header name too long: %s\n", name);
 		return NULL;
 	}
-	for (hdr_tbl_loc = HDR_TBL_LCL; hdr_tbl_loc < HDR_TBLS_TOTAL; hdr_tbl_loc++) {
-		list_for_each_entry(entry,
-				    &ipa3_ctx->hdr_tbl[hdr_tbl_loc].head_hdr_entry_list,
-				    link) {
-			if (!strcmp(name, entry->name))
-				return entry;
-		}
+	hash_for_each_possible(ipa3_ctx->hdr_name_hash, entry, name_node,
+		ipa3_name_hash(name)) {
+		if (strcmp(name, entry->name))
+			continue;
+		if (entry->is_lcl)
+			return entry;
+		if (!sys_entry)
+			sys_entry = entry;
 	}
 
-	return NULL;
+	return sys_entry;
 }
 
 static struct ipa3_hdr_proc_ctx_entry* __ipa_find_hdr_proc_ctx(const char *name)
@@ -1528,6 +1792,8 @@ int ipa3_get_hdr_offset(char* name, u32* offset)
 	entry = __ipa_find_hdr(name);
 	if (entry && entry->offset_entry) {
 		*offset = entry->offset_entry->offset;
+		/* the caller keeps the raw offset, never relocate this entry */
+		entry->ofst_pinned = true;
 		result = 0;
 	}
 
@@ -11,12 +11,14 @@
 #include <linux/bitops.h>
 #include <linux/cdev.h>
 #include <linux/export.h>
+#include <linux/hashtable.h>
 #include <linux/idr.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/skbuff.h>
 #include <linux/slab.h>
 #include <linux/notifier.h>
+#include <linux/poll.h>
 #include <linux/interrupt.h>
 #include <linux/netdevice.h>
 #include <linux/ipa.h>
@@ -43,6 +45,7 @@
 #include <linux/ipa_fmwk.h>
 #include <linux/mhi_dma.h>
 #include "ipa_uc_holb_monitor.h"
+#include "ipa_batch_uapi.h"
 #include <soc/qcom/minidump.h>
 
 #define IPA_DEV_NAME_MAX_LEN 15
@@ -251,6 +254,10 @@ enum {
 #define IPA_HDR_BIN5 5
 #define IPA_HDR_BIN_MAX 6
 
+/* buckets of the name keyed header and routing table lookup hashes */
+#define IPA_HDR_NAME_HASH_BITS 8
+#define IPA_RT_TBL_NAME_HASH_BITS 6
+
 enum hdr_tbl_storage {
 	HDR_TBL_LCL,
 	HDR_TBL_SYS,
@@ -564,6 +571,20 @@ enum {
 #define IPA_RULE_CNT_MAX 512
 
 /* miscellaneous for rmnet_ipa and qmi_service */
+
+/*
+ * skb->cb layout of frames queued by rmnet_ipa on one of its TX queues.
+ * Lets the low latency pipe completion hand such frames back to rmnet_ipa
+ * for BQL and per-queue accounting.
+ */
+#define IPA_WWAN_TX_CB_MAGIC 0x57414e51
+struct ipa3_wwan_tx_cb {
+	u32 magic;
+	u32 len;
+	u16 txq;
+};
+#define IPA_WWAN_TX_CB(skb) ((struct ipa3_wwan_tx_cb *)((skb)->cb))
+
 enum ipa_type_mode {
 	IPA_HW_TYPE,
 	PLATFORM_TYPE,
@@ -780,6 +801,7 @@ struct ipa3_flt_entry {
 /**
  * struct ipa3_rt_tbl - IPA routing table
  * @link: table's link in global routing tables list
+ * @name_node: table's node in the routing table set name hash
  * @head_rt_rule_list: head of routing rules list
  * @name: routing table name
  * @idx: routing table index
@@ -796,6 +818,7 @@ struct ipa3_flt_entry {
  */
 struct ipa3_rt_tbl {
 	struct list_head link;
+	struct hlist_node name_node;
 	u32 cookie;
 	struct list_head head_rt_rule_list;
 	char name[IPA_RESOURCE_NAME_MAX];
@@ -814,6 +837,7 @@ struct ipa3_rt_tbl {
 /**
  * struct ipa3_hdr_entry - IPA header table entry
  * @link: entry's link in global header table entries list
+ * @name_node: entry's node in the global header name hash
  * @hdr: the header
  * @hdr_len: header length
  * @name: name of header table entry
@@ -829,9 +853,15 @@ struct ipa3_rt_tbl {
  * @user_deleted: is the header deleted by the user?
  * @ipacm_installed: indicate if installed by ipacm
  * @is_lcl: is the entry in the SRAM?
+ * @ddr_only: entry must stay in the DDR table (partial or forced to DDR)
+ * @ofst_pinned: raw offset was handed out, entry must not be relocated
+ * @old_is_lcl: is old_offset_entry in the SRAM table?
+ * @old_offset_entry: slot the entry was relocated from, kept populated in HW
+ *	until routing rules pointing at it are recommitted
  */
 struct ipa3_hdr_entry {
 	struct list_head link;
+	struct hlist_node name_node;
 	u32 cookie;
 	u8 hdr[IPA_HDR_MAX_SIZE];
 	u32 hdr_len;
@@ -847,6 +877,10 @@ struct ipa3_hdr_entry {
 	bool user_deleted;
 	bool ipacm_installed;
 	bool is_lcl;
+	bool ddr_only;
+	bool ofst_pinned;
+	bool old_is_lcl;
+	struct ipa_hdr_offset_entry *old_offset_entry;
 };
 
 /**
@@ -865,6 +899,26 @@ struct ipa3_hdr_tbl {
 	u32 end;
 };
 
+/**
+ * struct ipa3_hdr_alloc_stats - header table allocator statistics
+ * @best_fit: SRAM headers placed in a free slot of a larger bin
+ * @spilled: headers placed in DDR because the SRAM table was full
+ * @migrated: DDR headers moved to SRAM at commit time
+ * @rebinned: SRAM headers moved from a larger bin to a fitting one
+ * @rt_recommit: routing recommits issued for relocated headers
+ * @retired: relocated slots still waiting for a routing recommit
+ * @retired_rt_ref: a waiting slot is referenced by routing rules
+ */
+struct ipa3_hdr_alloc_stats {
+	u32 best_fit;
+	u32 spilled;
+	u32 migrated;
+	u32 rebinned;
+	u32 rt_recommit;
+	u32 retired;
+	bool retired_rt_ref;
+};
+
 /**
  * struct ipa3_hdr_offset_entry - IPA header offset entry
  * @link: entry's link in global processing context header offset entries list
@@ -991,11 +1045,13 @@ struct ipa3_rt_entry {
 /**
  * struct ipa3_rt_tbl_set - collection of routing tables
  * @head_rt_tbl_list: collection of routing tables
+ * @name_hash: routing tables of head_rt_tbl_list keyed by name
  * @tbl_cnt: number of routing tables
  * @rule_ids: idr structure that holds the rule_id for each rule
  */
 struct ipa3_rt_tbl_set {
 	struct list_head head_rt_tbl_list;
+	DECLARE_HASHTABLE(name_hash, IPA_RT_TBL_NAME_HASH_BITS);
 	u32 tbl_cnt;
 	struct idr rule_ids;
 };
@@ -1171,6 +1227,39 @@ struct ipa3_page_repl_ctx {
 	atomic_t pending;
 };
 
+struct ipa3_xsk_pool;
+
+/**
+ * enum ipa_rx_hook_verdict - verdict returned by an RX page hook
+ * @IPA_RX_HOOK_PASS: build an skb and hand it to the pipe payload handler
+ * @IPA_RX_HOOK_DROP: recycle the page, no skb is allocated
+ * @IPA_RX_HOOK_TX: build an skb and transmit it on buff->tx_client
+ */
+enum ipa_rx_hook_verdict {
+	IPA_RX_HOOK_PASS,
+	IPA_RX_HOOK_DROP,
+	IPA_RX_HOOK_TX,
+};
+
+/**
+ * struct ipa_rx_hook_buff - RX buffer handed to an RX page hook
+ * @data: start of the received data in the page
+ * @len: number of valid bytes at @data
+ * @tx_client: producer pipe to use for IPA_RX_HOOK_TX
+ *
+ * The hook may advance @data and shrink @len to strip headers or
+ * trailers, but may not grow the buffer. The buffer is the whole
+ * transfer, so on aggregating pipes it holds the aggregated frame.
+ */
+struct ipa_rx_hook_buff {
+	void *data;
+	u32 len;
+	enum ipa_client_type tx_client;
+};
+
+typedef enum ipa_rx_hook_verdict (*ipa_rx_hook_fn)(void *priv,
+	struct ipa_rx_hook_buff *buff);
+
 /**
  * struct ipa3_sys_context - IPA GPI pipes context
  * @head_desc_list: header descriptors list
@@ -1188,6 +1277,14 @@ struct ipa3_page_repl_ctx {
  * @buff_size: rx packet length
  * @page_order: page order of the rx pipe based on the ioctl version
  * @ext_ioctl_v2: specifies if it's new version of ingress/egress ioctl
+ * @rx_hook: page-mode RX hook run before skb allocation (RCU protected)
+ * @rx_hook_priv: opaque pointer passed to @rx_hook
+ * @rx_hook_pass: packets the hook passed up the stack
+ * @rx_hook_drop: packets the hook dropped
+ * @rx_hook_tx: packets the hook redirected to a producer pipe
+ * @rx_hook_tx_err: redirected packets that failed to transmit
+ * @rx_hook_aborted: packets dropped because the hook returned a bad buffer
+ * @xsk: zero-copy RX socket backing this consumer pipe, NULL if none
  *
  * IPA context specific to the GPI pipes a.k.a LAN IN/OUT and WAN
  */
@@ -1237,6 +1334,14 @@ struct ipa3_sys_context {
 	struct ipa3_sys_context *common_sys;
 	atomic_t page_avilable;
 	u32 napi_sort_page_thrshld_cnt;
+	ipa_rx_hook_fn __rcu rx_hook;
+	void *rx_hook_priv;
+	u64 rx_hook_pass;
+	u64 rx_hook_drop;
+	u64 rx_hook_tx;
+	u64 rx_hook_tx_err;
+	u64 rx_hook_aborted;
+	struct ipa3_xsk_pool *xsk;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa3_ep_context *ep;
@@ -1309,7 +1414,8 @@ struct ipa3_tx_pkt_wrapper {
  * @len: len in bytes to copy
  * @link: linked to the wrappers list on the proper(sync/async) cons pipe
  * @xfer_done: completion object for sync_memcpy completion
- * @callback: IPADMA client provided completion callback
+ * @callback: IPADMA client provided completion callback, NULL for all but
+ *  the last segment of a batch
  * @user1: cookie1 for above callback
  *
  * This struct can wrap both sync and async memcpy transfers descriptors.
@@ -1324,6 +1430,20 @@ struct ipa3_dma_xfer_wrapper {
 	void *user1;
 };
 
+/**
+ * struct ipa3_dma_memcpy_entry - one copy of a batched IPADMA memcpy
+ * @dest: physical address to store the copied data
+ * @src: physical address of the source data to copy
+ * @len: number of bytes to copy, may exceed the max IPADMA packet size
+ * @status: 0 once copied, -EINVAL if the entry was rejected
+ */
+struct ipa3_dma_memcpy_entry {
+	u64 dest;
+	u64 src;
+	u32 len;
+	int status;
+};
+
 /**
  * struct ipa3_desc - IPA descriptor
  * @type: skb or immediate command or plain old data
@@ -1364,6 +1484,7 @@ struct ipa3_desc {
  * @link: linked to the Rx packets on that pipe
  * @len: fixed allocated skb length (i.e. times of page size)
  * @data_len: how many bytes are copied into skb's flat buffer
+ * @xsk_frame: UMEM frame index when the pipe is backed by an XSK pool
  */
 struct ipa3_rx_pkt_wrapper {
 	struct list_head link;
@@ -1375,6 +1496,25 @@ struct ipa3_rx_pkt_wrapper {
 	u32 data_len;
 	struct work_struct work;
 	struct ipa3_sys_context *sys;
+	u32 xsk_frame;
+};
+
+#define IPA_PUSH_MSG_INLINE_SZ 64
+
+/**
+ * struct ipa3_push_msg - message queued for user-space on /dev/ipa
+ * @meta: message meta-data
+ * @callback: frees @buff, NULL when the payload is held in @inline_buff
+ * @buff: message payload
+ * @link: linked to ipa3_ctx->msg_list
+ * @inline_buff: storage for payloads up to IPA_PUSH_MSG_INLINE_SZ bytes
+ */
+struct ipa3_push_msg {
+	struct ipa_msg_meta meta;
+	ipa_msg_free_fn callback;
+	void *buff;
+	struct list_head link;
+	u8 inline_buff[IPA_PUSH_MSG_INLINE_SZ];
 };
 
 /**
@@ -2221,6 +2361,8 @@ enum ipa_per_usb_enum_type_e {
  * @ipa_wrapper_size: size of the memory pointed to by ipa_wrapper_base
  * @ipa_cfg_offset: offset from IPA_WRAPPER_BASE to IPA registers
  * @hdr_tbl: IPA header table
+ * @hdr_name_hash: entries of both header tables keyed by name
+ * @hdr_alloc_stats: header table allocator and relocation statistics
  * @hdr_proc_ctx_tbl: IPA processing context table
  * @rt_tbl_set: list of routing tables each of which is a list of rules
  * @reap_rt_tbl_set: list of sys mem routing tables waiting to be reaped
@@ -2234,6 +2376,7 @@ enum ipa_per_usb_enum_type_e {
  * @rt_tbl_cache: routing table cache
  * @tx_pkt_wrapper_cache: Tx packets cache
  * @rx_pkt_wrapper_cache: Rx packets cache
+ * @push_msg_cache: cache of messages queued for user-space
  * @rt_idx_bitmap: routing table index bitmap
  * @lock: this does NOT protect the linked lists within ipa3_sys_context
  * @smem_sz: shared memory size available for SW use starting
@@ -2346,6 +2489,8 @@ struct ipa3_context {
 	u32 ipa_cfg_offset;
 	bool set_evict_reg;
 	struct ipa3_hdr_tbl hdr_tbl[HDR_TBLS_TOTAL];
+	DECLARE_HASHTABLE(hdr_name_hash, IPA_HDR_NAME_HASH_BITS);
+	struct ipa3_hdr_alloc_stats hdr_alloc_stats;
 	struct ipa3_hdr_proc_ctx_tbl hdr_proc_ctx_tbl;
 	struct ipa3_rt_tbl_set rt_tbl_set[IPA_IP_MAX];
 	struct ipa3_rt_tbl_set reap_rt_tbl_set[IPA_IP_MAX];
@@ -2359,6 +2504,7 @@ struct ipa3_context {
 	struct kmem_cache *rt_tbl_cache;
 	struct kmem_cache *tx_pkt_wrapper_cache;
 	struct kmem_cache *rx_pkt_wrapper_cache;
+	struct kmem_cache *push_msg_cache;
 	unsigned long rt_idx_bitmap[IPA_IP_MAX];
 	struct mutex lock;
 	u16 smem_sz;
@@ -3206,6 +3352,11 @@ int ipa3_tx_dp_mul(enum ipa_client_type dst,
 
 void ipa3_free_skb(struct ipa_rx_data *data);
 
+int ipa3_register_rx_hook(enum ipa_client_type client, ipa_rx_hook_fn hook,
+	void *priv);
+
+int ipa3_deregister_rx_hook(enum ipa_client_type client);
+
 /*
  * System pipes
  */
@@ -3213,6 +3364,9 @@ int ipa3_setup_tput_pipe(void);
 
 int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl);
 
+int ipa3_setup_xsk_pipe(struct ipa_sys_connect_params *sys_in,
+	struct ipa3_xsk_pool *xsk, u32 *clnt_hdl);
+
 int ipa3_teardown_sys_pipe(u32 clnt_hdl);
 
 int ipa3_connect_wdi_pipe(struct ipa_wdi_in_params *in,
@@ -3305,6 +3459,12 @@ int ipa3_dma_sync_memcpy(u64 dest, u64 src, int len);
 int ipa3_dma_async_memcpy(u64 dest, u64 src, int len,
 			void (*user_cb)(void *user1), void *user_param);
 
+int ipa3_dma_async_memcpy_batch(struct ipa3_dma_memcpy_entry *entries,
+	u32 num, void (*user_cb)(void *user1,
+	struct ipa3_dma_memcpy_entry *entries, u32 num), void *user_param);
+
+int ipa3_dma_memcpy_sg(struct ipa3_dma_memcpy_entry *entries, u32 num);
+
 int ipa3_dma_uc_memcpy(phys_addr_t dest, phys_addr_t src, int len);
 
 void ipa3_dma_destroy(void);
@@ -3481,6 +3641,19 @@ int __ipa3_del_rt_rule(u32 rule_hdl);
 int __ipa3_del_hdr(u32 hdr_hdl, bool by_user);
 int __ipa3_release_hdr(u32 hdr_hdl);
 int __ipa3_release_hdr_proc_ctx(u32 proc_ctx_hdl);
+int __ipa_add_hdr(struct ipa_hdr_add *hdr, bool user,
+	struct ipa3_hdr_entry **entry_out);
+int __ipa_add_hdr_proc_ctx(struct ipa_hdr_proc_ctx_add *proc_ctx,
+	bool add_ref_hdr, bool user_only);
+int __ipa3_del_hdr_proc_ctx(u32 proc_ctx_hdl,
+	bool release_hdr, bool by_user);
+int __ipa_add_rt_rule(enum ipa_ip_type ip, const char *name,
+	const struct ipa_rt_rule_i *rule, u8 at_rear, u32 *rule_hdl,
+	u16 rule_id, bool user);
+int __ipa_add_ep_flt_rule(enum ipa_ip_type ip, enum ipa_client_type ep,
+	const struct ipa_flt_rule_i *rule, u8 add_rear,
+	u32 *rule_hdl, bool user);
+int __ipa_del_flt_rule(u32 rule_hdl);
 int _ipa_read_ep_reg_v3_0(char *buf, int max_len, int pipe);
 int _ipa_read_ep_reg_v4_0(char *buf, int max_len, int pipe);
 int _ipa_read_ipahal_regs(void);
@@ -3494,6 +3667,7 @@ void ipa3_suspend_handler(enum ipa_irq_type interrupt,
 
 ssize_t ipa3_read(struct file *filp, char __user *buf, size_t count,
 		 loff_t *f_pos);
+unsigned int ipa3_poll(struct file *filp, poll_table *wait);
 int ipa3_pull_msg(struct ipa_msg_meta *meta, char *buff, size_t count);
 int ipa3_query_intf(struct ipa_ioc_query_intf *lookup);
 int ipa3_query_intf_tx_props(struct ipa_ioc_query_intf_tx_props *tx);
@@ -3538,6 +3712,7 @@ int ipa3_id_alloc(void *ptr);
 bool ipa3_check_idr_if_freed(void *ptr);
 void *ipa3_id_find(u32 id);
 void ipa3_id_remove(u32 id);
+u32 ipa3_name_hash(const char *name);
 int ipa3_enable_force_clear(u32 request_id, bool throttle_source,
 	u32 source_pipe_bitmask, u32 source_pipe_reg_idx);
 int ipa3_disable_force_clear(u32 request_id);
@@ -3736,6 +3911,9 @@ int ipa3_register_rmnet_ll_cb(
 	void *user_data3);
 int ipa3_unregister_rmnet_ll_cb(void);
 int ipa3_rmnet_ll_xmit(struct sk_buff *skb);
+bool ipa3_rmnet_ll_tx_ready(void);
+void ipa3_wwan_ll_tx_complete_notify(void *priv, enum ipa_dp_evt_type evt,
+	unsigned long data);
 int ipa3_register_notifier(void *fn_ptr);
 int ipa3_unregister_notifier(void *fn_ptr);
 int ipa3_setup_apps_low_lat_data_prod_pipe(
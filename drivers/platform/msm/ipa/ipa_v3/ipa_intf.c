@@ -21,12 +21,14 @@ struct ipa3_intf {
 	enum ipa_client_type excp_pipe;
 };
 
-struct ipa3_push_msg {
-	struct ipa_msg_meta meta;
-	ipa_msg_free_fn callback;
-	void *buff;
-	struct list_head link;
-};
+/*
+ * Legacy IPACM parses only the first message of every read(), so returning
+ * several messages per read() has to be requested explicitly.
+ */
+static bool msg_read_batch;
+module_param(msg_read_batch, bool, 0644);
+MODULE_PARM_DESC(msg_read_batch,
+	"Return as many queued messages as fit in each read() of /dev/ipa");
 
 struct ipa3_pull_msg {
 	struct ipa_msg_meta meta;
@@ -381,6 +383,45 @@ static void ipa3_send_msg_free(void *buff, u32 len, u32 type)
 	kfree(buff);
 }
 
+/*
+ * Allocate a message for msg_list with a private copy of the payload.
+ * Small payloads are kept inline so most messages cost one slab object.
+ */
+static struct ipa3_push_msg *ipa3_push_msg_alloc(struct ipa_msg_meta *meta,
+	void *buff)
+{
+	struct ipa3_push_msg *msg;
+
+	msg = kmem_cache_zalloc(ipa3_ctx->push_msg_cache, GFP_KERNEL);
+	if (msg == NULL)
+		return NULL;
+
+	msg->meta = *meta;
+	if (meta->msg_len > 0 && buff) {
+		if (meta->msg_len <= sizeof(msg->inline_buff)) {
+			memcpy(msg->inline_buff, buff, meta->msg_len);
+			msg->buff = msg->inline_buff;
+		} else {
+			msg->buff = kmemdup(buff, meta->msg_len, GFP_KERNEL);
+			if (msg->buff == NULL) {
+				kmem_cache_free(ipa3_ctx->push_msg_cache, msg);
+				return NULL;
+			}
+			msg->callback = ipa3_send_msg_free;
+		}
+	}
+
+	return msg;
+}
+
+static void ipa3_push_msg_free(struct ipa3_push_msg *msg)
+{
+	if (msg->callback)
+		msg->callback(msg->buff, msg->meta.msg_len,
+			msg->meta.msg_type);
+	kmem_cache_free(ipa3_ctx->push_msg_cache, msg);
+}
+
 static int wlan_msg_process(struct ipa_msg_meta *meta, void *buff)
 {
 	struct ipa3_push_msg *msg_dup;
@@ -501,7 +542,6 @@ int ipa3_send_msg(struct ipa_msg_meta *meta, void *buff,
 		  ipa_msg_free_fn callback)
 {
 	struct ipa3_push_msg *msg;
-	void *data = NULL;
 
 	if (meta == NULL || (buff == NULL && callback != NULL) ||
 	    (buff != NULL && callback == NULL)) {
@@ -515,21 +555,10 @@ int ipa3_send_msg(struct ipa_msg_meta *meta, void *buff,
 		return -EINVAL;
 	}
 
-	msg = kzalloc(sizeof(struct ipa3_push_msg), GFP_KERNEL);
+	msg = ipa3_push_msg_alloc(meta, buff);
 	if (msg == NULL)
 		return -ENOMEM;
 
-	msg->meta = *meta;
-	if (meta->msg_len > 0 && buff) {
-		data = kmemdup(buff, meta->msg_len, GFP_KERNEL);
-		if (data == NULL) {
-			kfree(msg);
-			return -ENOMEM;
-		}
-		msg->buff = data;
-		msg->callback = ipa3_send_msg_free;
-	}
-
 	mutex_lock(&ipa3_ctx->msg_lock);
 	list_add_tail(&msg->link, &ipa3_ctx->msg_list);
 	/* support for softap client event cache */
@@ -563,7 +592,6 @@ int ipa3_resend_wlan_msg(void)
 	struct ipa3_push_msg *next;
 	int cnt = 0, total = 0;
 	struct ipa3_push_msg *msg;
-	void *data = NULL;
 
 	IPADBG("\n");
 
@@ -580,20 +608,11 @@ int ipa3_resend_wlan_msg(void)
 			}
 		}
 
-		msg = kzalloc(sizeof(*msg), GFP_KERNEL);
+		msg = ipa3_push_msg_alloc(&entry->meta, entry->buff);
 		if (msg == NULL) {
 			mutex_unlock(&ipa3_ctx->msg_wlan_client_lock);
 			return -ENOMEM;
 		}
-		msg->meta = entry->meta;
-		data = kmemdup(entry->buff, entry->meta.msg_len, GFP_KERNEL);
-		if (data == NULL) {
-			kfree(msg);
-			mutex_unlock(&ipa3_ctx->msg_wlan_client_lock);
-			return -ENOMEM;
-		}
-		msg->buff = data;
-		msg->callback = ipa3_send_msg_free;
 		mutex_lock(&ipa3_ctx->msg_lock);
 		list_add_tail(&msg->link, &ipa3_ctx->msg_list);
 		mutex_unlock(&ipa3_ctx->msg_lock);
@@ -687,7 +706,11 @@ int ipa3_deregister_pull_msg(struct ipa_msg_meta *meta)
  * are no messages to read. Upon return, user-space should read the ipa_msg_meta
  * from the start of the buffer to know what type of message was read and its
  * length in the remainder of the buffer. Buffer supplied must be big enough to
- * hold the message meta-data and the largest defined message type
+ * hold the message meta-data and the largest defined message type.
+ *
+ * With the msg_read_batch module parameter set, as many complete messages as
+ * fit in the buffer are returned back to back, each one being an ipa_msg_meta
+ * followed by msg_len bytes of payload.
  *
  * Returns:	how many bytes copied to buffer
  *
@@ -697,71 +720,77 @@ ssize_t ipa3_read(struct file *filp, char __user *buf, size_t count,
 		  loff_t *f_pos)
 {
 	char __user *start;
-	struct ipa3_push_msg *msg = NULL;
+	struct ipa3_push_msg *msg;
+	struct ipa3_push_msg *next;
+	LIST_HEAD(batch);
+	size_t avail = count;
+	size_t len;
 	int ret;
 	DEFINE_WAIT_FUNC(wait, woken_wake_function);
-	int locked;
 
 	start = buf;
 
 	add_wait_queue(&ipa3_ctx->msg_waitq, &wait);
 	while (1) {
 		mutex_lock(&ipa3_ctx->msg_lock);
-		locked = 1;
-
-		if (!list_empty(&ipa3_ctx->msg_list)) {
-			msg = list_first_entry(&ipa3_ctx->msg_list,
-					struct ipa3_push_msg, link);
-			list_del(&msg->link);
+		list_for_each_entry_safe(msg, next, &ipa3_ctx->msg_list, link) {
+			len = sizeof(struct ipa_msg_meta);
+			if (msg->buff)
+				len += msg->meta.msg_len;
+			/* an oversized first message is dropped below */
+			if (len > avail && !list_empty(&batch))
+				break;
+			list_move_tail(&msg->link, &batch);
+			if (len > avail || !READ_ONCE(msg_read_batch))
+				break;
+			avail -= len;
 		}
+		mutex_unlock(&ipa3_ctx->msg_lock);
 
-		IPADBG_LOW("msg=%pK\n", msg);
+		IPADBG_LOW("batch empty=%d\n", list_empty(&batch));
 
-		if (msg) {
-			locked = 0;
-			mutex_unlock(&ipa3_ctx->msg_lock);
-			if (count < sizeof(struct ipa_msg_meta)) {
-				kfree(msg);
-				msg = NULL;
+		ret = 0;
+		list_for_each_entry_safe(msg, next, &batch, link) {
+			if (count < sizeof(struct ipa_msg_meta) ||
+				(msg->buff && count - sizeof(struct ipa_msg_meta) <
+					msg->meta.msg_len)) {
+				IPAERR_RL("msg type %d len %u does not fit %zu\n",
+					msg->meta.msg_type, msg->meta.msg_len,
+					count);
 				ret = -EFAULT;
-				break;
-			}
-			if (copy_to_user(buf, &msg->meta,
-					  sizeof(struct ipa_msg_meta))) {
+			} else if (copy_to_user(buf, &msg->meta,
+					sizeof(struct ipa_msg_meta)) ||
+				(msg->buff && copy_to_user(
+					buf + sizeof(struct ipa_msg_meta),
+					msg->buff, msg->meta.msg_len))) {
+				IPAERR_RL("Failed to copy the data to userspace\n");
 				ret = -EFAULT;
-				kfree(msg);
-				msg = NULL;
-				break;
 			}
-			buf += sizeof(struct ipa_msg_meta);
-			count -= sizeof(struct ipa_msg_meta);
-			if (msg->buff) {
-				if (count >= msg->meta.msg_len) {
-					if (copy_to_user(buf, msg->buff,
-							msg->meta.msg_len)) {
-						IPAERR_RL("Failed to copy the data to userspace\n");
-						msg->callback(msg->buff, msg->meta.msg_len,
-						msg->meta.msg_type);
-						ret = -EFAULT;
-						kfree(msg);
-						msg = NULL;
-						break;
-					}
-				} else {
-					ret = -EFAULT;
-					kfree(msg);
-					msg = NULL;
-					break;
-				}
-				buf += msg->meta.msg_len;
-				count -= msg->meta.msg_len;
-				msg->callback(msg->buff, msg->meta.msg_len,
-					       msg->meta.msg_type);
+
+			list_del(&msg->link);
+			if (ret) {
+				ipa3_push_msg_free(msg);
+				break;
 			}
+
+			len = sizeof(struct ipa_msg_meta);
+			if (msg->buff)
+				len += msg->meta.msg_len;
+			buf += len;
+			count -= len;
 			IPA_STATS_INC_CNT(
 				ipa3_ctx->stats.msg_r[msg->meta.msg_type]);
-			kfree(msg);
-			msg = NULL;
+			ipa3_push_msg_free(msg);
+		}
+
+		if (ret) {
+			/* keep whatever was not delivered, in order */
+			if (!list_empty(&batch)) {
+				mutex_lock(&ipa3_ctx->msg_lock);
+				list_splice(&batch, &ipa3_ctx->msg_list);
+				mutex_unlock(&ipa3_ctx->msg_lock);
+			}
+			break;
 		}
 
 		ret = -EAGAIN;
@@ -775,21 +804,36 @@ ssize_t ipa3_read(struct file *filp, char __user *buf, size_t count,
 		if (start != buf)
 			break;
 
-		locked = 0;
-		mutex_unlock(&ipa3_ctx->msg_lock);
 		wait_woken(&wait, TASK_INTERRUPTIBLE, MAX_SCHEDULE_TIMEOUT);
 	}
 
 	remove_wait_queue(&ipa3_ctx->msg_waitq, &wait);
-	if (start != buf && ret != -EFAULT)
+	/* report what was delivered even if a later message faulted */
+	if (start != buf)
 		ret = buf - start;
 
-	if (locked)
-		mutex_unlock(&ipa3_ctx->msg_lock);
-
 	return ret;
 }
 
+/**
+ * ipa3_poll() - poll for messages on IPA device
+ * @filp:	[in] file pointer
+ * @wait:	[in] poll table
+ *
+ * Returns:	POLLIN | POLLRDNORM when a read would not block
+ */
+unsigned int ipa3_poll(struct file *filp, poll_table *wait)
+{
+	unsigned int mask = 0;
+
+	poll_wait(filp, &ipa3_ctx->msg_waitq, wait);
+
+	if (!list_empty_careful(&ipa3_ctx->msg_list))
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
 /**
  * ipa3_pull_msg() - pull the specified message from client
  * @meta: [in] message meta-data
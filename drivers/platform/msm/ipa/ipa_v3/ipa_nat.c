@@ -37,7 +37,12 @@
 
 #define IPA_NAT_MAX_NUM_OF_INIT_CMD_DESC 4
 #define IPA_IPV6CT_MAX_NUM_OF_INIT_CMD_DESC 3
-#define IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC 5
+/*
+ * Table DMA entries posted per ipa3_send_cmd(), on top of the coal close and
+ * NOP commands which start every chunk
+ */
+#define IPA_TABLE_DMA_CHUNK_ENTRIES 16
+#define IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC (IPA_TABLE_DMA_CHUNK_ENTRIES + 2)
 
 /*
  * The base table max entries is limited by index into table 13 bits number.
@@ -1927,12 +1932,123 @@ static int ipa3_table_validate_table_dma_one(
 }
 
 
+/**
+ * ipa3_table_dma_sram_tbl_ofst() - SRAM offset of a NAT table
+ * @base_addr:	[in] table the DMA entry targets
+ * @ofst:	[out] table offset from the start of the IPA SRAM
+ *
+ * Returns:	0 when the table is an active SRAM NAT table, negative otherwise
+ */
+static int ipa3_table_dma_sram_tbl_ofst(
+	uint8_t base_addr,
+	u32    *ofst)
+{
+	struct ipa3_nat_mem *nm_ptr = &ipa3_ctx->nat_mem;
+	struct ipa3_nat_mem_loc_data *mld_ptr =
+		&nm_ptr->mem_loc[IPA_NAT_MEM_IN_SRAM];
+	char *tbl_addr;
+
+	if (nm_ptr->active_table != IPA_NAT_MEM_IN_SRAM ||
+		!mld_ptr->base_address)
+		return -EINVAL;
+
+	switch (base_addr) {
+	case IPA_NAT_BASE_TBL:
+		tbl_addr = mld_ptr->base_table_addr;
+		break;
+	case IPA_NAT_EXPN_TBL:
+		tbl_addr = mld_ptr->expansion_table_addr;
+		break;
+	case IPA_NAT_INDX_TBL:
+		tbl_addr = mld_ptr->index_table_addr;
+		break;
+	case IPA_NAT_INDEX_EXPN_TBL:
+		tbl_addr = mld_ptr->index_table_expansion_addr;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	*ofst = ipa3_ctx->smem_restricted_bytes + IPA_RAM_NAT_OFST +
+		(u32)(tbl_addr - (char *)mld_ptr->base_address);
+
+	return 0;
+}
+
+/**
+ * ipa3_table_dma_coalesce() - merge a run of table DMA entries
+ * @dma:	[in] table DMA command from the client
+ * @start:	[in] first entry of the run
+ * @buf:	[in] DMA buffer to hold the merged data
+ * @buf_ofst:	[inout] next free byte in buf
+ * @cmd:	[out] DMA_SHARED_MEM command covering the run
+ *
+ * Entries are merged only when they follow each other in the request and
+ * write consecutive 16 bit words of the same SRAM table, so the order in which
+ * the client expects the writes to land is kept. The run is trimmed to a 32 bit
+ * aligned start and size.
+ *
+ * Returns:	number of entries covered by cmd, 1 when nothing was merged
+ */
+static u32 ipa3_table_dma_coalesce(
+	struct ipa_ioc_nat_dma_cmd              *dma,
+	u32                                      start,
+	struct ipa_mem_buffer                   *buf,
+	u32                                     *buf_ofst,
+	struct ipahal_imm_cmd_dma_shared_mem    *cmd)
+{
+	struct ipa_ioc_nat_dma_one *first = &dma->dma[start];
+	__le16 *data;
+	u32 tbl_ofst;
+	u32 run, i;
+
+	if (!buf->base ||
+		ipa3_table_dma_sram_tbl_ofst(first->base_addr, &tbl_ofst))
+		return 1;
+
+	if ((tbl_ofst + first->offset) & 0x3)
+		return 1;
+
+	for (run = 1; start + run < dma->entries; run++) {
+		struct ipa_ioc_nat_dma_one *next = &dma->dma[start + run];
+
+		if (next->table_index != first->table_index ||
+			next->base_addr != first->base_addr ||
+			next->offset != first->offset + run * sizeof(u16))
+			break;
+	}
+
+	run &= ~1U;
+	if (run < 2)
+		return 1;
+
+	*buf_ofst = ALIGN(*buf_ofst, 8);
+	data = (__le16 *)((u8 *)buf->base + *buf_ofst);
+	for (i = 0; i < run; i++)
+		data[i] = cpu_to_le16(dma->dma[start + i].data);
+
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->is_read = false;
+	cmd->skip_pipeline_clear = false;
+	cmd->pipeline_clear_options = IPAHAL_HPS_CLEAR;
+	cmd->system_addr = buf->phys_base + *buf_ofst;
+	cmd->size = run * sizeof(u16);
+	cmd->local_addr = tbl_ofst + first->offset;
+	*buf_ofst += cmd->size;
+
+	return run;
+}
+
 /**
  * ipa3_table_dma_cmd() - Post TABLE_DMA command to IPA HW
  * @dma:	[in] initialization command attributes
  *
  * Called by NAT/IPv6CT clients to post TABLE_DMA command to IPA HW
  *
+ * Entries are sent in chunks of up to IPA_TABLE_DMA_CHUNK_ENTRIES commands,
+ * each preceded by the coal close and pipeline clearing commands. Adjacent
+ * writes to a SRAM NAT table are merged into one DMA_SHARED_MEM command.
+ *
  * Returns:	0 on success, negative on failure
  */
 int ipa3_table_dma_cmd(
@@ -1943,16 +2059,19 @@ int ipa3_table_dma_cmd(
 	enum ipahal_imm_cmd_name cmd_name = IPA_IMM_CMD_NAT_DMA;
 
 	struct ipahal_imm_cmd_table_dma cmd;
+	struct ipahal_imm_cmd_dma_shared_mem mem_cmd;
 	struct ipahal_imm_cmd_pyld *cmd_pyld[IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC];
 	struct ipa3_desc desc[IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC];
+	struct ipa_mem_buffer mem = {0};
 
-	uint8_t cnt, num_cmd = 0;
+	uint8_t num_cmd = 0, num_pre_cmd;
+	u32 cnt, run, buf_ofst = 0;
+	u32 num_dma_cmd = 0, num_chunks = 0;
 
 	int result = 0;
 	int i;
 	struct ipahal_reg_valmask valmask;
 	struct ipahal_imm_cmd_register_write reg_write_coal_close;
-	int max_dma_table_cmds = IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC;
 
 	IPADBG("In\n");
 
@@ -1978,16 +2097,7 @@ int ipa3_table_dma_cmd(
 	memset(cmd_pyld, 0, sizeof(cmd_pyld));
 	memset(desc, 0, sizeof(desc));
 
-	/**
-	 * We use a descriptor for closing coalsceing endpoint
-	 * by immediate command. So, DMA entries should be less than
-	 * IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC - 1 to overcome
-	 * buffer overflow of ipa3_desc array.
-	 */
-	if (ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_COAL_CONS) != -1)
-		max_dma_table_cmds -= 1;
-
-	if (!dma->entries || dma->entries > (max_dma_table_cmds - 1)) {
+	if (!dma->entries) {
 		IPAERR_RL("Invalid number of entries %d\n",
 			dma->entries);
 		result = -EPERM;
@@ -2006,6 +2116,18 @@ int ipa3_table_dma_cmd(
 		}
 	}
 
+	/*
+	 * Merged writes are staged in one buffer for the whole request, each
+	 * run starting 8 bytes aligned. Without it every entry is sent as is.
+	 */
+	if (dma->mem_type == IPA_NAT_MEM_IN_SRAM && dma->entries > 1) {
+		mem.size = dma->entries * sizeof(u16) + dma->entries * 8;
+		mem.base = dma_alloc_coherent(ipa3_ctx->pdev, mem.size,
+			&mem.phys_base, GFP_KERNEL);
+		if (!mem.base)
+			IPADBG("no DMA buffer, table DMA entries not merged\n");
+	}
+
 	/* IC to close the coal frame before HPS Clear if coal is enabled */
 	if (ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_COAL_CONS) != -1
 		&& !ipa3_ctx->ulso_wa) {
@@ -2051,6 +2173,7 @@ int ipa3_table_dma_cmd(
 	ipa3_init_imm_cmd_desc(&desc[num_cmd], cmd_pyld[num_cmd]);
 
 	++num_cmd;
+	num_pre_cmd = num_cmd;
 
 	/*
 	 * NAT_DMA was renamed to TABLE_DMA starting from IPAv4
@@ -2058,36 +2181,73 @@ int ipa3_table_dma_cmd(
 	if (ipa3_ctx->ipa_hw_type >= IPA_HW_v4_0)
 		cmd_name = IPA_IMM_CMD_TABLE_DMA;
 
-	for (cnt = 0; cnt < dma->entries; ++cnt) {
+	/*
+	 * The coal close and NOP commands are reused for every chunk, so each
+	 * chunk starts with an empty pipeline.
+	 */
+	cnt = 0;
+	while (cnt < dma->entries) {
+
+		while (cnt < dma->entries &&
+			num_cmd < IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC) {
+
+			run = ipa3_table_dma_coalesce(
+				dma, cnt, &mem, &buf_ofst, &mem_cmd);
+
+			if (run > 1) {
+				cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+					IPA_IMM_CMD_DMA_SHARED_MEM,
+					&mem_cmd, false);
+			} else {
+				cmd.table_index = dma->dma[cnt].table_index;
+				cmd.base_addr   = dma->dma[cnt].base_addr;
+				cmd.offset      = dma->dma[cnt].offset;
+				cmd.data        = dma->dma[cnt].data;
+
+				cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+					cmd_name, &cmd, false);
+			}
+
+			if (!cmd_pyld[num_cmd]) {
+				IPAERR_RL("Fail to construct table_dma imm cmd\n");
+				result = -ENOMEM;
+				goto destroy_imm_cmd;
+			}
 
-		cmd.table_index = dma->dma[cnt].table_index;
-		cmd.base_addr   = dma->dma[cnt].base_addr;
-		cmd.offset      = dma->dma[cnt].offset;
-		cmd.data        = dma->dma[cnt].data;
+			ipa3_init_imm_cmd_desc(&desc[num_cmd],
+				cmd_pyld[num_cmd]);
 
-		cmd_pyld[num_cmd] =
-			ipahal_construct_imm_cmd(cmd_name, &cmd, false);
+			++num_cmd;
+			cnt += run;
+		}
 
-		if (!cmd_pyld[num_cmd]) {
-			IPAERR_RL("Fail to construct table_dma imm cmd\n");
-			result = -ENOMEM;
+		result = ipa3_send_cmd(num_cmd, desc);
+
+		if (result) {
+			IPAERR("Fail to send table_dma immediate command\n");
 			goto destroy_imm_cmd;
 		}
 
-		ipa3_init_imm_cmd_desc(&desc[num_cmd], cmd_pyld[num_cmd]);
+		num_dma_cmd += num_cmd - num_pre_cmd;
+		++num_chunks;
 
-		++num_cmd;
+		for (; num_cmd > num_pre_cmd; --num_cmd) {
+			ipahal_destroy_imm_cmd(cmd_pyld[num_cmd - 1]);
+			cmd_pyld[num_cmd - 1] = NULL;
+		}
 	}
 
-	result = ipa3_send_cmd(num_cmd, desc);
-
-	if (result)
-		IPAERR("Fail to send table_dma immediate command\n");
+	IPADBG("%u entries sent as %u commands in %u chunks\n",
+		dma->entries, num_dma_cmd, num_chunks);
 
 destroy_imm_cmd:
 	for (cnt = 0; cnt < num_cmd; ++cnt)
 		ipahal_destroy_imm_cmd(cmd_pyld[cnt]);
 
+	if (mem.base)
+		dma_free_coherent(ipa3_ctx->pdev, mem.size, mem.base,
+			mem.phys_base);
+
 bail:
 	IPADBG("Out\n");
 
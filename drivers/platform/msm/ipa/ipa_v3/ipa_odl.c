@@ -9,6 +9,8 @@
 #include <linux/msm_ipa.h>
 #include <linux/sched/signal.h>
 #include <linux/poll.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 
 struct ipa_odl_context *ipa3_odl_ctx;
 
@@ -223,13 +225,78 @@ static void delete_first_node(void)
 	}
 }
 
+/**
+ * ipa3_odl_ring_push() - copy a DPL packet into the ADPL ring
+ * @ring: ring mapped by user-space
+ * @skb: packet to copy
+ *
+ * Single producer: only called from the ODL pipe receive notify, which is
+ * serialized by the sys pipe. The tail written by user-space is only used
+ * to compute free space, so a bogus tail can at worst cause drops.
+ *
+ * Returns: true if the packet was queued, false if it was dropped
+ */
+static bool ipa3_odl_ring_push(struct ipa3_odl_ring *ring,
+	struct sk_buff *skb)
+{
+	struct ipa_odl_ring_ctrl *ctrl = ring->ctrl;
+	struct ipa_odl_ring_rec *rec;
+	u64 head, tail;
+	u32 ofst, rec_len, pad = 0;
+
+	rec_len = ALIGN(sizeof(*rec) + skb->len, IPA_ODL_RING_REC_ALIGN);
+	head = ctrl->head;
+	tail = smp_load_acquire(&ctrl->tail);
+	ofst = head & (ring->data_size - 1);
+
+	/* records never wrap, fill the end of the data area instead */
+	if (ring->data_size - ofst < rec_len)
+		pad = ring->data_size - ofst;
+
+	if (rec_len > ring->data_size ||
+		head - tail > ring->data_size ||
+		rec_len + pad > ring->data_size - (head - tail)) {
+		ctrl->dropped_pkts++;
+		return false;
+	}
+
+	if (pad) {
+		rec = (struct ipa_odl_ring_rec *)(ring->data + ofst);
+		rec->len = pad - sizeof(*rec);
+		rec->flags = IPA_ODL_RING_REC_F_PAD;
+		head += pad;
+		ofst = 0;
+	}
+
+	rec = (struct ipa_odl_ring_rec *)(ring->data + ofst);
+	rec->len = skb->len;
+	rec->flags = 0;
+	skb_copy_bits(skb, 0, rec + 1, skb->len);
+
+	ctrl->produced_pkts++;
+	smp_store_release(&ctrl->head, head + rec_len);
+
+	return true;
+}
+
 int ipa3_send_adpl_msg(unsigned long skb_data)
 {
 	struct ipa3_push_msg_odl *msg;
 	struct sk_buff *skb = (struct sk_buff *)skb_data;
+	struct ipa3_odl_ring *ring;
 	void *data;
 
 	IPADBG_LOW("Processing DPL data\n");
+	ring = smp_load_acquire(&ipa3_odl_ctx->adpl_ring);
+	if (ring) {
+		if (!ipa3_odl_ring_push(ring, skb))
+			IPA_STATS_INC_CNT(ipa3_odl_ctx->stats.odl_drop_pkt);
+		else if (wq_has_sleeper(&ipa3_odl_ctx->adpl_msg_waitq))
+			wake_up(&ipa3_odl_ctx->adpl_msg_waitq);
+		IPA_STATS_INC_CNT(ipa3_odl_ctx->stats.odl_rx_pkt);
+		return 0;
+	}
+
 	msg = kzalloc(sizeof(struct ipa3_push_msg_odl), GFP_KERNEL);
 	if (msg == NULL) {
 		IPADBG("Memory allocation failed\n");
@@ -241,7 +308,6 @@ int ipa3_send_adpl_msg(unsigned long skb_data)
 		kfree(msg);
 		return -ENOMEM;
 	}
-	memcpy(data, skb->data, skb->len);
 	msg->buff = data;
 	msg->len = skb->len;
 	mutex_lock(&ipa3_odl_ctx->adpl_msg_lock);
@@ -424,6 +490,25 @@ fail:
 	return ret;
 
 }
+
+static void ipa3_odl_ring_free(void)
+{
+	struct ipa3_odl_ring *ring;
+
+	mutex_lock(&ipa3_odl_ctx->adpl_msg_lock);
+	ring = ipa3_odl_ctx->adpl_ring;
+	WRITE_ONCE(ipa3_odl_ctx->adpl_ring, NULL);
+	mutex_unlock(&ipa3_odl_ctx->adpl_msg_lock);
+
+	if (!ring)
+		return;
+
+	IPADBG("ADPL ring freed, produced %llu dropped %llu\n",
+		ring->ctrl->produced_pkts, ring->ctrl->dropped_pkts);
+	vfree(ring->vaddr);
+	kfree(ring);
+}
+
 static int ipa_adpl_open(struct inode *inode, struct file *filp)
 {
 	int ret = 0;
@@ -457,6 +542,8 @@ static int ipa_adpl_release(struct inode *inode, struct file *filp)
 	if (ret)
 		IPAERR("failed to activate pm\n");
 	ipa3_odl_pipe_cleanup(false);
+	/* the pipe is gone, nothing can produce into the ring anymore */
+	ipa3_odl_ring_free();
 
 	/* Disable ADPL over ODL for MPM */
 	if (ipa3_is_mhip_offload_enabled()) {
@@ -618,6 +705,105 @@ static ssize_t ipa_adpl_read(struct file *filp, char __user *buf, size_t count,
 	return ret;
 }
 
+/**
+ * ipa_adpl_mmap() - map the ADPL ring to user-space
+ * @filp:	[in] file pointer
+ * @vma:	[in] user mapping, PAGE_SIZE + power of two data size
+ *
+ * Switches DPL delivery from read() to the shared ring for as long as the
+ * device stays open. Packets already queued for read() stay readable.
+ *
+ * Returns:	0 on success, negative on failure
+ */
+static int ipa_adpl_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ipa3_odl_ring *ring;
+	size_t size = vma->vm_end - vma->vm_start;
+	size_t data_size;
+	int ret;
+
+	if (vma->vm_pgoff || size <= PAGE_SIZE) {
+		IPAERR("invalid ADPL ring mapping size %zu\n", size);
+		return -EINVAL;
+	}
+
+	data_size = size - PAGE_SIZE;
+	if (!is_power_of_2(data_size) ||
+		data_size < IPA_ODL_RING_MIN_DATA_SZ ||
+		data_size > IPA_ODL_RING_MAX_DATA_SZ) {
+		IPAERR("invalid ADPL ring data size %zu\n", data_size);
+		return -EINVAL;
+	}
+
+	mutex_lock(&ipa3_odl_ctx->adpl_msg_lock);
+	if (ipa3_odl_ctx->adpl_ring) {
+		IPAERR("ADPL ring already mapped\n");
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	ring->vaddr = vmalloc_user(size);
+	if (!ring->vaddr) {
+		IPAERR("failed to allocate %zu bytes ADPL ring\n", size);
+		ret = -ENOMEM;
+		goto free_ring;
+	}
+	ring->size = size;
+	ring->ctrl = ring->vaddr;
+	ring->data = (u8 *)ring->vaddr + PAGE_SIZE;
+	ring->data_size = data_size;
+
+	ring->ctrl->magic = IPA_ODL_RING_MAGIC;
+	ring->ctrl->version = IPA_ODL_RING_VERSION;
+	ring->ctrl->data_offset = PAGE_SIZE;
+	ring->ctrl->data_size = data_size;
+
+	ret = remap_vmalloc_range(vma, ring->vaddr, 0);
+	if (ret) {
+		IPAERR("failed to map ADPL ring %d\n", ret);
+		goto free_vaddr;
+	}
+
+	smp_store_release(&ipa3_odl_ctx->adpl_ring, ring);
+	mutex_unlock(&ipa3_odl_ctx->adpl_msg_lock);
+	IPADBG("ADPL ring mapped, data size %zu\n", data_size);
+
+	return 0;
+
+free_vaddr:
+	vfree(ring->vaddr);
+free_ring:
+	kfree(ring);
+unlock:
+	mutex_unlock(&ipa3_odl_ctx->adpl_msg_lock);
+	return ret;
+}
+
+static unsigned int ipa_adpl_poll(struct file *filp, poll_table *wait)
+{
+	struct ipa3_odl_ring *ring;
+	unsigned int mask = 0;
+
+	poll_wait(filp, &ipa3_odl_ctx->adpl_msg_waitq, wait);
+
+	ring = smp_load_acquire(&ipa3_odl_ctx->adpl_ring);
+	if (ring) {
+		if (smp_load_acquire(&ring->ctrl->head) !=
+			READ_ONCE(ring->ctrl->tail))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (atomic_read(&ipa3_odl_ctx->stats.numer_in_queue)) {
+		mask |= POLLIN | POLLRDNORM;
+	}
+
+	return mask;
+}
+
 static long ipa_adpl_ioctl(struct file *filp,
 	unsigned int cmd, unsigned long arg)
 {
@@ -670,6 +856,8 @@ static const struct file_operations ipa_adpl_fops = {
 	.release = ipa_adpl_release,
 	.read = ipa_adpl_read,
 	.unlocked_ioctl = ipa_adpl_ioctl,
+	.mmap = ipa_adpl_mmap,
+	.poll = ipa_adpl_poll,
 };
 
 int ipa_odl_init(void)
@@ -800,6 +988,7 @@ void ipa_odl_cleanup(void)
 	odl_cdev = ipa3_odl_ctx->odl_cdev;
 
 	ipa_pm_deregister(ipa3_odl_ctx->odl_pm_hdl);
+	ipa3_odl_ring_free();
 	device_destroy(odl_cdev[1].class, odl_cdev[1].dev_num);
 	unregister_chrdev_region(odl_cdev[1].dev_num, 1);
 	class_destroy(odl_cdev[1].class);
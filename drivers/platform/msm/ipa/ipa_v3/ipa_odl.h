@@ -6,6 +6,8 @@
 #ifndef _IPA3_ODL_H_
 #define _IPA3_ODL_H_
 
+#include "ipa_odl_uapi.h"
+
 #define IPA_ODL_AGGR_BYTE_LIMIT 15
 #define IPA_ODL_RX_RING_SIZE 192
 #define MAX_QUEUE_TO_ODL 1024
@@ -20,6 +22,22 @@ struct ipa3_odlstats {
 	atomic_t numer_in_queue;
 };
 
+/**
+ * struct ipa3_odl_ring - kernel side of the ADPL ring
+ * @vaddr: vmalloc_user() area backing the mapping
+ * @size: size of @vaddr in bytes
+ * @ctrl: control page, at the start of @vaddr
+ * @data: data area
+ * @data_size: copy of ctrl->data_size, never read back from user-space
+ */
+struct ipa3_odl_ring {
+	void *vaddr;
+	size_t size;
+	struct ipa_odl_ring_ctrl *ctrl;
+	u8 *data;
+	u32 data_size;
+};
+
 struct odl_state_bit_mask {
 	u32 odl_init:1;
 	u32 odl_open:1;
@@ -59,6 +77,7 @@ struct ipa_odl_context {
 	struct ipa3_odlstats stats;
 	u32 odl_pm_hdl;
 	wait_queue_head_t adpl_msg_waitq;
+	struct ipa3_odl_ring *adpl_ring;
 };
 
 struct ipa3_push_msg_odl {
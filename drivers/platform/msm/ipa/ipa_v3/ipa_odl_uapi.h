@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-only WITH Linux-syscall-note
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#ifndef _IPA_ODL_UAPI_H_
+#define _IPA_ODL_UAPI_H_
+
+#include <linux/types.h>
+
+/*
+ * ADPL ring mode: user-space mmap()s /dev/ipa_adpl with length
+ * PAGE_SIZE + data_size, data_size being a power of two within
+ * [IPA_ODL_RING_MIN_DATA_SZ, IPA_ODL_RING_MAX_DATA_SZ]. The first page holds
+ * struct ipa_odl_ring_ctrl, the data area follows it. The layout below is
+ * shared with user-space and must not change without bumping the version.
+ */
+#define IPA_ODL_RING_MAGIC 0x52444c4f /* "ODLR" */
+#define IPA_ODL_RING_VERSION 1
+#define IPA_ODL_RING_MIN_DATA_SZ (64 * 1024)
+#define IPA_ODL_RING_MAX_DATA_SZ (16 * 1024 * 1024)
+#define IPA_ODL_RING_REC_ALIGN 8
+#define IPA_ODL_RING_REC_F_PAD 0x1
+
+/**
+ * struct ipa_odl_ring_ctrl - ADPL ring control page
+ * @magic: IPA_ODL_RING_MAGIC
+ * @version: IPA_ODL_RING_VERSION
+ * @data_offset: offset of the data area from the start of the mapping
+ * @data_size: size of the data area in bytes, a power of two
+ * @produced_pkts: packets written to the ring
+ * @dropped_pkts: packets dropped because the ring was full
+ * @head: producer position in bytes, free running, written by the kernel
+ * @tail: consumer position in bytes, free running, written by user-space
+ *
+ * Positions are reduced modulo @data_size to get a data offset. The kernel
+ * publishes @head with release semantics after the record is written and
+ * user-space must publish @tail with release semantics after it is done
+ * with a record. @head and @tail live on separate cache lines.
+ */
+struct ipa_odl_ring_ctrl {
+	__u32 magic;
+	__u32 version;
+	__u32 data_offset;
+	__u32 data_size;
+	__u64 produced_pkts;
+	__u64 dropped_pkts;
+	__u8 reserved0[32];
+	__u64 head;
+	__u8 reserved1[56];
+	__u64 tail;
+	__u8 reserved2[56];
+};
+
+/**
+ * struct ipa_odl_ring_rec - ADPL ring record header
+ * @len: payload length in bytes, the payload follows the header
+ * @flags: IPA_ODL_RING_REC_F_PAD marks filler up to the end of the data
+ *	area, the consumer skips it and continues at offset 0
+ *
+ * Records start at IPA_ODL_RING_REC_ALIGN aligned offsets and never wrap.
+ */
+struct ipa_odl_ring_rec {
+	__u32 len;
+	__u32 flags;
+};
+
+#endif /* _IPA_ODL_UAPI_H_ */
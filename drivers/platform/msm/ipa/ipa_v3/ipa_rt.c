@@ -796,9 +796,10 @@ struct ipa3_rt_tbl *__ipa3_find_rt_tbl(enum ipa_ip_type ip, const char *name)
 	}
 
 	set = &ipa3_ctx->rt_tbl_set[ip];
-	list_for_each_entry(entry, &set->head_rt_tbl_list, link) {
-		if (!ipa3_check_idr_if_freed(entry) &&
-			!strcmp(name, entry->name))
+	hash_for_each_possible(set->name_hash, entry, name_node,
+		ipa3_name_hash(name)) {
+		if (!strcmp(name, entry->name) &&
+			!ipa3_check_idr_if_freed(entry))
 			return entry;
 	}
 
@@ -897,6 +898,8 @@ static struct ipa3_rt_tbl *__ipa_add_rt_tbl(enum ipa_ip_type ip,
 		set->tbl_cnt++;
 		entry->rule_ids = &set->rule_ids;
 		list_add(&entry->link, &set->head_rt_tbl_list);
+		hash_add(set->name_hash, &entry->name_node,
+			ipa3_name_hash(entry->name));
 
 		IPADBG("add rt tbl idx=%d tbl_cnt=%d ip=%d\n", entry->idx,
 				set->tbl_cnt, ip);
@@ -913,6 +916,7 @@ static struct ipa3_rt_tbl *__ipa_add_rt_tbl(enum ipa_ip_type ip,
 	return entry;
 ipa_insert_failed:
 	set->tbl_cnt--;
+	hash_del(&entry->name_node);
 	list_del(&entry->link);
 	idr_destroy(entry->rule_ids);
 fail_rt_idx_alloc:
@@ -950,6 +954,7 @@ static int __ipa_del_rt_tbl(struct ipa3_rt_tbl *entry)
 	rset = &ipa3_ctx->reap_rt_tbl_set[ip];
 
 	entry->rule_ids = NULL;
+	hash_del(&entry->name_node);
 	if (entry->in_sys[IPA_RULE_HASHABLE] ||
 		entry->in_sys[IPA_RULE_NON_HASHABLE]) {
 		list_move(&entry->link, &rset->head_rt_tbl_list);
@@ -1143,7 +1148,7 @@ failed:
 	return res;
 }
 
-static int __ipa_add_rt_rule(enum ipa_ip_type ip, const char *name,
+int __ipa_add_rt_rule(enum ipa_ip_type ip, const char *name,
 		const struct ipa_rt_rule_i *rule, u8 at_rear, u32 *rule_hdl,
 		u16 rule_id, bool user)
 {
@@ -2044,6 +2049,7 @@ int ipa3_reset_rt(enum ipa_ip_type ip, bool user_only)
 		if (tbl->idx != apps_start_idx) {
 			if (!user_only || tbl_user) {
 				tbl->rule_ids = NULL;
+				hash_del(&tbl->name_node);
 				if (tbl->in_sys[IPA_RULE_HASHABLE] ||
 					tbl->in_sys[IPA_RULE_NON_HASHABLE]) {
 					list_move(&tbl->link,
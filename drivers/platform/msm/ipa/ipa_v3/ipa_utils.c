@@ -11,6 +11,7 @@
 #include <linux/interconnect.h>
 #include <linux/msm_gsi.h>
 #include <linux/elf.h>
+#include <linux/stringhash.h>
 #include "ipa_i.h"
 #include "ipahal.h"
 #include "ipahal_nat.h"
@@ -10507,6 +10508,18 @@ void ipa3_id_remove(u32 id)
 	spin_unlock(&ipa3_ctx->idr_lock);
 }
 
+/**
+ * ipa3_name_hash() - hash key of a header or routing table name
+ * @name:	[in] name, at most IPA_RESOURCE_NAME_MAX long
+ *
+ * Returns:	hash key for the name keyed lookup tables
+ */
+u32 ipa3_name_hash(const char *name)
+{
+	return full_name_hash(NULL, name,
+		strnlen(name, IPA_RESOURCE_NAME_MAX));
+}
+
 void ipa3_tag_destroy_imm(void *user1, int user2)
 {
 	ipahal_destroy_imm_cmd(user1);
@@ -0,0 +1,596 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include "ipa_i.h"
+#include "ipa_xsk.h"
+#include <linux/msm_ipa.h>
+#include <linux/poll.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+
+#define IPA_XSK_DEV_NAME "ipa_xsk"
+#define IPA_XSK_DEFAULT_FIFO_SZ 0x800
+#define IPA_XSK_XFER_MAX 32
+#define IPA_XSK_REPL_THRESH 16
+
+/**
+ * struct ipa3_xsk_context - IPA XSK character device
+ * @class: pointer to the struct class
+ * @dev_num: device number
+ * @dev: the device
+ * @cdev: cdev of the device
+ * @lock: serializes open, release and ioctls
+ * @pool: socket of the current opener, NULL when closed
+ */
+struct ipa3_xsk_context {
+	struct class *class;
+	dev_t dev_num;
+	struct device *dev;
+	struct cdev cdev;
+	struct mutex lock;
+	struct ipa3_xsk_pool *pool;
+};
+
+static struct ipa3_xsk_context *ipa3_xsk_ctx;
+
+static void ipa3_xsk_stash(struct ipa3_xsk_pool *pool, u32 frame)
+{
+	/* only a consumer posting a frame twice can overflow the stash */
+	if (likely(pool->stash_cnt < pool->num_frames))
+		pool->stash[pool->stash_cnt++] = frame;
+}
+
+static void ipa3_xsk_unwind(struct ipa3_xsk_pool *pool,
+	struct gsi_xfer_elem *elem, int num)
+{
+	struct ipa3_rx_pkt_wrapper *rx_pkt;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		rx_pkt = elem[i].xfer_user_data;
+		ipa3_xsk_stash(pool, rx_pkt->xsk_frame);
+		kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
+	}
+}
+
+/**
+ * ipa3_xsk_replenish() - post UMEM frames to the bound consumer pipe
+ * @sys: consumer pipe context, sys->xsk set
+ *
+ * Frames kept back by the kernel are posted first, then frames from the
+ * fill ring. When the fill ring runs dry before the pipe is full,
+ * IPA_XSK_F_NEED_WAKEUP is raised so user-space kicks us after refilling.
+ */
+void ipa3_xsk_replenish(struct ipa3_sys_context *sys)
+{
+	struct ipa3_xsk_pool *pool = sys->xsk;
+	struct gsi_xfer_elem elem[IPA_XSK_XFER_MAX];
+	struct ipa3_rx_pkt_wrapper *rx_pkt;
+	u32 rx_len_cached, frame;
+	u64 cons, prod;
+	bool starved = false;
+	bool queued = false;
+	int idx = 0;
+	int ret;
+
+	spin_lock_bh(&pool->lock);
+	rx_len_cached = sys->len;
+	if (rx_len_cached &&
+		sys->rx_pool_sz - rx_len_cached < IPA_XSK_REPL_THRESH)
+		goto unlock;
+
+	cons = pool->fill_cons;
+	prod = smp_load_acquire(&pool->ctrl->fill_prod);
+	if (prod - cons > pool->mask + 1) {
+		IPAERR_RL("bad fill ring prod %llu cons %llu\n", prod, cons);
+		prod = cons;
+	}
+
+	while (rx_len_cached < sys->rx_pool_sz) {
+		if (pool->stash_cnt) {
+			frame = pool->stash[--pool->stash_cnt];
+		} else if (cons != prod) {
+			frame = READ_ONCE(pool->fill[cons & pool->mask]);
+			cons++;
+			if (unlikely(frame >= pool->num_frames)) {
+				pool->ctrl->fill_invalid++;
+				continue;
+			}
+		} else {
+			starved = true;
+			break;
+		}
+
+		rx_pkt = kmem_cache_zalloc(ipa3_ctx->rx_pkt_wrapper_cache,
+			GFP_ATOMIC);
+		if (unlikely(!rx_pkt)) {
+			ipa3_xsk_stash(pool, frame);
+			if (!rx_len_cached && !idx)
+				queue_delayed_work(sys->wq,
+					&sys->replenish_rx_work,
+					msecs_to_jiffies(1));
+			break;
+		}
+		rx_pkt->sys = sys;
+		rx_pkt->xsk_frame = frame;
+		rx_pkt->page_data.page = pool->pages[frame];
+		rx_pkt->page_data.dma_addr = pool->dma[frame];
+		rx_pkt->len = PAGE_SIZE;
+
+		dma_sync_single_for_device(ipa3_ctx->pdev, pool->dma[frame],
+			PAGE_SIZE, DMA_FROM_DEVICE);
+		elem[idx].addr = pool->dma[frame];
+		elem[idx].len = PAGE_SIZE;
+		elem[idx].flags = GSI_XFER_FLAG_EOT;
+		elem[idx].flags |= GSI_XFER_FLAG_EOB;
+		elem[idx].flags |= GSI_XFER_FLAG_BEI;
+		elem[idx].type = GSI_XFER_ELEM_DATA;
+		elem[idx].xfer_user_data = rx_pkt;
+		idx++;
+		rx_len_cached++;
+
+		if (idx == IPA_XSK_XFER_MAX) {
+			ret = gsi_queue_xfer(sys->ep->gsi_chan_hdl, idx,
+				elem, false);
+			if (ret != GSI_STATUS_SUCCESS) {
+				IPAERR("failed to provide buffer: %d\n", ret);
+				WARN_ON(1);
+				ipa3_xsk_unwind(pool, elem, idx);
+				rx_len_cached -= idx;
+				idx = 0;
+				break;
+			}
+			queued = true;
+			idx = 0;
+		}
+	}
+
+	if (idx || queued) {
+		/* only ring doorbell once here */
+		ret = gsi_queue_xfer(sys->ep->gsi_chan_hdl, idx, elem, true);
+		if (ret != GSI_STATUS_SUCCESS) {
+			IPAERR("failed to provide buffer: %d\n", ret);
+			WARN_ON(1);
+			ipa3_xsk_unwind(pool, elem, idx);
+			rx_len_cached -= idx;
+		}
+	}
+	sys->len = rx_len_cached;
+
+	pool->fill_cons = cons;
+	smp_store_release(&pool->ctrl->fill_cons, cons);
+	if (starved && rx_len_cached < sys->rx_pool_sz)
+		WRITE_ONCE(pool->ctrl->flags,
+			pool->ctrl->flags | IPA_XSK_F_NEED_WAKEUP);
+	else
+		WRITE_ONCE(pool->ctrl->flags,
+			pool->ctrl->flags & ~IPA_XSK_F_NEED_WAKEUP);
+unlock:
+	spin_unlock_bh(&pool->lock);
+}
+
+/**
+ * ipa3_xsk_rx() - post a completed UMEM frame on the RX ring
+ * @sys: consumer pipe context, sys->xsk set
+ * @notify: GSI completion of one frame
+ *
+ * No skb is built. If the RX ring is full the packet is dropped and the
+ * frame goes straight back to the pipe.
+ */
+void ipa3_xsk_rx(struct ipa3_sys_context *sys,
+	struct gsi_chan_xfer_notify *notify)
+{
+	struct ipa3_xsk_pool *pool = sys->xsk;
+	struct ipa3_rx_pkt_wrapper *rx_pkt = notify->xfer_user_data;
+	struct ipa_xsk_rx_desc *desc;
+	u32 frame = rx_pkt->xsk_frame;
+	u32 len = notify->bytes_xfered;
+	bool posted = false;
+	u64 cons;
+
+	kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
+
+	spin_lock_bh(&pool->lock);
+	sys->len--;
+	cons = smp_load_acquire(&pool->ctrl->rx_cons);
+	if (unlikely(!len || len > PAGE_SIZE ||
+		pool->rx_prod - cons > pool->mask)) {
+		pool->ctrl->rx_dropped++;
+		ipa3_xsk_stash(pool, frame);
+	} else {
+		dma_sync_single_for_cpu(ipa3_ctx->pdev, pool->dma[frame],
+			len, DMA_FROM_DEVICE);
+		desc = &pool->rx[pool->rx_prod & pool->mask];
+		desc->frame = frame;
+		desc->len = len;
+		pool->rx_prod++;
+		smp_store_release(&pool->ctrl->rx_prod, pool->rx_prod);
+		pool->ctrl->rx_pkts++;
+		pool->ctrl->rx_bytes += len;
+		posted = true;
+	}
+	spin_unlock_bh(&pool->lock);
+
+	if (posted && wq_has_sleeper(&pool->waitq))
+		wake_up_interruptible(&pool->waitq);
+
+	ipa3_xsk_replenish(sys);
+}
+
+/**
+ * ipa3_xsk_free_rx_pkt() - GSI cleanup callback for UMEM frames
+ * @chan_user_data: consumer pipe context
+ * @xfer_user_data: rx wrapper of a frame still owned by the channel
+ *
+ * The frame belongs to user-space, only the wrapper is freed.
+ */
+void ipa3_xsk_free_rx_pkt(void *chan_user_data, void *xfer_user_data)
+{
+	kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, xfer_user_data);
+}
+
+static void ipa3_xsk_unpin(struct ipa3_xsk_pool *pool, u32 mapped,
+	u32 pinned)
+{
+	u32 i;
+
+	for (i = 0; i < mapped; i++)
+		dma_unmap_page(ipa3_ctx->pdev, pool->dma[i], PAGE_SIZE,
+			DMA_FROM_DEVICE);
+	unpin_user_pages_dirty_lock(pool->pages, pinned, true);
+}
+
+static void ipa3_xsk_umem_free(struct ipa3_xsk_pool *pool)
+{
+	if (pool->num_frames)
+		ipa3_xsk_unpin(pool, pool->num_frames, pool->num_frames);
+	pool->num_frames = 0;
+	vfree(pool->vaddr);
+	pool->vaddr = NULL;
+	pool->ctrl = NULL;
+	kvfree(pool->stash);
+	pool->stash = NULL;
+	kvfree(pool->dma);
+	pool->dma = NULL;
+	kvfree(pool->pages);
+	pool->pages = NULL;
+}
+
+static int ipa3_xsk_reg_umem(struct ipa3_xsk_pool *pool,
+	struct ipa_xsk_umem_reg *reg)
+{
+	u32 ring_size, ring_bytes, num = reg->num_frames;
+	int pinned, ret;
+	u32 i;
+
+	if (pool->vaddr) {
+		IPAERR("UMEM already registered\n");
+		return -EBUSY;
+	}
+
+	if (!PAGE_ALIGNED(reg->addr) || num < IPA_XSK_MIN_FRAMES ||
+		num > IPA_XSK_MAX_FRAMES) {
+		IPAERR("invalid UMEM addr 0x%llx frames %u\n", reg->addr, num);
+		return -EINVAL;
+	}
+
+	ring_size = roundup_pow_of_two(num);
+	ring_bytes = PAGE_ALIGN(ring_size * sizeof(struct ipa_xsk_rx_desc));
+
+	pool->pages = kvcalloc(num, sizeof(*pool->pages), GFP_KERNEL);
+	pool->dma = kvcalloc(num, sizeof(*pool->dma), GFP_KERNEL);
+	pool->stash = kvcalloc(num, sizeof(*pool->stash), GFP_KERNEL);
+	pool->size = PAGE_SIZE + 2 * ring_bytes;
+	pool->vaddr = vmalloc_user(pool->size);
+	if (!pool->pages || !pool->dma || !pool->stash || !pool->vaddr) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	pinned = pin_user_pages_fast(reg->addr, num,
+		FOLL_WRITE | FOLL_LONGTERM, pool->pages);
+	if (pinned != num) {
+		IPAERR("pinned %d of %u UMEM pages\n", pinned, num);
+		if (pinned > 0)
+			unpin_user_pages(pool->pages, pinned);
+		ret = pinned < 0 ? pinned : -EFAULT;
+		goto fail;
+	}
+
+	for (i = 0; i < num; i++) {
+		pool->dma[i] = dma_map_page(ipa3_ctx->pdev, pool->pages[i], 0,
+			PAGE_SIZE, DMA_FROM_DEVICE);
+		if (dma_mapping_error(ipa3_ctx->pdev, pool->dma[i])) {
+			IPAERR("failed to map UMEM frame %u\n", i);
+			ipa3_xsk_unpin(pool, i, num);
+			ret = -ENOMEM;
+			goto fail;
+		}
+	}
+	pool->num_frames = num;
+
+	pool->ctrl = pool->vaddr;
+	pool->fill = (u32 *)((u8 *)pool->vaddr + PAGE_SIZE);
+	pool->rx = (struct ipa_xsk_rx_desc *)((u8 *)pool->vaddr +
+		PAGE_SIZE + ring_bytes);
+	pool->mask = ring_size - 1;
+
+	pool->ctrl->magic = IPA_XSK_MAGIC;
+	pool->ctrl->version = IPA_XSK_VERSION;
+	pool->ctrl->num_frames = num;
+	pool->ctrl->frame_size = PAGE_SIZE;
+	pool->ctrl->ring_size = ring_size;
+	pool->ctrl->fill_offset = PAGE_SIZE;
+	pool->ctrl->rx_offset = PAGE_SIZE + ring_bytes;
+	reg->mmap_size = pool->size;
+
+	IPADBG("UMEM registered, %u frames ring size %u\n", num, ring_size);
+	return 0;
+
+fail:
+	ipa3_xsk_umem_free(pool);
+	return ret;
+}
+
+static int ipa3_xsk_bind(struct ipa3_xsk_pool *pool, struct ipa_xsk_bind *bind)
+{
+	struct ipa_sys_connect_params sys_in;
+	int ret;
+
+	if (!pool->vaddr) {
+		IPAERR("no UMEM registered\n");
+		return -EINVAL;
+	}
+
+	if (pool->sys) {
+		IPAERR("already bound to client %d\n", pool->sys->ep->client);
+		return -EBUSY;
+	}
+
+	if (bind->client >= IPA_CLIENT_MAX ||
+		!IPA_CLIENT_IS_CONS(bind->client) ||
+		(bind->desc_fifo_sz % IPA_FIFO_ELEMENT_SIZE)) {
+		IPAERR("bad parm client %u fifo_sz %u\n", bind->client,
+			bind->desc_fifo_sz);
+		return -EINVAL;
+	}
+
+	memset(&sys_in, 0, sizeof(sys_in));
+	sys_in.client = bind->client;
+	sys_in.desc_fifo_sz = bind->desc_fifo_sz ? : IPA_XSK_DEFAULT_FIFO_SZ;
+	sys_in.ipa_ep_cfg.aggr.aggr_en = IPA_BYPASS_AGGR;
+
+	ret = ipa3_setup_xsk_pipe(&sys_in, pool, &pool->clnt_hdl);
+	if (ret) {
+		IPAERR("failed to setup %s %d\n",
+			ipa_clients_strings[bind->client], ret);
+		return ret;
+	}
+	pool->sys = ipa3_ctx->ep[pool->clnt_hdl].sys;
+	IPADBG("bound to %s\n", ipa_clients_strings[bind->client]);
+
+	return 0;
+}
+
+static int ipa3_xsk_open(struct inode *inode, struct file *filp)
+{
+	struct ipa3_xsk_pool *pool;
+	int ret = 0;
+
+	mutex_lock(&ipa3_xsk_ctx->lock);
+	if (ipa3_xsk_ctx->pool) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+	spin_lock_init(&pool->lock);
+	init_waitqueue_head(&pool->waitq);
+	ipa3_xsk_ctx->pool = pool;
+	filp->private_data = pool;
+unlock:
+	mutex_unlock(&ipa3_xsk_ctx->lock);
+	return ret;
+}
+
+static int ipa3_xsk_release(struct inode *inode, struct file *filp)
+{
+	struct ipa3_xsk_pool *pool = filp->private_data;
+
+	mutex_lock(&ipa3_xsk_ctx->lock);
+	if (pool->sys) {
+		/* pending frames come back through the GSI cleanup callback */
+		if (ipa3_teardown_sys_pipe(pool->clnt_hdl)) {
+			/* the channel may still write to UMEM, leak it */
+			IPAERR("failed to teardown pipe, leaking UMEM\n");
+			ipa3_xsk_ctx->pool = NULL;
+			mutex_unlock(&ipa3_xsk_ctx->lock);
+			return 0;
+		}
+		pool->sys->xsk = NULL;
+		IPADBG("unbound, rx %llu dropped %llu\n",
+			pool->ctrl->rx_pkts, pool->ctrl->rx_dropped);
+	}
+	ipa3_xsk_umem_free(pool);
+	kfree(pool);
+	ipa3_xsk_ctx->pool = NULL;
+	mutex_unlock(&ipa3_xsk_ctx->lock);
+
+	return 0;
+}
+
+/**
+ * ipa3_xsk_mmap() - map the control page and the rings to user-space
+ * @filp:	[in] file pointer
+ * @vma:	[in] user mapping, mmap_size from IPA_XSK_IOC_REG_UMEM
+ *
+ * Returns:	0 on success, negative on failure
+ */
+static int ipa3_xsk_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ipa3_xsk_pool *pool = filp->private_data;
+	size_t size = vma->vm_end - vma->vm_start;
+	int ret;
+
+	mutex_lock(&ipa3_xsk_ctx->lock);
+	if (!pool->vaddr || vma->vm_pgoff || size != pool->size) {
+		IPAERR("invalid XSK mapping size %zu\n", size);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = remap_vmalloc_range(vma, pool->vaddr, 0);
+	if (ret)
+		IPAERR("failed to map XSK rings %d\n", ret);
+unlock:
+	mutex_unlock(&ipa3_xsk_ctx->lock);
+	return ret;
+}
+
+static unsigned int ipa3_xsk_poll(struct file *filp, poll_table *wait)
+{
+	struct ipa3_xsk_pool *pool = filp->private_data;
+	unsigned int mask = 0;
+
+	if (!pool->ctrl)
+		return POLLERR;
+
+	poll_wait(filp, &pool->waitq, wait);
+	if (smp_load_acquire(&pool->ctrl->rx_prod) !=
+		READ_ONCE(pool->ctrl->rx_cons))
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
+static long ipa3_xsk_ioctl(struct file *filp, unsigned int cmd,
+	unsigned long arg)
+{
+	struct ipa3_xsk_pool *pool = filp->private_data;
+	struct ipa_xsk_umem_reg reg;
+	struct ipa_xsk_bind bind;
+	int ret = 0;
+
+	mutex_lock(&ipa3_xsk_ctx->lock);
+	switch (cmd) {
+	case IPA_XSK_IOC_REG_UMEM:
+		if (copy_from_user(&reg, (const void __user *)arg,
+			sizeof(reg))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = ipa3_xsk_reg_umem(pool, &reg);
+		if (ret)
+			break;
+		if (copy_to_user((void __user *)arg, &reg, sizeof(reg)))
+			ret = -EFAULT;
+		break;
+	case IPA_XSK_IOC_BIND:
+		if (copy_from_user(&bind, (const void __user *)arg,
+			sizeof(bind))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = ipa3_xsk_bind(pool, &bind);
+		break;
+	case IPA_XSK_IOC_WAKEUP:
+		if (!pool->sys) {
+			ret = -ENOTCONN;
+			break;
+		}
+		IPA_ACTIVE_CLIENTS_INC_SIMPLE();
+		ipa3_xsk_replenish(pool->sys);
+		IPA_ACTIVE_CLIENTS_DEC_SIMPLE();
+		break;
+	default:
+		ret = -ENOIOCTLCMD;
+		break;
+	}
+	mutex_unlock(&ipa3_xsk_ctx->lock);
+
+	return ret;
+}
+
+static const struct file_operations ipa3_xsk_fops = {
+	.owner = THIS_MODULE,
+	.open = ipa3_xsk_open,
+	.release = ipa3_xsk_release,
+	.unlocked_ioctl = ipa3_xsk_ioctl,
+	.mmap = ipa3_xsk_mmap,
+	.poll = ipa3_xsk_poll,
+};
+
+int ipa3_xsk_init(void)
+{
+	int result;
+
+	ipa3_xsk_ctx = kzalloc(sizeof(*ipa3_xsk_ctx), GFP_KERNEL);
+	if (!ipa3_xsk_ctx)
+		return -ENOMEM;
+
+	mutex_init(&ipa3_xsk_ctx->lock);
+
+	ipa3_xsk_ctx->class = class_create(THIS_MODULE, IPA_XSK_DEV_NAME);
+	if (IS_ERR(ipa3_xsk_ctx->class)) {
+		IPAERR("Error: xsk class NULL\n");
+		result = -ENODEV;
+		goto fail_class;
+	}
+
+	result = alloc_chrdev_region(&ipa3_xsk_ctx->dev_num, 0, 1,
+		IPA_XSK_DEV_NAME);
+	if (result) {
+		IPAERR("alloc_chrdev_region error for ipa xsk\n");
+		result = -ENODEV;
+		goto fail_chrdev;
+	}
+
+	ipa3_xsk_ctx->dev = device_create(ipa3_xsk_ctx->class, NULL,
+		ipa3_xsk_ctx->dev_num, ipa3_ctx, IPA_XSK_DEV_NAME);
+	if (IS_ERR(ipa3_xsk_ctx->dev)) {
+		IPAERR("device_create err:%ld\n", PTR_ERR(ipa3_xsk_ctx->dev));
+		result = PTR_ERR(ipa3_xsk_ctx->dev);
+		goto fail_device;
+	}
+
+	cdev_init(&ipa3_xsk_ctx->cdev, &ipa3_xsk_fops);
+	ipa3_xsk_ctx->cdev.owner = THIS_MODULE;
+	result = cdev_add(&ipa3_xsk_ctx->cdev, ipa3_xsk_ctx->dev_num, 1);
+	if (result) {
+		IPAERR("cdev_add err=%d\n", -result);
+		goto fail_cdev;
+	}
+
+	return 0;
+
+fail_cdev:
+	device_destroy(ipa3_xsk_ctx->class, ipa3_xsk_ctx->dev_num);
+fail_device:
+	unregister_chrdev_region(ipa3_xsk_ctx->dev_num, 1);
+fail_chrdev:
+	class_destroy(ipa3_xsk_ctx->class);
+fail_class:
+	kfree(ipa3_xsk_ctx);
+	ipa3_xsk_ctx = NULL;
+	return result;
+}
+
+void ipa3_xsk_cleanup(void)
+{
+	if (!ipa3_xsk_ctx)
+		return;
+
+	cdev_del(&ipa3_xsk_ctx->cdev);
+	device_destroy(ipa3_xsk_ctx->class, ipa3_xsk_ctx->dev_num);
+	unregister_chrdev_region(ipa3_xsk_ctx->dev_num, 1);
+	class_destroy(ipa3_xsk_ctx->class);
+	kfree(ipa3_xsk_ctx);
+	ipa3_xsk_ctx = NULL;
+}
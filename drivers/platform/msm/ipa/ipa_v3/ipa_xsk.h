@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#ifndef _IPA3_XSK_H_
+#define _IPA3_XSK_H_
+
+#include "ipa_xsk_uapi.h"
+
+struct ipa3_sys_context;
+struct gsi_chan_xfer_notify;
+
+/**
+ * struct ipa3_xsk_pool - kernel side of a zero-copy RX socket
+ * @pages: pinned UMEM pages, one per frame
+ * @dma: DMA address of each frame
+ * @num_frames: number of entries in @pages and @dma
+ * @vaddr: vmalloc_user() area with the control page and the rings
+ * @size: size of @vaddr in bytes
+ * @ctrl: control page, at the start of @vaddr
+ * @fill: fill ring
+ * @rx: RX ring
+ * @mask: ring_size - 1, never read back from user-space
+ * @fill_cons: kernel copy of ctrl->fill_cons
+ * @rx_prod: kernel copy of ctrl->rx_prod
+ * @stash: frames the kernel kept back because the RX ring was full
+ * @stash_cnt: valid entries in @stash
+ * @lock: serializes replenish against RX completions and wakeups
+ * @waitq: woken when descriptors are posted on the RX ring
+ * @sys: bound consumer pipe, NULL until IPA_XSK_IOC_BIND
+ * @clnt_hdl: handle of the bound pipe
+ */
+struct ipa3_xsk_pool {
+	struct page **pages;
+	dma_addr_t *dma;
+	u32 num_frames;
+	void *vaddr;
+	size_t size;
+	struct ipa_xsk_ctrl *ctrl;
+	u32 *fill;
+	struct ipa_xsk_rx_desc *rx;
+	u32 mask;
+	u64 fill_cons;
+	u64 rx_prod;
+	u32 *stash;
+	u32 stash_cnt;
+	spinlock_t lock;
+	wait_queue_head_t waitq;
+	struct ipa3_sys_context *sys;
+	u32 clnt_hdl;
+};
+
+int ipa3_xsk_init(void);
+void ipa3_xsk_cleanup(void);
+void ipa3_xsk_replenish(struct ipa3_sys_context *sys);
+void ipa3_xsk_rx(struct ipa3_sys_context *sys,
+	struct gsi_chan_xfer_notify *notify);
+void ipa3_xsk_free_rx_pkt(void *chan_user_data, void *xfer_user_data);
+
+#endif /* _IPA3_XSK_H_ */
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0-only WITH Linux-syscall-note
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#ifndef _IPA_XSK_UAPI_H_
+#define _IPA_XSK_UAPI_H_
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Zero-copy RX socket: user-space registers a page aligned buffer (UMEM)
+ * split into PAGE_SIZE frames, mmap()s /dev/ipa_xsk to get the control
+ * page and the two rings, posts free frame indices on the fill ring and
+ * binds a consumer pipe. IPA DMAs packets straight into UMEM frames and
+ * the driver posts {frame, len} descriptors on the RX ring. Frames go back
+ * to the driver through the fill ring.
+ *
+ * Both rings have ring_size entries, a power of two not smaller than the
+ * number of frames, so an honest consumer can never overflow them. The
+ * layout below is shared with user-space and must not change without
+ * bumping the version.
+ */
+#define IPA_XSK_MAGIC 0x4b535849 /* "IXSK" */
+#define IPA_XSK_VERSION 1
+#define IPA_XSK_MIN_FRAMES 64
+#define IPA_XSK_MAX_FRAMES 16384
+#define IPA_XSK_F_NEED_WAKEUP 0x1
+
+/**
+ * struct ipa_xsk_umem_reg - IPA_XSK_IOC_REG_UMEM argument
+ * @addr: [in] page aligned start of the UMEM
+ * @num_frames: [in] number of PAGE_SIZE frames in the UMEM
+ * @mmap_size: [out] length to mmap() the control page and rings with
+ */
+struct ipa_xsk_umem_reg {
+	__u64 addr;
+	__u32 num_frames;
+	__u32 mmap_size;
+};
+
+/**
+ * struct ipa_xsk_bind - IPA_XSK_IOC_BIND argument
+ * @client: enum ipa_client_type of an unused APPS consumer pipe
+ * @desc_fifo_sz: GSI ring size in bytes, 0 picks a default
+ */
+struct ipa_xsk_bind {
+	__u32 client;
+	__u32 desc_fifo_sz;
+};
+
+#define IPA_XSK_IOC_MAGIC 0xCE
+#define IPA_XSK_IOC_REG_UMEM _IOWR(IPA_XSK_IOC_MAGIC, 0, \
+	struct ipa_xsk_umem_reg)
+#define IPA_XSK_IOC_BIND _IOW(IPA_XSK_IOC_MAGIC, 1, struct ipa_xsk_bind)
+#define IPA_XSK_IOC_WAKEUP _IO(IPA_XSK_IOC_MAGIC, 2)
+
+/**
+ * struct ipa_xsk_rx_desc - RX ring entry
+ * @frame: UMEM frame index holding the packet, data starts at offset 0
+ * @len: packet length in bytes
+ */
+struct ipa_xsk_rx_desc {
+	__u32 frame;
+	__u32 len;
+};
+
+/**
+ * struct ipa_xsk_ctrl - control page, first page of the mapping
+ * @magic: IPA_XSK_MAGIC
+ * @version: IPA_XSK_VERSION
+ * @num_frames: number of UMEM frames
+ * @frame_size: size of a UMEM frame in bytes
+ * @ring_size: entries in each ring, a power of two
+ * @fill_offset: offset of the fill ring (__u32 frame indices)
+ * @rx_offset: offset of the RX ring (struct ipa_xsk_rx_desc)
+ * @flags: IPA_XSK_F_NEED_WAKEUP when the pipe ran out of fill entries and
+ *	user-space must issue IPA_XSK_IOC_WAKEUP after refilling
+ * @rx_pkts: packets posted on the RX ring
+ * @rx_bytes: bytes posted on the RX ring
+ * @rx_dropped: packets dropped because the RX ring was full
+ * @fill_invalid: fill ring entries ignored for being out of range
+ * @fill_prod: fill ring producer, written by user-space
+ * @fill_cons: fill ring consumer, written by the kernel
+ * @rx_prod: RX ring producer, written by the kernel
+ * @rx_cons: RX ring consumer, written by user-space
+ *
+ * Ring positions are free running and reduced modulo @ring_size. Each side
+ * publishes its position with release semantics after it is done with the
+ * entries and reads the other side's with acquire semantics.
+ */
+struct ipa_xsk_ctrl {
+	__u32 magic;
+	__u32 version;
+	__u32 num_frames;
+	__u32 frame_size;
+	__u32 ring_size;
+	__u32 fill_offset;
+	__u32 rx_offset;
+	__u32 flags;
+	__u64 rx_pkts;
+	__u64 rx_bytes;
+	__u64 rx_dropped;
+	__u64 fill_invalid;
+	__u64 fill_prod;
+	__u8 reserved0[56];
+	__u64 fill_cons;
+	__u8 reserved1[56];
+	__u64 rx_prod;
+	__u8 reserved2[56];
+	__u64 rx_cons;
+	__u8 reserved3[56];
+};
+
+#endif /* _IPA_XSK_UAPI_H_ */
@@ -22,6 +22,8 @@
 #include <linux/version.h>
 #include <linux/workqueue.h>
 #include <linux/debugfs.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
 #include <net/pkt_sched.h>
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
 #include <soc/qcom/subsystem_restart.h>
@@ -33,6 +35,7 @@
 #include <linux/ipa.h>
 #include <uapi/linux/ip.h>
 #include <uapi/linux/msm_rmnet.h>
+#include <net/ip.h>
 #include <net/ipv6.h>
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0))
 #include <linux/if_rmnet.h>
@@ -49,6 +52,16 @@
 #define OUTSTANDING_HIGH_CTL_DEFAULT (OUTSTANDING_HIGH_DEFAULT + 32)
 #define OUTSTANDING_LOW_DEFAULT 128
 
+/* TX queues of the WWAN netdev and the PROD pipe each one is mapped to */
+#define RMNET_IPA_TXQ_DEFAULT 0 /* IPA_CLIENT_APPS_WAN_PROD */
+#define RMNET_IPA_TXQ_LOW_LAT 1 /* IPA_CLIENT_APPS_WAN_LOW_LAT_DATA_PROD */
+#define RMNET_IPA_MAX_TXQ 2
+#define RMNET_IPA_LL_TXQ_PRIO_DEFAULT TC_PRIO_INTERACTIVE
+
+/* software RSS channels fanning WAN DL out of the pipe's NAPI context */
+#define RMNET_IPA_MAX_RSS_CH 8
+#define RMNET_IPA_RSS_BACKLOG 1000
+
 #define WWAN_METADATA_SHFT 24
 #define WWAN_METADATA_MASK 0xFF000000
 #define WWAN_DATA_LEN 9216
@@ -127,7 +140,66 @@ struct ipa3_rmnet_plat_drv_res {
 	bool ipa_rmnet_ssr;
 	bool ipa_advertise_sg_support;
 	bool ipa_napi_enable;
+	bool ipa_mq_tx_enable;
 	u32 wan_rx_desc_size;
+	u32 wan_rss_channels;
+	u32 wan_rss_cpu_mask;
+};
+
+/**
+ * struct ipa3_wwan_txq - per TX queue data of the WWAN netdev
+ * @outstanding_pkts: packets sent on this queue without TX complete ACKed
+ * @tx_pkts: packets sent to IPA on this queue
+ * @tx_bytes: bytes sent to IPA on this queue
+ * @tx_dropped: packets dropped on this queue
+ * @tx_busy: number of times NETDEV_TX_BUSY was returned on this queue
+ * @stopped: number of times the queue was stopped on the high watermark
+ * @woken: number of times the queue was woken on the low watermark
+ */
+struct ipa3_wwan_txq {
+	atomic_t outstanding_pkts;
+	u64 tx_pkts;
+	u64 tx_bytes;
+	u64 tx_dropped;
+	u32 tx_busy;
+	u32 stopped;
+	u32 woken;
+};
+
+/**
+ * struct ipa3_wwan_rss_ch - software RSS channel of the WWAN netdev
+ * @napi: NAPI instance delivering this channel's packets to the stack
+ * @rxq: packets steered to this channel by the WAN pipe's NAPI poll
+ * @process_q: packets taken off @rxq, only touched by @napi
+ * @csd: IPI used to schedule @napi on @cpu
+ * @ipi_pending: @csd is in flight
+ * @cpu: CPU @napi is pinned to
+ * @rx_pkts: packets passed to the stack
+ * @rx_bytes: bytes passed to the stack
+ * @rx_dropped: packets the stack refused
+ * @backlog_drops: packets dropped because @rxq was full
+ * @polls: number of @napi polls
+ * @ipis: number of IPIs sent to @cpu
+ * @last_pkts: @rx_pkts at the previous stats read
+ * @last_bytes: @rx_bytes at the previous stats read
+ * @last_ts: time of the previous stats read in ns
+ */
+struct ipa3_wwan_rss_ch {
+	struct napi_struct napi;
+	struct sk_buff_head rxq;
+	struct sk_buff_head process_q;
+	call_single_data_t csd;
+	atomic_t ipi_pending;
+	int cpu;
+	u64 rx_pkts;
+	u64 rx_bytes;
+	u64 rx_dropped;
+	u64 backlog_drops;
+	u64 polls;
+	u64 ipis;
+	u64 last_pkts;
+	u64 last_bytes;
+	u64 last_ts;
 };
 
 /**
@@ -135,9 +207,15 @@ struct ipa3_rmnet_plat_drv_res {
  * @net: network interface struct implemented by this driver
  * @stats: iface statistics
  * @outstanding_pkts: number of packets sent to IPA without TX complete ACKed
+ * @txq: per TX queue flow control state and statistics
  * @ch_id: channel id
  * @lock: spinlock for mutual exclusion
  * @device_status: holds device status
+ * @napi: NAPI instance polling the WAN consumer pipes
+ * @rss: software RSS channels, valid up to @num_rss
+ * @num_rss: number of RSS channels in use, 0 when RSS is off
+ * @rss_kick: bitmap of RSS channels that got packets and are not kicked yet,
+ *	only changed with atomic bitops
  *
  * WWAN private - holds all relevant info about WWAN driver
  */
@@ -145,11 +223,15 @@ struct ipa3_wwan_private {
 	struct net_device *net;
 	struct net_device_stats stats;
 	atomic_t outstanding_pkts;
+	struct ipa3_wwan_txq txq[RMNET_IPA_MAX_TXQ];
 	uint32_t ch_id;
 	spinlock_t lock;
 	struct completion resource_granted_completion;
 	enum ipa3_wwan_device_status device_status;
 	struct napi_struct napi;
+	struct ipa3_wwan_rss_ch rss[RMNET_IPA_MAX_RSS_CH];
+	u32 num_rss;
+	unsigned long rss_kick;
 };
 
 struct ipa3_netmgr_clock_vote {
@@ -196,6 +278,7 @@ struct rmnet_ipa3_context {
 	u32 outstanding_high;
 	u32 outstanding_high_ctl;
 	u32 outstanding_low;
+	u32 ll_txq_prio;
 	struct rmnet_ipa_debugfs dbgfs;
 	bool dl_csum_offload_enabled;
 	atomic_t ap_suspend;
@@ -1316,6 +1399,304 @@ static void ipa3_cleanup_deregister_intf(void)
 	}
 }
 
+/*
+ * Software RSS for WAN DL: the WAN consumer pipes are polled by one NAPI
+ * instance, so the pipe poll only splits each frame into its QMAP packets
+ * and steers every packet by a hash of its 5-tuple onto one of num_rss
+ * NAPI instances, each pinned to its own CPU. All packets of a flow land
+ * on the same channel so per-flow ordering is kept.
+ */
+struct ipa3_wwan_qmap_hdr {
+	u8 cd_pad;
+	u8 mux_id;
+	__be16 pkt_len;
+} __packed;
+
+#define IPA3_WWAN_QMAP_CD_BIT 0x80
+
+static u32 ipa3_wwan_rss_seed __read_mostly;
+
+static u32 ipa3_wwan_rss_hash(struct sk_buff *skb, u32 off, u32 hdr_len)
+{
+	struct iphdr _iph, *iph;
+	struct ipv6hdr _ip6h, *ip6h;
+	__be32 _ports, *ports;
+	u32 saddr, daddr, l4_ofst;
+	u8 _ver, *ver;
+	u8 proto;
+
+	/* MAPv4 DL checksum uses a trailer, MAPv5 a header after QMAP */
+	off += sizeof(struct ipa3_wwan_qmap_hdr);
+	ver = skb_header_pointer(skb, off, sizeof(_ver), &_ver);
+	if (ver && (*ver >> 4) != 4 && (*ver >> 4) != 6 &&
+		hdr_len > sizeof(struct ipa3_wwan_qmap_hdr)) {
+		off += hdr_len - sizeof(struct ipa3_wwan_qmap_hdr);
+		ver = skb_header_pointer(skb, off, sizeof(_ver), &_ver);
+	}
+	if (!ver)
+		return 0;
+
+	switch (*ver >> 4) {
+	case 4:
+		iph = skb_header_pointer(skb, off, sizeof(_iph), &_iph);
+		if (!iph || iph->ihl < 5)
+			return 0;
+		saddr = (__force u32)iph->saddr;
+		daddr = (__force u32)iph->daddr;
+		proto = iph->protocol;
+		if (ip_is_fragment(iph))
+			return jhash_3words(saddr, daddr, 0,
+				ipa3_wwan_rss_seed ^ proto);
+		l4_ofst = off + iph->ihl * 4;
+		break;
+	case 6:
+		ip6h = skb_header_pointer(skb, off, sizeof(_ip6h), &_ip6h);
+		if (!ip6h)
+			return 0;
+		saddr = ipv6_addr_hash(&ip6h->saddr);
+		daddr = ipv6_addr_hash(&ip6h->daddr);
+		proto = ip6h->nexthdr;
+		l4_ofst = off + sizeof(*ip6h);
+		break;
+	default:
+		return 0;
+	}
+
+	switch (proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+	case IPPROTO_UDPLITE:
+	case IPPROTO_SCTP:
+		ports = skb_header_pointer(skb, l4_ofst, sizeof(_ports),
+			&_ports);
+		break;
+	default:
+		ports = NULL;
+		break;
+	}
+
+	return jhash_3words(saddr, daddr, ports ? (__force u32)*ports : 0,
+		ipa3_wwan_rss_seed ^ proto);
+}
+
+static void ipa3_wwan_rss_enqueue(struct net_device *dev,
+	struct sk_buff *skb, u32 hash)
+{
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
+	u32 idx = reciprocal_scale(hash, wwan_ptr->num_rss);
+	struct ipa3_wwan_rss_ch *ch = &wwan_ptr->rss[idx];
+
+	if (skb_queue_len(&ch->rxq) >= RMNET_IPA_RSS_BACKLOG) {
+		ch->backlog_drops++;
+		kfree_skb(skb);
+		return;
+	}
+
+	skb_reset_mac_header(skb);
+	skb_queue_tail(&ch->rxq, skb);
+	set_bit(idx, &wwan_ptr->rss_kick);
+}
+
+/**
+ * ipa3_wwan_rss_steer() - split a WAN DL frame and steer its packets
+ * @dev: WWAN netdev
+ * @skb: frame as received from the WAN consumer pipe
+ *
+ * Aggregated frames carry several QMAP packets, possibly of different
+ * flows, so each one is cloned out of the frame and steered on its own.
+ * QMAP commands and anything that does not parse go to channel 0 as is.
+ * With MAPv4 DL checksum offload every packet is followed by a checksum
+ * trailer that pkt_len does not count.
+ */
+static void ipa3_wwan_rss_steer(struct net_device *dev, struct sk_buff *skb)
+{
+	struct ipa_ep_cfg *ep_cfg = &rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.ipa_ep_cfg;
+	u32 hdr_len = ep_cfg->hdr.hdr_len;
+	u32 trailer_len = 0;
+	struct ipa3_wwan_qmap_hdr _qh, *qh;
+	struct sk_buff *nskb;
+	u32 off = 0;
+	u32 len;
+	u32 hash;
+
+	if (hdr_len < sizeof(_qh))
+		hdr_len = sizeof(_qh);
+	if (ep_cfg->cfg.cs_offload_en == IPA_ENABLE_CS_OFFLOAD_DL)
+		trailer_len = sizeof(struct rmnet_map_dl_csum_trailer);
+
+	for (;;) {
+		qh = skb_header_pointer(skb, off, sizeof(_qh), &_qh);
+		if (!qh || (qh->cd_pad & IPA3_WWAN_QMAP_CD_BIT) ||
+			!qh->pkt_len) {
+			hash = 0;
+			len = skb->len - off;
+		} else {
+			hash = ipa3_wwan_rss_hash(skb, off, hdr_len);
+			len = ntohs(qh->pkt_len) + hdr_len + trailer_len;
+		}
+
+		if (off + len >= skb->len)
+			break;
+
+		nskb = skb_clone(skb, GFP_ATOMIC);
+		if (!nskb || pskb_trim(nskb, off + len) ||
+			!pskb_pull(nskb, off)) {
+			kfree_skb(nskb);
+			dev->stats.rx_dropped++;
+		} else {
+			ipa3_wwan_rss_enqueue(dev, nskb, hash);
+		}
+		off += len;
+	}
+
+	if (off && !pskb_pull(skb, off)) {
+		kfree_skb(skb);
+		dev->stats.rx_dropped++;
+		return;
+	}
+	ipa3_wwan_rss_enqueue(dev, skb, hash);
+}
+
+static void ipa3_wwan_rss_ipi(void *info)
+{
+	struct ipa3_wwan_rss_ch *ch = info;
+
+	atomic_set(&ch->ipi_pending, 0);
+	napi_schedule(&ch->napi);
+}
+
+/*
+ * Schedule every channel that got packets during the last pipe poll. The
+ * pipe NAPI is already completed here and its next poll may run on another
+ * CPU and set new bits meanwhile, so the bitmap is taken atomically; bits
+ * set after the exchange are kicked by the poll that set them.
+ */
+static void ipa3_wwan_rss_kick(struct ipa3_wwan_private *wwan_ptr)
+{
+	unsigned long kick = xchg(&wwan_ptr->rss_kick, 0);
+	struct ipa3_wwan_rss_ch *ch;
+	unsigned int idx;
+
+	for_each_set_bit(idx, &kick, wwan_ptr->num_rss) {
+		ch = &wwan_ptr->rss[idx];
+		if (ch->cpu == smp_processor_id()) {
+			napi_schedule(&ch->napi);
+			continue;
+		}
+		if (atomic_xchg(&ch->ipi_pending, 1))
+			continue;
+		if (smp_call_function_single_async(ch->cpu, &ch->csd)) {
+			/* target CPU is offline, run the channel here */
+			atomic_set(&ch->ipi_pending, 0);
+			napi_schedule(&ch->napi);
+			continue;
+		}
+		ch->ipis++;
+	}
+}
+
+static int ipa3_wwan_rss_poll(struct napi_struct *napi, int budget)
+{
+	struct ipa3_wwan_rss_ch *ch =
+		container_of(napi, struct ipa3_wwan_rss_ch, napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	ch->polls++;
+	while (work < budget) {
+		skb = __skb_dequeue(&ch->process_q);
+		if (!skb) {
+			spin_lock_irq(&ch->rxq.lock);
+			skb_queue_splice_tail_init(&ch->rxq, &ch->process_q);
+			spin_unlock_irq(&ch->rxq.lock);
+			if (skb_queue_empty(&ch->process_q))
+				break;
+			continue;
+		}
+
+		ch->rx_pkts++;
+		ch->rx_bytes += skb->len;
+		if (netif_receive_skb(skb))
+			ch->rx_dropped++;
+		work++;
+	}
+
+	/* a kick racing with this completion is caught by NAPI_STATE_MISSED */
+	if (work < budget)
+		napi_complete_done(napi, work);
+
+	return work;
+}
+
+static int ipa3_wwan_rss_next_cpu(int cpu, u32 mask)
+{
+	int i;
+
+	for (i = 0; i < nr_cpu_ids; i++) {
+		cpu = cpumask_next(cpu, cpu_possible_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_possible_mask);
+		if (!mask || (cpu < 32 && (mask & BIT(cpu))))
+			return cpu;
+	}
+
+	return cpumask_first(cpu_possible_mask);
+}
+
+static void ipa3_wwan_rss_init(struct net_device *dev)
+{
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
+	struct ipa3_wwan_rss_ch *ch;
+	u32 num = ipa3_rmnet_res.wan_rss_channels;
+	int cpu = -1;
+	int i;
+
+	wwan_ptr->num_rss = 0;
+	wwan_ptr->rss_kick = 0;
+	if (num < 2)
+		return;
+
+	if (!ipa3_rmnet_res.ipa_napi_enable) {
+		IPAWANERR("WAN RSS needs NAPI, keeping a single RX context\n");
+		return;
+	}
+
+	num = min_t(u32, num, RMNET_IPA_MAX_RSS_CH);
+	ipa3_wwan_rss_seed = get_random_u32();
+	for (i = 0; i < num; i++) {
+		ch = &wwan_ptr->rss[i];
+		memset(ch, 0, sizeof(*ch));
+		skb_queue_head_init(&ch->rxq);
+		skb_queue_head_init(&ch->process_q);
+		ch->csd.func = ipa3_wwan_rss_ipi;
+		ch->csd.info = ch;
+		cpu = ipa3_wwan_rss_next_cpu(cpu,
+			ipa3_rmnet_res.wan_rss_cpu_mask);
+		ch->cpu = cpu;
+		netif_napi_add(dev, &ch->napi, ipa3_wwan_rss_poll,
+			NAPI_WEIGHT);
+		IPAWANDBG("WAN RSS channel %d on cpu %d\n", i, cpu);
+	}
+	wwan_ptr->num_rss = num;
+}
+
+/* the pipe NAPI must be disabled before, so nothing is steered anymore */
+static void ipa3_wwan_rss_stop(struct ipa3_wwan_private *wwan_ptr)
+{
+	struct ipa3_wwan_rss_ch *ch;
+	int i;
+
+	for (i = 0; i < wwan_ptr->num_rss; i++) {
+		ch = &wwan_ptr->rss[i];
+		while (atomic_read(&ch->ipi_pending))
+			cpu_relax();
+		napi_disable(&ch->napi);
+		skb_queue_purge(&ch->rxq);
+		__skb_queue_purge(&ch->process_q);
+	}
+	wwan_ptr->rss_kick = 0;
+}
+
 #ifdef INIT_COMPLETION
 #define reinit_completion(x) INIT_COMPLETION(*(x))
 #endif /* INIT_COMPLETION */
@@ -1323,14 +1704,18 @@ static void ipa3_cleanup_deregister_intf(void)
 static int __ipa_wwan_open(struct net_device *dev)
 {
 	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
+	int i;
 
 	IPAWANDBG("[%s] __wwan_open()\n", dev->name);
 	if (wwan_ptr->device_status != WWAN_DEVICE_ACTIVE)
 		reinit_completion(&wwan_ptr->resource_granted_completion);
 	wwan_ptr->device_status = WWAN_DEVICE_ACTIVE;
 
-	if (ipa3_rmnet_res.ipa_napi_enable)
+	if (ipa3_rmnet_res.ipa_napi_enable) {
+		for (i = 0; i < wwan_ptr->num_rss; i++)
+			napi_enable(&wwan_ptr->rss[i].napi);
 		napi_enable(&(wwan_ptr->napi));
+	}
 	return 0;
 }
 
@@ -1351,7 +1736,7 @@ static int ipa3_wwan_open(struct net_device *dev)
 	IPAWANDBG("[%s] wwan_open()\n", dev->name);
 	rc = __ipa_wwan_open(dev);
 	if (rc == 0)
-		netif_start_queue(dev);
+		netif_tx_start_all_queues(dev);
 	return rc;
 }
 
@@ -1395,9 +1780,11 @@ static int ipa3_wwan_stop(struct net_device *dev)
 
 	IPAWANDBG("[%s]\n", dev->name);
 	__ipa_wwan_close(dev);
-	if (ipa3_rmnet_res.ipa_napi_enable)
+	if (ipa3_rmnet_res.ipa_napi_enable) {
 		napi_disable(&(wwan_ptr->napi));
-	netif_stop_queue(dev);
+		ipa3_wwan_rss_stop(wwan_ptr);
+	}
+	netif_tx_stop_all_queues(dev);
 	return 0;
 }
 
@@ -1411,12 +1798,60 @@ static int ipa3_wwan_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+static bool ipa3_wwan_is_qmap_cmd(struct sk_buff *skb)
+{
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
+	return RMNET_MAP_GET_CD_BIT(skb);
+#else
+	return (((struct rmnet_map_header *)(void *)(skb->data))->flags &
+		MAP_CMD_FLAG) ? true : false;
+#endif
+}
+
+/**
+ * ipa3_wwan_select_queue() - Picks the TX queue of an skb.
+ *
+ * @dev: network device
+ * @skb: skb to be transmitted
+ *
+ * When multi-queue TX is enabled, data frames with a priority at or above
+ * ll_txq_prio go to the low latency queue, as long as the low latency data
+ * PROD pipe is up. QMAP commands always stay on the default queue.
+ *
+ * Return: TX queue index
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0))
+static u16 ipa3_wwan_select_queue(struct net_device *dev,
+	struct sk_buff *skb, struct net_device *sb_dev)
+#else /* Legacy API. */
+static u16 ipa3_wwan_select_queue(struct net_device *dev,
+	struct sk_buff *skb, struct net_device *sb_dev,
+	select_queue_fallback_t fallback)
+#endif
+{
+	if (dev->real_num_tx_queues < RMNET_IPA_MAX_TXQ ||
+		!ipa3_rmnet_ll_tx_ready())
+		return RMNET_IPA_TXQ_DEFAULT;
+
+	if (skb->protocol != htons(ETH_P_MAP) ||
+		ipa3_wwan_is_qmap_cmd(skb))
+		return RMNET_IPA_TXQ_DEFAULT;
+
+	if (skb->priority >= rmnet_ipa3_ctx->ll_txq_prio)
+		return RMNET_IPA_TXQ_LOW_LAT;
+
+	return RMNET_IPA_TXQ_DEFAULT;
+}
+
 /**
  * ipa3_wwan_xmit() - Transmits an skb.
  *
  * @skb: skb to be transmitted
  * @dev: network device
  *
+ * Flow control is done per TX queue against the outstanding watermarks,
+ * and every queue reports its in-flight bytes to BQL.
+ *
  * Return codes:
  * 0: success
  * NETDEV_TX_BUSY: Error while transmitting the skb. Try again
@@ -1429,11 +1864,26 @@ static netdev_tx_t ipa3_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 	bool qmap_check;
 	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
 	unsigned long flags;
+	u16 q = skb_get_queue_mapping(skb);
+	struct netdev_queue *txq;
+	struct ipa3_wwan_txq *wtxq;
+	struct ipa3_wwan_tx_cb saved_cb;
+	enum ipa_client_type client;
+	unsigned int len;
+
+	if (q >= RMNET_IPA_MAX_TXQ)
+		q = RMNET_IPA_TXQ_DEFAULT;
+	txq = netdev_get_tx_queue(dev, q);
+	wtxq = &wwan_ptr->txq[q];
+	client = (q == RMNET_IPA_TXQ_LOW_LAT) ?
+		IPA_CLIENT_APPS_WAN_LOW_LAT_DATA_PROD :
+		IPA_CLIENT_APPS_WAN_PROD;
 
 	if (rmnet_ipa3_ctx->ipa_config_is_apq) {
 		IPAWANERR_RL("IPA embedded data on APQ platform\n");
 		dev_kfree_skb_any(skb);
 		dev->stats.tx_dropped++;
+		wtxq->tx_dropped++;
 		return NETDEV_TX_OK;
 	}
 
@@ -1443,49 +1893,49 @@ static netdev_tx_t ipa3_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 		current->comm);
 		dev_kfree_skb_any(skb);
 		dev->stats.tx_dropped++;
+		wtxq->tx_dropped++;
 		return NETDEV_TX_OK;
 	}
 
-#if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 14, 0))
-	qmap_check = RMNET_MAP_GET_CD_BIT(skb);
-#else
-	qmap_check = (((struct rmnet_map_header *)(void *)(skb->data))->flags & MAP_CMD_FLAG) ?
-			true : false;
-#endif
+	qmap_check = ipa3_wwan_is_qmap_cmd(skb);
 	spin_lock_irqsave(&wwan_ptr->lock, flags);
 	/* There can be a race between enabling the wake queue and
 	 * suspend in progress. Check if suspend is pending and
 	 * return from here itself.
 	 */
 	if (atomic_read(&rmnet_ipa3_ctx->ap_suspend)) {
-		netif_stop_queue(dev);
+		netif_tx_stop_queue(txq);
+		wtxq->tx_busy++;
 		spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 		return NETDEV_TX_BUSY;
 	}
-	if (netif_queue_stopped(dev)) {
+	if (netif_tx_queue_stopped(txq)) {
 		if (qmap_check &&
-			atomic_read(&wwan_ptr->outstanding_pkts) <
+			atomic_read(&wtxq->outstanding_pkts) <
 				rmnet_ipa3_ctx->outstanding_high_ctl) {
-			IPAWANERR("[%s]Queue stop, send ctrl pkts\n",
-							dev->name);
+			IPAWANERR("[%s]Queue %u stop, send ctrl pkts\n",
+							dev->name, q);
 			goto send;
 		} else {
-			IPAWANERR("[%s]fatal: %s stopped\n", dev->name,
-							__func__);
+			IPAWANERR("[%s]fatal: %s queue %u stopped\n",
+				dev->name, __func__, q);
+			wtxq->tx_busy++;
 			spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 			return NETDEV_TX_BUSY;
 		}
 	}
 	/* checking High WM hit */
-	if (atomic_read(&wwan_ptr->outstanding_pkts) >=
+	if (atomic_read(&wtxq->outstanding_pkts) >=
 		rmnet_ipa3_ctx->outstanding_high) {
 		if (!qmap_check) {
-			IPAWANDBG_LOW("pending(%d)/(%d)- stop(%d)\n",
-				atomic_read(&wwan_ptr->outstanding_pkts),
+			IPAWANDBG_LOW("q(%u) pending(%d)/(%d)- stop(%d)\n",
+				q, atomic_read(&wtxq->outstanding_pkts),
 				rmnet_ipa3_ctx->outstanding_high,
-				netif_queue_stopped(dev));
+				netif_tx_queue_stopped(txq));
 			IPAWANDBG_LOW("qmap_chk(%d)\n", qmap_check);
-			netif_stop_queue(dev);
+			netif_tx_stop_queue(txq);
+			wtxq->stopped++;
+			wtxq->tx_busy++;
 			spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 			return NETDEV_TX_BUSY;
 		}
@@ -1498,7 +1948,8 @@ send:
 	ret = ipa_pm_activate(rmnet_ipa3_ctx->pm_hdl);
 
 	if (ret == -EINPROGRESS) {
-		netif_stop_queue(dev);
+		netif_tx_stop_queue(txq);
+		wtxq->tx_busy++;
 		spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 		return NETDEV_TX_BUSY;
 	}
@@ -1507,6 +1958,7 @@ send:
 		       dev->name, ret);
 		dev_kfree_skb_any(skb);
 		dev->stats.tx_dropped++;
+		wtxq->tx_dropped++;
 		spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 		return NETDEV_TX_OK;
 	}
@@ -1518,28 +1970,50 @@ send:
 	 * after unlock
 	 */
 	atomic_inc(&wwan_ptr->outstanding_pkts);
+	atomic_inc(&wtxq->outstanding_pkts);
 	spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 
+	/*
+	 * Tag the skb so that the TX complete of either PROD pipe can
+	 * account it to this queue. The original cb is restored if the
+	 * skb is handed back to the stack.
+	 */
+	len = skb->len;
+	saved_cb = *IPA_WWAN_TX_CB(skb);
+	IPA_WWAN_TX_CB(skb)->magic = IPA_WWAN_TX_CB_MAGIC;
+	IPA_WWAN_TX_CB(skb)->len = len;
+	IPA_WWAN_TX_CB(skb)->txq = q;
+
+	/* BQL accounting must precede the TX complete of this skb */
+	netdev_tx_sent_queue(txq, len);
+
 	/*
 	 * both data packets and command will be routed to
 	 * IPA_CLIENT_Q6_WAN_CONS based on status configuration
 	 */
-	ret = ipa3_tx_dp(IPA_CLIENT_APPS_WAN_PROD, skb, NULL);
+	ret = ipa3_tx_dp(client, skb, NULL);
 	if (ret) {
+		netdev_tx_completed_queue(txq, 1, len);
+		atomic_dec(&wtxq->outstanding_pkts);
 		atomic_dec(&wwan_ptr->outstanding_pkts);
 		if (ret == -EPIPE) {
 			IPAWANERR_RL("[%s] fatal: pipe is not valid\n",
 				dev->name);
 			dev_kfree_skb_any(skb);
 			dev->stats.tx_dropped++;
+			wtxq->tx_dropped++;
 			return NETDEV_TX_OK;
 		}
+		*IPA_WWAN_TX_CB(skb) = saved_cb;
+		wtxq->tx_busy++;
 		ret = NETDEV_TX_BUSY;
 		goto out;
 	}
 
 	dev->stats.tx_packets++;
-	dev->stats.tx_bytes += skb->len;
+	dev->stats.tx_bytes += len;
+	wtxq->tx_pkts++;
+	wtxq->tx_bytes += len;
 	ret = NETDEV_TX_OK;
 out:
 	if (atomic_read(&wwan_ptr->outstanding_pkts) == 0) {
@@ -1558,11 +2032,36 @@ static void ipa3_wwan_tx_timeout(struct net_device *dev)
 #endif
 {
 	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
+	int i;
 
 	if (atomic_read(&wwan_ptr->outstanding_pkts) != 0)
 		IPAWANERR("[%s] data stall in UL, %d outstanding\n",
 			dev->name, atomic_read(&wwan_ptr->outstanding_pkts));
+
+	for (i = 0; i < dev->real_num_tx_queues; i++)
+		if (atomic_read(&wwan_ptr->txq[i].outstanding_pkts) != 0)
+			IPAWANERR("[%s] txq %d: %d outstanding\n", dev->name, i,
+				atomic_read(&wwan_ptr->txq[i].outstanding_pkts));
+}
+
+/**
+ * ipa3_wwan_reset_tx_queues() - Resets BQL and per-queue flow control
+ * state of all TX queues. Must only be called once no TX complete can
+ * arrive anymore, i.e. after the PROD pipes were torn down.
+ *
+ * @dev: network device
+ */
+static void ipa3_wwan_reset_tx_queues(struct net_device *dev)
+{
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
+	int i;
+
+	for (i = 0; i < dev->num_tx_queues; i++) {
+		netdev_tx_reset_queue(netdev_get_tx_queue(dev, i));
+		atomic_set(&wwan_ptr->txq[i].outstanding_pkts, 0);
+	}
 }
+
 /**
  * apps_ipa_tx_complete_notify() - Rx notify
  *
@@ -1580,6 +2079,9 @@ static void apps_ipa_tx_complete_notify(void *priv,
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
 	struct ipa3_wwan_private *wwan_ptr;
+	struct netdev_queue *txq;
+	struct ipa3_wwan_txq *wtxq;
+	u16 q;
 
 	if (dev != IPA_NETDEV()) {
 		IPAWANDBG("Received pre-SSR packet completion\n");
@@ -1587,23 +2089,36 @@ static void apps_ipa_tx_complete_notify(void *priv,
 		return;
 	}
 
-	if (evt != IPA_WRITE_DONE) {
-		IPAWANERR("unsupported evt on Tx callback, Drop the packet\n");
+	q = IPA_WWAN_TX_CB(skb)->txq;
+	if (IPA_WWAN_TX_CB(skb)->magic != IPA_WWAN_TX_CB_MAGIC ||
+		q >= dev->num_tx_queues) {
+		IPAWANERR_RL("TX complete of an untagged skb\n");
 		dev_kfree_skb_any(skb);
-		dev->stats.tx_dropped++;
 		return;
 	}
 
 	wwan_ptr = netdev_priv(dev);
+	txq = netdev_get_tx_queue(dev, q);
+	wtxq = &wwan_ptr->txq[q];
+
+	if (evt != IPA_WRITE_DONE) {
+		IPAWANERR("unsupported evt on Tx callback, Drop the packet\n");
+		dev->stats.tx_dropped++;
+		wtxq->tx_dropped++;
+	}
+
+	atomic_dec(&wtxq->outstanding_pkts);
 	atomic_dec(&wwan_ptr->outstanding_pkts);
-	__netif_tx_lock_bh(netdev_get_tx_queue(dev, 0));
+	__netif_tx_lock_bh(txq);
+	netdev_tx_completed_queue(txq, 1, IPA_WWAN_TX_CB(skb)->len);
 	if (!atomic_read(&rmnet_ipa3_ctx->is_ssr) &&
-		netif_queue_stopped(wwan_ptr->net) &&
-		atomic_read(&wwan_ptr->outstanding_pkts) <
+		netif_tx_queue_stopped(txq) &&
+		atomic_read(&wtxq->outstanding_pkts) <
 			rmnet_ipa3_ctx->outstanding_low) {
-		IPAWANDBG_LOW("Outstanding low (%d) - waking up queue\n",
-				rmnet_ipa3_ctx->outstanding_low);
-		netif_wake_queue(wwan_ptr->net);
+		IPAWANDBG_LOW("Outstanding low (%d) - waking up queue %u\n",
+				rmnet_ipa3_ctx->outstanding_low, q);
+		wtxq->woken++;
+		netif_tx_wake_queue(txq);
 	}
 
 	if (atomic_read(&wwan_ptr->outstanding_pkts) == 0) {
@@ -1611,10 +2126,24 @@ static void apps_ipa_tx_complete_notify(void *priv,
 		ipa_pm_deferred_deactivate(rmnet_ipa3_ctx->q6_pm_hdl);
 
 	}
-	__netif_tx_unlock_bh(netdev_get_tx_queue(dev, 0));
+	__netif_tx_unlock_bh(txq);
 	dev_kfree_skb_any(skb);
 }
 
+/**
+ * ipa3_wwan_ll_tx_complete_notify() - TX complete of a frame sent on the
+ * low latency TX queue, forwarded by the low latency data PROD pipe
+ *
+ * @priv: driver context
+ * @evt: event type
+ * @data: data provided with event
+ */
+void ipa3_wwan_ll_tx_complete_notify(void *priv, enum ipa_dp_evt_type evt,
+	unsigned long data)
+{
+	apps_ipa_tx_complete_notify(priv, evt, data);
+}
+
 /**
  * apps_ipa_packet_receive_notify() - Rx notify
  *
@@ -1629,6 +2158,7 @@ static void apps_ipa_packet_receive_notify(void *priv,
 		unsigned long data)
 {
 	struct net_device *dev = (struct net_device *)priv;
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
 
 	if (evt == IPA_RECEIVE) {
 		struct sk_buff *skb = (struct sk_buff *)data;
@@ -1642,7 +2172,11 @@ static void apps_ipa_packet_receive_notify(void *priv,
 
 		/* default traffic uses rx-0 queue. */
 		skb_record_rx_queue(skb, 0);
-		if (ipa3_rmnet_res.ipa_napi_enable) {
+		if (wwan_ptr->num_rss) {
+			/* counted per channel in rss_stats once delivered */
+			ipa3_wwan_rss_steer(dev, skb);
+			result = 0;
+		} else if (ipa3_rmnet_res.ipa_napi_enable) {
 			trace_rmnet_ipa_netif_rcv_skb3(skb, dev->stats.rx_packets);
 			result = netif_receive_skb(skb);
 		} else {
@@ -3138,6 +3672,7 @@ static const struct net_device_ops ipa3_wwan_ops_ip = {
 	.ndo_open = ipa3_wwan_open,
 	.ndo_stop = ipa3_wwan_stop,
 	.ndo_start_xmit = ipa3_wwan_xmit,
+	.ndo_select_queue = ipa3_wwan_select_queue,
 	.ndo_tx_timeout = ipa3_wwan_tx_timeout,
 #if (LINUX_VERSION_CODE <= KERNEL_VERSION(5, 14, 14))
 	.ndo_do_ioctl = ipa3_wwan_ioctl,
@@ -3358,11 +3893,18 @@ int ipa3_wwan_set_modem_perf_profile(int throughput)
 
 static void ipa3_wake_tx_queue(struct work_struct *work)
 {
-	if (IPA_NETDEV()) {
-		__netif_tx_lock_bh(netdev_get_tx_queue(IPA_NETDEV(), 0));
+	struct net_device *dev = IPA_NETDEV();
+	struct netdev_queue *txq;
+	int i;
+
+	if (dev) {
 		IPAWANDBG("Waking up the workqueue.\n");
-		netif_wake_queue(IPA_NETDEV());
-		__netif_tx_unlock_bh(netdev_get_tx_queue(IPA_NETDEV(), 0));
+		for (i = 0; i < dev->real_num_tx_queues; i++) {
+			txq = netdev_get_tx_queue(dev, i);
+			__netif_tx_lock_bh(txq);
+			netif_tx_wake_queue(txq);
+			__netif_tx_unlock_bh(txq);
+		}
 	}
 }
 
@@ -3423,6 +3965,12 @@ static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 	pr_info("IPA Napi Enable = %s\n",
 		ipa_rmnet_drv_res->ipa_napi_enable ? "True" : "False");
 
+	ipa_rmnet_drv_res->ipa_mq_tx_enable =
+		of_property_read_bool(pdev->dev.of_node,
+			"qcom,rmnet-ipa-mq-tx");
+	pr_info("IPA multi-queue TX = %s\n",
+		ipa_rmnet_drv_res->ipa_mq_tx_enable ? "True" : "False");
+
 	/* Get IPA WAN RX desc fifo size */
 	result = of_property_read_u32(pdev->dev.of_node,
 			"qcom,wan-rx-desc-size",
@@ -3434,6 +3982,19 @@ static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 		IPAWANDBG(": found ipa_drv_res->wan-rx-desc-size = %u\n",
 				ipa_rmnet_drv_res->wan_rx_desc_size);
 
+	/* spread WAN DL over this many CPUs, 0 or 1 keeps a single one */
+	ipa_rmnet_drv_res->wan_rss_channels = 0;
+	of_property_read_u32(pdev->dev.of_node,
+		"qcom,ipa-wan-rss-channels",
+		&ipa_rmnet_drv_res->wan_rss_channels);
+	ipa_rmnet_drv_res->wan_rss_cpu_mask = 0;
+	of_property_read_u32(pdev->dev.of_node,
+		"qcom,ipa-wan-rss-cpu-mask",
+		&ipa_rmnet_drv_res->wan_rss_cpu_mask);
+	pr_info("IPA WAN RSS channels = %u cpu mask = 0x%x\n",
+		ipa_rmnet_drv_res->wan_rss_channels,
+		ipa_rmnet_drv_res->wan_rss_cpu_mask);
+
 	return 0;
 }
 
@@ -3524,6 +4085,7 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	int ret, i, j;
 	struct net_device *dev;
 	int wan_cons_ep;
+	unsigned int num_txq;
 
 	pr_info("rmnet_ipa3 started initialization\n");
 
@@ -3597,11 +4159,16 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 		ipa3_wan_ioctl_enable_qmi_messages();
 	}
 
-	/* initialize wan-driver netdev */
+	/*
+	 * initialize wan-driver netdev, with an extra TX queue mapped
+	 * onto the low latency data PROD pipe if requested
+	 */
+	num_txq = (ipa3_rmnet_res.ipa_mq_tx_enable &&
+		ipa3_ctx->rmnet_ll_enable) ? RMNET_IPA_MAX_TXQ : 1;
 	dev = alloc_netdev_mqs(sizeof(struct ipa3_wwan_private),
 			   IPA_WWAN_DEV_NAME,
 			   NET_NAME_UNKNOWN,
-			   ipa3_wwan_setup, 1, 2);
+			   ipa3_wwan_setup, num_txq, 2);
 	if (!dev) {
 		IPAWANERR("no memory for netdev\n");
 		ret = -ENOMEM;
@@ -3613,6 +4180,9 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	IPAWANDBG("wwan_ptr (private) = %pK", rmnet_ipa3_ctx->wwan_priv);
 	rmnet_ipa3_ctx->wwan_priv->net = dev;
 	atomic_set(&rmnet_ipa3_ctx->wwan_priv->outstanding_pkts, 0);
+	for (i = 0; i < RMNET_IPA_MAX_TXQ; i++)
+		atomic_set(&rmnet_ipa3_ctx->wwan_priv->txq[i].outstanding_pkts,
+			0);
 	spin_lock_init(&rmnet_ipa3_ctx->wwan_priv->lock);
 	init_completion(
 		&rmnet_ipa3_ctx->wwan_priv->resource_granted_completion);
@@ -3646,6 +4216,7 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		netif_napi_add(dev, &(rmnet_ipa3_ctx->wwan_priv->napi),
 		       ipa3_rmnet_poll, NAPI_WEIGHT);
+	ipa3_wwan_rss_init(dev);
 	ret = register_netdev(dev);
 	if (ret) {
 		IPAWANERR("unable to register ipa_netdev %d rc=%d\n",
@@ -3739,6 +4310,9 @@ static int ipa3_wwan_remove(struct platform_device *pdev)
 		IPAWANERR("Failed to teardown APPS->IPA pipe\n");
 	else
 		rmnet_ipa3_ctx->apps_to_ipa3_hdl = -1;
+	/* no more TX completes past this point */
+	if (IPA_NETDEV())
+		ipa3_wwan_reset_tx_queues(IPA_NETDEV());
 	/* Clear pipe setup info */
 	for (j = 0; j < RMNET_INGRESS_MAX; j++) {
 		ingress_pipe_status[j].ep_type = 0;
@@ -6384,8 +6958,129 @@ static ssize_t rmnet_ipa_set_mtu(struct file *file,
 	return count;
 }
 
+static ssize_t rmnet_ipa_read_txq_stats(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct net_device *dev = IPA_NETDEV();
+	struct ipa3_wwan_private *wwan_ptr;
+	struct ipa3_wwan_txq *wtxq;
+	struct netdev_queue *txq;
+	int nbytes = 0;
+	int i;
+
+	if (!dev) {
+		nbytes = scnprintf(dbg_buff, sizeof(dbg_buff),
+			"netdev not initialized\n");
+		return simple_read_from_buffer(ubuf, count, ppos, dbg_buff,
+			nbytes);
+	}
+
+	wwan_ptr = netdev_priv(dev);
+	nbytes += scnprintf(dbg_buff + nbytes, sizeof(dbg_buff) - nbytes,
+		"num_txq=%u ll_txq=%s\n", dev->real_num_tx_queues,
+		ipa3_rmnet_ll_tx_ready() ? "ready" : "not ready");
+	for (i = 0; i < dev->real_num_tx_queues; i++) {
+		wtxq = &wwan_ptr->txq[i];
+		txq = netdev_get_tx_queue(dev, i);
+		nbytes += scnprintf(dbg_buff + nbytes,
+			sizeof(dbg_buff) - nbytes,
+			"txq %d (%s):\n"
+			"outstanding_pkts=%d\n"
+			"tx_pkts=%llu\n"
+			"tx_bytes=%llu\n"
+			"tx_dropped=%llu\n"
+			"tx_busy=%u\n"
+			"stopped=%u\n"
+			"woken=%u\n"
+			"drv_stopped=%d\n",
+			i, (i == RMNET_IPA_TXQ_LOW_LAT) ?
+				"WAN_LOW_LAT_DATA_PROD" : "WAN_PROD",
+			atomic_read(&wtxq->outstanding_pkts),
+			wtxq->tx_pkts,
+			wtxq->tx_bytes,
+			wtxq->tx_dropped,
+			wtxq->tx_busy,
+			wtxq->stopped,
+			wtxq->woken,
+			netif_tx_queue_stopped(txq));
+#ifdef CONFIG_BQL
+		nbytes += scnprintf(dbg_buff + nbytes,
+			sizeof(dbg_buff) - nbytes,
+			"bql_inflight=%u\n"
+			"bql_limit=%u\n",
+			txq->dql.num_queued - txq->dql.num_completed,
+			txq->dql.limit);
+#endif
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
+
+static ssize_t rmnet_ipa_read_rss_stats(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct net_device *dev = IPA_NETDEV();
+	struct ipa3_wwan_private *wwan_ptr;
+	struct ipa3_wwan_rss_ch *ch;
+	u64 now, delta_us, pps, kbps;
+	u64 pkts, bytes;
+	int nbytes = 0;
+	int i;
+
+	if (!dev) {
+		nbytes = scnprintf(dbg_buff, sizeof(dbg_buff),
+			"netdev not initialized\n");
+		return simple_read_from_buffer(ubuf, count, ppos, dbg_buff,
+			nbytes);
+	}
+
+	wwan_ptr = netdev_priv(dev);
+	now = ktime_get_ns();
+	nbytes += scnprintf(dbg_buff + nbytes, sizeof(dbg_buff) - nbytes,
+		"num_rss=%u\n", wwan_ptr->num_rss);
+	for (i = 0; i < wwan_ptr->num_rss; i++) {
+		ch = &wwan_ptr->rss[i];
+		pkts = READ_ONCE(ch->rx_pkts);
+		bytes = READ_ONCE(ch->rx_bytes);
+		/* rates are averaged since the previous read of this file */
+		delta_us = ch->last_ts ? div_u64(now - ch->last_ts,
+			NSEC_PER_USEC) : 0;
+		pps = delta_us ? div64_u64((pkts - ch->last_pkts) *
+			USEC_PER_SEC, delta_us) : 0;
+		kbps = delta_us ? div64_u64((bytes - ch->last_bytes) * 8 *
+			MSEC_PER_SEC, delta_us) : 0;
+		ch->last_pkts = pkts;
+		ch->last_bytes = bytes;
+		ch->last_ts = now;
+		nbytes += scnprintf(dbg_buff + nbytes,
+			sizeof(dbg_buff) - nbytes,
+			"ch %d cpu %d:\n"
+			"queued=%u\n"
+			"rx_pkts=%llu\n"
+			"rx_bytes=%llu\n"
+			"rx_dropped=%llu\n"
+			"backlog_drops=%llu\n"
+			"polls=%llu\n"
+			"ipis=%llu\n"
+			"pps=%llu\n"
+			"kbps=%llu\n",
+			i, ch->cpu,
+			skb_queue_len(&ch->rxq),
+			pkts,
+			bytes,
+			ch->rx_dropped,
+			ch->backlog_drops,
+			ch->polls,
+			ch->ipis,
+			pps,
+			kbps);
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
 
 #define RMNET_IPA_WRITE_ONLY_MODE 0220
+#define RMNET_IPA_READ_ONLY_MODE 0444
 
 struct rmnet_ipa_debugfs_file {
 	const char *name;
@@ -6399,6 +7094,14 @@ static const struct rmnet_ipa_debugfs_file debugfs_files[] = {
 		"mtu", RMNET_IPA_WRITE_ONLY_MODE, NULL, {
 			.write = rmnet_ipa_set_mtu,
 		}
+	}, {
+		"txq_stats", RMNET_IPA_READ_ONLY_MODE, NULL, {
+			.read = rmnet_ipa_read_txq_stats,
+		}
+	}, {
+		"rss_stats", RMNET_IPA_READ_ONLY_MODE, NULL, {
+			.read = rmnet_ipa_read_rss_stats,
+		}
 	},
 };
 
@@ -6444,6 +7147,10 @@ static void rmnet_ipa_debugfs_init(void)
 		read_write_mode, dbgfs->dent,
 		&rmnet_ipa3_ctx->outstanding_low);
 
+	debugfs_create_u32("ll_txq_prio",
+		read_write_mode, dbgfs->dent,
+		&rmnet_ipa3_ctx->ll_txq_prio);
+
 	return;
 }
 
@@ -6658,6 +7365,7 @@ int ipa3_wwan_init(void)
 	rmnet_ipa3_ctx->outstanding_high = OUTSTANDING_HIGH_DEFAULT;
 	rmnet_ipa3_ctx->outstanding_high_ctl = OUTSTANDING_HIGH_CTL_DEFAULT;
 	rmnet_ipa3_ctx->outstanding_low = OUTSTANDING_LOW_DEFAULT;
+	rmnet_ipa3_ctx->ll_txq_prio = RMNET_IPA_LL_TXQ_PRIO_DEFAULT;
 
 	rmnet_ipa_debugfs_init();
 
@@ -6769,10 +7477,14 @@ static void ipa3_wwan_msg_free_cb(void *buff, u32 len, u32 type)
 
 static int ipa3_rmnet_poll(struct napi_struct *napi, int budget)
 {
+	struct ipa3_wwan_private *wwan_ptr =
+		container_of(napi, struct ipa3_wwan_private, napi);
 	int rcvd_pkts = 0;
 
 	rcvd_pkts = ipa3_rx_poll(rmnet_ipa3_ctx->ipa3_to_apps_hdl,
 					NAPI_WEIGHT);
+	if (READ_ONCE(wwan_ptr->rss_kick))
+		ipa3_wwan_rss_kick(wwan_ptr);
 	IPAWANDBG_LOW("rcvd packets: %d\n", rcvd_pkts);
 	return rcvd_pkts;
 }
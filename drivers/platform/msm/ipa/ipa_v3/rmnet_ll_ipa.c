@@ -640,6 +640,9 @@ int ipa3_rmnet_ll_xmit(struct sk_buff *skb)
 		return -ENODEV;
 	}
 
+	/* not one of the rmnet_ipa netdev TX queue frames */
+	IPA_WWAN_TX_CB(skb)->magic = 0;
+
 	spin_lock_irqsave(&rmnet_ll_ipa3_ctx->tx_lock, flags);
 
 	if (rmnet_ll_ipa3_ctx->state != IPA_RMNET_LL_START) {
@@ -758,6 +761,18 @@ out:
 	return (free_desc > 0) ? free_desc : 0;
 }
 
+/**
+ * ipa3_rmnet_ll_tx_ready() - check if the low latency data PROD pipe
+ * can take traffic from the rmnet_ipa low latency TX queue
+ *
+ * Return: true if the pipe is set up
+ */
+bool ipa3_rmnet_ll_tx_ready(void)
+{
+	return ipa3_ctx->rmnet_ll_enable && rmnet_ll_ipa3_ctx &&
+		(rmnet_ll_ipa3_ctx->pipe_state & IPA_RMNET_LL_PIPE_TX_READY);
+}
+
 static void rmnet_ll_wakeup_ipa(struct work_struct *work)
 {
 	int ret;
@@ -845,6 +860,12 @@ static void apps_rmnet_ll_tx_complete_notify(void *priv,
 	unsigned long flags;
 	u32 pending_credits = 0;
 
+	/* frames sent on the rmnet_ipa low latency TX queue */
+	if (IPA_WWAN_TX_CB(skb)->magic == IPA_WWAN_TX_CB_MAGIC) {
+		ipa3_wwan_ll_tx_complete_notify(priv, evt, data);
+		return;
+	}
+
 	if (evt != IPA_WRITE_DONE) {
 		IPAERR("unsupported evt on Tx callback, Drop the packet\n");
 		spin_lock_irqsave(&rmnet_ll_ipa3_ctx->tx_lock,
@@ -11,6 +11,7 @@
 #define IPA_TEST_DMA_MT_TEST_NUM_WQ		200
 #define IPA_TEST_DMA_MEMCPY_BUFF_SIZE		16384
 #define IPA_TEST_DMA_MAX_PKT_SIZE		0xFF00
+#define IPA_TEST_DMA_BATCH_SPLIT_SIZE		0x20002
 #define IPA_DMA_TEST_LOOP_NUM			1000
 #define IPA_DMA_TEST_INT_LOOP_NUM		50
 #define IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM	128
@@ -1073,6 +1074,235 @@ static int ipa_test_dma_sync_memcpy_max_pkt_size(void *priv)
 	return 0;
 }
 
+/**
+ * struct ipa_test_dma_percall_ctx - per-call async copies tracking
+ * @pending: number of copies not completed yet
+ * @all_done: completed when the last copy is done
+ */
+struct ipa_test_dma_percall_ctx {
+	atomic_t pending;
+	struct completion all_done;
+};
+
+static void ipa_test_dma_percall_cb(void *user_param)
+{
+	struct ipa_test_dma_percall_ctx *ctx = user_param;
+
+	if (atomic_dec_and_test(&ctx->pending))
+		complete(&ctx->all_done);
+}
+
+/**
+ * TEST: Batched memory copy throughput
+ *
+ *	1. dma enable
+ *	2. copy the buffer in small chunks, one async memcpy per chunk
+ *	3. copy the same chunks with one batched memcpy per iteration
+ *	4. compare the buffers after each mode and report both rates
+ *	5. dma disable
+ */
+static int ipa_test_dma_batch_memcpy_throughput(void *priv)
+{
+	int rc;
+	int i, j;
+	int chunk = IPA_TEST_DMA_MEMCPY_BUFF_SIZE /
+		IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM;
+	struct ipa_mem_buffer src_mem;
+	struct ipa_mem_buffer dest_mem;
+	struct ipa3_dma_memcpy_entry *entries;
+	struct ipa_test_dma_percall_ctx ctx;
+	ktime_t start;
+	s64 percall_us, batch_us;
+	u64 bytes = (u64)IPA_TEST_DMA_MEMCPY_BUFF_SIZE *
+		IPA_DMA_TEST_INT_LOOP_NUM;
+
+	IPA_UT_LOG("Test Start\n");
+
+	rc = ipa_dma_enable();
+	if (rc) {
+		IPA_UT_LOG("DMA enable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail enable dma");
+		return rc;
+	}
+
+	entries = kcalloc(IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM,
+		sizeof(*entries), GFP_KERNEL);
+	if (!entries) {
+		IPA_UT_ERR("fail allocate entries array\n");
+		(void)ipa_dma_disable();
+		return -ENOMEM;
+	}
+
+	rc = ipa_test_dma_alloc_buffs(&src_mem, &dest_mem,
+		IPA_TEST_DMA_MEMCPY_BUFF_SIZE);
+	if (rc) {
+		IPA_UT_LOG("fail to alloc buffers\n");
+		IPA_UT_TEST_FAIL_REPORT("fail to alloc buffers");
+		goto free_entries;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < IPA_DMA_TEST_INT_LOOP_NUM; i++) {
+		atomic_set(&ctx.pending, IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM);
+		init_completion(&ctx.all_done);
+		for (j = 0; j < IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM; j++) {
+			rc = ipa_dma_async_memcpy(
+				dest_mem.phys_base + j * chunk,
+				src_mem.phys_base + j * chunk, chunk,
+				ipa_test_dma_percall_cb, &ctx);
+			if (rc) {
+				IPA_UT_LOG("async memcpy fail i=%d j=%d rc=%d\n",
+					i, j, rc);
+				IPA_UT_TEST_FAIL_REPORT("async memcpy failed");
+				/* drop the copies that were never queued */
+				if (atomic_sub_and_test(
+					IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM - j,
+					&ctx.pending))
+					complete(&ctx.all_done);
+				wait_for_completion(&ctx.all_done);
+				goto free_buffs;
+			}
+		}
+		wait_for_completion(&ctx.all_done);
+	}
+	percall_us = ktime_us_delta(ktime_get(), start);
+
+	if (memcmp(dest_mem.base, src_mem.base, src_mem.size)) {
+		IPA_UT_LOG("BAD per-call memcpy - buffs are not equal\n");
+		IPA_UT_TEST_FAIL_REPORT("BAD per-call memcpy");
+		rc = -EFAULT;
+		goto free_buffs;
+	}
+	memset(dest_mem.base, 0, dest_mem.size);
+
+	for (j = 0; j < IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM; j++) {
+		entries[j].dest = dest_mem.phys_base + j * chunk;
+		entries[j].src = src_mem.phys_base + j * chunk;
+		entries[j].len = chunk;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < IPA_DMA_TEST_INT_LOOP_NUM; i++) {
+		rc = ipa3_dma_memcpy_sg(entries,
+			IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM);
+		if (rc) {
+			IPA_UT_LOG("batched memcpy fail i=%d rc=%d\n", i, rc);
+			IPA_UT_TEST_FAIL_REPORT("batched memcpy failed");
+			goto free_buffs;
+		}
+	}
+	batch_us = ktime_us_delta(ktime_get(), start);
+
+	for (j = 0; j < IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM; j++) {
+		if (entries[j].status) {
+			IPA_UT_LOG("entry %d status %d\n", j,
+				entries[j].status);
+			IPA_UT_TEST_FAIL_REPORT("bad batched entry status");
+			rc = -EFAULT;
+			goto free_buffs;
+		}
+	}
+	if (memcmp(dest_mem.base, src_mem.base, src_mem.size)) {
+		IPA_UT_LOG("BAD batched memcpy - buffs are not equal\n");
+		IPA_UT_TEST_FAIL_REPORT("BAD batched memcpy");
+		rc = -EFAULT;
+		goto free_buffs;
+	}
+
+	IPA_UT_LOG("%d x %dB copies: per-call %lldus (%llu KB/s)\n",
+		IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM, chunk, percall_us,
+		percall_us ? div64_u64(bytes * 1000, percall_us) : 0);
+	IPA_UT_LOG("%d x %dB copies: batched %lldus (%llu KB/s)\n",
+		IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM, chunk, batch_us,
+		batch_us ? div64_u64(bytes * 1000, batch_us) : 0);
+
+free_buffs:
+	ipa_test_dma_destroy_buffs(&src_mem, &dest_mem);
+free_entries:
+	kfree(entries);
+	if (rc) {
+		(void)ipa_dma_disable();
+		return rc;
+	}
+
+	rc = ipa_dma_disable();
+	if (rc) {
+		IPA_UT_LOG("DMA disable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail disable dma");
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * TEST: Batched memory copy of an entry above max packet size
+ *
+ *	1. dma enable
+ *	2. batched memcpy of a single entry that has to be split
+ *	3. compare the buffers
+ *	4. dma disable
+ */
+static int ipa_test_dma_batch_memcpy_split(void *priv)
+{
+	int rc;
+	struct ipa_mem_buffer src_mem;
+	struct ipa_mem_buffer dest_mem;
+	struct ipa3_dma_memcpy_entry entry;
+
+	IPA_UT_LOG("Test Start\n");
+
+	rc = ipa_dma_enable();
+	if (rc) {
+		IPA_UT_LOG("DMA enable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail enable dma");
+		return rc;
+	}
+
+	rc = ipa_test_dma_alloc_buffs(&src_mem, &dest_mem,
+		IPA_TEST_DMA_BATCH_SPLIT_SIZE);
+	if (rc) {
+		IPA_UT_LOG("fail to alloc buffers\n");
+		IPA_UT_TEST_FAIL_REPORT("fail to alloc buffers");
+		(void)ipa_dma_disable();
+		return rc;
+	}
+
+	entry.dest = dest_mem.phys_base;
+	entry.src = src_mem.phys_base;
+	entry.len = IPA_TEST_DMA_BATCH_SPLIT_SIZE;
+	rc = ipa3_dma_memcpy_sg(&entry, 1);
+	if (rc || entry.status) {
+		IPA_UT_LOG("batched memcpy fail rc=%d status=%d\n",
+			rc, entry.status);
+		IPA_UT_TEST_FAIL_REPORT("batched memcpy failed");
+		rc = rc ? rc : -EFAULT;
+		goto free_buffs;
+	}
+
+	if (memcmp(dest_mem.base, src_mem.base, src_mem.size)) {
+		IPA_UT_LOG("BAD batched memcpy - buffs are not equal\n");
+		IPA_UT_TEST_FAIL_REPORT("BAD batched memcpy");
+		rc = -EFAULT;
+	}
+
+free_buffs:
+	ipa_test_dma_destroy_buffs(&src_mem, &dest_mem);
+	if (rc) {
+		(void)ipa_dma_disable();
+		return rc;
+	}
+
+	rc = ipa_dma_disable();
+	if (rc) {
+		IPA_UT_LOG("DMA disable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail disable dma");
+		return rc;
+	}
+
+	return 0;
+}
+
 /* Suite definition block */
 IPA_UT_DEFINE_SUITE_START(dma, "DMA for GSI",
 	ipa_test_dma_setup, ipa_test_dma_teardown)
@@ -1133,4 +1363,12 @@ IPA_UT_DEFINE_SUITE_START(dma, "DMA for GSI",
 		"Sync memory copy with max packet size",
 		ipa_test_dma_sync_memcpy_max_pkt_size,
 		true, IPA_HW_v3_0, IPA_HW_MAX),
+	IPA_UT_ADD_TEST(batch_memcpy_throughput,
+		"Per-call vs batched async memory copy throughput",
+		ipa_test_dma_batch_memcpy_throughput,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
+	IPA_UT_ADD_TEST(batch_memcpy_split,
+		"Batched memory copy above max packet size",
+		ipa_test_dma_batch_memcpy_split,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
 } IPA_UT_DEFINE_SUITE_END(dma);
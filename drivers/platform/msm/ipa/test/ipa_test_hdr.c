@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include <linux/ktime.h>
+#include "ipa_ut_framework.h"
+#include "ipa_i.h"
+
+/* Number of entries / lookups the stress tests aim for */
+#define IPA_TEST_HDR_STRESS_NUM 1000
+#define IPA_TEST_HDR_NAME_FMT "ut_hdr_%d"
+#define IPA_TEST_HDR_LEN 8
+
+/**
+ * struct ipa_test_hdr_ctx - header suite context
+ * @hdls: handles of the headers added by the stress test
+ * @num_hdls: number of valid entries in hdls
+ */
+struct ipa_test_hdr_ctx {
+	u32 hdls[IPA_TEST_HDR_STRESS_NUM];
+	int num_hdls;
+};
+
+static struct ipa_test_hdr_ctx *test_hdr_ctx;
+
+static int ipa_test_hdr_suite_setup(void **ppriv)
+{
+	IPA_UT_DBG("Start Setup\n");
+
+	test_hdr_ctx = kzalloc(sizeof(*test_hdr_ctx), GFP_KERNEL);
+	if (!test_hdr_ctx)
+		return -ENOMEM;
+
+	*ppriv = test_hdr_ctx;
+
+	return 0;
+}
+
+static int ipa_test_hdr_suite_teardown(void *priv)
+{
+	IPA_UT_DBG("Start Teardown\n");
+
+	kfree(test_hdr_ctx);
+	test_hdr_ctx = NULL;
+
+	return 0;
+}
+
+static int ipa_test_hdr_add_one(struct ipa_ioc_add_hdr *hdrs, int idx)
+{
+	struct ipa_hdr_add *hdr = &hdrs->hdr[0];
+
+	memset(hdr, 0, sizeof(*hdr));
+	snprintf(hdr->name, IPA_RESOURCE_NAME_MAX, IPA_TEST_HDR_NAME_FMT, idx);
+	hdr->hdr_len = IPA_TEST_HDR_LEN;
+	hdr->hdr[0] = (u8)idx;
+	hdr->hdr[1] = (u8)(idx >> 8);
+	hdr->type = IPA_HDR_L2_ETHERNET_II;
+	hdrs->num_hdrs = 1;
+	hdrs->commit = 0;
+
+	if (ipa3_add_hdr_usr(hdrs, true) || hdr->status)
+		return -EFAULT;
+
+	return 0;
+}
+
+static void ipa_test_hdr_del_all(struct ipa_test_hdr_ctx *ctx)
+{
+	struct ipa_ioc_del_hdr *hdls;
+	int i;
+
+	hdls = kzalloc(sizeof(*hdls) + sizeof(hdls->hdl[0]), GFP_KERNEL);
+	if (!hdls)
+		return;
+
+	hdls->num_hdls = 1;
+	hdls->commit = 0;
+	for (i = 0; i < ctx->num_hdls; i++) {
+		hdls->hdl[0].hdl = ctx->hdls[i];
+		if (ipa3_del_hdr_by_user(hdls, true) || hdls->hdl[0].status)
+			IPA_UT_ERR("failed to delete hdr %d\n", i);
+	}
+	ctx->num_hdls = 0;
+	kfree(hdls);
+}
+
+/**
+ * ipa_test_hdr_add_get_stress() - add headers one by one the way IPACM
+ * does, then time name lookups and duplicate adds against the populated
+ * tables.
+ *
+ * The SRAM and DDR header partitions limit how many headers fit, so the
+ * add phase stops early on a full table; the lookup and duplicate phases
+ * always issue IPA_TEST_HDR_STRESS_NUM operations.
+ */
+static int ipa_test_hdr_add_get_stress(void *priv)
+{
+	struct ipa_test_hdr_ctx *ctx = priv;
+	struct ipa_ioc_add_hdr *hdrs;
+	struct ipa_ioc_get_hdr lookup;
+	ktime_t start;
+	s64 add_ns, get_ns, dup_ns;
+	int i, idx;
+	int rc = 0;
+
+	hdrs = kzalloc(sizeof(*hdrs) + sizeof(hdrs->hdr[0]), GFP_KERNEL);
+	if (!hdrs) {
+		IPA_UT_TEST_FAIL_REPORT("fail to alloc hdrs");
+		return -ENOMEM;
+	}
+
+	ctx->num_hdls = 0;
+	start = ktime_get();
+	for (i = 0; i < IPA_TEST_HDR_STRESS_NUM; i++) {
+		if (ipa_test_hdr_add_one(hdrs, i))
+			break;
+		ctx->hdls[ctx->num_hdls++] = hdrs->hdr[0].hdr_hdl;
+	}
+	add_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!ctx->num_hdls) {
+		IPA_UT_TEST_FAIL_REPORT("no header could be added");
+		rc = -EFAULT;
+		goto free_hdrs;
+	}
+	IPA_UT_LOG("added %d hdrs, avg add %lld ns\n", ctx->num_hdls,
+		div_s64(add_ns, ctx->num_hdls));
+
+	start = ktime_get();
+	for (i = 0; i < IPA_TEST_HDR_STRESS_NUM; i++) {
+		idx = i % ctx->num_hdls;
+		memset(&lookup, 0, sizeof(lookup));
+		snprintf(lookup.name, IPA_RESOURCE_NAME_MAX,
+			IPA_TEST_HDR_NAME_FMT, idx);
+		if (ipa3_get_hdr(&lookup)) {
+			IPA_UT_LOG("get of %s failed\n", lookup.name);
+			IPA_UT_TEST_FAIL_REPORT("hdr lookup failed");
+			rc = -EFAULT;
+			goto del_hdrs;
+		}
+		if (lookup.hdl != ctx->hdls[idx]) {
+			IPA_UT_LOG("%s: hdl %u expected %u\n", lookup.name,
+				lookup.hdl, ctx->hdls[idx]);
+			IPA_UT_TEST_FAIL_REPORT("hdr lookup returned wrong hdl");
+			rc = -EFAULT;
+			goto del_hdrs;
+		}
+		ipa3_put_hdr(lookup.hdl);
+	}
+	get_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* IPACM duplicate adds hand back the original entry */
+	start = ktime_get();
+	for (i = 0; i < IPA_TEST_HDR_STRESS_NUM; i++) {
+		if (ipa_test_hdr_add_one(hdrs, i % ctx->num_hdls)) {
+			IPA_UT_TEST_FAIL_REPORT("duplicate hdr add failed");
+			rc = -EFAULT;
+			goto del_hdrs;
+		}
+	}
+	dup_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	IPA_UT_LOG("%d lookups: avg get %lld ns, avg dup add %lld ns\n",
+		IPA_TEST_HDR_STRESS_NUM,
+		div_s64(get_ns, IPA_TEST_HDR_STRESS_NUM),
+		div_s64(dup_ns, IPA_TEST_HDR_STRESS_NUM));
+
+del_hdrs:
+	ipa_test_hdr_del_all(ctx);
+
+	/* all names must be gone from the lookup hash */
+	memset(&lookup, 0, sizeof(lookup));
+	snprintf(lookup.name, IPA_RESOURCE_NAME_MAX, IPA_TEST_HDR_NAME_FMT, 0);
+	if (!rc && !ipa3_get_hdr(&lookup)) {
+		IPA_UT_TEST_FAIL_REPORT("deleted hdr still found");
+		rc = -EFAULT;
+	}
+free_hdrs:
+	kfree(hdrs);
+	return rc;
+}
+
+/**
+ * ipa_test_hdr_rt_tbl_lookup() - time routing table lookups by name on
+ * the default routing table of both IP families
+ */
+static int ipa_test_hdr_rt_tbl_lookup(void *priv)
+{
+	struct ipa_ioc_get_rt_tbl_indx in;
+	enum ipa_ip_type ip;
+	ktime_t start;
+	s64 ns;
+	int i;
+
+	for (ip = IPA_IP_v4; ip < IPA_IP_MAX; ip++) {
+		start = ktime_get();
+		for (i = 0; i < IPA_TEST_HDR_STRESS_NUM; i++) {
+			memset(&in, 0, sizeof(in));
+			in.ip = ip;
+			strlcpy(in.name, IPA_DFLT_RT_TBL_NAME,
+				IPA_RESOURCE_NAME_MAX);
+			if (ipa3_query_rt_index(&in)) {
+				IPA_UT_LOG("ip %d: default rt tbl not found\n",
+					ip);
+				IPA_UT_TEST_FAIL_REPORT("rt tbl lookup failed");
+				return -EFAULT;
+			}
+		}
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		IPA_UT_LOG("ip %d: %d rt tbl lookups, avg %lld ns\n", ip,
+			IPA_TEST_HDR_STRESS_NUM,
+			div_s64(ns, IPA_TEST_HDR_STRESS_NUM));
+	}
+
+	return 0;
+}
+
+/**
+ * ipa_test_hdr_migrate() - fill SRAM until a header spills to DDR, free an
+ * SRAM slot and check the commit moves the DDR header back to SRAM
+ */
+static int ipa_test_hdr_migrate(void *priv)
+{
+	struct ipa_test_hdr_ctx *ctx = priv;
+	struct ipa_ioc_add_hdr *hdrs;
+	struct ipa_ioc_del_hdr *del;
+	struct ipa3_hdr_entry *entry;
+	u32 ddr_hdl = 0;
+	u32 migrated;
+	int i;
+	int rc = 0;
+
+	if (!IPA_MEM_PART(apps_hdr_size) || !IPA_MEM_PART(apps_hdr_size_ddr)) {
+		IPA_UT_LOG("no SRAM or DDR header table, skip\n");
+		return 0;
+	}
+
+	hdrs = kzalloc(sizeof(*hdrs) + sizeof(hdrs->hdr[0]), GFP_KERNEL);
+	del = kzalloc(sizeof(*del) + sizeof(del->hdl[0]), GFP_KERNEL);
+	if (!hdrs || !del) {
+		IPA_UT_TEST_FAIL_REPORT("fail to alloc");
+		rc = -ENOMEM;
+		goto free;
+	}
+
+	ctx->num_hdls = 0;
+	for (i = 0; i < IPA_TEST_HDR_STRESS_NUM; i++) {
+		if (ipa_test_hdr_add_one(hdrs, i))
+			break;
+		ctx->hdls[ctx->num_hdls++] = hdrs->hdr[0].hdr_hdl;
+		entry = ipa3_id_find(hdrs->hdr[0].hdr_hdl);
+		if (entry && !entry->is_lcl) {
+			ddr_hdl = hdrs->hdr[0].hdr_hdl;
+			break;
+		}
+	}
+
+	if (!ddr_hdl || ctx->num_hdls < 2) {
+		IPA_UT_LOG("SRAM did not fill up (%d hdrs), skip\n",
+			ctx->num_hdls);
+		goto del_hdrs;
+	}
+
+	/* free the first SRAM slot of the same bin */
+	del->num_hdls = 1;
+	del->hdl[0].hdl = ctx->hdls[0];
+	if (ipa3_del_hdr_by_user(del, true) || del->hdl[0].status) {
+		IPA_UT_TEST_FAIL_REPORT("fail to del hdr");
+		rc = -EFAULT;
+		goto del_hdrs;
+	}
+	ctx->hdls[0] = ctx->hdls[--ctx->num_hdls];
+
+	migrated = ipa3_ctx->hdr_alloc_stats.migrated;
+	if (ipa3_commit_hdr()) {
+		IPA_UT_TEST_FAIL_REPORT("fail to commit hdr");
+		rc = -EFAULT;
+		goto del_hdrs;
+	}
+
+	entry = ipa3_id_find(ddr_hdl);
+	if (!entry || !entry->is_lcl ||
+		ipa3_ctx->hdr_alloc_stats.migrated == migrated) {
+		IPA_UT_TEST_FAIL_REPORT("DDR hdr was not migrated to SRAM");
+		rc = -EFAULT;
+		goto del_hdrs;
+	}
+	if (ipa3_ctx->hdr_alloc_stats.retired) {
+		IPA_UT_TEST_FAIL_REPORT("old hdr slot was not released");
+		rc = -EFAULT;
+	}
+
+del_hdrs:
+	ipa_test_hdr_del_all(ctx);
+	ipa3_commit_hdr();
+free:
+	kfree(del);
+	kfree(hdrs);
+	return rc;
+}
+
+/* Suite definition block */
+IPA_UT_DEFINE_SUITE_START(hdr, "Header and RT table lookup tests",
+	ipa_test_hdr_suite_setup, ipa_test_hdr_suite_teardown)
+{
+	IPA_UT_ADD_TEST(add_get_stress,
+		"Add/get/duplicate-add cost with a populated header table",
+		ipa_test_hdr_add_get_stress,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
+
+	IPA_UT_ADD_TEST(migrate,
+		"DDR header moves back to SRAM once a slot frees up",
+		ipa_test_hdr_migrate,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
+
+	IPA_UT_ADD_TEST(rt_tbl_lookup,
+		"Routing table lookup by name cost",
+		ipa_test_hdr_rt_tbl_lookup,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
+
+} IPA_UT_DEFINE_SUITE_END(hdr);
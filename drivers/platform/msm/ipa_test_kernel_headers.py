@@ -40,9 +40,7 @@ def run_headers_install(verbose, gen_dir, headers_install, unifdef, prefix, h):
 def gen_ipa_test_headers(verbose, gen_dir, headers_install, unifdef, ipa_test_include_uapi):
     error_count = 0
     for h in ipa_test_include_uapi:
-        ipa_test_uapi_include_prefix = os.path.join(h.split('/ipa/ipa_test_module/')[0],
-                                                 'ipa',
-                                                 'ipa_test_module') + os.sep
+        ipa_test_uapi_include_prefix = os.path.dirname(h) + os.sep
 
         if not run_headers_install(
                 verbose, gen_dir, headers_install, unifdef,
@@ -33,6 +33,8 @@
 #include <stdbool.h>
 #include <linux/msm_ipa.h>
 
+#include "ipa_table.h"
+
 /**
  * enum ipa_ipv6_ct_direction_settings_type - direction filter settings
  *
@@ -139,6 +141,73 @@ int ipa_ipv6ct_query_timestamp(uint32_t table_handle, uint32_t rule_handle, uint
  */
 void ipa_ipv6ct_dump_table(uint32_t tbl_hdl);
 
+/**
+ * ipa_ipv6ct_advise_tbl() - recommend how to split an IPv6CT table
+ * between base and expansion entries for a workload
+ * @number_of_entries: [in] number of IPv6CT entries that would be asked for
+ * @rules: [in] the workload, eg. rules sampled off a live system
+ * @num_rules: [in] number of entries in @rules
+ * @advice_ptr: [out] the candidate splits of the table's total size,
+ *              how the workload fares in each, which one the table gets
+ *              by default and which one is best
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_advise_tbl(
+	uint16_t number_of_entries,
+	const ipa_ipv6ct_rule* rules,
+	uint32_t num_rules,
+	ipa_table_advice* advice_ptr);
+
+/**
+ * ipa_ipv6ct_advise_live_tbl() - as ipa_ipv6ct_advise_tbl(), for the
+ * rules in a table
+ * @table_handle: [in] handle of IPv6CT table
+ * @number_of_entries: [in] number of IPv6CT entries to advise on
+ * @advice_ptr: [out] see ipa_ipv6ct_advise_tbl()
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_advise_live_tbl(
+	uint32_t table_handle,
+	uint16_t number_of_entries,
+	ipa_table_advice* advice_ptr);
+
+/**
+ * ipa_ipv6ct_apply_tbl_advice() - use the best split of some advice for
+ * the IPv6CT tables created from now on
+ * @advice_ptr: [in] the advice, NULL to go back to the default split
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_apply_tbl_advice(const ipa_table_advice* advice_ptr);
+
+/**
+ * ipa_ipv6ct_verify_tbl() - check an IPv6CT table's chains and counts
+ * @table_handle: [in] handle of IPv6CT table
+ * @repair: [in] fix what is found, through the IPA
+ * @report_ptr: [out] what was found
+ *
+ * Every chain must be reachable from its base entry, end without a cycle
+ * and agree on prev and next. Repair cuts bad links and fixes prevs and
+ * counts, at most IPA_TABLE_VERIFY_MAX_DMA fixes per call. Expansion
+ * entries no chain reaches are only reported.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_verify_tbl(uint32_t table_handle, bool repair, ipa_table_verify_report* report_ptr);
+
+/**
+ * ipa_ipv6ct_set_scrub() - verify the IPv6CT tables in the background
+ * @period_ms: [in] time between runs, 0 stops the scrub
+ * @repair: [in] as for ipa_ipv6ct_verify_tbl()
+ *
+ * Each run verifies every table off a timer thread at the lowest priority.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_set_scrub(uint32_t period_ms, bool repair);
+
 /**
  * ipa_ipv6ct_add_uc_act_entry() - add uc activation entry
  * @u: [in] structure specifying the uC activation entry
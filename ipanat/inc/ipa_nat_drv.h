@@ -30,6 +30,8 @@
 #define IPA_NAT_DRV_H
 
 #include "ipa_nat_utils.h"
+#include "ipa_table.h"
+#include "ipa_nat_trace.h"
 
 #include <stdint.h>  /* uint32_t */
 #include <stdbool.h>
@@ -267,5 +269,232 @@ int ipa_nat_switch_to(
 	enum ipa3_nat_mem_in nmi,
 	bool                 hold_state );
 
-#endif
+/**
+ * enum ipa_nat_journal_op - kinds of NAT rule change journal records
+ * @IPA_NAT_JRNL_ADD: a rule was added, its handle is orig_rule_hdl
+ * @IPA_NAT_JRNL_DEL: the rule known as orig_rule_hdl was deleted
+ * @IPA_NAT_JRNL_MIGRATE: the rule known as orig_rule_hdl was copied to the
+ *  other memory type, old_rule_hdl being its handle in the source table and
+ *  new_rule_hdl its handle in the destination table
+ * @IPA_NAT_JRNL_SWITCH: the IPA now uses the table in nmi; the MIGRATE
+ *  records of the switch precede this record
+ * @IPA_NAT_JRNL_CLEAR: all rules of the table in nmi are gone
+ */
+typedef enum {
+	IPA_NAT_JRNL_ADD     = 0,
+	IPA_NAT_JRNL_DEL     = 1,
+	IPA_NAT_JRNL_MIGRATE = 2,
+	IPA_NAT_JRNL_SWITCH  = 3,
+	IPA_NAT_JRNL_CLEAR   = 4,
+
+	IPA_NAT_JRNL_MAX
+} ipa_nat_journal_op;
+
+/**
+ * struct ipa_nat_journal_rec - one NAT rule change journal record
+ * @seq: sequence number of the record, increasing by one per record
+ * @op: what happened
+ * @nmi: memory type of the table the change was made in
+ * @orig_rule_hdl: rule handle as known by the client
+ * @old_rule_hdl: handle in the source table (MIGRATE only)
+ * @new_rule_hdl: handle in the table the rule now lives in
+ */
+typedef struct {
+	uint64_t             seq;
+	ipa_nat_journal_op   op;
+	enum ipa3_nat_mem_in nmi;
+	uint32_t             orig_rule_hdl;
+	uint32_t             old_rule_hdl;
+	uint32_t             new_rule_hdl;
+} ipa_nat_journal_rec;
+
+/**
+ * ipa_nat_journal_enable() - enable, resize or disable the NAT rule
+ * change journal
+ * @num_recs: [in] journal depth in records, zero disables the journal
+ *
+ * The journal is a ring; once num_recs records are outstanding the
+ * oldest ones are overwritten. Sequence numbers keep counting across
+ * resizes, so readers notice the records they missed.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_journal_enable(
+	uint32_t num_recs);
 
+/**
+ * ipa_nat_journal_read() - read NAT rule change journal records
+ * @cursor_ptr: [in/out] sequence number of the next record to read
+ * @recs: [out] records read
+ * @max_recs: [in] size of recs
+ * @num_recs_ptr: [out] number of records read
+ *
+ * Start with a cursor of zero. The cursor is advanced past the records
+ * returned.
+ *
+ * Returns:	0 On Success, -EOVERFLOW when records before the cursor were
+ *          overwritten or dropped by a resize (the cursor is then moved
+ *          past the newest record, to the sequence number the next record
+ *          will get, and the client has to resynchronize with a full
+ *          table walk),
+ *          other negative values on failure
+ */
+int ipa_nat_journal_read(
+	uint64_t*            cursor_ptr,
+	ipa_nat_journal_rec* recs,
+	uint32_t             max_recs,
+	uint32_t*            num_recs_ptr);
+
+/**
+ * ipa_nat_trace_enable() - enable, resize or disable the binary trace
+ * @num_recs: [in] trace depth in records, zero disables the trace (the
+ *            default)
+ *
+ * The trace keeps the raw DMA commands and rules the library hands the
+ * IPA in a ring, oldest records being overwritten. Records are read
+ * back with ipa_nat_trace_read() and decoded with
+ * ipa_nat_trace_format(), neither of which holds up the API. A
+ * disabled trace costs a not taken branch per trace point.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_trace_enable(
+	uint32_t num_recs);
+
+/**
+ * ipa_nat_set_switch_chunk() - make hybrid mode switches from SRAM to
+ * DDR incremental
+ * @num_recs: [in] SRAM records copied to DDR per API call, zero makes
+ *            the switch copy the whole table at once (the default)
+ *
+ * With a non zero num_recs, the add that finds SRAM full goes to DDR
+ * and starts the copy, each later add or delete copies up to num_recs
+ * more records, and the IPA is pointed at DDR once all are copied.
+ * Operations on the whole table finish a switch under way first. The
+ * switch back to SRAM always copies at once.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_switch_chunk(
+	uint32_t num_recs);
+
+/**
+ * ipa_nat_set_sram_return() - tune when hybrid mode goes back from DDR
+ * to SRAM
+ * @low_wm_pct: [in] go back once the rules in DDR are at or below this
+ *              percent of what SRAM holds, below 100 (default 25)
+ * @dwell_ms: [in] least time spent in DDR before going back (default
+ *            1000)
+ *
+ * The return is looked at on rule deletes and table clears, and off a
+ * timer when it was put off by the dwell time. Going back to DDR less
+ * than the dwell time after returning to SRAM doubles the dwell time,
+ * up to 64 seconds, until the table settles. Switch counts are
+ * reported by ipa_nati_ipv4_tbl_stats().
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_sram_return(
+	uint32_t low_wm_pct,
+	uint32_t dwell_ms);
+
+
+/**
+ * ipa_nat_advise_ipv4_tbl() - recommend how to split a NAT table
+ * between base and expansion entries for a workload
+ * @public_ip_addr: [in] public ipv4 address of the table
+ * @mem_type_ptr: [in] type of memory the table would reside in, HYBRID
+ *                is advised on as DDR
+ * @number_of_entries: [in] number of nat entries that would be asked for
+ * @rules: [in] the workload, eg. rules sampled off a live system
+ * @num_rules: [in] number of entries in @rules
+ * @advice_ptr: [out] the candidate splits of the table's total size,
+ *              how the workload fares in each, which one the table
+ *              gets by default and which one is best
+ *
+ * The rules are hashed with the hash the IPA uses and dropped into each
+ * candidate. The best candidate loses the fewest rules to a full
+ * expansion table, then has the shortest chains. An SRAM table always
+ * fills SRAM, so for SRAM @number_of_entries is ignored and the advice
+ * is on that size.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_advise_ipv4_tbl(
+	uint32_t                 public_ip_addr,
+	const char*              mem_type_ptr,
+	uint16_t                 number_of_entries,
+	const ipa_nat_ipv4_rule* rules,
+	uint32_t                 num_rules,
+	ipa_table_advice*        advice_ptr);
+
+/**
+ * ipa_nat_advise_live_ipv4_tbl() - as ipa_nat_advise_ipv4_tbl(), for
+ * the rules in a table
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @number_of_entries: [in] number of nat entries to advise on
+ * @advice_ptr: [out] see ipa_nat_advise_ipv4_tbl()
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_advise_live_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_advice* advice_ptr);
+
+/**
+ * ipa_nat_apply_ipv4_tbl_advice() - use the best split of some advice
+ * for the NAT tables created from now on
+ * @mem_type_ptr: [in] type of memory the advice is for
+ * @advice_ptr: [in] the advice, NULL to go back to the default split
+ *
+ * DDR tables of other sizes than the one advised on are split in the
+ * same proportion. SRAM advice must be on the size SRAM tables have,
+ * and its split must fit SRAM. Tables that exist are not touched.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_apply_ipv4_tbl_advice(
+	const char*             mem_type_ptr,
+	const ipa_table_advice* advice_ptr);
+
+
+/**
+ * ipa_nat_verify_ipv4_tbl() - check a NAT table's chains and counts
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @repair: [in] fix what is found, through the IPA
+ * @nat_report_ptr: [out] what was found in the rule table
+ * @idx_report_ptr: [out] what was found in the index table
+ *
+ * Every chain must be reachable from its base entry, end without a
+ * cycle and agree on prev and next. Repair cuts bad links, fixes prevs
+ * and counts, and releases a rule no chain reaches together with its
+ * index entry when that is on no chain either. Other entries no chain
+ * reaches are only reported. Only IPA_TABLE_VERIFY_MAX_DMA fixes are
+ * made per call, the rest are counted as deferred. In hybrid mode the
+ * table in use is checked.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr);
+
+/**
+ * ipa_nat_set_scrub() - verify the NAT table in the background
+ * @period_ms: [in] time between runs, 0 stops the scrub
+ * @repair: [in] as for ipa_nat_verify_ipv4_tbl()
+ *
+ * Each run verifies the table in use off a timer thread at the lowest
+ * priority. Runs, errors found and repairs made are reported by
+ * ipa_nati_ipv4_tbl_stats().
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_scrub(
+	uint32_t period_ms,
+	bool     repair);
+
+#endif
@@ -351,6 +351,20 @@ typedef struct
 	uint32_t min_chain_len;
 	uint32_t max_chain_len;
 	float    avg_chain_len;
+	/*
+	 * Hybrid mode switch counters, zero otherwise...
+	 */
+	uint32_t sw_to_ddr;
+	uint32_t sw_to_ddr_fail;
+	uint32_t sw_to_sram;
+	uint32_t sw_to_sram_fail;
+	uint32_t sw_to_sram_deferred;
+	/*
+	 * Background scrub counters, see ipa_nat_set_scrub()...
+	 */
+	uint32_t scrub_runs;
+	uint32_t scrub_errors;
+	uint32_t scrub_repaired;
 } ipa_nati_tbl_stats;
 
 int ipa_nati_ipv4_tbl_stats(
@@ -361,6 +375,44 @@ int ipa_nati_ipv4_tbl_stats(
 int ipa_nati_vote_clock(
 	enum ipa_app_clock_vote_type vote_type );
 
+int ipa_nati_journal_enable(
+	uint32_t num_recs );
+
+int ipa_nati_journal_read(
+	uint64_t*            cursor_ptr,
+	ipa_nat_journal_rec* recs,
+	uint32_t             max_recs,
+	uint32_t*            num_recs_ptr );
+
+int ipa_nati_set_switch_chunk(
+	uint32_t num_recs );
+
+int ipa_nati_trace_enable(
+	uint32_t num_recs );
+
+int ipa_nati_set_sram_return(
+	uint32_t low_wm_pct,
+	uint32_t dwell_ms );
+
+int ipa_nati_advise_live_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_advice* advice_ptr );
+
+int ipa_nati_apply_ipv4_tbl_advice(
+	enum ipa3_nat_mem_in    nmi,
+	const ipa_table_advice* advice_ptr );
+
+int ipa_nati_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr );
+
+int ipa_nati_set_scrub(
+	uint32_t period_ms,
+	bool     repair );
+
 int ipa_NATI_add_ipv4_tbl(
 	enum ipa3_nat_mem_in nmi,
 	uint32_t             public_ip_addr,
@@ -379,6 +431,13 @@ int ipa_NATI_walk_ipv4_tbl(
 	ipa_table_walk_cb walk_cb,
 	void*             arb_data_ptr );
 
+int ipa_NATI_walk_ipv4_tbl_from(
+	uint32_t          tbl_hdl,
+	WhichTbl2Use      which,
+	uint32_t          start_index,
+	ipa_table_walk_cb walk_cb,
+	void*             arb_data_ptr );
+
 int ipa_NATI_ipv4_tbl_stats(
 	uint32_t            tbl_hdl,
 	ipa_nati_tbl_stats* nat_stats_ptr,
@@ -401,4 +460,22 @@ int ipa_NATI_del_ipv4_rule(
 int ipa_NATI_post_ipv4_init_cmd(
 	uint32_t tbl_hdl );
 
+int ipa_NATI_advise_ipv4_tbl(
+	enum ipa3_nat_mem_in     nmi,
+	uint32_t                 public_ip,
+	uint16_t                 number_of_entries,
+	const ipa_nat_ipv4_rule* rules,
+	uint32_t                 num_rules,
+	ipa_table_advice*        advice_ptr );
+
+int ipa_NATI_apply_ipv4_tbl_advice(
+	enum ipa3_nat_mem_in    nmi,
+	const ipa_table_advice* advice_ptr );
+
+int ipa_NATI_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr );
+
 #endif /* #ifndef IPA_NAT_DRVI_H */
@@ -89,6 +89,11 @@ int ipa_nat_map_find(
 	uint32_t      key,
 	uint32_t*     val_ptr );
 
+/* Like ipa_nat_map_find(), but quiet; non-zero when key is in the map */
+int ipa_nat_map_has(
+	ipa_which_map which,
+	uint32_t      key );
+
 int ipa_nat_map_del(
 	ipa_which_map which,
 	uint32_t      key,
@@ -102,6 +102,7 @@ typedef enum {
 	NATI_TRIG_GOTO_DDR   =  9,
 	NATI_TRIG_GOTO_SRAM  = 10,
 	NATI_TRIG_GET_TSTAMP = 11,
+	NATI_TRIG_VERIFY     = 12,
 
 	NATI_TRIG_LAST
 } ipa_nati_trigger;
@@ -109,13 +110,94 @@ typedef enum {
 /******************************************************************************/
 /**
  * The following structure used to keep switch stats.
+ *
+ * The chunk and latency fields are only kept for incremental
+ * switches (see ipa_nat_set_switch_chunk()) and describe the last one.
  */
 typedef struct
 {
 	uint32_t pass;
 	uint32_t fail;
+	uint32_t chunks;
+	uint32_t adds_during_switch;
+	uint64_t switch_ns;
+	uint64_t add_p99_ns;
+	uint64_t add_max_ns;
+	uint32_t deferred;    /* returns to SRAM put off by the dwell time */
 } nati_switch_stats;
 
+/******************************************************************************/
+/**
+ * The following structure used to keep the state of an incremental
+ * SRAM to DDR switch.
+ *
+ * Add latencies are kept in a log-linear histogram: four buckets per
+ * power of two nanoseconds.
+ *
+ * Besides the step each add and delete takes, a timer takes one every
+ * NATI_MIG_TICK_MS so the switch finishes without further API calls.
+ */
+#define NATI_LAT_SUB_BITS 2
+#define NATI_LAT_BUCKETS  (64 << NATI_LAT_SUB_BITS)
+#define NATI_MIG_TICK_MS  1
+
+typedef struct
+{
+	uint32_t chunk;       /* records copied per API call, 0 = blocking */
+	bool     active;      /* a switch is in progress */
+	bool     failed;      /* a record could not be copied */
+	uint32_t next_index;  /* where the walk of the SRAM table resumes */
+	uint32_t budget;      /* records left to copy in the current step */
+	uint32_t chunks;
+	uint64_t start_ns;
+	uint32_t adds;
+	uint64_t add_max_ns;
+	uint32_t add_lat_hist[NATI_LAT_BUCKETS];
+	bool     timer_made;
+	timer_t  timer;       /* steps the switch between API calls */
+} nati_migration;
+
+/******************************************************************************/
+/**
+ * The following structure used to keep the policy for returning from
+ * DDR to SRAM in hybrid mode.
+ *
+ * The table goes back to SRAM once the rules in DDR drop to low_wm_pct
+ * percent of what SRAM holds, but not before it has been in DDR for
+ * cur_dwell_ms. A stay in SRAM shorter than cur_dwell_ms is taken as
+ * flapping and doubles cur_dwell_ms, up to NATI_MAX_DWELL_MS; a longer
+ * one sets it back to dwell_ms.
+ */
+#define NATI_DFLT_LOW_WM_PCT 25
+#define NATI_DFLT_DWELL_MS   1000
+#define NATI_MAX_DWELL_MS    (64 * 1000)
+
+typedef struct
+{
+	uint32_t low_wm_pct;
+	uint32_t dwell_ms;
+	uint32_t cur_dwell_ms;
+	uint64_t ddr_since_ns;   /* when the table last went to DDR */
+	uint64_t sram_since_ns;  /* when it last came back to SRAM */
+	bool     timer_made;
+	bool     timer_armed;
+	timer_t  timer;          /* re-evaluates a return put off */
+} nati_sram_return;
+
+/******************************************************************************/
+/**
+ * The following structure is used by the background table verify,
+ * see ipa_nati_set_scrub()
+ */
+typedef struct
+{
+	ipa_table_scrub tmr;
+	bool            repair;
+	uint32_t        runs;
+	uint32_t        errors;
+	uint32_t        repaired;
+} nati_scrub;
+
 /******************************************************************************/
 /**
  * The following structure used to direct map usage.
@@ -129,6 +211,20 @@ typedef struct
 	uint32_t new2orig_map;
 } nati_map_pair;
 
+/******************************************************************************/
+/**
+ * The following structure used to keep the rule change journal.
+ *
+ * Record with sequence number seq lives in recs[seq % num_recs].
+ */
+typedef struct
+{
+	ipa_nat_journal_rec* recs;
+	uint32_t             num_recs;
+	uint64_t             next_seq;
+	uint64_t             first_seq; /* next_seq when recs was made */
+} nati_journal;
+
 /******************************************************************************/
 /**
  * The following is a nati object that will maintain state relative to
@@ -159,6 +255,22 @@ typedef struct
 	 * sw_stats[1] for sram
 	 */
 	nati_switch_stats sw_stats[2];
+	/*
+	 * Optional rule change journal, see ipa_nat_journal_read()
+	 */
+	nati_journal      journal;
+	/*
+	 * Incremental SRAM to DDR switch, see nati_migrate_step()
+	 */
+	nati_migration    mig;
+	/*
+	 * When to go back from DDR to SRAM, see nati_sram_return_eval()
+	 */
+	nati_sram_return  sram_ret;
+	/*
+	 * Periodic table verify, see ipa_nati_set_scrub()
+	 */
+	nati_scrub        scrub;
 } ipa_nati_obj;
 
 /*
@@ -185,10 +297,10 @@ typedef struct
 
 #undef COMPATIBLE_NMI_4SWITCH
 #define COMPATIBLE_NMI_4SWITCH(n) \
-	( (n) == IPA_NAT_MEM_IN_SRAM && nati_obj.curr_state == NATI_STATE_HYBRID_DDR ) || \
-	( (n) == IPA_NAT_MEM_IN_DDR  && nati_obj.curr_state == NATI_STATE_HYBRID ) || \
-	( (n) == IPA_NAT_MEM_IN_DDR  && nati_obj.curr_state == NATI_STATE_DDR_ONLY ) || \
-	( (n) == IPA_NAT_MEM_IN_SRAM && nati_obj.curr_state == NATI_STATE_SRAM_ONLY )
+	( ( (n) == IPA_NAT_MEM_IN_SRAM && nati_obj.curr_state == NATI_STATE_HYBRID_DDR ) || \
+	  ( (n) == IPA_NAT_MEM_IN_DDR  && nati_obj.curr_state == NATI_STATE_HYBRID ) || \
+	  ( (n) == IPA_NAT_MEM_IN_DDR  && nati_obj.curr_state == NATI_STATE_DDR_ONLY ) || \
+	  ( (n) == IPA_NAT_MEM_IN_SRAM && nati_obj.curr_state == NATI_STATE_SRAM_ONLY ) )
 
 #undef GEN_HOLD_STATE
 #define GEN_HOLD_STATE() \
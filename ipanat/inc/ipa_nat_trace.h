@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef IPA_NAT_TRACE_H
+#define IPA_NAT_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A binary trace of what libipanat hands the IPA, for when IPADBG is
+ * too slow or compiled out. Hot paths copy the raw structures into a
+ * ring of fixed size records and nothing is formatted until the
+ * records are read back with ipa_nat_trace_format(). While the trace
+ * is disabled, a trace point costs a load and a not taken branch.
+ *
+ * Records are only written with the nat mutex held, so there is one
+ * writer at a time, and the ring is only resized with it held. Readers
+ * don't take the mutex: each record carries its sequence number, which
+ * is cleared while the record is being written, so a reader can tell a
+ * torn or overwritten record from a good one.
+ */
+#undef  IPA_NAT_TRACE_DATA_SZ
+#define IPA_NAT_TRACE_DATA_SZ 48
+
+/**
+ * enum ipa_nat_trace_ev - kinds of trace records
+ * @IPA_NAT_TRC_DMA_CMD: a DMA command posted to the IPA; arg is the
+ *  number of entries in the command and data holds up to four of them,
+ *  commands with more entries take more records
+ * @IPA_NAT_TRC_ADD_RULE: a client's ipa_nat_ipv4_rule being added; arg is
+ *  the table's index within its memory type
+ * @IPA_NAT_TRC_NEW_RULE: the NAT table record made for it; arg is the new
+ *  rule handle
+ * @IPA_NAT_TRC_DEL_RULE: a NAT table record being deleted; arg is the rule
+ *  handle
+ * @IPA_NAT_TRC_GET_RULE: a NAT table record whose timestamp was queried;
+ *  arg is the rule handle
+ * @IPA_NAT_TRC_MIGRATE: a NAT table record being copied to the other
+ *  memory type; arg is its rule handle in the source table
+ */
+typedef enum {
+	IPA_NAT_TRC_DMA_CMD  = 0,
+	IPA_NAT_TRC_ADD_RULE = 1,
+	IPA_NAT_TRC_NEW_RULE = 2,
+	IPA_NAT_TRC_DEL_RULE = 3,
+	IPA_NAT_TRC_GET_RULE = 4,
+	IPA_NAT_TRC_MIGRATE  = 5,
+
+	IPA_NAT_TRC_MAX
+} ipa_nat_trace_ev;
+
+/**
+ * struct ipa_nat_trace_rec - one trace record
+ * @seq: sequence number of the record, increasing by one per record
+ * @ts_ns: CLOCK_MONOTONIC time the record was made at
+ * @ev: an ipa_nat_trace_ev
+ * @aux: memory type of the table
+ * @len: bytes of data used
+ * @arg: see ipa_nat_trace_ev
+ * @data: the raw structure
+ */
+typedef struct {
+	uint64_t seq;
+	uint64_t ts_ns;
+	uint8_t  ev;
+	uint8_t  aux;
+	uint16_t len;
+	uint32_t arg;
+	uint8_t  data[IPA_NAT_TRACE_DATA_SZ];
+} ipa_nat_trace_rec;
+
+typedef struct {
+	ipa_nat_trace_rec* recs;
+	uint32_t           num_recs;
+	uint64_t           first_seq; /* next_seq when the ring was made */
+	uint64_t           next_seq;
+} ipa_nat_trace_ring;
+
+extern ipa_nat_trace_ring nat_trace;
+
+void ipa_nat_trace_put(
+	ipa_nat_trace_ev ev,
+	uint8_t          aux,
+	uint32_t         arg,
+	const void*      data_ptr,
+	uint32_t         len );
+
+/*
+ * The trace points. The arguments are not evaluated while the trace
+ * is disabled.
+ */
+#undef  IPA_NAT_TRACE_ON
+#define IPA_NAT_TRACE_ON() \
+	__builtin_expect(__atomic_load_n(&nat_trace.recs, __ATOMIC_RELAXED) != NULL, 0)
+
+#undef  IPA_NAT_TRACE
+#define IPA_NAT_TRACE(ev, nmi, arg, data_ptr, len) \
+	do { \
+		if ( IPA_NAT_TRACE_ON() ) \
+			ipa_nat_trace_put((ev), (nmi), (arg), (data_ptr), (len)); \
+	} while (0)
+
+#undef  IPA_NAT_TRACE_DMA
+#define IPA_NAT_TRACE_DMA(cmd_ptr) \
+	do { \
+		if ( IPA_NAT_TRACE_ON() ) \
+			ipa_nat_trace_dma(cmd_ptr); \
+	} while (0)
+
+struct ipa_ioc_nat_dma_cmd;
+
+void ipa_nat_trace_dma(
+	const struct ipa_ioc_nat_dma_cmd* cmd_ptr );
+
+int ipa_nat_trace_resize(
+	uint32_t num_recs );
+
+int ipa_nat_trace_read(
+	uint64_t*          cursor_ptr,
+	ipa_nat_trace_rec* recs,
+	uint32_t           max_recs,
+	uint32_t*          num_recs_ptr );
+
+char* ipa_nat_trace_format(
+	const ipa_nat_trace_rec* rec_ptr,
+	char*                    buf_ptr,
+	uint32_t                 buf_sz );
+
+#endif /* #ifndef IPA_NAT_TRACE_H */
@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <linux/msm_ipa.h>
 
 #define IPA_TABLE_MAX_ENTRIES 5120
@@ -320,4 +321,160 @@ int ipa_table_add_dma_cmd(
 	uint16_t                    data_for_entry,
 	struct ipa_ioc_nat_dma_cmd* cmd_ptr );
 
+int ipa_table_calculate_entries_split(
+	ipa_table* table,
+	uint16_t   number_of_entries,
+	float      btp,
+	float      etp);
+
+int ipa_table_set_entries(
+	ipa_table* table,
+	uint16_t   table_entries,
+	uint16_t   expn_table_entries);
+
+/*
+ * Table sizing advice: a workload's tuples, hashed by the same hash
+ * the IPA uses, are dropped into candidate base/expansion splits of
+ * the same total size to see which one gives the shortest chains
+ * without running out of expansion entries.
+ */
+#define IPA_TABLE_CHAIN_BINS    8 /* the last bin also counts longer chains */
+#define IPA_TABLE_MAX_SPLITS    6
+#define IPA_TABLE_ADV_MAX_TBLS  2 /* NAT has a rule and an index table */
+
+/**
+ * struct ipa_table_split_stats - how a workload fares in one table
+ * @table_entries: base table entries, a power of two
+ * @expn_table_entries: expansion table entries
+ * @placed: tuples that found a base or expansion entry
+ * @failed: tuples that found the expansion table full
+ * @max_chain: longest chain
+ * @avg_probe: records looked at, on average, to find a placed tuple
+ * @chain_hist: used base entries by chain length, 1 in chain_hist[0]
+ */
+typedef struct
+{
+	uint16_t table_entries;
+	uint16_t expn_table_entries;
+	uint32_t placed;
+	uint32_t failed;
+	uint32_t max_chain;
+	float    avg_probe;
+	uint32_t chain_hist[IPA_TABLE_CHAIN_BINS];
+} ipa_table_split_stats;
+
+/**
+ * struct ipa_table_advice - candidate splits for one table size
+ * @number_of_entries: the size asked about, as passed to the add table API
+ * @num_tuples: tuples in the workload
+ * @num_tbls: tables hashed per tuple, see IPA_TABLE_ADV_MAX_TBLS
+ * @num_splits: candidates in @splits
+ * @dflt: the candidate the add table API uses without advice
+ * @best: the recommended candidate
+ * @splits: per candidate, per table stats
+ */
+typedef struct
+{
+	uint16_t              number_of_entries;
+	uint32_t              num_tuples;
+	uint32_t              num_tbls;
+	uint32_t              num_splits;
+	uint32_t              dflt;
+	uint32_t              best;
+	ipa_table_split_stats splits[IPA_TABLE_MAX_SPLITS][IPA_TABLE_ADV_MAX_TBLS];
+} ipa_table_advice;
+
+int ipa_table_simulate(
+	const uint16_t*        hashes,
+	uint32_t               num_hashes,
+	uint16_t               table_entries,
+	uint16_t               expn_table_entries,
+	ipa_table_split_stats* stats_ptr );
+
+int ipa_table_advise(
+	const uint16_t*      hashes[],
+	uint32_t             num_tbls,
+	uint32_t             num_hashes,
+	uint16_t             number_of_entries,
+	enum ipa3_nat_mem_in nmi,
+	ipa_table_advice*    advice_ptr );
+
+/*
+ * Table verification: a torn DMA or an SSR in the middle of an update
+ * can leave chains that loop, that lead out of the expansion table or
+ * that lose their tail, which shows up as lookups that miss or walks
+ * that never end.
+ */
+
+/**
+ * struct ipa_table_verify_report - what ipa_table_verify() found
+ * @base_filled: filled base entries
+ * @expn_filled: filled expansion entries
+ * @chains: base entries with a tail
+ * @max_chain: longest chain
+ * @bad_links: next indexes out of the expansion table or to an empty
+ *             entry
+ * @cycles: next indexes to an entry already on a chain, ie. a cycle or
+ *          two chains run together
+ * @bad_prevs: entries whose prev index is not the entry before them
+ * @orphans: filled expansion entries no chain reaches
+ * @bad_cnts: how many of cur_tbl_cnt and cur_expn_tbl_cnt were off
+ * @errors: the five above added up
+ * @repaired: errors repaired
+ * @deferred: errors left for a later run for want of DMA entries
+ */
+typedef struct
+{
+	uint32_t base_filled;
+	uint32_t expn_filled;
+	uint32_t chains;
+	uint32_t max_chain;
+	uint32_t bad_links;
+	uint32_t cycles;
+	uint32_t bad_prevs;
+	uint32_t orphans;
+	uint32_t bad_cnts;
+	uint32_t errors;
+	uint32_t repaired;
+	uint32_t deferred;
+} ipa_table_verify_report;
+
+/* DMA entries a verify may queue, which keeps the command on the stack */
+#define IPA_TABLE_VERIFY_MAX_DMA 32
+
+int ipa_table_verify(
+	ipa_table*                  table,
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint32_t                    max_dma,
+	uint8_t*                    orphans,
+	ipa_table_verify_report*    report_ptr );
+
+int ipa_table_release_orphan(
+	ipa_table*                  table,
+	uint16_t                    rec_index,
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint32_t                    max_dma );
+
+/*
+ * Background scrub: a timer that runs scrub_cb every period_ms on a
+ * thread of its own, at the lowest nice level.
+ */
+typedef void (*ipa_table_scrub_cb)(
+	void* arb_data_ptr );
+
+typedef struct
+{
+	uint32_t           period_ms;
+	bool               timer_made;
+	timer_t            timer;
+	ipa_table_scrub_cb scrub_cb;
+	void*              arb_data_ptr;
+} ipa_table_scrub;
+
+int ipa_table_scrub_set(
+	ipa_table_scrub*   scrub_ptr,
+	uint32_t           period_ms,
+	ipa_table_scrub_cb scrub_cb,
+	void*              arb_data_ptr );
+
 #endif
@@ -82,6 +82,7 @@ static void ipa_ipv6ct_create_table_dma_cmd_helpers(ipa_ipv6ct_table* ipv6ct_tab
 static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_index);
 static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd);
 static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size);
+static uint16_t ipa_ipv6ct_hash_raw(const ipa_ipv6ct_rule* rule);
 static uint16_t ipa_ipv6ct_xor_segments(uint64_t num);
 
 static int table_entry_is_valid(void* entry);
@@ -96,6 +97,13 @@ static uint16_t table_entry_get_delete_head_dma_command_data(void* head, void* n
 static ipa_ipv6ct ipv6ct;
 static pthread_mutex_t ipv6ct_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Base and expansion table percentages from ipa_ipv6ct_apply_tbl_advice() */
+static struct {
+	bool  set;
+	float btp;
+	float etp;
+} tbl_split;
+
 static ipa_table_entry_interface entry_interface =
 {
 	table_entry_is_valid,
@@ -499,14 +507,7 @@ static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size)
 	IPADBG("src_port: 0x%x dest_port: 0x%x\n", rule->src_port, rule->dest_port);
 	IPADBG("protocol: 0x%x size: 0x%x\n", rule->protocol, size);
 
-	hash ^= ipa_ipv6ct_xor_segments(rule->src_ipv6_lsb);
-	hash ^= ipa_ipv6ct_xor_segments(rule->src_ipv6_msb);
-	hash ^= ipa_ipv6ct_xor_segments(rule->dest_ipv6_lsb);
-	hash ^= ipa_ipv6ct_xor_segments(rule->dest_ipv6_msb);
-
-	hash ^= rule->src_port;
-	hash ^= rule->dest_port;
-	hash ^= rule->protocol;
+	hash = ipa_ipv6ct_hash_raw(rule);
 
 	/*
 	 * The size passed to hash function expected be power^2-1, while the actual size is power^2,
@@ -524,6 +525,23 @@ static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size)
 	return hash;
 }
 
+/* ipa_ipv6ct_hash() before it is cut to the table size */
+static uint16_t ipa_ipv6ct_hash_raw(const ipa_ipv6ct_rule* rule)
+{
+	uint16_t hash = 0;
+
+	hash ^= ipa_ipv6ct_xor_segments(rule->src_ipv6_lsb);
+	hash ^= ipa_ipv6ct_xor_segments(rule->src_ipv6_msb);
+	hash ^= ipa_ipv6ct_xor_segments(rule->dest_ipv6_lsb);
+	hash ^= ipa_ipv6ct_xor_segments(rule->dest_ipv6_msb);
+
+	hash ^= rule->src_port;
+	hash ^= rule->dest_port;
+	hash ^= rule->protocol;
+
+	return hash;
+}
+
 static uint16_t ipa_ipv6ct_xor_segments(uint64_t num)
 {
 	const uint64_t mask = 0xffff;
@@ -697,8 +715,12 @@ static int ipa_ipv6ct_create_table(ipa_ipv6ct_table* ipv6ct_table, uint16_t numb
 		&ipv6ct_table->table, IPA_IPV6CT_TABLE_NAME, IPA_NAT_MEM_IN_DDR,
 		sizeof(ipa_ipv6ct_hw_entry), NULL, 0, &entry_interface);
 
-	ret = ipa_table_calculate_entries_num(
-		&ipv6ct_table->table, number_of_entries, IPA_NAT_MEM_IN_DDR);
+	if (tbl_split.set)
+		ret = ipa_table_calculate_entries_split(
+			&ipv6ct_table->table, number_of_entries, tbl_split.btp, tbl_split.etp);
+	else
+		ret = ipa_table_calculate_entries_num(
+			&ipv6ct_table->table, number_of_entries, IPA_NAT_MEM_IN_DDR);
 
 	if (ret)
 	{
@@ -890,6 +912,353 @@ unlock:
 		IPAERR("unable to unlock the ipv6ct mutex\n");
 }
 
+/**
+ * ipa_ipv6ct_advise_tbl() - recommend how to split an IPv6CT table
+ * @number_of_entries: [in] number of IPv6CT entries
+ * @rules: [in] the workload
+ * @num_rules: [in] number of rules in the workload
+ * @advice_ptr: [out] the advice
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_advise_tbl(
+	uint16_t number_of_entries,
+	const ipa_ipv6ct_rule* rules,
+	uint32_t num_rules,
+	ipa_table_advice* advice_ptr)
+{
+	const uint16_t* hashes[1];
+	uint16_t* hash_arr;
+	uint32_t i;
+	int ret;
+
+	IPADBG("\n");
+
+	if (number_of_entries == 0 || (rules == NULL && num_rules) || advice_ptr == NULL)
+	{
+		IPAERR("Invalid parameters number_of_entries=%d rules=%pK advice_ptr=%pK\n",
+			number_of_entries, rules, advice_ptr);
+		return -EINVAL;
+	}
+
+	hash_arr = calloc(num_rules ? num_rules : 1, sizeof(uint16_t));
+	if (hash_arr == NULL)
+	{
+		IPAERR("unable to allocate room for %u hashes\n", num_rules);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_rules; ++i)
+		hash_arr[i] = ipa_ipv6ct_hash_raw(&rules[i]);
+
+	hashes[0] = hash_arr;
+	ret = ipa_table_advise(hashes, 1, num_rules, number_of_entries, IPA_NAT_MEM_IN_DDR, advice_ptr);
+
+	free(hash_arr);
+
+	IPADBG("return\n");
+	return ret;
+}
+
+typedef struct
+{
+	uint32_t num;
+	uint32_t max;
+	uint16_t* hashes;
+} ipv6ct_advice_help;
+
+static int collect_advice_tuple(
+	ipa_table* table_ptr,
+	uint32_t rule_hdl,
+	void* record_ptr,
+	uint16_t record_index,
+	void* meta_record_ptr,
+	uint16_t meta_record_index,
+	void* arb_data_ptr)
+{
+	ipv6ct_advice_help* ah_ptr = (ipv6ct_advice_help*)arb_data_ptr;
+	ipa_ipv6ct_hw_entry* entry = (ipa_ipv6ct_hw_entry*)record_ptr;
+	ipa_ipv6ct_rule rule;
+
+	if (entry->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+		return 0;
+
+	if (ah_ptr->num == ah_ptr->max)
+		return 1;
+
+	memset(&rule, 0, sizeof(rule));
+	rule.src_ipv6_lsb = entry->src_ipv6_lsb;
+	rule.src_ipv6_msb = entry->src_ipv6_msb;
+	rule.dest_ipv6_lsb = entry->dest_ipv6_lsb;
+	rule.dest_ipv6_msb = entry->dest_ipv6_msb;
+	rule.src_port = entry->src_port;
+	rule.dest_port = entry->dest_port;
+	rule.protocol = entry->protocol;
+
+	ah_ptr->hashes[ah_ptr->num++] = ipa_ipv6ct_hash_raw(&rule);
+
+	return 0;
+}
+
+/**
+ * ipa_ipv6ct_advise_live_tbl() - recommend how to split an IPv6CT table
+ * for the rules in it
+ * @table_handle: [in] handle of IPv6CT table
+ * @number_of_entries: [in] number of IPv6CT entries to advise on
+ * @advice_ptr: [out] the advice
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_advise_live_tbl(
+	uint32_t table_handle,
+	uint16_t number_of_entries,
+	ipa_table_advice* advice_ptr)
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipv6ct_advice_help ah;
+	const uint16_t* hashes[1];
+	int ret;
+
+	IPADBG("\n");
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		number_of_entries == 0 || advice_ptr == NULL)
+	{
+		IPAERR("Invalid parameters table_handle=%d number_of_entries=%d advice_ptr=%pK\n",
+			table_handle, number_of_entries, advice_ptr);
+		return -EINVAL;
+	}
+
+	memset(&ah, 0, sizeof(ah));
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ah.max = ipv6ct_table->table.table_entries + ipv6ct_table->table.expn_table_entries;
+	ah.hashes = calloc(ah.max, sizeof(uint16_t));
+	if (ah.hashes == NULL)
+	{
+		IPAERR("unable to allocate room for %u hashes\n", ah.max);
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	ret = ipa_table_walk(&ipv6ct_table->table, 0, WHEN_SLOT_FILLED, collect_advice_tuple, &ah);
+	if (ret < 0)
+	{
+		IPAERR("unable to walk IPv6CT table with handle %d\n", table_handle);
+		goto unlock;
+	}
+
+	hashes[0] = ah.hashes;
+	ret = ipa_table_advise(hashes, 1, ah.num, number_of_entries, IPA_NAT_MEM_IN_DDR, advice_ptr);
+
+unlock:
+	free(ah.hashes);
+
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_apply_tbl_advice() - split new IPv6CT tables as advised
+ * @advice_ptr: [in] the advice, NULL for the default split
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_apply_tbl_advice(const ipa_table_advice* advice_ptr)
+{
+	const ipa_table_split_stats* split_ptr;
+
+	IPADBG("\n");
+
+	if (advice_ptr &&
+		(advice_ptr->number_of_entries == 0 || advice_ptr->best >= advice_ptr->num_splits))
+	{
+		IPAERR("Invalid advice passed\n");
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	if (advice_ptr)
+	{
+		split_ptr = &advice_ptr->splits[advice_ptr->best][0];
+		tbl_split.btp = (float)split_ptr->table_entries / advice_ptr->number_of_entries;
+		tbl_split.etp = (float)split_ptr->expn_table_entries / advice_ptr->number_of_entries;
+		tbl_split.set = true;
+	}
+	else
+	{
+		memset(&tbl_split, 0, sizeof(tbl_split));
+	}
+
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return -EPERM;
+	}
+
+	IPADBG("return\n");
+	return 0;
+}
+
+static int ipa_ipv6ct_verify_locked(ipa_ipv6ct_table* ipv6ct_table, bool repair,
+	ipa_table_verify_report* report_ptr)
+{
+	uint32_t cmd_sz = sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(IPA_TABLE_VERIFY_MAX_DMA * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd;
+	int ret;
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+	cmd = (struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+	cmd->entries = 0;
+
+	ret = ipa_table_verify(&ipv6ct_table->table, (repair) ? cmd : NULL,
+		IPA_TABLE_VERIFY_MAX_DMA, NULL, report_ptr);
+	if (ret)
+	{
+		IPAERR("unable to verify %s\n", ipv6ct_table->table.name);
+		return ret;
+	}
+
+	if (cmd->entries)
+	{
+		ret = ipa_ipv6ct_post_dma_cmd(cmd);
+		if (ret)
+			IPAERR("unable to post dma command\n");
+	}
+
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_verify_tbl() - check an IPv6CT table's chains and counts
+ * @table_handle: [in] handle of IPv6CT table
+ * @repair: [in] fix what is found
+ * @report_ptr: [out] what was found
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_verify_tbl(uint32_t table_handle, bool repair, ipa_table_verify_report* report_ptr)
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	int ret;
+
+	IPADBG("\n");
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS ||
+		report_ptr == NULL)
+	{
+		IPAERR("Invalid parameters table_handle=%d report_ptr=%pK\n", table_handle, report_ptr);
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	ipv6ct_table = &ipv6ct.tables[table_handle - 1];
+	if (!ipv6ct_table->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = ipa_ipv6ct_verify_locked(ipv6ct_table, repair, report_ptr);
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+static struct
+{
+	ipa_table_scrub tmr;
+	bool repair;
+} scrub;
+
+static void ipa_ipv6ct_scrub_cb(void* arb_data_ptr)
+{
+	ipa_table_verify_report report;
+	uint8_t i;
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+		return;
+
+	for (i = 0; i < IPA_IPV6CT_MAX_TBLS; i++)
+	{
+		if (ipv6ct.tables[i].mem_desc.valid)
+			ipa_ipv6ct_verify_locked(&ipv6ct.tables[i], scrub.repair, &report);
+	}
+
+	pthread_mutex_unlock(&ipv6ct_mutex);
+}
+
+/**
+ * ipa_ipv6ct_set_scrub() - verify the IPv6CT tables in the background
+ * @period_ms: [in] time between runs, 0 stops the scrub
+ * @repair: [in] fix what is found
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_set_scrub(uint32_t period_ms, bool repair)
+{
+	int ret;
+
+	IPADBG("\n");
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	scrub.repair = repair;
+	ret = ipa_table_scrub_set(&scrub.tmr, period_ms, ipa_ipv6ct_scrub_cb, NULL);
+
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
 /**
  * ipa_ipv6ct_add_uc_act_entry() - add uc activation entry
  * @u: [in] structure specifying the uC activation entry
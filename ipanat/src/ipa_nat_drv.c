@@ -346,3 +346,210 @@ int ipa_nat_vote_clock(
 
 	return ipa_nati_vote_clock(vote_type);
 }
+
+/**
+ * ipa_nat_journal_enable() - enable, resize or disable the NAT rule
+ * change journal
+ * @num_recs: [in] journal depth in records, zero disables the journal
+ */
+int ipa_nat_journal_enable(
+	uint32_t num_recs)
+{
+	IPADBG("Journal depth %u\n", num_recs);
+
+	return ipa_nati_journal_enable(num_recs);
+}
+
+/**
+ * ipa_nat_journal_read() - read NAT rule change journal records
+ * @cursor_ptr: [in/out] sequence number of the next record to read
+ * @recs: [out] records read
+ * @max_recs: [in] size of recs
+ * @num_recs_ptr: [out] number of records read
+ */
+int ipa_nat_journal_read(
+	uint64_t*            cursor_ptr,
+	ipa_nat_journal_rec* recs,
+	uint32_t             max_recs,
+	uint32_t*            num_recs_ptr)
+{
+	if ( cursor_ptr == NULL ||
+		 recs == NULL ||
+		 max_recs == 0 ||
+		 num_recs_ptr == NULL )
+	{
+		IPAERR("Invalid parameters cursor_ptr=%pK recs=%pK max_recs=%u num_recs_ptr=%pK\n",
+			   cursor_ptr, recs, max_recs, num_recs_ptr);
+		return -EINVAL;
+	}
+
+	return ipa_nati_journal_read(cursor_ptr, recs, max_recs, num_recs_ptr);
+}
+
+/**
+ * ipa_nat_trace_enable() - enable, resize or disable the binary trace
+ * @num_recs: [in] trace depth in records, zero disables the trace
+ */
+int ipa_nat_trace_enable(
+	uint32_t num_recs)
+{
+	IPADBG("Trace depth %u\n", num_recs);
+
+	return ipa_nati_trace_enable(num_recs);
+}
+
+/**
+ * ipa_nat_set_switch_chunk() - make hybrid mode switches from SRAM to
+ * DDR incremental
+ * @num_recs: [in] SRAM records copied to DDR per API call, zero for
+ *            blocking switches
+ */
+int ipa_nat_set_switch_chunk(
+	uint32_t num_recs)
+{
+	IPADBG("Switch chunk %u\n", num_recs);
+
+	return ipa_nati_set_switch_chunk(num_recs);
+}
+
+/**
+ * ipa_nat_set_sram_return() - tune when hybrid mode goes back from DDR
+ * to SRAM
+ * @low_wm_pct: [in] low watermark, percent of SRAM capacity
+ * @dwell_ms: [in] least time spent in DDR before going back
+ */
+int ipa_nat_set_sram_return(
+	uint32_t low_wm_pct,
+	uint32_t dwell_ms)
+{
+	IPADBG("low_wm_pct %u dwell_ms %u\n", low_wm_pct, dwell_ms);
+
+	return ipa_nati_set_sram_return(low_wm_pct, dwell_ms);
+}
+
+/*
+ * HYBRID tables are advised on as DDR, which is where the size given
+ * goes in hybrid mode.
+ */
+static enum ipa3_nat_mem_in mem_type_str_to_nmi(
+	const char* mem_type_ptr)
+{
+	return (mem_type_ptr && !strcasecmp(mem_type_ptr, "SRAM")) ?
+		IPA_NAT_MEM_IN_SRAM : IPA_NAT_MEM_IN_DDR;
+}
+
+/**
+ * ipa_nat_advise_ipv4_tbl() - recommend how to split a NAT table
+ * @public_ip_addr: [in] public ipv4 address
+ * @mem_type_ptr: [in] type of memory table would reside in
+ * @number_of_entries: [in] number of nat entries
+ * @rules: [in] the workload
+ * @num_rules: [in] number of rules in the workload
+ * @advice_ptr: [out] the advice
+ */
+int ipa_nat_advise_ipv4_tbl(
+	uint32_t                 public_ip_addr,
+	const char*              mem_type_ptr,
+	uint16_t                 number_of_entries,
+	const ipa_nat_ipv4_rule* rules,
+	uint32_t                 num_rules,
+	ipa_table_advice*        advice_ptr)
+{
+	if (mem_type_ptr == NULL || number_of_entries == 0 || advice_ptr == NULL) {
+		IPAERR(
+			"Invalid parameters mem_type_ptr=%p number_of_entries=%d advice_ptr=%p\n",
+			mem_type_ptr,
+			number_of_entries,
+			advice_ptr);
+		return -EINVAL;
+	}
+
+	return ipa_NATI_advise_ipv4_tbl(
+		mem_type_str_to_nmi(mem_type_ptr),
+		public_ip_addr,
+		number_of_entries,
+		rules,
+		num_rules,
+		advice_ptr);
+}
+
+/**
+ * ipa_nat_advise_live_ipv4_tbl() - recommend how to split a NAT table
+ * for the rules in it
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @number_of_entries: [in] number of nat entries
+ * @advice_ptr: [out] the advice
+ */
+int ipa_nat_advise_live_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_advice* advice_ptr)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ) {
+		IPAERR("Invalid table handle passed 0x%08X\n", tbl_hdl);
+		return -EINVAL;
+	}
+
+	return ipa_nati_advise_live_ipv4_tbl(
+		tbl_hdl, number_of_entries, advice_ptr);
+}
+
+/**
+ * ipa_nat_apply_ipv4_tbl_advice() - split new NAT tables as advised
+ * @mem_type_ptr: [in] type of memory the advice is for
+ * @advice_ptr: [in] the advice, NULL for the default split
+ */
+int ipa_nat_apply_ipv4_tbl_advice(
+	const char*             mem_type_ptr,
+	const ipa_table_advice* advice_ptr)
+{
+	if (mem_type_ptr == NULL) {
+		IPAERR("Invalid parameter mem_type_ptr=%p\n", mem_type_ptr);
+		return -EINVAL;
+	}
+
+	return ipa_nati_apply_ipv4_tbl_advice(
+		mem_type_str_to_nmi(mem_type_ptr), advice_ptr);
+}
+
+/**
+ * ipa_nat_verify_ipv4_tbl() - check a NAT table's chains and counts
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @repair: [in] fix what is found
+ * @nat_report_ptr: [out] rule table findings
+ * @idx_report_ptr: [out] index table findings
+ */
+int ipa_nat_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr)
+{
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 nat_report_ptr == NULL ||
+		 idx_report_ptr == NULL ) {
+		IPAERR(
+			"Invalid parameters tbl_hdl=0x%08X nat_report_ptr=%p idx_report_ptr=%p\n",
+			tbl_hdl,
+			nat_report_ptr,
+			idx_report_ptr);
+		return -EINVAL;
+	}
+
+	return ipa_nati_verify_ipv4_tbl(
+		tbl_hdl, repair, nat_report_ptr, idx_report_ptr);
+}
+
+/**
+ * ipa_nat_set_scrub() - verify the NAT table in the background
+ * @period_ms: [in] time between runs, 0 to stop
+ * @repair: [in] fix what is found
+ */
+int ipa_nat_set_scrub(
+	uint32_t period_ms,
+	bool     repair)
+{
+	IPADBG("period_ms %u repair %u\n", period_ms, repair);
+
+	return ipa_nati_set_scrub(period_ms, repair);
+}
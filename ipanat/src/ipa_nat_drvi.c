@@ -29,6 +29,7 @@
 
 #include "ipa_nat_drv.h"
 #include "ipa_nat_drvi.h"
+#include "ipa_nat_trace.h"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -73,6 +74,20 @@ extern pthread_mutex_t nat_mutex;
 static ipa_nat_pdn_entry pdns[IPA_MAX_PDN_NUM];
 static int num_pdns = 0;
 static int Hash_token = 69;
+
+/*
+ * Base and expansion table split from ipa_NATI_apply_ipv4_tbl_advice(),
+ * used instead of the built in one when tables are created. DDR tables
+ * are split by percentages; SRAM tables are always the size that fills
+ * SRAM, so they get their split in entries.
+ */
+static struct {
+	bool     set;
+	float    btp;
+	float    etp;
+	uint16_t base;
+	uint16_t expn;
+} tbl_split[IPA_NAT_MEM_IN_MAX];
 /*
  * ----------------------------------------------------------------------------
  * Private helpers for manipulating regular tables
@@ -716,10 +731,23 @@ static int ipa_nati_create_table(
 		0,
 		&entry_interface);
 
-	ret = ipa_table_calculate_entries_num(
-		&nat_table->table,
-		number_of_entries,
-		nat_cache_ptr->nmi);
+	if (tbl_split[nat_cache_ptr->nmi].set &&
+		nat_cache_ptr->nmi == IPA_NAT_MEM_IN_SRAM)
+		ret = ipa_table_set_entries(
+			&nat_table->table,
+			tbl_split[nat_cache_ptr->nmi].base,
+			tbl_split[nat_cache_ptr->nmi].expn);
+	else if (tbl_split[nat_cache_ptr->nmi].set)
+		ret = ipa_table_calculate_entries_split(
+			&nat_table->table,
+			number_of_entries,
+			tbl_split[nat_cache_ptr->nmi].btp,
+			tbl_split[nat_cache_ptr->nmi].etp);
+	else
+		ret = ipa_table_calculate_entries_num(
+			&nat_table->table,
+			number_of_entries,
+			nat_cache_ptr->nmi);
 
 	if (ret) {
 		IPAERR(
@@ -954,6 +982,33 @@ static void ipa_nati_copy_second_index_entry_to_head(
 	IPADBG("Out\n");
 }
 
+/*
+ * dst_hash_raw() - dst_hash() before it is cut to the table size, the
+ * public IP only counting from IPA v4.0 on
+ */
+static uint16_t dst_hash_raw(
+	bool     use_public_ip,
+	uint32_t public_ip,
+	uint32_t trgt_ip,
+	uint16_t trgt_port,
+	uint16_t public_port,
+	uint8_t  proto)
+{
+	uint16_t hash =
+		((uint16_t)(trgt_ip))       ^
+		((uint16_t)(trgt_ip >> 16)) ^
+		(trgt_port)                 ^
+		(public_port)               ^
+		(proto);
+
+	if (use_public_ip)
+		hash ^=
+			((uint16_t)(public_ip)) ^
+			((uint16_t)(public_ip >> 16));
+
+	return hash;
+}
+
 /**
  * dst_hash() - Find the index into ipv4 base table
  * @public_ip: [in] public_ip
@@ -979,12 +1034,7 @@ static uint16_t dst_hash(
 	uint8_t  proto,
 	uint16_t size)
 {
-	uint16_t hash =
-		((uint16_t)(trgt_ip))       ^
-		((uint16_t)(trgt_ip >> 16)) ^
-		(trgt_port)                 ^
-		(public_port)               ^
-		(proto);
+	uint16_t hash;
 
 	IPADBG("In\n");
 
@@ -992,10 +1042,9 @@ static uint16_t dst_hash(
 	IPADBG("target_ip: 0x%08X target_port: 0x%04X\n", trgt_ip, trgt_port);
 	IPADBG("proto: 0x%02X size: 0x%04X\n", proto, size);
 
-	if (nat_cache_ptr->ipa_desc->ver >= IPA_HW_v4_0)
-		hash ^=
-			((uint16_t)(public_ip)) ^
-			((uint16_t)(public_ip >> 16));
+	hash = dst_hash_raw(
+		nat_cache_ptr->ipa_desc->ver >= IPA_HW_v4_0,
+		public_ip, trgt_ip, trgt_port, public_port, proto);
 
 	/*
 	 * The size passed to hash function expected be power^2-1, while
@@ -1018,6 +1067,26 @@ static uint16_t dst_hash(
 	return hash;
 }
 
+/*
+ * src_hash_raw() - src_hash() before it is cut to the table size
+ */
+static uint16_t src_hash_raw(
+	uint32_t priv_ip,
+	uint16_t priv_port,
+	uint32_t trgt_ip,
+	uint16_t trgt_port,
+	uint8_t  proto)
+{
+	return
+		((uint16_t)(priv_ip))       ^
+		((uint16_t)(priv_ip >> 16)) ^
+		(priv_port)                 ^
+		((uint16_t)(trgt_ip))       ^
+		((uint16_t)(trgt_ip >> 16)) ^
+		(trgt_port)                 ^
+		(proto);
+}
+
 /**
  * src_hash() - Find the index into ipv4 index base table
  * @priv_ip: [in] Private IP address
@@ -1043,13 +1112,7 @@ static uint16_t src_hash(
 	uint16_t size)
 {
 	uint16_t hash =
-		((uint16_t)(priv_ip))       ^
-		((uint16_t)(priv_ip >> 16)) ^
-		(priv_port)                 ^
-		((uint16_t)(trgt_ip))       ^
-		((uint16_t)(trgt_ip >> 16)) ^
-		(trgt_port)                 ^
-		(proto);
+		src_hash_raw(priv_ip, priv_port, trgt_ip, trgt_port, proto);
 
 	IPADBG("In\n");
 
@@ -1082,14 +1145,13 @@ static int ipa_nati_post_ipv4_dma_cmd(
 	struct ipa_nat_cache*       nat_cache_ptr,
 	struct ipa_ioc_nat_dma_cmd* cmd)
 {
-	char buf[4096];
-	int  ret = 0;
+	int ret = 0;
 
 	IPADBG("In\n");
 
 	cmd->mem_type = nat_cache_ptr->nmi;
 
-	IPADBG("%s\n", prep_ioc_nat_dma_cmd_4print(cmd, buf, sizeof(buf)));
+	IPA_NAT_TRACE_DMA(cmd);
 
 	if (ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd)) {
 		IPAERR("ioctl (IPA_IOC_TABLE_DMA_CMD) on fd %d has failed\n",
@@ -1562,8 +1624,7 @@ int ipa_NATI_query_timestamp(
 	struct ipa_nat_ip4_table_cache* nat_table;
 	struct ipa_nat_rule*            rule_ptr;
 
-	char buf[1024];
-	int  ret;
+	int ret;
 
 	IPADBG("In\n");
 
@@ -1606,9 +1667,7 @@ int ipa_NATI_query_timestamp(
 		goto unlock;
 	}
 
-	IPADBG("rule_hdl(0x%08X) -> %s\n",
-		   rule_hdl,
-		   prep_nat_rule_4print(rule_ptr, buf, sizeof(buf)));
+	IPA_NAT_TRACE(IPA_NAT_TRC_GET_RULE, nmi, rule_hdl, rule_ptr, sizeof(*rule_ptr));
 
 	*time_stamp = rule_ptr->time_stamp;
 
@@ -1644,7 +1703,6 @@ int ipa_NATI_add_ipv4_rule(
 	uint16_t new_entry_index;
 	uint16_t new_index_tbl_entry_index;
 	uint32_t new_entry_handle;
-	char     buf[1024];
 
 	int ret = 0;
 
@@ -1674,10 +1732,7 @@ int ipa_NATI_add_ipv4_rule(
 		goto done;
 	}
 
-	IPADBG("tbl_hdl(0x%08X) nmi(%s) %s\n",
-		   tbl_hdl,
-		   ipa3_nat_mem_in_as_str(nmi),
-		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
+	IPADBG("tbl_hdl(0x%08X) nmi(%s)\n", tbl_hdl, ipa3_nat_mem_in_as_str(nmi));
 
 	nat_cache_ptr = &ipv4_nat_cache[nmi];
 
@@ -1706,6 +1761,8 @@ int ipa_NATI_add_ipv4_rule(
 		goto done;
 	}
 
+	IPA_NAT_TRACE(IPA_NAT_TRC_ADD_RULE, nmi, tbl_hdl, clnt_rule, sizeof(*clnt_rule));
+
 	if (! nat_table->mem_desc.valid) {
 		IPAERR("invalid table handle %d\n", tbl_hdl);
 		ret = -EINVAL;
@@ -1805,9 +1862,7 @@ int ipa_NATI_add_ipv4_rule(
 	IPADBG("new entry:%d, new index entry: %d\n",
 		   new_entry_index, new_index_tbl_entry_index);
 
-	IPADBG("rule_hdl(0x%08X) -> %s\n",
-		   new_entry_handle,
-		   prep_nat_rule_4print(rule, buf, sizeof(buf)));
+	IPA_NAT_TRACE(IPA_NAT_TRC_NEW_RULE, nmi, new_entry_handle, rule, sizeof(*rule));
 
 	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
 
@@ -1864,7 +1919,6 @@ int ipa_NATI_del_ipv4_rule(
 	ipa_table_iterator index_table_iterator;
 
 	uint16_t index;
-	char     buf[1024];
 	int      ret = 0;
 
 	IPADBG("In\n");
@@ -1910,9 +1964,7 @@ int ipa_NATI_del_ipv4_rule(
 		goto unlock;
 	}
 
-	IPADBG("rule_hdl(0x%08X) -> %s\n",
-		   rule_hdl,
-		   prep_nat_rule_4print(table_rule, buf, sizeof(buf)));
+	IPA_NAT_TRACE(IPA_NAT_TRC_DEL_RULE, nmi, rule_hdl, table_rule, sizeof(*table_rule));
 
 	ret = ipa_table_iterator_init(
 		&table_iterator,
@@ -2334,6 +2386,32 @@ int ipa_NATI_walk_ipv4_tbl(
 	WhichTbl2Use      which,
 	ipa_table_walk_cb walk_cb,
 	void*             arb_data_ptr )
+{
+	int ret;
+
+	ret = ipa_NATI_walk_ipv4_tbl_from(
+		tbl_hdl, which, 0, walk_cb, arb_data_ptr);
+
+	if ( ret > 0 )
+	{
+		IPAERR("walk_cb stopped the walk (%d)\n", ret);
+	}
+
+	return ret;
+}
+
+/*
+ * Like ipa_NATI_walk_ipv4_tbl(), but starts at record start_index and
+ * hands a positive walk_cb return value, which stops the walk, back to
+ * the caller without complaint. Starting past the last record is a
+ * walk of nothing.
+ */
+int ipa_NATI_walk_ipv4_tbl_from(
+	uint32_t          tbl_hdl,
+	WhichTbl2Use      which,
+	uint32_t          start_index,
+	ipa_table_walk_cb walk_cb,
+	void*             arb_data_ptr )
 {
 	enum ipa3_nat_mem_in            nmi;
 	uint32_t                        broken_tbl_hdl;
@@ -2391,9 +2469,16 @@ int ipa_NATI_walk_ipv4_tbl(
 		&nat_table->table     :
 		&nat_table->index_table;
 
-	ret = ipa_table_walk(ipa_tbl_ptr, 0, WHEN_SLOT_FILLED, walk_cb, arb_data_ptr);
+	if ( start_index >=
+		 ipa_tbl_ptr->table_entries + ipa_tbl_ptr->expn_table_entries )
+	{
+		goto unlock;
+	}
 
-	if ( ret != 0 )
+	ret = ipa_table_walk(
+		ipa_tbl_ptr, start_index, WHEN_SLOT_FILLED, walk_cb, arb_data_ptr);
+
+	if ( ret < 0 )
 	{
 		IPAERR("ipa_table_walk returned non-zero (%d)\n", ret);
 		goto unlock;
@@ -2452,7 +2537,9 @@ static int gen_chain_stats(
 		{
 			chain_len = 1;
 
-			while ( list_elem_ptr->next_index )
+			while ( list_elem_ptr->next_index &&
+					list_elem_ptr->next_index < table_ptr->tot_tbl_ents &&
+					chain_len <= table_ptr->expn_table_entries )
 			{
 				chain_len++;
 
@@ -2469,7 +2556,9 @@ static int gen_chain_stats(
 		{
 			chain_len = 1;
 
-			while ( list_elem_ptr->next_index )
+			while ( list_elem_ptr->next_index &&
+					list_elem_ptr->next_index < table_ptr->tot_tbl_ents &&
+					chain_len <= table_ptr->expn_table_entries )
 			{
 				chain_len++;
 
@@ -2650,6 +2739,683 @@ bail:
 	return ret;
 }
 
+/*
+ * A rule and its index entry are released together or not at all:
+ * either one left behind names an entry that may be reused for
+ * something else. So a rule no chain reaches goes only when the index
+ * entry it names is also on no chain and names it back.
+ */
+static void nati_release_orphans(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	const uint8_t*                  nat_orphans,
+	const uint8_t*                  idx_orphans,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	ipa_table_verify_report*        nat_report_ptr,
+	ipa_table_verify_report*        idx_report_ptr )
+{
+	ipa_table*                    rule_tbl = &nat_table->table;
+	ipa_table*                    idx_tbl  = &nat_table->index_table;
+	struct ipa_nat_rule*          rule_ptr;
+	struct ipa_nat_indx_tbl_rule* indx_ptr;
+	bool                          deferred;
+	uint16_t                      i, j;
+
+	deferred = nat_report_ptr->deferred || idx_report_ptr->deferred;
+
+	for ( i = 0; i < rule_tbl->expn_table_entries; i++ )
+	{
+		if ( ! nat_orphans[i] )
+		{
+			continue;
+		}
+
+		rule_ptr = (struct ipa_nat_rule*)
+			GOTO_REC(rule_tbl, rule_tbl->table_entries + i);
+
+		j = rule_ptr->indx_tbl_entry;
+
+		if ( j <  idx_tbl->table_entries ||
+			 j >= idx_tbl->table_entries + idx_tbl->expn_table_entries ||
+			 ! idx_orphans[j - idx_tbl->table_entries] )
+		{
+			continue;
+		}
+
+		indx_ptr = (struct ipa_nat_indx_tbl_rule*) GOTO_REC(idx_tbl, j);
+
+		if ( indx_ptr->tbl_entry != rule_tbl->table_entries + i )
+		{
+			continue;
+		}
+
+		/*
+		 * Room for both DMAs, so neither goes without the other
+		 */
+		if ( deferred || cmd->entries + 2 > IPA_TABLE_VERIFY_MAX_DMA )
+		{
+			nat_report_ptr->deferred++;
+			idx_report_ptr->deferred++;
+			continue;
+		}
+
+		if ( ipa_table_release_orphan(
+				 rule_tbl, rule_tbl->table_entries + i,
+				 cmd, IPA_TABLE_VERIFY_MAX_DMA) ||
+			 ipa_table_release_orphan(
+				 idx_tbl, j, cmd, IPA_TABLE_VERIFY_MAX_DMA) )
+		{
+			IPAERR("Unable to release rule %u and index entry %u\n",
+				   rule_tbl->table_entries + i, j);
+			continue;
+		}
+
+		nat_report_ptr->repaired++;
+		idx_report_ptr->repaired++;
+	}
+}
+
+/**
+ * ipa_NATI_verify_ipv4_tbl() - check, and optionally repair, the chains
+ * of a NAT table and its index table
+ * @tbl_hdl: [in] the table
+ * @repair: [in] repair what is found, see ipa_table_verify()
+ * @nat_report_ptr: [out] what was found in the rule table
+ * @idx_report_ptr: [out] what was found in the index table
+ *
+ * Repairs the IPA has to see are posted in one DMA command. A rule and
+ * its index entry that no chain reaches are released as a pair, see
+ * nati_release_orphans(); orphans without a partner are only reported.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_NATI_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr )
+{
+	uint32_t cmd_sz =
+		sizeof(struct ipa_ioc_nat_dma_cmd) +
+		(IPA_TABLE_VERIFY_MAX_DMA * sizeof(struct ipa_ioc_nat_dma_one));
+	char cmd_buf[cmd_sz];
+	struct ipa_ioc_nat_dma_cmd* cmd =
+		(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	enum ipa3_nat_mem_in            nmi;
+	uint32_t                        broken_tbl_hdl;
+	struct ipa_nat_cache*           nat_cache_ptr;
+	struct ipa_nat_ip4_table_cache* nat_table;
+	uint8_t*                        nat_orphans = NULL;
+	uint8_t*                        idx_orphans = NULL;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 ! nat_report_ptr ||
+		 ! idx_report_ptr )
+	{
+		IPAERR("Bad arg: "
+			   "tbl_hdl(0x%08X) and/or "
+			   "nat_report_ptr(%p) and/or "
+			   "idx_report_ptr(%p)\n",
+			   tbl_hdl,
+			   nat_report_ptr,
+			   idx_report_ptr );
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, broken_tbl_hdl);
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) )
+	{
+		IPAERR("Bad cache type argument passed\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	memset(cmd_buf, 0, sizeof(cmd_buf));
+
+	if ( pthread_mutex_lock(&nat_mutex) )
+	{
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	nat_cache_ptr = &ipv4_nat_cache[nmi];
+
+	nat_table = &nat_cache_ptr->ip4_tbl[broken_tbl_hdl - 1];
+
+	if ( ! nat_cache_ptr->table_cnt || ! nat_table->mem_desc.valid )
+	{
+		IPAERR("Invalid table handle 0x%08X\n", tbl_hdl);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	if ( repair )
+	{
+		nat_orphans = calloc(
+			nat_table->table.expn_table_entries +
+			nat_table->index_table.expn_table_entries + 1,
+			sizeof(uint8_t));
+
+		if ( nat_orphans == NULL )
+		{
+			IPAERR("Unable to allocate orphan maps\n");
+			ret = -ENOMEM;
+			goto unlock;
+		}
+
+		idx_orphans = nat_orphans + nat_table->table.expn_table_entries;
+	}
+
+	ret = ipa_table_verify(
+		&nat_table->index_table,
+		(repair) ? cmd : NULL,
+		IPA_TABLE_VERIFY_MAX_DMA,
+		idx_orphans,
+		idx_report_ptr);
+
+	if ( ret )
+	{
+		goto unlock;
+	}
+
+	ret = ipa_table_verify(
+		&nat_table->table,
+		(repair) ? cmd : NULL,
+		IPA_TABLE_VERIFY_MAX_DMA,
+		nat_orphans,
+		nat_report_ptr);
+
+	if ( ret )
+	{
+		goto unlock;
+	}
+
+	if ( repair && (nat_report_ptr->orphans || idx_report_ptr->orphans) )
+	{
+		nati_release_orphans(
+			nat_table, nat_orphans, idx_orphans, cmd,
+			nat_report_ptr, idx_report_ptr);
+	}
+
+	if ( cmd->entries )
+	{
+		ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+
+		if ( ret )
+		{
+			IPAERR("Unable to post dma command\n");
+			goto unlock;
+		}
+	}
+
+unlock:
+	if ( pthread_mutex_unlock(&nat_mutex) )
+	{
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+	free(nat_orphans);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * The hash that decides where a rule goes only takes in the public IP
+ * from IPA v4.0 on. Without a device to ask, assume a recent one.
+ */
+static bool nati_hash_public_ip(void)
+{
+	struct ipa_nat_cache* nat_cache_ptr =
+		(ipv4_nat_cache[IPA_NAT_MEM_IN_DDR].ipa_desc) ?
+		&ipv4_nat_cache[IPA_NAT_MEM_IN_DDR]           :
+		&ipv4_nat_cache[IPA_NAT_MEM_IN_SRAM];
+
+	return ! nat_cache_ptr->ipa_desc ||
+		nat_cache_ptr->ipa_desc->ver >= IPA_HW_v4_0;
+}
+
+/*
+ * The total SRAM tables are made with, see _smAddSramTbl(), which is
+ * the only size an SRAM table is advised on.
+ */
+static int nati_sram_slots(
+	uint32_t* sram_size_ptr,
+	uint16_t* slots_ptr )
+{
+	int ret;
+
+	ret = ipa_nati_get_sram_size(sram_size_ptr);
+
+	if ( ret == 0 )
+	{
+		ret = ipa_calc_num_sram_table_entries(
+			*sram_size_ptr,
+			sizeof(struct ipa_nat_rule),
+			sizeof(struct ipa_nat_indx_tbl_rule),
+			slots_ptr);
+	}
+
+	if ( ret == 0 && *slots_ptr == 0 )
+	{
+		IPAERR("No room for a table in SRAM\n");
+		ret = -ENOSPC;
+	}
+
+	return ret;
+}
+
+typedef struct
+{
+	bool      use_public_ip;
+	uint32_t  num;
+	uint32_t  max;
+	uint16_t* hashes[IPA_TABLE_ADV_MAX_TBLS];
+} advice_help;
+
+static int advice_help_init(
+	advice_help* ah_ptr,
+	uint32_t     max )
+{
+	memset(ah_ptr, 0, sizeof(advice_help));
+
+	ah_ptr->use_public_ip = nati_hash_public_ip();
+	ah_ptr->max           = max;
+
+	ah_ptr->hashes[0] = calloc(max ? max : 1, sizeof(uint16_t));
+	ah_ptr->hashes[1] = calloc(max ? max : 1, sizeof(uint16_t));
+
+	if ( ! ah_ptr->hashes[0] || ! ah_ptr->hashes[1] )
+	{
+		IPAERR("Unable to allocate room for %u hashes\n", max);
+		free(ah_ptr->hashes[0]);
+		free(ah_ptr->hashes[1]);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void advice_help_add(
+	advice_help* ah_ptr,
+	uint32_t     public_ip,
+	uint32_t     private_ip,
+	uint32_t     target_ip,
+	uint16_t     private_port,
+	uint16_t     target_port,
+	uint16_t     public_port,
+	uint8_t      protocol )
+{
+	if ( ah_ptr->num < ah_ptr->max )
+	{
+		ah_ptr->hashes[0][ah_ptr->num] = dst_hash_raw(
+			ah_ptr->use_public_ip,
+			public_ip, target_ip, target_port, public_port, protocol);
+
+		ah_ptr->hashes[1][ah_ptr->num] = src_hash_raw(
+			private_ip, private_port, target_ip, target_port, protocol);
+
+		ah_ptr->num++;
+	}
+}
+
+static int advice_help_fini(
+	advice_help*         ah_ptr,
+	uint16_t             number_of_entries,
+	enum ipa3_nat_mem_in nmi,
+	ipa_table_advice*    advice_ptr )
+{
+	const uint16_t* hashes[IPA_TABLE_ADV_MAX_TBLS] = {
+		ah_ptr->hashes[0],
+		ah_ptr->hashes[1],
+	};
+
+	int ret;
+
+	/*
+	 * The NAT and index tables are always the same size, so they
+	 * share the split.
+	 */
+	ret = ipa_table_advise(
+		hashes, IPA_TABLE_ADV_MAX_TBLS, ah_ptr->num,
+		number_of_entries, nmi, advice_ptr);
+
+	free(ah_ptr->hashes[0]);
+	free(ah_ptr->hashes[1]);
+
+	return ret;
+}
+
+/**
+ * ipa_NATI_advise_ipv4_tbl() - recommend how to split a NAT table for
+ * a workload
+ * @nmi: [in] the memory the table would live in
+ * @public_ip: [in] the table's public IP
+ * @number_of_entries: [in] the table size that would be asked for
+ * @rules: [in] the workload
+ * @num_rules: [in] number of entries in @rules
+ * @advice_ptr: [out] see ipa_table_advise()
+ *
+ * The rules are hashed the way ipa_NATI_add_ipv4_rule() hashes them,
+ * less the scattering of src_only and dst_only rules. SRAM tables
+ * always fill SRAM, so for SRAM @number_of_entries is ignored and the
+ * advice is on that size.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_NATI_advise_ipv4_tbl(
+	enum ipa3_nat_mem_in     nmi,
+	uint32_t                 public_ip,
+	uint16_t                 number_of_entries,
+	const ipa_nat_ipv4_rule* rules,
+	uint32_t                 num_rules,
+	ipa_table_advice*        advice_ptr )
+{
+	advice_help ah;
+	uint32_t    sram_size;
+	uint32_t    i;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ||
+		 (rules == NULL && num_rules) ||
+		 advice_ptr == NULL )
+	{
+		IPAERR("Bad arg: nmi(%u) rules(%p) advice_ptr(%p)\n",
+			   nmi, rules, advice_ptr);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( nmi == IPA_NAT_MEM_IN_SRAM )
+	{
+		ret = nati_sram_slots(&sram_size, &number_of_entries);
+
+		if ( ret )
+		{
+			goto bail;
+		}
+	}
+
+	ret = advice_help_init(&ah, num_rules);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	for ( i = 0; i < num_rules; i++ )
+	{
+		advice_help_add(
+			&ah,
+			public_ip,
+			rules[i].private_ip,
+			rules[i].target_ip,
+			rules[i].private_port,
+			rules[i].target_port,
+			rules[i].public_port,
+			rules[i].protocol);
+	}
+
+	ret = advice_help_fini(&ah, number_of_entries, nmi, advice_ptr);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+static int collect_advice_tuple(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	advice_help*         ah_ptr   = (advice_help*) arb_data_ptr;
+	struct ipa_nat_rule* rule_ptr = (struct ipa_nat_rule*) record_ptr;
+
+	if ( rule_ptr->protocol == IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
+	{
+		return 0;
+	}
+
+	if ( ah_ptr->num == ah_ptr->max )
+	{
+		return 1;
+	}
+
+	advice_help_add(
+		ah_ptr,
+		pdns[rule_ptr->pdn_index].public_ip,
+		rule_ptr->private_ip,
+		rule_ptr->target_ip,
+		rule_ptr->private_port,
+		rule_ptr->target_port,
+		rule_ptr->public_port,
+		rule_ptr->protocol);
+
+	return 0;
+}
+
+/**
+ * ipa_nati_advise_live_ipv4_tbl() - recommend how to split a NAT table
+ * for the rules already in it
+ * @tbl_hdl: [in] the table, as handed out by ipa_nat_add_ipv4_tbl()
+ * @number_of_entries: [in] the table size to advise on, eg. the one
+ *                     the table was asked for with; ignored for an
+ *                     SRAM table, see ipa_NATI_advise_ipv4_tbl()
+ * @advice_ptr: [out] see ipa_table_advise()
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_nati_advise_live_ipv4_tbl(
+	uint32_t          tbl_hdl,
+	uint16_t          number_of_entries,
+	ipa_table_advice* advice_ptr )
+{
+	ipa_nati_tbl_stats nat_stats, idx_stats;
+	advice_help        ah;
+	uint32_t           sram_size;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) ||
+		 number_of_entries == 0 ||
+		 advice_ptr == NULL )
+	{
+		IPAERR("Bad arg: tbl_hdl(0x%08X) number_of_entries(%u) advice_ptr(%p)\n",
+			   tbl_hdl, number_of_entries, advice_ptr);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nat_stats, &idx_stats);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	if ( nat_stats.nmi == IPA_NAT_MEM_IN_SRAM )
+	{
+		ret = nati_sram_slots(&sram_size, &number_of_entries);
+
+		if ( ret )
+		{
+			goto bail;
+		}
+	}
+
+	ret = advice_help_init(&ah, nat_stats.tot_ents);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	ret = ipa_nati_walk_ipv4_tbl(
+		tbl_hdl, USE_NAT_TABLE, collect_advice_tuple, &ah);
+
+	if ( ret < 0 )
+	{
+		IPAERR("Unable to walk table 0x%08X\n", tbl_hdl);
+		free(ah.hashes[0]);
+		free(ah.hashes[1]);
+		goto bail;
+	}
+
+	ret = advice_help_fini(&ah, number_of_entries, nat_stats.nmi, advice_ptr);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/**
+ * ipa_NATI_apply_ipv4_tbl_advice() - split NAT tables created from
+ * now on as advised
+ * @nmi: [in] the memory the advice is for
+ * @advice_ptr: [in] advice from ipa_nat_advise_ipv4_tbl(), or NULL to go
+ *              back to the built in split
+ *
+ * For DDR, the advised split is kept as percentages of the size
+ * advised on, so tables of other sizes are split in the same
+ * proportion. SRAM tables are only ever the one size, so for SRAM the
+ * advice must be on that size and the split is kept in entries, once
+ * checked to fit. The caller holds the nat mutex.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_NATI_apply_ipv4_tbl_advice(
+	enum ipa3_nat_mem_in    nmi,
+	const ipa_table_advice* advice_ptr )
+{
+	const ipa_table_split_stats* split_ptr;
+
+	ipa_table nat_table, index_table;
+	uint32_t  sram_size;
+	uint16_t  slots;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) ||
+		 (advice_ptr &&
+		  (advice_ptr->number_of_entries == 0 ||
+		   advice_ptr->best >= advice_ptr->num_splits)) )
+	{
+		IPAERR("Bad arg: nmi(%u) and/or advice_ptr(%p)\n", nmi, advice_ptr);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( advice_ptr && nmi == IPA_NAT_MEM_IN_SRAM )
+	{
+		split_ptr = &advice_ptr->splits[advice_ptr->best][0];
+
+		ret = nati_sram_slots(&sram_size, &slots);
+
+		if ( ret )
+		{
+			goto bail;
+		}
+
+		if ( advice_ptr->number_of_entries != slots )
+		{
+			IPAERR("SRAM advice on %u entries, SRAM tables have %u\n",
+				   advice_ptr->number_of_entries, slots);
+			ret = -EINVAL;
+			goto bail;
+		}
+
+		ipa_table_init(&nat_table, "sram_advice", nmi,
+					   sizeof(struct ipa_nat_rule), NULL, 0, NULL);
+		ipa_table_init(&index_table, "sram_advice", nmi,
+					   sizeof(struct ipa_nat_indx_tbl_rule), NULL, 0, NULL);
+
+		ret = ipa_table_set_entries(
+			&nat_table,
+			split_ptr->table_entries,
+			split_ptr->expn_table_entries);
+
+		if ( ret == 0 )
+		{
+			ret = ipa_table_set_entries(
+				&index_table,
+				split_ptr->table_entries,
+				split_ptr->expn_table_entries);
+		}
+
+		if ( ret )
+		{
+			goto bail;
+		}
+
+		if ( (uint32_t) (ipa_table_calculate_size(&nat_table) +
+						 ipa_table_calculate_size(&index_table)) > sram_size )
+		{
+			IPAERR("SRAM split base(%u) expn(%u) exceeds sram_size(%u)\n",
+				   split_ptr->table_entries,
+				   split_ptr->expn_table_entries,
+				   sram_size);
+			ret = -ENOSPC;
+			goto bail;
+		}
+
+		memset(&tbl_split[nmi], 0, sizeof(tbl_split[nmi]));
+
+		tbl_split[nmi].base = split_ptr->table_entries;
+		tbl_split[nmi].expn = split_ptr->expn_table_entries;
+		tbl_split[nmi].set  = true;
+
+		IPADBG("%s tables split %u/%u\n",
+			   ipa3_nat_mem_in_as_str(nmi),
+			   tbl_split[nmi].base, tbl_split[nmi].expn);
+	}
+	else if ( advice_ptr )
+	{
+		split_ptr = &advice_ptr->splits[advice_ptr->best][0];
+
+		tbl_split[nmi].btp =
+			(float) split_ptr->table_entries / advice_ptr->number_of_entries;
+		tbl_split[nmi].etp =
+			(float) split_ptr->expn_table_entries / advice_ptr->number_of_entries;
+		tbl_split[nmi].set = true;
+
+		IPADBG("%s tables split %f/%f\n",
+			   ipa3_nat_mem_in_as_str(nmi),
+			   tbl_split[nmi].btp, tbl_split[nmi].etp);
+	}
+	else
+	{
+		memset(&tbl_split[nmi], 0, sizeof(tbl_split[nmi]));
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nati_vote_clock(
     enum ipa_app_clock_vote_type vote_type )
 {
@@ -125,6 +125,21 @@ bail:
 
 /******************************************************************************/
 
+int ipa_nat_map_has(
+	ipa_which_map which,
+	uint32_t      key )
+{
+	if ( ! VALID_IPA_USE_MAP(which) )
+	{
+		IPAERR("Bad arg which(%u)\n", which);
+		return 0;
+	}
+
+	return map_array[which].find(key) != map_array[which].end();
+}
+
+/******************************************************************************/
+
 int ipa_nat_map_del(
 	ipa_which_map which,
 	uint32_t      key,
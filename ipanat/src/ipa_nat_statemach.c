@@ -62,23 +62,28 @@
  */
 #include <errno.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include "ipa_nat_drv.h"
 #include "ipa_nat_drvi.h"
+#include "ipa_nat_trace.h"
 
 #include "ipa_nat_map.h"
 
 #include "ipa_nat_statemach.h"
 
 #undef PRCNT_OF
-#define PRCNT_OF(v) \
-	((.25) * (v))
+#define PRCNT_OF(v, p) \
+	((uint32_t) (((uint64_t) (v) * (p)) / 100))
 
 #undef  CHOOSE_MEM_SUB
 #define CHOOSE_MEM_SUB() \
-	(nati_obj.curr_state == NATI_STATE_HYBRID) ? \
-	SRAM_SUB : \
-	DDR_SUB
+	((nati_obj.curr_state == NATI_STATE_HYBRID && ! nati_obj.mig.active) ? \
+	 SRAM_SUB : \
+	 DDR_SUB)
 
 #undef  CHOOSE_MAPS
 #define CHOOSE_MAPS(o2n, n2o) \
@@ -170,6 +175,11 @@ static ipa_nati_obj nati_obj = {
 	 *   sw_stats[1] for sram
 	 */
 	.sw_stats = { {0, 0}, {0, 0} },
+	.sram_ret = {
+		.low_wm_pct   = NATI_DFLT_LOW_WM_PCT,
+		.dwell_ms     = NATI_DFLT_DWELL_MS,
+		.cur_dwell_ms = NATI_DFLT_DWELL_MS,
+	},
 };
 
 /*
@@ -387,6 +397,30 @@ int ipa_nati_ipv4_tbl_stats(
 	return ret;
 }
 
+int ipa_nati_verify_ipv4_tbl(
+	uint32_t                 tbl_hdl,
+	bool                     repair,
+	ipa_table_verify_report* nat_report_ptr,
+	ipa_table_verify_report* idx_report_ptr )
+{
+	arb_t* args[] = {
+		(arb_t*)(arb_t)tbl_hdl,
+		(arb_t*)(arb_t)repair,
+		(arb_t*) nat_report_ptr,
+		(arb_t*) idx_report_ptr,
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_VERIFY, args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nati_add_ipv4_rule(
 	uint32_t                 tbl_hdl,
 	const ipa_nat_ipv4_rule* clnt_rule,
@@ -515,7 +549,16 @@ int ipa_nat_switch_to(
 	{
 		ret = 0;
 
-		if ( COMPATIBLE_NMI_4SWITCH(nmi) )
+		/*
+		 * An incremental switch under way is seen through first, so
+		 * that the state below is where the rules really are...
+		 */
+		if ( nati_obj.mig.active )
+		{
+			ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_TBL_SWITCH, 0);
+		}
+
+		if ( ret == 0 && COMPATIBLE_NMI_4SWITCH(nmi) )
 		{
 			ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_TBL_SWITCH, 0);
 		}
@@ -596,208 +639,1451 @@ int ipa_nat_switch_to(
 	ret = 0;
 
 unlock:
+	if ( give_mutex() != 0 )
+	{
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+bool ipa_nat_is_sram_supported(void)
+{
+	return VALID_TBL_HDL(nati_obj.sram_tbl_hdl);
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: journal_rec
+ *
+ * PARAMS:
+ *
+ *   op            (IN) What happened to the rule or table
+ *
+ *   tbl_hdl       (IN) The table the change was made in
+ *
+ *   orig_rule_hdl (IN) The rule handle known to the application
+ *
+ *   old_rule_hdl  (IN) The rule handle in the source table (migrate only)
+ *
+ *   new_rule_hdl  (IN) The rule handle in tbl_hdl
+ *
+ * DESCRIPTION:
+ *
+ *   Appends a record to the rule change journal, if the journal is
+ *   enabled, overwriting the oldest record when the journal is full.
+ *
+ *   Must be called with the nat mutex held.
+ */
+static void journal_rec(
+	ipa_nat_journal_op op,
+	uint32_t           tbl_hdl,
+	uint32_t           orig_rule_hdl,
+	uint32_t           old_rule_hdl,
+	uint32_t           new_rule_hdl )
+{
+	nati_journal*        jrnl_ptr = &nati_obj.journal;
+	ipa_nat_journal_rec* rec_ptr;
+	enum ipa3_nat_mem_in nmi;
+	uint32_t             unused_hdl __attribute__((unused));
+
+	if ( jrnl_ptr->recs == NULL )
+	{
+		return;
+	}
+
+	BREAK_TBL_HDL(tbl_hdl, nmi, unused_hdl);
+
+	rec_ptr = &jrnl_ptr->recs[jrnl_ptr->next_seq % jrnl_ptr->num_recs];
+
+	rec_ptr->seq           = jrnl_ptr->next_seq++;
+	rec_ptr->op            = op;
+	rec_ptr->nmi           = nmi;
+	rec_ptr->orig_rule_hdl = orig_rule_hdl;
+	rec_ptr->old_rule_hdl  = old_rule_hdl;
+	rec_ptr->new_rule_hdl  = new_rule_hdl;
+}
+
+int ipa_nati_journal_enable(
+	uint32_t num_recs )
+{
+	nati_journal*        jrnl_ptr = &nati_obj.journal;
+	ipa_nat_journal_rec* recs     = NULL;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( num_recs )
+	{
+		recs = calloc(num_recs, sizeof(*recs));
+
+		if ( recs == NULL )
+		{
+			IPAERR("Unable to allocate %u journal records\n", num_recs);
+			ret = -ENOMEM;
+			goto bail;
+		}
+	}
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		free(recs);
+		goto bail;
+	}
+
+	free(jrnl_ptr->recs);
+
+	/*
+	 * Records already handed out are gone; next_seq keeps counting so
+	 * a reader behind it gets told, and nothing before first_seq is
+	 * in the new ring.
+	 */
+	jrnl_ptr->recs      = recs;
+	jrnl_ptr->num_recs  = num_recs;
+	jrnl_ptr->first_seq = jrnl_ptr->next_seq;
+
+	IPADBG("Journal %s, depth(%u) next_seq(%llu)\n",
+		   (recs) ? "enabled" : "disabled",
+		   num_recs,
+		   (unsigned long long) jrnl_ptr->next_seq);
+
 	ret = give_mutex();
 
 bail:
 	IPADBG("Out\n");
 
-	return ret;
-}
+	return ret;
+}
+
+int ipa_nati_journal_read(
+	uint64_t*            cursor_ptr,
+	ipa_nat_journal_rec* recs,
+	uint32_t             max_recs,
+	uint32_t*            num_recs_ptr )
+{
+	nati_journal* jrnl_ptr = &nati_obj.journal;
+	uint64_t      oldest_seq;
+	uint32_t      cnt = 0;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	*num_recs_ptr = 0;
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	if ( jrnl_ptr->recs == NULL )
+	{
+		IPAERR("Journal not enabled\n");
+		ret = -EPERM;
+		goto unlock;
+	}
+
+	if ( *cursor_ptr > jrnl_ptr->next_seq )
+	{
+		IPAERR("Cursor(%llu) beyond next_seq(%llu)\n",
+			   (unsigned long long) *cursor_ptr,
+			   (unsigned long long) jrnl_ptr->next_seq);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	oldest_seq =
+		(jrnl_ptr->next_seq - jrnl_ptr->first_seq > jrnl_ptr->num_recs) ?
+		jrnl_ptr->next_seq - jrnl_ptr->num_recs                         :
+		jrnl_ptr->first_seq;
+
+	if ( *cursor_ptr < oldest_seq )
+	{
+		IPAINFO("Journal overrun, cursor(%llu) oldest(%llu)\n",
+				(unsigned long long) *cursor_ptr,
+				(unsigned long long) oldest_seq);
+		*cursor_ptr = jrnl_ptr->next_seq;
+		ret = -EOVERFLOW;
+		goto unlock;
+	}
+
+	while ( cnt < max_recs && *cursor_ptr < jrnl_ptr->next_seq )
+	{
+		recs[cnt++] =
+			jrnl_ptr->recs[*cursor_ptr % jrnl_ptr->num_recs];
+		(*cursor_ptr)++;
+	}
+
+	*num_recs_ptr = cnt;
+
+unlock:
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_trace_enable(
+	uint32_t num_recs )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	/*
+	 * Records are only written with the mutex held, so none is being
+	 * written while the ring changes...
+	 */
+	ret = ipa_nat_trace_resize(num_recs);
+
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_apply_ipv4_tbl_advice(
+	enum ipa3_nat_mem_in    nmi,
+	const ipa_table_advice* advice_ptr )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	ret = ipa_NATI_apply_ipv4_tbl_advice(nmi, advice_ptr);
+
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+int ipa_nati_set_switch_chunk(
+	uint32_t num_recs )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = take_mutex();
+
+	if ( ret != 0 )
+	{
+		goto bail;
+	}
+
+	nati_obj.mig.chunk = num_recs;
+
+	IPADBG("SRAM to DDR switch %s, chunk(%u)\n",
+		   (num_recs) ? "incremental" : "blocking",
+		   num_recs);
+
+	/*
+	 * Going back to blocking switches sees one under way through...
+	 */
+	if ( num_recs == 0 && nati_obj.mig.active )
+	{
+		ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_TBL_SWITCH, 0);
+	}
+
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: migrate_rule
+ *
+ * PARAMS:
+ *
+ *   table_ptr         (IN) The table being walked
+ *
+ *   tbl_rule_hdl      (IN) The nat rule's handle from the source table
+ *
+ *   record_ptr        (IN) The nat rule record from the source table
+ *
+ *   record_index      (IN) The record above's index in the table being walked
+ *
+ *   meta_record_ptr   (IN) If meta data in table, this will be it
+ *
+ *   meta_record_index (IN) The record above's index in the table being walked
+ *
+ *   arb_data_ptr      (IN) The destination table handle
+ *
+ * DESCRIPTION:
+ *
+ *   This routine is intended to copy records from a source table to a
+ *   destination table.
+
+ *   It is used in union with the ipa_nati_copy_ipv4_tbl() API call
+ *   below.
+ *
+ *   It is compatible with the ipa_table_walk() API.
+ *
+ *   In the context of the ipa_nati_copy_ipv4_tbl(), the arguments
+ *   passed in are as enumerated above.
+ *
+ * AN IMPORTANT NOTE ON RULE HANDLES WHEN IN MYBRID MODE
+ *
+ *   The rule_hdl is used to find a rule in the nat table.  It is, in
+ *   effect, an index into the table.  The applcation above us retains
+ *   it for future manipulation of the rule in the table.
+ *
+ *   In hybrid mode, a rule can and will move between SRAM and DDR.
+ *   Because of this, its handle will change.  The application has
+ *   only the original handle and doesn't know of the new handle.  A
+ *   mapping, used in hybrid mode, will maintain a relationship
+ *   between the original handle and the rule's current real handle...
+ *
+ *   To help you get a mindset of how this is done:
+ *
+ *     The original handle will map (point) to the new and new handle
+ *     will map (point) back to original.
+ *
+ * NOTE WELL: There are two sets of maps.  One for each memory type...
+ *
+ * RETURNS:
+ *
+ *   Returns 0 on success, non-zero on failure
+ */
+static int migrate_rule(
+	ipa_table*      table_ptr,
+	uint32_t        tbl_rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	struct ipa_nat_rule* nat_rule_ptr = (struct ipa_nat_rule*) record_ptr;
+	uint32_t             dst_tbl_hdl  = (uint32_t) arb_data_ptr;
+
+	ipa_nat_ipv4_rule    v4_rule;
+
+	uint32_t             orig_rule_hdl;
+	uint32_t             new_rule_hdl;
+
+	uint32_t             src_orig2new_map, src_new2orig_map;
+	uint32_t             dst_orig2new_map, dst_new2orig_map;
+	uint32_t*            cnt_ptr;
+
+	const char*          mig_dir_ptr;
+
+	int                  ret;
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_mem_type(%s) tbl_rule_hdl(%u)\n",
+		   ipa3_nat_mem_in_as_str(table_ptr->nmi),
+		   tbl_rule_hdl);
+
+	IPA_NAT_TRACE(IPA_NAT_TRC_MIGRATE, table_ptr->nmi, tbl_rule_hdl,
+				  nat_rule_ptr, sizeof(*nat_rule_ptr));
+
+	IPADBG("dst_tbl_hdl(0x%08X)\n", dst_tbl_hdl);
+
+	/*
+	 * What is the type of the source table?
+	 */
+	if ( table_ptr->nmi == IPA_NAT_MEM_IN_SRAM )
+	{
+		mig_dir_ptr = "SRAM -> DDR";
+
+		src_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
+		src_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
+
+		dst_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
+		dst_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
+
+		cnt_ptr          = &(nati_obj.tot_rules_in_table[DDR_SUB]);
+	}
+	else
+	{
+		mig_dir_ptr = "DDR -> SRAM";
+
+		src_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
+		src_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
+
+		dst_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
+		dst_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
+
+		cnt_ptr          = &(nati_obj.tot_rules_in_table[SRAM_SUB]);
+	}
+
+	if ( nat_rule_ptr->protocol == IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
+	{
+		IPADBG("%s: Special \"first rule in list\" case. "
+			   "Rule's enabled bit on, but protocol implies deleted\n",
+			   mig_dir_ptr);
+		ret = 0;
+		goto bail;
+	}
+
+	ret = ipa_nat_map_find(src_new2orig_map, tbl_rule_hdl, &orig_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("%s: ipa_nat_map_find(src_new2orig_map) fail\n", mig_dir_ptr);
+		goto bail;
+	}
+
+	memset(&v4_rule, 0, sizeof(v4_rule));
+
+	v4_rule.private_ip   = nat_rule_ptr->private_ip;
+	v4_rule.private_port = nat_rule_ptr->private_port;
+	v4_rule.protocol     = nat_rule_ptr->protocol;
+	v4_rule.public_port  = nat_rule_ptr->public_port;
+	v4_rule.target_ip    = nat_rule_ptr->target_ip;
+	v4_rule.target_port  = nat_rule_ptr->target_port;
+	v4_rule.pdn_index    = nat_rule_ptr->pdn_index;
+	v4_rule.redirect     = nat_rule_ptr->redirect;
+	v4_rule.enable       = nat_rule_ptr->enable;
+	v4_rule.time_stamp   = nat_rule_ptr->time_stamp;
+	v4_rule.uc_activation_index = nat_rule_ptr->uc_activation_index;
+	v4_rule.s = nat_rule_ptr->s;
+	v4_rule.ucp = nat_rule_ptr->ucp;
+	v4_rule.dst_only = nat_rule_ptr->dst_only;
+	v4_rule.src_only = nat_rule_ptr->src_only;
+
+	ret = ipa_NATI_add_ipv4_rule(dst_tbl_hdl, &v4_rule, &new_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("%s: ipa_NATI_add_ipv4_rule() fail\n", mig_dir_ptr);
+		goto bail;
+	}
+
+	(*cnt_ptr)++;
+
+	/*
+	 * The following is needed to maintain the original handle and
+	 * have it point to the new handle.
+	 *
+	 * Remember, original handle points to new and the new handle
+	 * points back to original.
+	 */
+	ret = ipa_nat_map_add(dst_orig2new_map, orig_rule_hdl, new_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("%s: ipa_nat_map_add(dst_orig2new_map) fail\n", mig_dir_ptr);
+		goto bail;
+	}
+
+	ret = ipa_nat_map_add(dst_new2orig_map, new_rule_hdl, orig_rule_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("%s: ipa_nat_map_add(dst_new2orig_map) fail\n", mig_dir_ptr);
+		goto bail;
+	}
+
+	IPADBG("orig_rule_hdl(0x%08X) new_rule_hdl(0x%08X)\n",
+		   orig_rule_hdl, new_rule_hdl);
+
+	journal_rec(IPA_NAT_JRNL_MIGRATE, dst_tbl_hdl,
+				orig_rule_hdl, tbl_rule_hdl, new_rule_hdl);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_lat_record
+ *
+ * PARAMS:
+ *
+ *   mig_ptr (IN) The incremental switch to account to
+ *
+ *   ns      (IN) How long an add took
+ *
+ * DESCRIPTION:
+ *
+ *   Drops an add's latency into the histogram of the switch. Below
+ *   four nanoseconds buckets are exact, above each power of two is
+ *   split in four, which keeps percentiles within 25 percent.
+ */
+static void nati_lat_record(
+	nati_migration* mig_ptr,
+	uint64_t        ns )
+{
+	uint32_t bucket, msb;
+
+	if ( ns < (1 << NATI_LAT_SUB_BITS) )
+	{
+		bucket = ns;
+	}
+	else
+	{
+		msb = 63 - __builtin_clzll(ns);
+
+		bucket =
+			((msb - NATI_LAT_SUB_BITS + 1) << NATI_LAT_SUB_BITS) +
+			((ns >> (msb - NATI_LAT_SUB_BITS)) &
+			 ((1 << NATI_LAT_SUB_BITS) - 1));
+	}
+
+	mig_ptr->add_lat_hist[bucket]++;
+	mig_ptr->adds++;
+
+	if ( ns > mig_ptr->add_max_ns )
+	{
+		mig_ptr->add_max_ns = ns;
+	}
+}
+
+/*
+ * The 99th percentile of the adds recorded above, rounded up to the
+ * top of its bucket, but never above the largest one seen.
+ */
+static uint64_t nati_lat_p99(
+	const nati_migration* mig_ptr )
+{
+	uint64_t rank = ((uint64_t) mig_ptr->adds * 99 + 99) / 100;
+	uint64_t seen = 0, top;
+	uint32_t b, shift;
+
+	for ( b = 0; b < NATI_LAT_BUCKETS && rank; b++ )
+	{
+		seen += mig_ptr->add_lat_hist[b];
+
+		if ( seen < rank )
+		{
+			continue;
+		}
+
+		if ( b < (1 << NATI_LAT_SUB_BITS) )
+		{
+			top = b;
+		}
+		else
+		{
+			shift = (b >> NATI_LAT_SUB_BITS) - 1;
+
+			top = (((uint64_t) (1 << NATI_LAT_SUB_BITS) +
+					(b & ((1 << NATI_LAT_SUB_BITS) - 1))) << shift) +
+				((uint64_t) 1 << shift) - 1;
+		}
+
+		return (top < mig_ptr->add_max_ns) ? top : mig_ptr->add_max_ns;
+	}
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: migrate_rule_chunk
+ *
+ * PARAMS:
+ *
+ *   As for migrate_rule() above
+ *
+ * DESCRIPTION:
+ *
+ *   An ipa_table_walk() callback copying at most nati_obj.mig.budget
+ *   records. It stops the walk, by returning one, on the first record
+ *   over the budget and leaves that record's index as the place to
+ *   resume from.
+ *
+ *   A record that cannot be copied is skipped and the switch marked as
+ *   failed. The blocking switch gives up on the whole copy there, but
+ *   once adds have gone to DDR there is no going back to SRAM, so
+ *   losing one rule beats losing all the ones after it.
+ *
+ * RETURNS:
+ *
+ *   zero to carry on walking, one to stop
+ */
+static int migrate_rule_chunk(
+	ipa_table*      table_ptr,
+	uint32_t        tbl_rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	nati_migration* mig_ptr = &nati_obj.mig;
+
+	if ( mig_ptr->budget == 0 )
+	{
+		mig_ptr->next_index = record_index;
+		return 1;
+	}
+
+	mig_ptr->budget--;
+	mig_ptr->next_index = record_index + 1;
+
+	if ( migrate_rule(table_ptr, tbl_rule_hdl, record_ptr, record_index,
+					  meta_record_ptr, meta_record_index, arb_data_ptr) != 0 )
+	{
+		IPAERR("Rule hdl(0x%08X) not migrated to DDR\n", tbl_rule_hdl);
+		mig_ptr->failed = true;
+	}
+
+	return 0;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_migrate_tick
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   on           (IN) Whether to start or stop the ticks
+ *
+ * DESCRIPTION:
+ *
+ *   Starts or stops the timer that has nati_migrate_timer_cb() take a
+ *   step of the switch every NATI_MIG_TICK_MS, for when no add or
+ *   delete comes along to take it.  Without the timer, the switch is
+ *   left to API calls, as before.
+ */
+static void nati_migrate_timer_cb(
+	union sigval sv ); /* forward declaration */
+
+static void nati_migrate_tick(
+	ipa_nati_obj* nati_obj_ptr,
+	bool          on )
+{
+	nati_migration*   mig_ptr = &nati_obj_ptr->mig;
+
+	struct sigevent   sev;
+	struct itimerspec its;
+
+	if ( ! mig_ptr->timer_made )
+	{
+		if ( ! on )
+		{
+			return;
+		}
+
+		memset(&sev, 0, sizeof(sev));
+
+		sev.sigev_notify          = SIGEV_THREAD;
+		sev.sigev_notify_function = nati_migrate_timer_cb;
+		sev.sigev_value.sival_ptr = nati_obj_ptr;
+
+		if ( timer_create(CLOCK_MONOTONIC, &sev, &mig_ptr->timer) != 0 )
+		{
+			IPAERR("timer_create failed (%d), switch left to API calls\n",
+				   errno);
+			return;
+		}
+
+		mig_ptr->timer_made = true;
+	}
+
+	memset(&its, 0, sizeof(its));
+
+	if ( on )
+	{
+		its.it_value.tv_nsec = NATI_MIG_TICK_MS * 1000000;
+		its.it_interval      = its.it_value;
+	}
+
+	if ( timer_settime(mig_ptr->timer, 0, &its, NULL) != 0 )
+	{
+		IPAERR("timer_settime failed (%d)\n", errno);
+	}
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_migrate_start
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ * DESCRIPTION:
+ *
+ *   Starts an incremental SRAM to DDR switch. The IPA keeps using the
+ *   SRAM table while nati_migrate_step() copies it to DDR a chunk at a
+ *   time, on each add and delete and off a timer. Meanwhile:
+ *
+ *     - adds go to DDR only, SRAM being full
+ *
+ *     - deletes and timestamp queries find a rule through the SRAM
+ *       maps, the DDR maps, or both when it has already been copied
+ *
+ *   The IPA is pointed at DDR only once the copy has caught up, so
+ *   no API call has to wait for the whole table to be copied.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int nati_migrate_start(
+	ipa_nati_obj* nati_obj_ptr )
+{
+	nati_migration* mig_ptr    = &nati_obj_ptr->mig;
+	uint32_t        chunk      = mig_ptr->chunk;
+	bool            timer_made = mig_ptr->timer_made;
+	timer_t         timer      = mig_ptr->timer;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_NATI_clear_ipv4_tbl(nati_obj_ptr->ddr_tbl_hdl);
+
+	if ( ret != 0 )
+	{
+		IPAERR("Unable to clear DDR table(0x%08X)\n",
+			   nati_obj_ptr->ddr_tbl_hdl);
+		goto bail;
+	}
+
+	nati_obj_ptr->tot_rules_in_table[DDR_SUB] = 0;
+
+	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map);
+	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map);
+
+	memset(mig_ptr, 0, sizeof(*mig_ptr));
+
+	mig_ptr->chunk      = chunk;
+	mig_ptr->active     = true;
+	mig_ptr->timer_made = timer_made;
+	mig_ptr->timer      = timer;
+
+	currTimeAs(TimeAsNanSecs, &mig_ptr->start_ns);
+
+	nati_migrate_tick(nati_obj_ptr, true);
+
+	IPAINFO("Incremental switch from SRAM to DDR started, "
+			"%u records per step, %u rules in SRAM\n",
+			chunk,
+			nati_obj_ptr->tot_rules_in_table[SRAM_SUB]);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_migrate_step
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   max_recs     (IN) The most records to copy
+ *
+ * DESCRIPTION:
+ *
+ *   Copies up to max_recs more SRAM records to DDR. When the last one
+ *   has been copied, points the IPA at the DDR table.
+ *
+ * RETURNS:
+ *
+ *   zero when there is more to copy, one when the IPA now uses DDR,
+ *   negative when pointing the IPA at DDR failed (the next step tries
+ *   again)
+ */
+static int nati_migrate_step(
+	ipa_nati_obj* nati_obj_ptr,
+	uint32_t      max_recs )
+{
+	nati_migration* mig_ptr = &nati_obj_ptr->mig;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	mig_ptr->budget = max_recs;
+	mig_ptr->chunks++;
+
+	ret = ipa_NATI_walk_ipv4_tbl_from(
+		nati_obj_ptr->sram_tbl_hdl,
+		USE_NAT_TABLE,
+		mig_ptr->next_index,
+		migrate_rule_chunk,
+		(void*) (uintptr_t) nati_obj_ptr->ddr_tbl_hdl);
+
+	if ( ret > 0 )
+	{
+		IPADBG("Switch resumes at index(%u)\n", mig_ptr->next_index);
+		ret = 0;
+		goto bail;
+	}
+
+	if ( ret < 0 )
+	{
+		IPAERR("Walk of SRAM table failed (%d)\n", ret);
+		mig_ptr->failed = true;
+	}
+
+	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_DDR, 0);
+
+	if ( ret != 0 || nati_obj_ptr->curr_state != NATI_STATE_HYBRID_DDR )
+	{
+		IPAERR("Unable to point the IPA at DDR, will retry\n");
+		ret = -EAGAIN;
+		goto bail;
+	}
+
+	mig_ptr->active = false;
+
+	nati_migrate_tick(nati_obj_ptr, false);
+
+	ret = 1;
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_migrate_finish
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ * DESCRIPTION:
+ *
+ *   Accounts a finished incremental switch in the SRAM switch stats,
+ *   as the blocking switch does.
+ */
+static void nati_migrate_finish(
+	ipa_nati_obj* nati_obj_ptr )
+{
+	nati_switch_stats* sw_stats_ptr = &nati_obj_ptr->sw_stats[SRAM_SUB];
+	nati_migration*    mig_ptr      = &nati_obj_ptr->mig;
+
+	uint64_t           stop;
+
+	currTimeAs(TimeAsNanSecs, &stop);
+
+	if ( mig_ptr->failed )
+	{
+		sw_stats_ptr->fail += 1;
+	}
+	else
+	{
+		sw_stats_ptr->pass += 1;
+	}
+
+	sw_stats_ptr->chunks             = mig_ptr->chunks;
+	sw_stats_ptr->adds_during_switch = mig_ptr->adds;
+	sw_stats_ptr->switch_ns          = stop - mig_ptr->start_ns;
+	sw_stats_ptr->add_p99_ns         = nati_lat_p99(mig_ptr);
+	sw_stats_ptr->add_max_ns         = mig_ptr->add_max_ns;
+
+	journal_rec(IPA_NAT_JRNL_SWITCH, nati_obj_ptr->ddr_tbl_hdl, 0, 0, 0);
+
+	IPAINFO("Incremental switch from SRAM to DDR %s: %u steps over %f "
+			"microseconds, %u adds meanwhile with p99(%llu ns) max(%llu ns)\n",
+			(mig_ptr->failed) ? "lost rules" : "done",
+			sw_stats_ptr->chunks,
+			(float) sw_stats_ptr->switch_ns / 1000.0,
+			sw_stats_ptr->adds_during_switch,
+			(unsigned long long) sw_stats_ptr->add_p99_ns,
+			(unsigned long long) sw_stats_ptr->add_max_ns);
+
+	IPADBG("Transistion pass/fail counts (SRAM to DDR) PASS: %u FAIL: %u\n",
+		   sw_stats_ptr->pass,
+		   sw_stats_ptr->fail);
+}
+
+/*
+ * Finishes an incremental switch under way in one go, for operations
+ * that need to see the table as a whole.
+ */
+static int nati_migrate_drain(
+	ipa_nati_obj* nati_obj_ptr )
+{
+	int ret;
+
+	if ( ! nati_obj_ptr->mig.active )
+	{
+		return 0;
+	}
+
+	ret = nati_migrate_step(nati_obj_ptr, UINT32_MAX);
+
+	if ( ret == 1 )
+	{
+		nati_migrate_finish(nati_obj_ptr);
+		return 0;
+	}
+
+	return (ret) ? ret : -EAGAIN;
+}
+
+/*
+ * Takes a step of an incremental switch off the timer. The walk reads
+ * the SRAM table, hence the clock vote the state machine would have
+ * made for an API call.
+ */
+static void nati_migrate_timer_cb(
+	union sigval sv )
+{
+	ipa_nati_obj* nati_obj_ptr = (ipa_nati_obj*) sv.sival_ptr;
+
+	if ( take_mutex() != 0 )
+	{
+		return;
+	}
+
+	if ( ! nati_obj_ptr->mig.active )
+	{
+		nati_migrate_tick(nati_obj_ptr, false);
+	}
+	else if ( ipa_nat_vote_clock(IPA_APP_CLK_VOTE) != 0 )
+	{
+		IPAERR("Voting failed, switch step skipped\n");
+	}
+	else
+	{
+		if ( nati_migrate_step(nati_obj_ptr, nati_obj_ptr->mig.chunk) == 1 )
+		{
+			nati_migrate_finish(nati_obj_ptr);
+		}
+
+		if ( ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
+		{
+			IPAERR("Devoting failed\n");
+		}
+	}
+
+	give_mutex();
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_del_rule_migrating
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr  (IN) A pointer to an initialized nati object
+ *
+ *   orig_rule_hdl (IN) The rule handle known to the application
+ *
+ * DESCRIPTION:
+ *
+ *   Deletes a rule while an incremental switch is under way. A rule
+ *   not copied yet is in SRAM only, one added since the switch started
+ *   is in DDR only, and a copied one is in both; the IPA still uses
+ *   SRAM, so it has to go from there as well.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int nati_del_rule_migrating(
+	ipa_nati_obj* nati_obj_ptr,
+	uint32_t      orig_rule_hdl )
+{
+	nati_map_pair* sram_maps = &nati_obj_ptr->map_pairs[SRAM_SUB];
+	nati_map_pair* ddr_maps  = &nati_obj_ptr->map_pairs[DDR_SUB];
+
+	bool     in_sram = ipa_nat_map_has(sram_maps->orig2new_map, orig_rule_hdl);
+	bool     in_ddr  = ipa_nat_map_has(ddr_maps->orig2new_map,  orig_rule_hdl);
+
+	uint32_t new_rule_hdl;
+	uint32_t jrnl_tbl_hdl  = 0;
+	uint32_t jrnl_rule_hdl = 0;
+
+	int      ret = 0, sram_ret;
+
+	IPADBG("In\n");
+
+	if ( ! in_sram && ! in_ddr )
+	{
+		IPAERR("orig_rule_hdl(0x%08X) in neither SRAM nor DDR\n",
+			   orig_rule_hdl);
+		ret = -1;
+		goto bail;
+	}
+
+	if ( in_ddr )
+	{
+		ipa_nat_map_del(ddr_maps->orig2new_map, orig_rule_hdl, &new_rule_hdl);
+		ipa_nat_map_del(ddr_maps->new2orig_map, new_rule_hdl, NULL);
+
+		ret = ipa_NATI_del_ipv4_rule(nati_obj_ptr->ddr_tbl_hdl, new_rule_hdl);
+
+		if ( ret == 0 )
+		{
+			nati_obj_ptr->tot_rules_in_table[DDR_SUB]--;
+
+			jrnl_tbl_hdl  = nati_obj_ptr->ddr_tbl_hdl;
+			jrnl_rule_hdl = new_rule_hdl;
+		}
+	}
+
+	if ( in_sram )
+	{
+		ipa_nat_map_del(sram_maps->orig2new_map, orig_rule_hdl, &new_rule_hdl);
+		ipa_nat_map_del(sram_maps->new2orig_map, new_rule_hdl, NULL);
+
+		sram_ret = ipa_NATI_del_ipv4_rule(
+			nati_obj_ptr->sram_tbl_hdl, new_rule_hdl);
+
+		if ( sram_ret == 0 )
+		{
+			nati_obj_ptr->tot_rules_in_table[SRAM_SUB]--;
+
+			if ( ! in_ddr )
+			{
+				jrnl_tbl_hdl  = nati_obj_ptr->sram_tbl_hdl;
+				jrnl_rule_hdl = new_rule_hdl;
+			}
+		}
+
+		ret = (ret) ? ret : sram_ret;
+	}
+
+	IPADBG("orig_rule_hdl(0x%08X) deleted from%s%s\n",
+		   orig_rule_hdl,
+		   (in_sram) ? " SRAM" : "",
+		   (in_ddr)  ? " DDR"  : "");
+
+	if ( ret == 0 )
+	{
+		journal_rec(IPA_NAT_JRNL_DEL, jrnl_tbl_hdl,
+					orig_rule_hdl, jrnl_rule_hdl, jrnl_rule_hdl);
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_sram_return_arm
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   ms           (IN) When to look again
+ *
+ * DESCRIPTION:
+ *
+ *   Has nati_sram_return_eval() run again in ms milliseconds, off a
+ *   timer thread, for when no delete comes along to run it.
+ */
+static void nati_sram_return_timer_cb(
+	union sigval sv ); /* forward declaration */
+
+static void nati_sram_return_arm(
+	ipa_nati_obj* nati_obj_ptr,
+	uint32_t      ms )
+{
+	nati_sram_return* sr_ptr = &nati_obj_ptr->sram_ret;
+
+	struct sigevent   sev;
+	struct itimerspec its;
+
+	if ( ! sr_ptr->timer_made )
+	{
+		memset(&sev, 0, sizeof(sev));
+
+		sev.sigev_notify          = SIGEV_THREAD;
+		sev.sigev_notify_function = nati_sram_return_timer_cb;
+		sev.sigev_value.sival_ptr = nati_obj_ptr;
+
+		if ( timer_create(CLOCK_MONOTONIC, &sev, &sr_ptr->timer) != 0 )
+		{
+			IPAERR("timer_create failed (%d), SRAM return left to deletes\n",
+				   errno);
+			return;
+		}
+
+		sr_ptr->timer_made = true;
+	}
+
+	memset(&its, 0, sizeof(its));
+
+	/*
+	 * A zero it_value would disarm it, hence at least a millisecond...
+	 */
+	ms = (ms) ? ms : 1;
+
+	its.it_value.tv_sec  = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000;
+
+	if ( timer_settime(sr_ptr->timer, 0, &its, NULL) != 0 )
+	{
+		IPAERR("timer_settime failed (%d)\n", errno);
+		return;
+	}
+
+	sr_ptr->timer_armed = true;
+
+	IPADBG("SRAM return looked at again in %u ms\n", ms);
+}
+
+static void nati_sram_return_disarm(
+	ipa_nati_obj* nati_obj_ptr )
+{
+	nati_sram_return* sr_ptr = &nati_obj_ptr->sram_ret;
+
+	struct itimerspec its;
+
+	if ( sr_ptr->timer_armed )
+	{
+		memset(&its, 0, sizeof(its));
+
+		timer_settime(sr_ptr->timer, 0, &its, NULL);
 
-bool ipa_nat_is_sram_supported(void)
-{
-	return VALID_TBL_HDL(nati_obj.sram_tbl_hdl);
+		sr_ptr->timer_armed = false;
+	}
 }
 
 /******************************************************************************/
 /*
- * FUNCTION: migrate_rule
+ * FUNCTION: nati_sram_return_went
  *
  * PARAMS:
  *
- *   table_ptr         (IN) The table being walked
- *
- *   tbl_rule_hdl      (IN) The nat rule's handle from the source table
- *
- *   record_ptr        (IN) The nat rule record from the source table
- *
- *   record_index      (IN) The record above's index in the table being walked
- *
- *   meta_record_ptr   (IN) If meta data in table, this will be it
- *
- *   meta_record_index (IN) The record above's index in the table being walked
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
  *
- *   arb_data_ptr      (IN) The destination table handle
+ *   to_ddr       (IN) Whether the IPA now uses DDR, or SRAM
  *
  * DESCRIPTION:
  *
- *   This routine is intended to copy records from a source table to a
- *   destination table.
+ *   Keeps the times the dwell is measured from. Going to DDR before
+ *   the last stay in SRAM lasted the dwell time means the table is
+ *   flapping between the two, so the dwell time is doubled.
+ */
+static void nati_sram_return_went(
+	ipa_nati_obj* nati_obj_ptr,
+	bool          to_ddr )
+{
+	nati_sram_return* sr_ptr = &nati_obj_ptr->sram_ret;
 
- *   It is used in union with the ipa_nati_copy_ipv4_tbl() API call
- *   below.
- *
- *   It is compatible with the ipa_table_walk() API.
- *
- *   In the context of the ipa_nati_copy_ipv4_tbl(), the arguments
- *   passed in are as enumerated above.
+	uint64_t          now;
+
+	currTimeAs(TimeAsNanSecs, &now);
+
+	if ( ! to_ddr )
+	{
+		nati_sram_return_disarm(nati_obj_ptr);
+
+		sr_ptr->sram_since_ns = now;
+
+		return;
+	}
+
+	sr_ptr->ddr_since_ns = now;
+
+	if ( sr_ptr->sram_since_ns
+		 &&
+		 now - sr_ptr->sram_since_ns < (uint64_t) sr_ptr->cur_dwell_ms * 1000000 )
+	{
+		sr_ptr->cur_dwell_ms =
+			(sr_ptr->cur_dwell_ms * 2 < NATI_MAX_DWELL_MS) ?
+			sr_ptr->cur_dwell_ms * 2 :
+			NATI_MAX_DWELL_MS;
+
+		IPAINFO("Back in DDR after a short stay in SRAM, dwell now %u ms\n",
+				sr_ptr->cur_dwell_ms);
+	}
+	else
+	{
+		sr_ptr->cur_dwell_ms = sr_ptr->dwell_ms;
+	}
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_sram_return_eval
  *
- * AN IMPORTANT NOTE ON RULE HANDLES WHEN IN MYBRID MODE
+ * PARAMS:
  *
- *   The rule_hdl is used to find a rule in the nat table.  It is, in
- *   effect, an index into the table.  The applcation above us retains
- *   it for future manipulation of the rule in the table.
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
  *
- *   In hybrid mode, a rule can and will move between SRAM and DDR.
- *   Because of this, its handle will change.  The application has
- *   only the original handle and doesn't know of the new handle.  A
- *   mapping, used in hybrid mode, will maintain a relationship
- *   between the original handle and the rule's current real handle...
+ * DESCRIPTION:
  *
- *   To help you get a mindset of how this is done:
+ *   We need to check when/if we can go back to SRAM.
  *
- *     The original handle will map (point) to the new and new handle
- *     will map (point) back to original.
+ *   How/why can we go back?
  *
- * NOTE WELL: There are two sets of maps.  One for each memory type...
+ *     Given enough deletions, and when we get to a user defined
+ *     threshold (ie. a percentage of what SRAM can hold), we can pop
+ *     back to using SRAM.
  *
- * RETURNS:
+ *   The gap between that threshold and a full SRAM, plus the dwell
+ *   time in DDR, keep the table from bouncing between the two. A
+ *   return put off by the dwell time, or one that failed, is looked at
+ *   again off a timer, so it does not wait for the next delete.
  *
- *   Returns 0 on success, non-zero on failure
+ *   Run under the nat mutex, on deletes, clears and the timer.
  */
-static int migrate_rule(
-	ipa_table*      table_ptr,
-	uint32_t        tbl_rule_hdl,
-	void*           record_ptr,
-	uint16_t        record_index,
-	void*           meta_record_ptr,
-	uint16_t        meta_record_index,
-	void*           arb_data_ptr )
+static void nati_sram_return_eval(
+	ipa_nati_obj* nati_obj_ptr )
 {
-	struct ipa_nat_rule* nat_rule_ptr = (struct ipa_nat_rule*) record_ptr;
-	uint32_t             dst_tbl_hdl  = (uint32_t) arb_data_ptr;
+	nati_sram_return* sr_ptr  = &nati_obj_ptr->sram_ret;
+	uint32_t          cnt     = nati_obj_ptr->tot_rules_in_table[DDR_SUB];
+	uint64_t          dwell   = (uint64_t) sr_ptr->cur_dwell_ms * 1000000;
+	uint64_t          now, in_ddr;
 
-	ipa_nat_ipv4_rule    v4_rule;
+	int ret;
 
-	uint32_t             orig_rule_hdl;
-	uint32_t             new_rule_hdl;
+	if ( nati_obj_ptr->curr_state != NATI_STATE_HYBRID_DDR
+		 ||
+		 nati_obj_ptr->hold_state
+		 ||
+		 nati_obj_ptr->mig.active
+		 ||
+		 cnt > nati_obj_ptr->back_to_sram_thresh )
+	{
+		return;
+	}
 
-	uint32_t             src_orig2new_map, src_new2orig_map;
-	uint32_t             dst_orig2new_map, dst_new2orig_map;
-	uint32_t*            cnt_ptr;
+	currTimeAs(TimeAsNanSecs, &now);
 
-	const char*          mig_dir_ptr;
+	in_ddr = now - sr_ptr->ddr_since_ns;
 
-	char                 buf[1024];
-	int                  ret;
+	if ( in_ddr < dwell )
+	{
+		if ( ! sr_ptr->timer_armed )
+		{
+			nati_obj_ptr->sw_stats[DDR_SUB].deferred += 1;
 
-	IPADBG("In\n");
+			IPADBG("Return to SRAM put off, %llu of %u ms in DDR\n",
+				   (unsigned long long) (in_ddr / 1000000),
+				   sr_ptr->cur_dwell_ms);
 
-	IPADBG("tbl_mem_type(%s) tbl_rule_hdl(%u) -> %s\n",
-		   ipa3_nat_mem_in_as_str(table_ptr->nmi),
-		   tbl_rule_hdl,
-		   prep_nat_rule_4print(nat_rule_ptr, buf, sizeof(buf)));
+			nati_sram_return_arm(
+				nati_obj_ptr, (uint32_t) ((dwell - in_ddr + 999999) / 1000000));
+		}
 
-	IPADBG("dst_tbl_hdl(0x%08X)\n", dst_tbl_hdl);
+		return;
+	}
 
 	/*
-	 * What is the type of the source table?
+	 * The following will focus us on SRAM and cause the copy of data
+	 * from DDR to SRAM.
 	 */
-	if ( table_ptr->nmi == IPA_NAT_MEM_IN_SRAM )
-	{
-		mig_dir_ptr = "SRAM -> DDR";
+	IPAINFO("Switch back to SRAM threshold has been reached -> "
+			"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
+			cnt,
+			nati_obj_ptr->back_to_sram_thresh);
 
-		src_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
-		src_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
-
-		dst_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
-		dst_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
+	ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
 
-		cnt_ptr          = &(nati_obj.tot_rules_in_table[DDR_SUB]);
+	if ( ret != 0 || nati_obj_ptr->curr_state != NATI_STATE_HYBRID )
+	{
+		/*
+		 * The following will force us stay in DDR for now, but the
+		 * next delete, or the timer, will trigger the switch logic
+		 * above to run again...perhaps it will work then.
+		 */
+		nati_sram_return_arm(
+			nati_obj_ptr,
+			(sr_ptr->cur_dwell_ms > NATI_DFLT_DWELL_MS) ?
+			sr_ptr->cur_dwell_ms :
+			NATI_DFLT_DWELL_MS);
 	}
-	else
+}
+
+static void nati_sram_return_timer_cb(
+	union sigval sv )
+{
+	ipa_nati_obj* nati_obj_ptr = (ipa_nati_obj*) sv.sival_ptr;
+
+	if ( take_mutex() != 0 )
 	{
-		mig_dir_ptr = "DDR -> SRAM";
+		return;
+	}
 
-		src_orig2new_map = nati_obj.map_pairs[DDR_SUB].orig2new_map;
-		src_new2orig_map = nati_obj.map_pairs[DDR_SUB].new2orig_map;
+	nati_obj_ptr->sram_ret.timer_armed = false;
 
-		dst_orig2new_map = nati_obj.map_pairs[SRAM_SUB].orig2new_map;
-		dst_new2orig_map = nati_obj.map_pairs[SRAM_SUB].new2orig_map;
+	nati_sram_return_eval(nati_obj_ptr);
 
-		cnt_ptr          = &(nati_obj.tot_rules_in_table[SRAM_SUB]);
-	}
+	give_mutex();
+}
 
-	if ( nat_rule_ptr->protocol == IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
+int ipa_nati_set_sram_return(
+	uint32_t low_wm_pct,
+	uint32_t dwell_ms )
+{
+	nati_sram_return* sr_ptr = &nati_obj.sram_ret;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( low_wm_pct >= 100 || dwell_ms > NATI_MAX_DWELL_MS )
 	{
-		IPADBG("%s: Special \"first rule in list\" case. "
-			   "Rule's enabled bit on, but protocol implies deleted\n",
-			   mig_dir_ptr);
-		ret = 0;
+		IPAERR("Bad low_wm_pct(%u) and/or dwell_ms(%u)\n",
+			   low_wm_pct, dwell_ms);
+		ret = -EINVAL;
 		goto bail;
 	}
 
-	ret = ipa_nat_map_find(src_new2orig_map, tbl_rule_hdl, &orig_rule_hdl);
+	ret = take_mutex();
 
 	if ( ret != 0 )
 	{
-		IPAERR("%s: ipa_nat_map_find(src_new2orig_map) fail\n", mig_dir_ptr);
 		goto bail;
 	}
 
-	memset(&v4_rule, 0, sizeof(v4_rule));
+	sr_ptr->low_wm_pct   = low_wm_pct;
+	sr_ptr->dwell_ms     = dwell_ms;
+	sr_ptr->cur_dwell_ms = dwell_ms;
 
-	v4_rule.private_ip   = nat_rule_ptr->private_ip;
-	v4_rule.private_port = nat_rule_ptr->private_port;
-	v4_rule.protocol     = nat_rule_ptr->protocol;
-	v4_rule.public_port  = nat_rule_ptr->public_port;
-	v4_rule.target_ip    = nat_rule_ptr->target_ip;
-	v4_rule.target_port  = nat_rule_ptr->target_port;
-	v4_rule.pdn_index    = nat_rule_ptr->pdn_index;
-	v4_rule.redirect     = nat_rule_ptr->redirect;
-	v4_rule.enable       = nat_rule_ptr->enable;
-	v4_rule.time_stamp   = nat_rule_ptr->time_stamp;
-	v4_rule.uc_activation_index = nat_rule_ptr->uc_activation_index;
-	v4_rule.s = nat_rule_ptr->s;
-	v4_rule.ucp = nat_rule_ptr->ucp;
-	v4_rule.dst_only = nat_rule_ptr->dst_only;
-	v4_rule.src_only = nat_rule_ptr->src_only;
+	nati_obj.back_to_sram_thresh =
+		PRCNT_OF(nati_obj.tot_slots_in_sram, low_wm_pct);
 
-	ret = ipa_NATI_add_ipv4_rule(dst_tbl_hdl, &v4_rule, &new_rule_hdl);
+	IPADBG("low_wm_pct(%u) dwell_ms(%u) back_to_sram_thresh(%u)\n",
+		   low_wm_pct, dwell_ms, nati_obj.back_to_sram_thresh);
 
-	if ( ret != 0 )
+	/*
+	 * The new settings may let us go back right away...
+	 */
+	nati_sram_return_disarm(&nati_obj);
+	nati_sram_return_eval(&nati_obj);
+
+	if ( give_mutex() != 0 )
 	{
-		IPAERR("%s: ipa_NATI_add_ipv4_rule() fail\n", mig_dir_ptr);
-		goto bail;
+		ret = -EPERM;
 	}
 
-	(*cnt_ptr)++;
+bail:
+	IPADBG("Out\n");
 
-	/*
-	 * The following is needed to maintain the original handle and
-	 * have it point to the new handle.
-	 *
-	 * Remember, original handle points to new and the new handle
-	 * points back to original.
-	 */
-	ret = ipa_nat_map_add(dst_orig2new_map, orig_rule_hdl, new_rule_hdl);
+	return ret;
+}
 
-	if ( ret != 0 )
+/******************************************************************************/
+/*
+ * FUNCTION: nati_scrub_cb
+ *
+ * PARAMS:
+ *
+ *   arb_data_ptr (IN) A pointer to an initialized nati object
+ *
+ * DESCRIPTION:
+ *
+ *   Runs off the scrub timer and verifies the table in use, as
+ *   ipa_nati_verify_ipv4_tbl() would.
+ */
+static void nati_scrub_cb(
+	void* arb_data_ptr )
+{
+	ipa_nati_obj* nati_obj_ptr = (ipa_nati_obj*) arb_data_ptr;
+
+	ipa_table_verify_report nat_report, idx_report;
+
+	uint32_t tbl_hdl;
+
+	if ( take_mutex() != 0 )
 	{
-		IPAERR("%s: ipa_nat_map_add(dst_orig2new_map) fail\n", mig_dir_ptr);
-		goto bail;
+		return;
 	}
 
-	ret = ipa_nat_map_add(dst_new2orig_map, new_rule_hdl, orig_rule_hdl);
+	tbl_hdl =
+		(nati_obj_ptr->curr_state == NATI_STATE_DDR_ONLY) ?
+		nati_obj_ptr->ddr_tbl_hdl :
+		nati_obj_ptr->sram_tbl_hdl;
+
+	if ( nati_obj_ptr->curr_state != NATI_STATE_NULL &&
+		 VALID_TBL_HDL(tbl_hdl) )
+	{
+		arb_t* args[] = {
+			(arb_t*)(arb_t)tbl_hdl,
+			(arb_t*)(arb_t)nati_obj_ptr->scrub.repair,
+			(arb_t*) &nat_report,
+			(arb_t*) &idx_report,
+		};
+
+		if ( ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_VERIFY, args) == 0 )
+		{
+			nati_obj_ptr->scrub.runs++;
+			nati_obj_ptr->scrub.errors   += nat_report.errors   + idx_report.errors;
+			nati_obj_ptr->scrub.repaired += nat_report.repaired + idx_report.repaired;
+		}
+	}
+
+	give_mutex();
+}
+
+int ipa_nati_set_scrub(
+	uint32_t period_ms,
+	bool     repair )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = take_mutex();
 
 	if ( ret != 0 )
 	{
-		IPAERR("%s: ipa_nat_map_add(dst_new2orig_map) fail\n", mig_dir_ptr);
 		goto bail;
 	}
 
-	IPADBG("orig_rule_hdl(0x%08X) new_rule_hdl(0x%08X)\n",
-		   orig_rule_hdl, new_rule_hdl);
+	nati_obj.scrub.repair = repair;
+
+	ret = ipa_table_scrub_set(
+		&nati_obj.scrub.tmr, period_ms, nati_scrub_cb, &nati_obj);
+
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EPERM;
+	}
 
 bail:
 	IPADBG("Out\n");
@@ -855,6 +2141,11 @@ static int _smDelTbl(
 
 	ret = ipa_NATI_del_ipv4_table(tbl_hdl);
 
+	if ( ret == 0 )
+	{
+		journal_rec(IPA_NAT_JRNL_CLEAR, tbl_hdl, 0, 0, 0);
+	}
+
 	if ( ret == 0 && ! IN_HYBRID_STATE() )
 	{
 		/*
@@ -1033,7 +2324,8 @@ static int _smAddSramTbl(
 		if ( ret == 0 )
 		{
 			nati_obj_ptr->back_to_sram_thresh =
-				PRCNT_OF(nati_obj_ptr->tot_slots_in_sram);
+				PRCNT_OF(nati_obj_ptr->tot_slots_in_sram,
+						 nati_obj_ptr->sram_ret.low_wm_pct);
 
 			IPADBG("sram_size(%u or 0x%x) tot_slots_in_sram(%u) back_to_sram_thresh(%u)\n",
 				   sram_size,
@@ -1208,6 +2500,11 @@ static int _smDelSramAndDdrTbl(
 
 	IPADBG("In\n");
 
+	nati_sram_return_disarm(nati_obj_ptr);
+
+	nati_obj_ptr->sram_ret.sram_since_ns = 0;
+	nati_obj_ptr->sram_ret.cur_dwell_ms  = nati_obj_ptr->sram_ret.dwell_ms;
+
 	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
 	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
 
@@ -1296,6 +2593,11 @@ static int _smClrTbl(
 
 	ret = ipa_NATI_clear_ipv4_tbl(tbl_hdl);
 
+	if ( ret == 0 )
+	{
+		journal_rec(IPA_NAT_JRNL_CLEAR, tbl_hdl, 0, 0, 0);
+	}
+
 bail:
 	IPADBG("Out\n");
 
@@ -1344,6 +2646,11 @@ static int _smClrTblHybrid(
 
 	ret = _smClrTbl(nati_obj_ptr, trigger, new_args);
 
+	if ( ret == 0 )
+	{
+		nati_sram_return_eval(nati_obj_ptr);
+	}
+
 	IPADBG("Out\n");
 
 	return ret;
@@ -1486,6 +2793,13 @@ static int _smStatTbl(
 
 	ret = ipa_NATI_ipv4_tbl_stats(tbl_hdl, nat_stats_ptr, idx_stats_ptr);
 
+	if ( ret == 0 )
+	{
+		nat_stats_ptr->scrub_runs     = nati_obj_ptr->scrub.runs;
+		nat_stats_ptr->scrub_errors   = nati_obj_ptr->scrub.errors;
+		nat_stats_ptr->scrub_repaired = nati_obj_ptr->scrub.repaired;
+	}
+
 	IPADBG("Out\n");
 
 	return ret;
@@ -1533,13 +2847,80 @@ static int _smStatTblHybrid(
 
 	int ret;
 
-	IPADBG("In\n");
+	IPADBG("In\n");
+
+	ret = _smStatTbl(nati_obj_ptr, trigger, new_args);
+
+	if ( ret == 0 )
+	{
+		nat_stats_ptr->sw_to_ddr           = nati_obj_ptr->sw_stats[SRAM_SUB].pass;
+		nat_stats_ptr->sw_to_ddr_fail      = nati_obj_ptr->sw_stats[SRAM_SUB].fail;
+		nat_stats_ptr->sw_to_sram          = nati_obj_ptr->sw_stats[DDR_SUB].pass;
+		nat_stats_ptr->sw_to_sram_fail     = nati_obj_ptr->sw_stats[DDR_SUB].fail;
+		nat_stats_ptr->sw_to_sram_deferred = nati_obj_ptr->sw_stats[DDR_SUB].deferred;
+	}
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: nati_orig_rule_hdl
+ *
+ * PARAMS:
+ *
+ *   tbl_rule_hdl (IN) The handle of a rule just added to a table
+ *
+ * DESCRIPTION:
+ *
+ *   Picks the handle the application will know a new rule by.  That
+ *   is the table handle itself, except in hybrid mode where a rule
+ *   keeps its original handle as it moves between tables, so the
+ *   table handle may already be some other rule's original handle;
+ *   for instance a rule first added to DDR, moved to SRAM and not yet
+ *   copied back by an incremental switch.  Such a rule gets an alias
+ *   instead: table handles only use the low 16 bits, so a count above
+ *   them makes a handle no table will ever hand out.
+ *
+ *   Must be called before the new rule is mapped.
+ *
+ * RETURNS:
+ *
+ *   The original handle for the rule
+ */
+static uint32_t nati_orig_rule_hdl(
+	uint32_t tbl_rule_hdl )
+{
+	uint32_t orig_rule_hdl = tbl_rule_hdl;
+	uint32_t gen;
+
+	if ( ! IN_HYBRID_STATE() )
+	{
+		return tbl_rule_hdl;
+	}
 
-	ret = _smStatTbl(nati_obj_ptr, trigger, new_args);
+	for ( gen = 1;
+		  gen <= 0xFFFF
+			  &&
+			  (ipa_nat_map_has(nati_obj.map_pairs[SRAM_SUB].orig2new_map,
+							   orig_rule_hdl)
+			   ||
+			   ipa_nat_map_has(nati_obj.map_pairs[DDR_SUB].orig2new_map,
+							   orig_rule_hdl));
+		  gen++ )
+	{
+		orig_rule_hdl = (gen << 16) | tbl_rule_hdl;
+	}
 
-	IPADBG("Out\n");
+	if ( orig_rule_hdl != tbl_rule_hdl )
+	{
+		IPADBG("rule_hdl(0x%08X) in use, aliased as (0x%08X)\n",
+			   tbl_rule_hdl, orig_rule_hdl);
+	}
 
-	return ret;
+	return orig_rule_hdl;
 }
 
 /******************************************************************************/
@@ -1574,15 +2955,12 @@ static int _smAddRuleToTbl(
 	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args[1];
 	uint32_t*          rule_hdl  = (uint32_t*)          args[2];
 
-	char buf[1024];
-
 	int ret;
 
 	IPADBG("In\n");
 
-	IPADBG("tbl_hdl(0x%08X) clnt_rule_ptr(%p) rule_hdl_ptr(%p) %s\n",
-		   tbl_hdl, clnt_rule, rule_hdl,
-		   prep_nat_ipv4_rule_4print(clnt_rule, buf, sizeof(buf)));
+	IPADBG("tbl_hdl(0x%08X) clnt_rule_ptr(%p) rule_hdl_ptr(%p)\n",
+		   tbl_hdl, clnt_rule, rule_hdl);
 
 	clnt_rule->redirect = clnt_rule->enable = clnt_rule->time_stamp = 0;
 
@@ -1594,6 +2972,9 @@ static int _smAddRuleToTbl(
 
 		(*cnt_ptr)++;
 
+		journal_rec(IPA_NAT_JRNL_ADD, tbl_hdl,
+					nati_orig_rule_hdl(*rule_hdl), *rule_hdl, *rule_hdl);
+
 		IPADBG("rule_hdl value(%u or 0x%08X)\n",
 			   *rule_hdl, *rule_hdl);
 	}
@@ -1647,6 +3028,16 @@ static int _smDelRuleFromTbl(
 		uint32_t* cnt_ptr = CHOOSE_CNTR();
 
 		(*cnt_ptr)--;
+
+		/*
+		 * In hybrid mode, the caller knows the original handle and
+		 * journals the delete itself...
+		 */
+		if ( ! IN_HYBRID_STATE() )
+		{
+			journal_rec(IPA_NAT_JRNL_DEL, tbl_hdl,
+						rule_hdl, rule_hdl, rule_hdl);
+		}
 	}
 
 	IPADBG("Out\n");
@@ -1654,6 +3045,75 @@ static int _smDelRuleFromTbl(
 	return ret;
 }
 
+/******************************************************************************/
+/*
+ * Adds a rule to the table tbl_hdl and maps its handle, which is the
+ * handle the application will know it by, to itself in that table's
+ * maps.
+ */
+static int add_rule_and_map(
+	ipa_nati_obj*      nati_obj_ptr,
+	ipa_nati_trigger   trigger,
+	uint32_t           tbl_hdl,
+	ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*          rule_hdl )
+{
+	arb_t* new_args[] = {
+		(arb_t*)(arb_t) tbl_hdl,
+		(arb_t*) clnt_rule,
+		(arb_t*) rule_hdl,
+	};
+
+	uint32_t orig2new_map, new2orig_map;
+	uint32_t orig_rule_hdl;
+
+	int ret;
+
+	ret = _smAddRuleToTbl(nati_obj_ptr, trigger, new_args);
+
+	if ( ret == 0 )
+	{
+		/*
+		 * The rule_hdl is used to find a rule in the nat table.  It
+		 * is, in effect, an index into the table.  The applcation
+		 * above us retains it for future manipulation of the rule in
+		 * the table.
+		 *
+		 * In hybrid mode, a rule can and will move between SRAM and
+		 * DDR.  Because of this, its handle will change.  The
+		 * application has only the original handle and doesn't know
+		 * of the new handle.  A mapping, used in hybrid mode, will
+		 * maintain a relationship between the original handle and the
+		 * rule's current real handle...
+		 *
+		 * To help you get a mindset of how this is done:
+		 *
+		 *   The original handle will map (point) to the new and new
+		 *   handle will map (point) back to original.
+		 *
+		 * NOTE WELL: There are two sets of maps.  One for each memory
+		 *            type...
+		 *
+		 * A new rule's original handle is normally its table handle,
+		 * but see nati_orig_rule_hdl() for when it can not be.
+		 */
+		CHOOSE_MAPS(orig2new_map, new2orig_map);
+
+		orig_rule_hdl = nati_orig_rule_hdl(*rule_hdl);
+
+		ret = ipa_nat_map_add(orig2new_map, orig_rule_hdl, *rule_hdl);
+
+		if ( ret == 0 )
+		{
+			ret = ipa_nat_map_add(new2orig_map, *rule_hdl, orig_rule_hdl);
+		}
+
+		*rule_hdl = orig_rule_hdl;
+	}
+
+	return ret;
+}
+
 /******************************************************************************/
 /*
  * FUNCTION: _smAddRuleHybrid
@@ -1692,71 +3152,62 @@ static int _smAddRuleHybrid(
 	ipa_nat_ipv4_rule* clnt_rule = (ipa_nat_ipv4_rule*) args[1];
 	uint32_t*          rule_hdl  = (uint32_t*)          args[2];
 
-	arb_t*             new_args[] = {
-		(arb_t*)(arb_t)(nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
-		         tbl_hdl :
-		         nati_obj_ptr->ddr_tbl_hdl,
-		(arb_t*) clnt_rule,
-		(arb_t*) rule_hdl,
-	};
+	nati_migration*    mig_ptr   = &nati_obj_ptr->mig;
+	bool               in_switch = mig_ptr->active;
+	bool               switched  = false;
 
-	uint32_t orig2new_map, new2orig_map;
+	uint64_t           start, stop;
 
 	int ret;
 
 	IPADBG("In\n");
 
-	ret = _smAddRuleToTbl(nati_obj_ptr, trigger, new_args);
+	currTimeAs(TimeAsNanSecs, &start);
 
-	if ( ret == 0 )
+	ret = add_rule_and_map(
+		nati_obj_ptr, trigger,
+		(CHOOSE_MEM_SUB() == SRAM_SUB) ? tbl_hdl : nati_obj_ptr->ddr_tbl_hdl,
+		clnt_rule, rule_hdl);
+
+	if ( ret != 0
+		 &&
+		 nati_obj_ptr->curr_state == NATI_STATE_HYBRID
+		 &&
+		 ! mig_ptr->active
+		 &&
+		 ! nati_obj_ptr->hold_state )
 	{
 		/*
-		 * The rule_hdl is used to find a rule in the nat table.  It
-		 * is, in effect, an index into the table.  The applcation
-		 * above us retains it for future manipulation of the rule in
-		 * the table.
-		 *
-		 * In hybrid mode, a rule can and will move between SRAM and
-		 * DDR.  Because of this, its handle will change.  The
-		 * application has only the original handle and doesn't know
-		 * of the new handle.  A mapping, used in hybrid mode, will
-		 * maintain a relationship between the original handle and the
-		 * rule's current real handle...
-		 *
-		 * To help you get a mindset of how this is done:
-		 *
-		 *   The original handle will map (point) to the new and new
-		 *   handle will map (point) back to original.
-		 *
-		 * NOTE WELL: There are two sets of maps.  One for each memory
-		 *            type...
+		 * In hybrid mode, we always start in SRAM...hence
+		 * NATI_STATE_HYBRID implies SRAM.  The rule addition
+		 * above did not work, meaning the SRAM table is full,
+		 * hence let's jump to DDR...
 		 */
-		CHOOSE_MAPS(orig2new_map, new2orig_map);
-
-		ret = ipa_nat_map_add(orig2new_map, *rule_hdl, *rule_hdl);
+		IPAINFO("Add of rule failed...attempting table switch\n");
 
-		if ( ret == 0 )
+		if ( mig_ptr->chunk )
 		{
-			ret = ipa_nat_map_add(new2orig_map, *rule_hdl, *rule_hdl);
+			/*
+			 * The following starts copying SRAM to DDR a chunk
+			 * per API call and puts this rule, and the ones
+			 * added after it, straight into DDR.
+			 */
+			ret = nati_migrate_start(nati_obj_ptr);
+
+			if ( ret == 0 )
+			{
+				ret = add_rule_and_map(
+					nati_obj_ptr, trigger,
+					nati_obj_ptr->ddr_tbl_hdl,
+					clnt_rule, rule_hdl);
+			}
 		}
-	}
-	else
-	{
-		if ( nati_obj_ptr->curr_state == NATI_STATE_HYBRID
-			 &&
-			 ! nati_obj_ptr->hold_state )
+		else
 		{
 			/*
-			 * In hybrid mode, we always start in SRAM...hence
-			 * NATI_STATE_HYBRID implies SRAM.  The rule addition
-			 * above did not work, meaning the SRAM table is full,
-			 * hence let's jump to DDR...
-			 *
 			 * The following will focus us on DDR and cause the copy
 			 * of data from SRAM to DDR.
 			 */
-			IPAINFO("Add of rule failed...attempting table switch\n");
-
 			ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
 
 			if ( ret == 0 )
@@ -1771,6 +3222,23 @@ static int _smAddRuleHybrid(
 		}
 	}
 
+	if ( mig_ptr->active )
+	{
+		switched = (nati_migrate_step(nati_obj_ptr, mig_ptr->chunk) == 1);
+	}
+
+	if ( in_switch || mig_ptr->active || switched )
+	{
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		nati_lat_record(mig_ptr, stop - start);
+	}
+
+	if ( switched )
+	{
+		nati_migrate_finish(nati_obj_ptr);
+	}
+
 	IPADBG("Out\n");
 
 	return ret;
@@ -1821,6 +3289,18 @@ static int _smDelRuleHybrid(
 
 	IPADBG("In\n");
 
+	if ( nati_obj_ptr->mig.active )
+	{
+		ret = nati_del_rule_migrating(nati_obj_ptr, orig_rule_hdl);
+
+		if ( nati_migrate_step(nati_obj_ptr, nati_obj_ptr->mig.chunk) == 1 )
+		{
+			nati_migrate_finish(nati_obj_ptr);
+		}
+
+		goto bail;
+	}
+
 	CHOOSE_MAPS(orig2new_map, new2orig_map);
 
 	/*
@@ -1861,52 +3341,16 @@ static int _smDelRuleHybrid(
 
 		ret = _smDelRuleFromTbl(nati_obj_ptr, trigger, new_args);
 
-		if ( ret == 0 && nati_obj_ptr->curr_state == NATI_STATE_HYBRID_DDR )
+		if ( ret == 0 )
 		{
-			/*
-			 * We need to check when/if we can go back to SRAM.
-			 *
-			 * How/why can we go back?
-			 *
-			 *   Given enough deletions, and when we get to a user
-			 *   defined threshold (ie. a percentage of what SRAM can
-			 *   hold), we can pop back to using SRAM.
-			 */
-			uint32_t* cnt_ptr = CHOOSE_CNTR();
+			journal_rec(IPA_NAT_JRNL_DEL, (uint32_t) new_args[0],
+						orig_rule_hdl, new_rule_hdl, new_rule_hdl);
 
-			if ( *cnt_ptr <= nati_obj_ptr->back_to_sram_thresh
-				 &&
-				 ! nati_obj_ptr->hold_state )
-			{
-				/*
-				 * The following will focus us on SRAM and cause the copy
-				 * of data from DDR to SRAM.
-				 */
-				IPAINFO("Switch back to SRAM threshold has been reached -> "
-						"Total rules in DDR(%u) <= SRAM THRESH(%u)\n",
-						*cnt_ptr,
-						nati_obj_ptr->back_to_sram_thresh);
-
-				ret = ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_TBL_SWITCH, 0);
-
-				if ( ret == 0 )
-				{
-					SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
-				}
-				else
-				{
-					/*
-					 * The following will force us stay in DDR for
-					 * now, but the next delete will trigger the
-					 * switch logic above to run again...perhaps it
-					 * will work then.
-					 */
-					ret = 0;
-				}
-			}
+			nati_sram_return_eval(nati_obj_ptr);
 		}
 	}
 
+bail:
 	IPADBG("Out\n");
 
 	return ret;
@@ -1947,6 +3391,8 @@ static int _smGoToDdr(
 	if ( ret == 0 )
 	{
 		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID_DDR);
+
+		nati_sram_return_went(nati_obj_ptr, true);
 	}
 
 	IPADBG("Out\n");
@@ -1989,6 +3435,8 @@ static int _smGoToSram(
 	if ( ret == 0 )
 	{
 		SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_HYBRID);
+
+		nati_sram_return_went(nati_obj_ptr, false);
 	}
 
 	IPADBG("Out\n");
@@ -2077,6 +3525,8 @@ static int _smSwitchFromDdrToSram(
 		{
 			sw_stats_ptr->pass += 1;
 
+			journal_rec(IPA_NAT_JRNL_SWITCH, nati_obj_ptr->sram_tbl_hdl, 0, 0, 0);
+
 			IPADBG("Transistion from DDR to SRAM took %f microseconds\n",
 				   (float) (stop - start) / 1000.0);
 		}
@@ -2208,6 +3658,18 @@ static int _smSwitchFromSramToDdr(
 
 	IPADBG("In\n");
 
+	if ( nati_obj_ptr->mig.active )
+	{
+		/*
+		 * An incremental switch is under way, so just see it through...
+		 */
+		ret = nati_migrate_drain(nati_obj_ptr);
+
+		IPADBG("Out\n");
+
+		return ret;
+	}
+
 	stats_ret = (collect_stats) ?
 		ipa_NATI_ipv4_tbl_stats(
 			nati_obj_ptr->sram_tbl_hdl, &nat_stats, &idx_stats) :
@@ -2247,6 +3709,8 @@ static int _smSwitchFromSramToDdr(
 		{
 			sw_stats_ptr->pass += 1;
 
+			journal_rec(IPA_NAT_JRNL_SWITCH, nati_obj_ptr->ddr_tbl_hdl, 0, 0, 0);
+
 			IPADBG("Transistion from SRAM to DDR took %f microseconds\n",
 				   (float) (stop - start) / 1000.0);
 		}
@@ -2419,20 +3883,35 @@ static int _smGetTmStmpHybrid(
 
 	uint32_t  new_rule_hdl;
 
-	uint32_t  orig2new_map, new2orig_map;
+	uint32_t  orig2new_map;
 
-	int       ret;
+	int       sub, ret;
 
 	IPADBG("In\n");
 
-	CHOOSE_MAPS(orig2new_map, new2orig_map);
+	/*
+	 * Mid switch, a rule still in SRAM is the one the IPA stamps...
+	 */
+	if ( nati_obj_ptr->mig.active )
+	{
+		sub = ipa_nat_map_has(
+			nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map, orig_rule_hdl) ?
+			SRAM_SUB :
+			DDR_SUB;
+	}
+	else
+	{
+		sub = CHOOSE_MEM_SUB();
+	}
+
+	orig2new_map = nati_obj_ptr->map_pairs[sub].orig2new_map;
 
 	ret = ipa_nat_map_find(orig2new_map, orig_rule_hdl, &new_rule_hdl);
 
 	if ( ret == 0 )
 	{
 		arb_t* new_args[] = {
-			(arb_t*)(arb_t)(nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+			(arb_t*)(arb_t)(sub == SRAM_SUB) ?
 			         tbl_hdl :
 			         nati_obj_ptr->ddr_tbl_hdl,
 			(arb_t*)(arb_t)new_rule_hdl,
@@ -2447,6 +3926,103 @@ static int _smGetTmStmpHybrid(
 	return ret;
 }
 
+/******************************************************************************/
+/*
+ * FUNCTION: _smVerifyTbl
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will check, and optionally repair, the chains and
+ *   counts of a table.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smVerifyTbl(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	arb_t*           arb_data_ptr )
+{
+	arb_t** args = arb_data_ptr;
+
+	uint32_t                 tbl_hdl        = (uint32_t)                 args[0];
+	bool                     repair         = (bool)                     args[1];
+	ipa_table_verify_report* nat_report_ptr = (ipa_table_verify_report*) args[2];
+	ipa_table_verify_report* idx_report_ptr = (ipa_table_verify_report*) args[3];
+
+	int ret;
+
+	IPADBG("In\n");
+
+	IPADBG("tbl_hdl(0x%08X) repair(%u)\n", tbl_hdl, repair);
+
+	ret = ipa_NATI_verify_ipv4_tbl(
+		tbl_hdl, repair, nat_report_ptr, idx_report_ptr);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTION: _smVerifyTblHybrid
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   The following will verify the hybrid table in use, as a walk
+ *   would walk it.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smVerifyTblHybrid(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	arb_t*           arb_data_ptr )
+{
+	arb_t** args = arb_data_ptr;
+
+	uint32_t tbl_hdl = (uint32_t) args[0];
+
+	arb_t* new_args[] = {
+		(arb_t*)(arb_t)(nati_obj_ptr->curr_state == NATI_STATE_HYBRID) ?
+		         tbl_hdl :
+		         nati_obj_ptr->ddr_tbl_hdl,
+		args[1],
+		args[2],
+		args[3],
+	};
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = _smVerifyTbl(nati_obj_ptr, trigger, new_args);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 /******************************************************************************/
 /*
  * The following table relates a nati object's state and a transition
@@ -2468,6 +4044,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_VERIFY,     _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2484,6 +4061,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_VERIFY,     _smVerifyTbl ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2500,6 +4078,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_VERIFY,     _smVerifyTbl ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2516,6 +4095,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_VERIFY,     _smVerifyTblHybrid ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2532,6 +4112,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_VERIFY,     _smVerifyTblHybrid ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2548,6 +4129,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_VERIFY,     _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_LAST,       _smUndef ),
 	},
 };
@@ -2647,6 +4229,32 @@ int ipa_nati_statemach(
 		}
 	}
 
+	if ( nati_obj_ptr->mig.active )
+	{
+		/*
+		 * Operations on the table as a whole see it after an
+		 * incremental switch under way has been seen through, while
+		 * deleting the table just drops the switch.
+		 */
+		switch ( trigger )
+		{
+		case NATI_TRIG_CLR_TABLE:
+		case NATI_TRIG_WLK_TABLE:
+		case NATI_TRIG_TBL_STATS:
+			if ( nati_migrate_drain(nati_obj_ptr) != 0 )
+			{
+				IPAERR("Unable to finish switch before TRIGGER(%s)\n", ts_ptr);
+			}
+			break;
+		case NATI_TRIG_DEL_TABLE:
+			nati_obj_ptr->mig.active = false;
+			nati_migrate_tick(nati_obj_ptr, false);
+			break;
+		default:
+			break;
+		}
+	}
+
 	ret = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb(
 		nati_obj_ptr, trigger, arb_data_ptr);
 
@@ -2662,7 +4270,10 @@ int ipa_nati_statemach(
 	}
 
 unlock:
-	ret = give_mutex();
+	if ( give_mutex() != 0 )
+	{
+		ret = (ret) ? ret : -EPERM;
+	}
 
 bail:
 	IPADBG("Out\n");
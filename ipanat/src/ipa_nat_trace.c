@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ipa_nat_drv.h"
+#include "ipa_nat_drvi.h"
+#include "ipa_nat_trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+#undef  MAKE_AS_STR_CASE
+#define MAKE_AS_STR_CASE(v) case v: return #v
+
+ipa_nat_trace_ring nat_trace;
+
+/*
+ * Serializes readers against resizes, so a reader never looks at a
+ * ring that was freed under it. Writers don't take it.
+ */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * The DMA entries that fit in a record...
+ */
+#undef  DMA_ONES_PER_REC
+#define DMA_ONES_PER_REC \
+	(IPA_NAT_TRACE_DATA_SZ / sizeof(struct ipa_ioc_nat_dma_one))
+
+/**
+ * ipa_nat_trace_put() - append a record to the trace
+ * @ev: [in] kind of record
+ * @aux: [in] see struct ipa_nat_trace_rec
+ * @arg: [in] see enum ipa_nat_trace_ev
+ * @data_ptr: [in] the raw structure to keep
+ * @len: [in] its size, cut to IPA_NAT_TRACE_DATA_SZ
+ *
+ * Called through the trace point macros with the nat mutex held.
+ */
+void ipa_nat_trace_put(
+	ipa_nat_trace_ev ev,
+	uint8_t          aux,
+	uint32_t         arg,
+	const void*      data_ptr,
+	uint32_t         len )
+{
+	ipa_nat_trace_rec* rec_ptr;
+	struct timespec    ts;
+	uint64_t           seq = nat_trace.next_seq;
+
+	if ( nat_trace.recs == NULL )
+	{
+		return;
+	}
+
+	if ( len > IPA_NAT_TRACE_DATA_SZ )
+	{
+		len = IPA_NAT_TRACE_DATA_SZ;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	rec_ptr = &nat_trace.recs[seq % nat_trace.num_recs];
+
+	/*
+	 * Readers copying this record from now on see a bad sequence
+	 * number on one side or the other of their copy...
+	 */
+	__atomic_store_n(&rec_ptr->seq, UINT64_MAX, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	rec_ptr->ts_ns = SECS2NanSECS((uint64_t) ts.tv_sec) + (uint64_t) ts.tv_nsec;
+	rec_ptr->ev    = ev;
+	rec_ptr->aux   = aux;
+	rec_ptr->len   = len;
+	rec_ptr->arg   = arg;
+
+	memcpy(rec_ptr->data, data_ptr, len);
+
+	__atomic_store_n(&rec_ptr->seq, seq, __ATOMIC_RELEASE);
+	__atomic_store_n(&nat_trace.next_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * ipa_nat_trace_dma() - trace a DMA command
+ * @cmd_ptr: [in] the command, as about to be posted
+ */
+void ipa_nat_trace_dma(
+	const struct ipa_ioc_nat_dma_cmd* cmd_ptr )
+{
+	uint32_t i, cnt;
+
+	for ( i = 0; i < cmd_ptr->entries; i += cnt )
+	{
+		cnt = cmd_ptr->entries - i;
+
+		if ( cnt > DMA_ONES_PER_REC )
+		{
+			cnt = DMA_ONES_PER_REC;
+		}
+
+		ipa_nat_trace_put(
+			IPA_NAT_TRC_DMA_CMD,
+			cmd_ptr->mem_type,
+			cmd_ptr->entries,
+			&cmd_ptr->dma[i],
+			cnt * sizeof(struct ipa_ioc_nat_dma_one));
+	}
+}
+
+/**
+ * ipa_nat_trace_resize() - enable, resize or disable the trace
+ * @num_recs: [in] trace depth in records, zero disables the trace
+ *
+ * Called with the nat mutex held, so no record is being written.
+ * Records already made are dropped; sequence numbers keep counting.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_nat_trace_resize(
+	uint32_t num_recs )
+{
+	ipa_nat_trace_rec* recs = NULL;
+
+	IPADBG("In\n");
+
+	if ( num_recs )
+	{
+		recs = calloc(num_recs, sizeof(*recs));
+
+		if ( recs == NULL )
+		{
+			IPAERR("Unable to allocate %u trace records\n", num_recs);
+			return -ENOMEM;
+		}
+	}
+
+	if ( pthread_mutex_lock(&trace_mutex) )
+	{
+		IPAERR("Unable to lock the trace mutex\n");
+		free(recs);
+		return -EINVAL;
+	}
+
+	free(nat_trace.recs);
+
+	nat_trace.num_recs  = num_recs;
+	nat_trace.first_seq = nat_trace.next_seq;
+
+	__atomic_store_n(&nat_trace.recs, recs, __ATOMIC_RELEASE);
+
+	IPADBG("Trace %s, depth(%u) next_seq(%llu)\n",
+		   (recs) ? "enabled" : "disabled",
+		   num_recs,
+		   (unsigned long long) nat_trace.next_seq);
+
+	if ( pthread_mutex_unlock(&trace_mutex) )
+	{
+		IPAERR("Unable to unlock the trace mutex\n");
+		return -EPERM;
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
+
+/**
+ * ipa_nat_trace_read() - copy trace records out
+ * @cursor_ptr: [in/out] sequence number of the next record to read
+ * @recs: [out] records read
+ * @max_recs: [in] size of recs
+ * @num_recs_ptr: [out] number of records read
+ *
+ * Doesn't take the nat mutex, so reading doesn't hold up the API.
+ *
+ * Returns: 0 on success, -EOVERFLOW when records at the cursor were
+ * overwritten before they were read (the records read until then are
+ * returned and the cursor is moved to the newest record), other
+ * negative values on failure
+ */
+int ipa_nat_trace_read(
+	uint64_t*          cursor_ptr,
+	ipa_nat_trace_rec* recs,
+	uint32_t           max_recs,
+	uint32_t*          num_recs_ptr )
+{
+	const ipa_nat_trace_rec* rec_ptr;
+	uint64_t                 next_seq, oldest_seq, seq;
+	uint32_t                 cnt = 0;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	*num_recs_ptr = 0;
+
+	if ( pthread_mutex_lock(&trace_mutex) )
+	{
+		IPAERR("Unable to lock the trace mutex\n");
+		return -EINVAL;
+	}
+
+	if ( nat_trace.recs == NULL )
+	{
+		IPAERR("Trace not enabled\n");
+		ret = -EPERM;
+		goto unlock;
+	}
+
+	next_seq = __atomic_load_n(&nat_trace.next_seq, __ATOMIC_ACQUIRE);
+
+	if ( *cursor_ptr > next_seq )
+	{
+		IPAERR("Cursor(%llu) beyond next_seq(%llu)\n",
+			   (unsigned long long) *cursor_ptr,
+			   (unsigned long long) next_seq);
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	oldest_seq =
+		(next_seq - nat_trace.first_seq > nat_trace.num_recs) ?
+		next_seq - nat_trace.num_recs                         :
+		nat_trace.first_seq;
+
+	if ( *cursor_ptr < oldest_seq )
+	{
+		ret = -EOVERFLOW;
+	}
+
+	while ( ret == 0 && cnt < max_recs && *cursor_ptr < next_seq )
+	{
+		rec_ptr = &nat_trace.recs[*cursor_ptr % nat_trace.num_recs];
+
+		seq = __atomic_load_n(&rec_ptr->seq, __ATOMIC_ACQUIRE);
+
+		memcpy(&recs[cnt], rec_ptr, sizeof(*rec_ptr));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if ( seq != *cursor_ptr ||
+			 __atomic_load_n(&rec_ptr->seq, __ATOMIC_RELAXED) != seq )
+		{
+			ret = -EOVERFLOW;
+			break;
+		}
+
+		recs[cnt++].seq = seq;
+
+		(*cursor_ptr)++;
+	}
+
+	if ( ret == -EOVERFLOW )
+	{
+		IPAINFO("Trace overrun, cursor(%llu) oldest(%llu)\n",
+				(unsigned long long) *cursor_ptr,
+				(unsigned long long) oldest_seq);
+		*cursor_ptr = __atomic_load_n(&nat_trace.next_seq, __ATOMIC_ACQUIRE);
+	}
+
+	*num_recs_ptr = cnt;
+
+unlock:
+	if ( pthread_mutex_unlock(&trace_mutex) )
+	{
+		IPAERR("Unable to unlock the trace mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+static const char* ipa_nat_trace_ev_as_str(
+	uint8_t ev )
+{
+	switch ( ev )
+	{
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_DMA_CMD);
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_ADD_RULE);
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_NEW_RULE);
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_DEL_RULE);
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_GET_RULE);
+		MAKE_AS_STR_CASE(IPA_NAT_TRC_MIGRATE);
+
+	default:
+		break;
+	}
+
+	return "???";
+}
+
+/**
+ * ipa_nat_trace_format() - decode a trace record
+ * @rec_ptr: [in] a record from ipa_nat_trace_read()
+ * @buf_ptr: [out] where to put the text
+ * @buf_sz: [in] size of buf_ptr
+ *
+ * This is where the formatting the hot paths used to do now happens.
+ *
+ * Returns: buf_ptr
+ */
+char* ipa_nat_trace_format(
+	const ipa_nat_trace_rec* rec_ptr,
+	char*                    buf_ptr,
+	uint32_t                 buf_sz )
+{
+	char     cmd_buf[sizeof(struct ipa_ioc_nat_dma_cmd) + IPA_NAT_TRACE_DATA_SZ];
+	char     body[1024];
+	uint8_t  data[IPA_NAT_TRACE_DATA_SZ];
+	uint32_t len;
+
+	struct ipa_ioc_nat_dma_cmd* cmd_ptr = (struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+	if ( ! rec_ptr || ! buf_ptr || ! buf_sz )
+	{
+		return buf_ptr;
+	}
+
+	/*
+	 * The raw structures go through an aligned copy, and the
+	 * bytes the record didn't fill read as zero...
+	 */
+	len = (rec_ptr->len < sizeof(data)) ? rec_ptr->len : sizeof(data);
+
+	memset(data, 0, sizeof(data));
+	memcpy(data, rec_ptr->data, len);
+
+	body[0] = '\0';
+
+	switch ( rec_ptr->ev )
+	{
+	case IPA_NAT_TRC_DMA_CMD:
+		memset(cmd_buf, 0, sizeof(cmd_buf));
+		cmd_ptr->mem_type = rec_ptr->aux;
+		cmd_ptr->entries  = len / sizeof(struct ipa_ioc_nat_dma_one);
+		memcpy(cmd_ptr->dma, data, sizeof(data));
+		prep_ioc_nat_dma_cmd_4print(cmd_ptr, body, sizeof(body));
+		break;
+
+	case IPA_NAT_TRC_ADD_RULE:
+		prep_nat_ipv4_rule_4print((ipa_nat_ipv4_rule*) data, body, sizeof(body));
+		break;
+
+	case IPA_NAT_TRC_NEW_RULE:
+	case IPA_NAT_TRC_DEL_RULE:
+	case IPA_NAT_TRC_GET_RULE:
+	case IPA_NAT_TRC_MIGRATE:
+		prep_nat_rule_4print((struct ipa_nat_rule*) data, body, sizeof(body));
+		break;
+
+	default:
+		break;
+	}
+
+	snprintf(
+		buf_ptr, buf_sz,
+		"%llu %llu.%09llu %s arg(0x%08X) %s",
+		(unsigned long long) rec_ptr->seq,
+		(unsigned long long) (rec_ptr->ts_ns / NANOS_PER_SEC),
+		(unsigned long long) (rec_ptr->ts_ns % NANOS_PER_SEC),
+		ipa_nat_trace_ev_as_str(rec_ptr->ev),
+		rec_ptr->arg,
+		body);
+
+	return buf_ptr;
+}
@@ -30,6 +30,8 @@
 #include "ipa_nat_utils.h"
 
 #include <errno.h>
+#include <signal.h>
+#include <sys/resource.h>
 
 #define IPA_BASE_TABLE_PERCENTAGE       .8
 #define IPA_EXPANSION_TABLE_PERCENTAGE  .2
@@ -108,19 +110,7 @@ int ipa_table_calculate_entries_num(
 	uint16_t             number_of_entries,
 	enum ipa3_nat_mem_in nmi)
 {
-	uint16_t table_entries, expn_table_entries;
 	float btp, etp;
-	int result = 0;
-
-	IPADBG("In\n");
-
-	if (number_of_entries > IPA_TABLE_MAX_ENTRIES)
-	{
-		IPAERR("Required number of %s entries %d exceeds the maximum %d\n",
-			table->name, number_of_entries, IPA_TABLE_MAX_ENTRIES);
-		result = -EINVAL;
-		goto bail;
-	}
 
 	if ( nmi == IPA_NAT_MEM_IN_SRAM )
 	{
@@ -133,6 +123,32 @@ int ipa_table_calculate_entries_num(
 		etp = IPA_EXPANSION_TABLE_PERCENTAGE;
 	}
 
+	return ipa_table_calculate_entries_split(table, number_of_entries, btp, etp);
+}
+
+/*
+ * As ipa_table_calculate_entries_num(), but with the base and
+ * expansion table percentages given, eg. from ipa_table_advise().
+ */
+int ipa_table_calculate_entries_split(
+	ipa_table* table,
+	uint16_t   number_of_entries,
+	float      btp,
+	float      etp)
+{
+	uint16_t table_entries, expn_table_entries;
+	int result = 0;
+
+	IPADBG("In\n");
+
+	if (number_of_entries > IPA_TABLE_MAX_ENTRIES)
+	{
+		IPAERR("Required number of %s entries %d exceeds the maximum %d\n",
+			table->name, number_of_entries, IPA_TABLE_MAX_ENTRIES);
+		result = -EINVAL;
+		goto bail;
+	}
+
 	table_entries      = Get2PowerTightUpperBound(number_of_entries * btp);
 	expn_table_entries = GetEvenTightUpperBound(number_of_entries * etp);
 
@@ -165,6 +181,47 @@ bail:
 	return result;
 }
 
+/*
+ * As ipa_table_calculate_entries_split(), but with the base and
+ * expansion table sizes given in entries, eg. for SRAM where a table
+ * can only be the one size.
+ */
+int ipa_table_set_entries(
+	ipa_table* table,
+	uint16_t   table_entries,
+	uint16_t   expn_table_entries)
+{
+	int result = 0;
+
+	IPADBG("In\n");
+
+	if ( table_entries == 0 ||
+		 (table_entries & (table_entries - 1)) ||
+		 (expn_table_entries & 1) ||
+		 table_entries + expn_table_entries > IPA_TABLE_MAX_ENTRIES )
+	{
+		IPAERR("Bad %s split: base(%u) expn(%u)\n",
+			   table->name, table_entries, expn_table_entries);
+		result = -EINVAL;
+		goto bail;
+	}
+
+	table->table_entries      = table_entries;
+	table->expn_table_entries = expn_table_entries;
+	table->tot_tbl_ents       = table_entries + expn_table_entries;
+
+	IPADBG("Num of %s entries:%u expn entries:%u total entries:%u\n",
+		   table->name,
+		   table->table_entries,
+		   table->expn_table_entries,
+		   table->tot_tbl_ents);
+
+bail:
+	IPADBG("Out\n");
+
+	return result;
+}
+
 int ipa_table_calculate_size(ipa_table* table)
 {
 	int size = table->entry_size * (table->table_entries + table->expn_table_entries);
@@ -696,7 +753,8 @@ int ipa_table_iterator_end(
 	uint16_t            rec_index,  /* a table slot relative to hash */
 	void*               rec_ptr )   /* occupant record at index above */
 {
-	bool found_end = false;
+	bool     found_end = false;
+	uint32_t steps;
 
 	int ret;
 
@@ -715,7 +773,11 @@ int ipa_table_iterator_end(
 	iterator->prev_index = rec_index;
 	iterator->prev_entry = rec_ptr;
 
-	while ( 1 )
+	/*
+	 * A chain can't be longer than the expansion table, so one that
+	 * is has a cycle...
+	 */
+	for ( steps = 0; steps <= table_ptr->expn_table_entries; steps++ )
 	{
 		uint16_t next_index =
 			table_ptr->entry_interface->entry_get_next_index(iterator->prev_entry);
@@ -726,9 +788,10 @@ int ipa_table_iterator_end(
 			break;
 		}
 
-		if ( next_index == iterator->prev_index )
+		if ( next_index == iterator->prev_index ||
+			 next_index >= table_ptr->tot_tbl_ents )
 		{
-			IPAERR("next_index(%u) and prev_index(%u) shouldn't be equal in %s\n",
+			IPAERR("next_index(%u) after prev_index(%u) is bad in %s\n",
 				   next_index,
 				   iterator->prev_index,
 				   table_ptr->name);
@@ -1331,3 +1394,721 @@ bail:
 
 	return ret;
 }
+
+/**
+ * ipa_table_simulate() - drop hashed tuples into a table of a given split
+ * @hashes: [in] the tuples' hashes, before they are cut to the table size
+ * @num_hashes: [in] number of entries in @hashes
+ * @table_entries: [in] base table entries, a power of two
+ * @expn_table_entries: [in] expansion table entries
+ * @stats_ptr: [out] where the tuples went
+ *
+ * Places the tuples as ipa_table_add_entry() would: a tuple goes to its
+ * base entry, or to the end of that entry's chain in the expansion
+ * table, and an index of zero is never used.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_table_simulate(
+	const uint16_t*        hashes,
+	uint32_t               num_hashes,
+	uint16_t               table_entries,
+	uint16_t               expn_table_entries,
+	ipa_table_split_stats* stats_ptr )
+{
+	uint16_t  mask = table_entries - 1;
+	uint32_t* chain;
+	uint32_t  expn_used = 0, i, bin;
+	uint64_t  probes = 0;
+
+	if ( (hashes == NULL && num_hashes) ||
+		 table_entries < 2 ||
+		 (table_entries & mask) ||
+		 stats_ptr == NULL )
+	{
+		IPAERR("Bad arg: hashes(%pK) table_entries(%u) stats_ptr(%pK)\n",
+			   hashes, table_entries, stats_ptr);
+		return -EINVAL;
+	}
+
+	chain = calloc(table_entries, sizeof(*chain));
+
+	if ( chain == NULL )
+	{
+		IPAERR("Unable to allocate %u chain counters\n", table_entries);
+		return -ENOMEM;
+	}
+
+	memset(stats_ptr, 0, sizeof(*stats_ptr));
+
+	stats_ptr->table_entries      = table_entries;
+	stats_ptr->expn_table_entries = expn_table_entries;
+
+	for ( i = 0; i < num_hashes; i++ )
+	{
+		uint16_t idx = hashes[i] & mask;
+
+		idx = (idx) ? idx : mask;
+
+		if ( chain[idx] && expn_used == expn_table_entries )
+		{
+			stats_ptr->failed++;
+			continue;
+		}
+
+		if ( chain[idx] )
+		{
+			expn_used++;
+		}
+
+		probes += ++chain[idx];
+
+		stats_ptr->placed++;
+	}
+
+	for ( i = 1; i < table_entries; i++ )
+	{
+		if ( chain[i] == 0 )
+		{
+			continue;
+		}
+
+		bin = (chain[i] < IPA_TABLE_CHAIN_BINS) ?
+			chain[i] - 1 :
+			IPA_TABLE_CHAIN_BINS - 1;
+
+		stats_ptr->chain_hist[bin]++;
+
+		if ( chain[i] > stats_ptr->max_chain )
+		{
+			stats_ptr->max_chain = chain[i];
+		}
+	}
+
+	stats_ptr->avg_probe =
+		(stats_ptr->placed) ? (float) probes / stats_ptr->placed : 0;
+
+	free(chain);
+
+	return 0;
+}
+
+/**
+ * ipa_table_advise() - recommend a base/expansion split for a workload
+ * @hashes: [in] per table, the workload's hashes, see ipa_table_simulate()
+ * @num_tbls: [in] number of tables sharing the split, eg. NAT rule and index
+ * @num_hashes: [in] number of hashes per table
+ * @number_of_entries: [in] the table size asked for
+ * @nmi: [in] the memory the table lives in
+ * @advice_ptr: [out] candidate splits, how the workload fares in each
+ *              and which one is best
+ *
+ * The candidates all have as many entries as the split the percentages
+ * above give for @number_of_entries, and it is one of them. The best
+ * one loses the fewest tuples, then looks at the fewest records per
+ * lookup, then has the shortest longest chain.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_table_advise(
+	const uint16_t*      hashes[],
+	uint32_t             num_tbls,
+	uint32_t             num_hashes,
+	uint16_t             number_of_entries,
+	enum ipa3_nat_mem_in nmi,
+	ipa_table_advice*    advice_ptr )
+{
+	ipa_table dflt_tbl;
+	uint32_t  tot, base, expn, i, t;
+	uint32_t  max_ents = IPA_TABLE_INDX_MASK + 1;
+	uint32_t  failed, best_failed = 0, max_chain, best_max_chain = 0;
+	float     probes, best_probes = 0;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( hashes == NULL ||
+		 num_tbls == 0 ||
+		 num_tbls > IPA_TABLE_ADV_MAX_TBLS ||
+		 advice_ptr == NULL )
+	{
+		IPAERR("Bad arg: hashes(%pK) num_tbls(%u) advice_ptr(%pK)\n",
+			   hashes, num_tbls, advice_ptr);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	memset(&dflt_tbl, 0, sizeof(dflt_tbl));
+
+	strlcpy(dflt_tbl.name, "advice", IPA_RESOURCE_NAME_MAX);
+
+	ret = ipa_table_calculate_entries_num(&dflt_tbl, number_of_entries, nmi);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	memset(advice_ptr, 0, sizeof(*advice_ptr));
+
+	advice_ptr->number_of_entries = number_of_entries;
+	advice_ptr->num_tuples        = num_hashes;
+	advice_ptr->num_tbls          = num_tbls;
+
+	tot = dflt_tbl.tot_tbl_ents;
+
+	/*
+	 * The largest base table that fits, then ever smaller ones handing
+	 * their entries to the expansion table...
+	 */
+	for ( base = Get2PowerTightUpperBound(tot);
+		  base >= 2 && advice_ptr->num_splits < IPA_TABLE_MAX_SPLITS;
+		  base >>= 1 )
+	{
+		if ( base > tot || base > max_ents )
+		{
+			continue;
+		}
+
+		expn = (tot - base) & ~1;
+
+		if ( expn < 2 )
+		{
+			continue;
+		}
+
+		if ( expn > max_ents )
+		{
+			break;
+		}
+
+		advice_ptr->splits[advice_ptr->num_splits++][0].table_entries = base;
+		advice_ptr->splits[advice_ptr->num_splits - 1][0].expn_table_entries = expn;
+	}
+
+	for ( i = 0; i < advice_ptr->num_splits; i++ )
+	{
+		if ( advice_ptr->splits[i][0].table_entries == dflt_tbl.table_entries )
+		{
+			break;
+		}
+	}
+
+	if ( i == advice_ptr->num_splits )
+	{
+		i = (i < IPA_TABLE_MAX_SPLITS) ? advice_ptr->num_splits++ : i - 1;
+	}
+
+	advice_ptr->dflt = i;
+
+	advice_ptr->splits[i][0].table_entries      = dflt_tbl.table_entries;
+	advice_ptr->splits[i][0].expn_table_entries = dflt_tbl.expn_table_entries;
+
+	for ( i = 0; i < advice_ptr->num_splits; i++ )
+	{
+		base = advice_ptr->splits[i][0].table_entries;
+		expn = advice_ptr->splits[i][0].expn_table_entries;
+
+		failed = max_chain = 0;
+		probes = 0;
+
+		for ( t = 0; t < num_tbls; t++ )
+		{
+			ipa_table_split_stats* stats_ptr = &advice_ptr->splits[i][t];
+
+			ret = ipa_table_simulate(hashes[t], num_hashes, base, expn, stats_ptr);
+
+			if ( ret )
+			{
+				goto bail;
+			}
+
+			failed += stats_ptr->failed;
+			probes += stats_ptr->avg_probe * stats_ptr->placed;
+
+			if ( stats_ptr->max_chain > max_chain )
+			{
+				max_chain = stats_ptr->max_chain;
+			}
+		}
+
+		IPADBG("Split %u: base(%u) expn(%u) failed(%u) probes(%f) max_chain(%u)\n",
+			   i, base, expn, failed, probes, max_chain);
+
+		if ( i == 0 ||
+			 failed < best_failed ||
+			 (failed == best_failed && probes < best_probes) ||
+			 (failed == best_failed && probes == best_probes &&
+			  max_chain < best_max_chain) )
+		{
+			advice_ptr->best = i;
+
+			best_failed    = failed;
+			best_probes    = probes;
+			best_max_chain = max_chain;
+		}
+	}
+
+	IPADBG("%u tuples in %u entries: default split %u, best split %u\n",
+		   num_hashes, tot, advice_ptr->dflt, advice_ptr->best);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/*
+ * What ipa_table_verify() knows of an entry
+ */
+#define VERIFY_FILLED  0x1
+#define VERIFY_REACHED 0x2
+
+static int verify_dma(
+	ipa_table*                  table,
+	dma_help_type               help_type,
+	uint16_t                    rec_index,
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint32_t                    max_dma )
+{
+	if ( cmd->entries >= max_dma )
+	{
+		return -ENOSPC;
+	}
+
+	return ipa_table_add_dma_cmd(
+		table, help_type, GOTO_REC(table, rec_index), rec_index, 0, cmd);
+}
+
+/**
+ * ipa_table_verify() - check, and optionally repair, every chain of a table
+ * @table: [in] the table
+ * @cmd: [out] where repairs are queued, NULL to only check
+ * @max_dma: [in] DMA entries @cmd has room for, counting those in it
+ * @orphans: [out] NULL, or one byte per expansion entry, set for those
+ *           no chain reaches
+ * @report_ptr: [out] what was found and repaired
+ *
+ * The records are read once, in address order, keeping each filled
+ * entry's next and prev index. The chains are then followed in those
+ * copies from every filled base entry, so a long chain costs no more
+ * cache misses than a short one, and a cycle shows as an entry reached
+ * twice.
+ *
+ * A link that is bad or closes a cycle is cut by a DMA command that
+ * clears the next index before it, which ends the chain there, queued
+ * on @cmd for the caller to post. Prev indexes and counts belong to
+ * the library and are fixed in place. Filled expansion entries no
+ * chain reaches are only reported: an entry may be tied to one in
+ * another table, and only the caller knows whether both can go. See
+ * ipa_table_release_orphan().
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_table_verify(
+	ipa_table*                  table,
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint32_t                    max_dma,
+	uint8_t*                    orphans,
+	ipa_table_verify_report*    report_ptr )
+{
+	ipa_table_entry_interface* ei_ptr;
+
+	uint32_t  tot, i, chain_len;
+	uint16_t* next;
+	uint16_t* prev;
+	uint8_t*  state;
+	uint8_t*  rec_ptr;
+	uint16_t  p, n;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! table || ! table->entry_interface || ! report_ptr )
+	{
+		IPAERR("Bad arg: table(%p) and/or report_ptr(%p)\n",
+			   table, report_ptr);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	memset(report_ptr, 0, sizeof(*report_ptr));
+
+	ei_ptr = table->entry_interface;
+
+	tot = table->table_entries + table->expn_table_entries;
+
+	if ( tot == 0 )
+	{
+		goto bail;
+	}
+
+	next = calloc(tot, 2 * sizeof(uint16_t) + sizeof(uint8_t));
+
+	if ( next == NULL )
+	{
+		IPAERR("Unable to allocate verify state for %u entries\n", tot);
+		ret = -ENOMEM;
+		goto bail;
+	}
+
+	prev  = next + tot;
+	state = (uint8_t*) (prev + tot);
+
+	/*
+	 * The one pass over the records...
+	 */
+	for ( i = 0, rec_ptr = table->table_addr;
+		  i < tot;
+		  i++,   rec_ptr += table->entry_size )
+	{
+		if ( ! ei_ptr->entry_is_valid(rec_ptr) )
+		{
+			continue;
+		}
+
+		state[i] = VERIFY_FILLED;
+
+		next[i] = ei_ptr->entry_get_next_index(rec_ptr);
+		prev[i] = ei_ptr->entry_get_prev_index(
+			rec_ptr, i, table->meta, table->table_entries);
+
+		if ( i < table->table_entries )
+		{
+			report_ptr->base_filled++;
+		}
+		else
+		{
+			report_ptr->expn_filled++;
+		}
+	}
+
+	/*
+	 * ...then the chains, in the copies made above
+	 */
+	for ( i = 0; i < table->table_entries; i++ )
+	{
+		if ( ! (state[i] & VERIFY_FILLED) )
+		{
+			continue;
+		}
+
+		if ( VALID_INDEX(prev[i]) )
+		{
+			IPAERR("%s: base entry %u has prev index %u\n",
+				   table->name, i, prev[i]);
+
+			report_ptr->bad_prevs++;
+
+			if ( cmd )
+			{
+				ei_ptr->entry_set_prev_index(
+					GOTO_REC(table, i), i, IPA_TABLE_INVALID_ENTRY,
+					table->meta, table->table_entries);
+				report_ptr->repaired++;
+			}
+		}
+
+		for ( chain_len = 1, p = i, n = next[i];
+			  VALID_INDEX(n);
+			  p = n, n = next[n] )
+		{
+			if ( n < table->table_entries ||
+				 n >= tot ||
+				 ! (state[n] & VERIFY_FILLED) )
+			{
+				IPAERR("%s: entry %u links to %s entry %u\n",
+					   table->name, p,
+					   (n < table->table_entries || n >= tot) ?
+					   "non expansion" : "empty",
+					   n);
+				report_ptr->bad_links++;
+			}
+			else if ( state[n] & VERIFY_REACHED )
+			{
+				IPAERR("%s: entry %u links to entry %u, already on a chain\n",
+					   table->name, p, n);
+				report_ptr->cycles++;
+			}
+			else
+			{
+				state[n] |= VERIFY_REACHED;
+
+				if ( prev[n] != p )
+				{
+					IPAERR("%s: entry %u follows %u, but has prev index %u\n",
+						   table->name, n, p, prev[n]);
+
+					report_ptr->bad_prevs++;
+
+					if ( cmd )
+					{
+						ei_ptr->entry_set_prev_index(
+							GOTO_REC(table, n), n, p,
+							table->meta, table->table_entries);
+						report_ptr->repaired++;
+					}
+				}
+
+				chain_len++;
+
+				continue;
+			}
+
+			if ( cmd )
+			{
+				if ( verify_dma(table, HELP_UPDATE_ENTRY, p, cmd, max_dma) == 0 )
+				{
+					report_ptr->repaired++;
+				}
+				else
+				{
+					report_ptr->deferred++;
+				}
+			}
+
+			break;
+		}
+
+		if ( chain_len > 1 )
+		{
+			report_ptr->chains++;
+		}
+
+		if ( chain_len > report_ptr->max_chain )
+		{
+			report_ptr->max_chain = chain_len;
+		}
+	}
+
+	for ( i = table->table_entries; i < tot; i++ )
+	{
+		if ( state[i] != VERIFY_FILLED )
+		{
+			continue;
+		}
+
+		IPAERR("%s: expansion entry %u is on no chain\n", table->name, i);
+
+		report_ptr->orphans++;
+
+		if ( orphans )
+		{
+			orphans[i - table->table_entries] = 1;
+		}
+	}
+
+	if ( table->cur_tbl_cnt != report_ptr->base_filled )
+	{
+		IPAERR("%s: cur_tbl_cnt(%u) but %u base entries filled\n",
+			   table->name, table->cur_tbl_cnt, report_ptr->base_filled);
+
+		report_ptr->bad_cnts++;
+
+		if ( cmd )
+		{
+			table->cur_tbl_cnt = report_ptr->base_filled;
+			report_ptr->repaired++;
+		}
+	}
+
+	if ( table->cur_expn_tbl_cnt != report_ptr->expn_filled )
+	{
+		IPAERR("%s: cur_expn_tbl_cnt(%u) but %u expansion entries filled\n",
+			   table->name, table->cur_expn_tbl_cnt, report_ptr->expn_filled);
+
+		report_ptr->bad_cnts++;
+
+		if ( cmd )
+		{
+			report_ptr->repaired++;
+		}
+	}
+
+	if ( cmd )
+	{
+		table->cur_expn_tbl_cnt = report_ptr->expn_filled;
+	}
+
+	report_ptr->errors =
+		report_ptr->bad_links +
+		report_ptr->cycles +
+		report_ptr->bad_prevs +
+		report_ptr->orphans +
+		report_ptr->bad_cnts;
+
+	if ( report_ptr->errors )
+	{
+		IPAERR("%s: %u errors, %u repaired, %u deferred\n",
+			   table->name,
+			   report_ptr->errors,
+			   report_ptr->repaired,
+			   report_ptr->deferred);
+	}
+
+	free(next);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+/**
+ * ipa_table_release_orphan() - release an expansion entry no chain reaches
+ * @table: [in] the table
+ * @rec_index: [in] the entry, as found by ipa_table_verify()
+ * @cmd: [out] where the DMA disabling it is queued
+ * @max_dma: [in] DMA entries @cmd has room for, counting those in it
+ *
+ * The entry is disabled by DMA as a delete would, then erased. Only
+ * call this once no cut ipa_table_verify() made is deferred, since the
+ * IPA may still reach the entry until then.
+ *
+ * Returns: 0 on success, -ENOSPC when @cmd is full, negative on failure
+ */
+int ipa_table_release_orphan(
+	ipa_table*                  table,
+	uint16_t                    rec_index,
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint32_t                    max_dma )
+{
+	uint8_t* rec_ptr;
+
+	int ret;
+
+	if ( ! table || ! cmd ||
+		 rec_index <  table->table_entries ||
+		 rec_index >= table->table_entries + table->expn_table_entries )
+	{
+		IPAERR("Bad arg: table(%p) and/or cmd(%p) and/or rec_index(%u)\n",
+			   table, cmd, rec_index);
+		return -EINVAL;
+	}
+
+	ret = verify_dma(table, HELP_UPDATE_HEAD, rec_index, cmd, max_dma);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	rec_ptr = GOTO_REC(table, rec_index);
+
+	memset(rec_ptr, 0, table->entry_size);
+
+	table->entry_interface->entry_set_prev_index(
+		rec_ptr, rec_index, IPA_TABLE_INVALID_ENTRY,
+		table->meta, table->table_entries);
+
+	if ( table->cur_expn_tbl_cnt )
+	{
+		table->cur_expn_tbl_cnt--;
+	}
+
+	return 0;
+}
+
+static void scrub_timer_cb(
+	union sigval sv )
+{
+	ipa_table_scrub* scrub_ptr = (ipa_table_scrub*) sv.sival_ptr;
+
+	/*
+	 * On Linux this only lowers the calling thread, not the process
+	 */
+	setpriority(PRIO_PROCESS, 0, 19);
+
+	scrub_ptr->scrub_cb(scrub_ptr->arb_data_ptr);
+}
+
+/**
+ * ipa_table_scrub_set() - start, retime or stop a background scrub
+ * @scrub_ptr: [in] the scrub
+ * @period_ms: [in] time between runs, zero stops the scrub
+ * @scrub_cb: [in] what a run does, typically lock and verify
+ * @arb_data_ptr: [in] passed to @scrub_cb
+ *
+ * Runs can't overlap: a run that is still going when the next one is
+ * due makes that one wait for the lock the callback takes.
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int ipa_table_scrub_set(
+	ipa_table_scrub*   scrub_ptr,
+	uint32_t           period_ms,
+	ipa_table_scrub_cb scrub_cb,
+	void*              arb_data_ptr )
+{
+	struct sigevent   sev;
+	struct itimerspec its;
+
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( ! scrub_ptr || (period_ms && ! scrub_cb) )
+	{
+		IPAERR("Bad arg: scrub_ptr(%p) and/or scrub_cb(%p)\n",
+			   scrub_ptr, scrub_cb);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( ! scrub_ptr->timer_made )
+	{
+		if ( period_ms == 0 )
+		{
+			goto bail;
+		}
+
+		memset(&sev, 0, sizeof(sev));
+
+		sev.sigev_notify          = SIGEV_THREAD;
+		sev.sigev_notify_function = scrub_timer_cb;
+		sev.sigev_value.sival_ptr = scrub_ptr;
+
+		if ( timer_create(CLOCK_MONOTONIC, &sev, &scrub_ptr->timer) != 0 )
+		{
+			ret = -errno;
+			IPAERR("timer_create failed (%d)\n", -ret);
+			goto bail;
+		}
+
+		scrub_ptr->timer_made = true;
+	}
+
+	/*
+	 * Disarmed while the callback is changed...
+	 */
+	memset(&its, 0, sizeof(its));
+
+	timer_settime(scrub_ptr->timer, 0, &its, NULL);
+
+	scrub_ptr->period_ms    = period_ms;
+	scrub_ptr->scrub_cb     = scrub_cb;
+	scrub_ptr->arb_data_ptr = arb_data_ptr;
+
+	if ( period_ms )
+	{
+		its.it_value.tv_sec  = period_ms / 1000;
+		its.it_value.tv_nsec = (period_ms % 1000) * 1000000;
+		its.it_interval      = its.it_value;
+
+		if ( timer_settime(scrub_ptr->timer, 0, &its, NULL) != 0 )
+		{
+			ret = -errno;
+			IPAERR("timer_settime failed (%d)\n", -ret);
+			goto bail;
+		}
+	}
+
+	IPADBG("Scrub every %u ms\n", period_ms);
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
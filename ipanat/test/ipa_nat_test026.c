@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test026.c
+
+	@brief
+	Verify the following scenario:
+	1. Enable a small rule change journal
+	2. Add rules and verify their ADD records
+	3. Delete a rule and verify its DEL record
+	4. Resize the journal under an unread record and verify the
+	   reader is told
+	5. Overrun the journal and verify the reader is told
+	6. Delete the rules and disable the journal
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <errno.h>
+
+#undef  JRNL_DEPTH
+#define JRNL_DEPTH 4
+
+/*
+ * Reads journal records until one of type op shows up. Records of
+ * other types (eg. migrations on a hybrid table) are skipped.
+ */
+static int find_jrnl_rec(
+	uint64_t*            cursor_ptr,
+	ipa_nat_journal_op   op,
+	ipa_nat_journal_rec* rec_ptr)
+{
+	u32 num_recs;
+	int ret;
+
+	do
+	{
+		ret = ipa_nat_journal_read(cursor_ptr, rec_ptr, 1, &num_recs);
+
+		if ( ret )
+		{
+			return ret;
+		}
+	} while ( num_recs && rec_ptr->op != op );
+
+	return (num_recs) ? 0 : -ENOENT;
+}
+
+int ipa_nat_test026(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule   ipv4_rule;
+	ipa_nat_journal_rec rec;
+	u32                 rule_hdls[JRNL_DEPTH / 2 + 1 + JRNL_DEPTH + 1];
+	u32                 i, num_recs;
+	uint64_t            cursor = 0;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_journal_enable(JRNL_DEPTH);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * Earlier iterations may have left records behind; skip to the
+	 * newest one.
+	 */
+	while ( (ret = ipa_nat_journal_read(&cursor, &rec, 1, &num_recs)) == 0 &&
+			num_recs );
+
+	if ( ret == -EOVERFLOW )
+	{
+		ret = 0;
+	}
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < JRNL_DEPTH / 2; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	for ( i = 0; i < JRNL_DEPTH / 2; i++ )
+	{
+		ret = find_jrnl_rec(&cursor, IPA_NAT_JRNL_ADD, &rec);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		IPADBG("ADD seq(%llu) orig_rule_hdl(0x%08X)\n",
+			   (unsigned long long) rec.seq, rec.orig_rule_hdl);
+
+		ret = (rec.orig_rule_hdl == rule_hdls[i]) ? 0 : -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[0]);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = find_jrnl_rec(&cursor, IPA_NAT_JRNL_DEL, &rec);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = (rec.orig_rule_hdl == rule_hdls[0]) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * A resize drops the records not read yet...
+	 */
+	memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+	ipv4_rule.protocol     = IPPROTO_TCP;
+	ipv4_rule.public_port  = RAN_PORT;
+	ipv4_rule.target_ip    = RAN_ADDR;
+	ipv4_rule.target_port  = RAN_PORT;
+	ipv4_rule.private_ip   = RAN_ADDR;
+	ipv4_rule.private_port = RAN_PORT;
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[JRNL_DEPTH / 2]);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_journal_enable(JRNL_DEPTH);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_journal_read(&cursor, &rec, 1, &num_recs);
+
+	IPADBG("Read after resize returned %d\n", ret);
+
+	ret = (ret == -EOVERFLOW) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * Now add more rules than the journal holds without reading...
+	 */
+	for ( i = JRNL_DEPTH / 2 + 1; i < array_sz(rule_hdls); i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_UDP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_journal_read(&cursor, &rec, 1, &num_recs);
+
+	IPADBG("Read after overrun returned %d\n", ret);
+
+	ret = (ret == -EOVERFLOW) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 1; i < array_sz(rule_hdls); i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_journal_enable(0);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test028.c
+
+	@brief
+	Verify the following scenario:
+	1. In hybrid mode, add rules until the table goes to DDR
+	2. Delete them and verify the table goes back to SRAM
+	3. Set a dwell time, go to DDR again and delete the rules
+	4. Verify the return is put off, then done off the timer
+	5. Restore the default return policy
+	Other memory types just add and delete the rules.
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <unistd.h>
+
+#undef  DWELL_MS
+#define DWELL_MS 200
+
+/*
+ * Adds rules until the table leaves the memory it started in, or
+ * rule_hdls is full, or an add fails.
+ */
+static int fill_tbl(
+	u32  tbl_hdl,
+	u32* rule_hdls,
+	u32  max_rules,
+	u32* num_rules_ptr,
+	bool* switched_ptr)
+{
+	ipa_nat_ipv4_rule  ipv4_rule;
+	ipa_nati_tbl_stats nstats, istats;
+	enum ipa3_nat_mem_in start_nmi;
+	u32                i;
+
+	int ret;
+
+	*num_rules_ptr = 0;
+	*switched_ptr  = false;
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	start_nmi = nstats.nmi;
+
+	for ( i = 0; i < max_rules; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]) )
+		{
+			break;
+		}
+
+		(*num_rules_ptr)++;
+
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+		if ( ret )
+		{
+			return ret;
+		}
+
+		if ( nstats.nmi != start_nmi )
+		{
+			*switched_ptr = true;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static int empty_tbl(
+	u32  tbl_hdl,
+	u32* rule_hdls,
+	u32  num_rules)
+{
+	u32 i;
+	int ret;
+
+	for ( i = 0; i < num_rules; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+
+		if ( ret )
+		{
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int ipa_nat_test028(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nati_tbl_stats nstats, istats, first;
+	u32                rule_hdls[2048];
+	u32                num_rules, waited;
+	bool               switched;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_set_sram_return(25, 0);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &first, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = fill_tbl(tbl_hdl, rule_hdls, array_sz(rule_hdls), &num_rules, &switched);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = empty_tbl(tbl_hdl, rule_hdls, num_rules);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( ! switched )
+	{
+		IPAINFO("Table never left %s, nothing to return from\n",
+				ipa3_nat_mem_in_as_str(first.nmi));
+		goto done;
+	}
+
+	/*
+	 * No dwell time, so the deletes should have brought us back...
+	 */
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("After %u rules: nmi(%s) sw_to_ddr(%u) sw_to_sram(%u)\n",
+			num_rules,
+			ipa3_nat_mem_in_as_str(nstats.nmi),
+			nstats.sw_to_ddr,
+			nstats.sw_to_sram);
+
+	ret = ( nstats.nmi == first.nmi &&
+			nstats.sw_to_ddr  == first.sw_to_ddr  + 1 &&
+			nstats.sw_to_sram == first.sw_to_sram + 1 ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * Now with a dwell time, the deletes should leave us in DDR...
+	 */
+	ret = ipa_nat_set_sram_return(25, DWELL_MS);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = fill_tbl(tbl_hdl, rule_hdls, array_sz(rule_hdls), &num_rules, &switched);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = empty_tbl(tbl_hdl, rule_hdls, num_rules);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &first, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("After deletes: nmi(%s) sw_to_sram_deferred(%u)\n",
+			ipa3_nat_mem_in_as_str(first.nmi),
+			first.sw_to_sram_deferred);
+
+	ret = ( switched &&
+			first.nmi != nstats.nmi &&
+			first.sw_to_sram_deferred > nstats.sw_to_sram_deferred ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * ...until the timer brings us back. The dwell time may have been
+	 * doubled for the short stay in SRAM, so allow for that.
+	 */
+	for ( waited = 0; waited < 8 * DWELL_MS; waited += DWELL_MS / 4 )
+	{
+		usleep(DWELL_MS / 4 * 1000);
+
+		ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &first, &istats);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+		if ( first.nmi == nstats.nmi )
+		{
+			break;
+		}
+	}
+
+	IPAINFO("Back in %s after %u ms\n",
+			ipa3_nat_mem_in_as_str(first.nmi), waited);
+
+	ret = ( first.nmi == nstats.nmi &&
+			first.sw_to_sram == nstats.sw_to_sram + 1 ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+done:
+	ret = ipa_nat_set_sram_return(25, 1000);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
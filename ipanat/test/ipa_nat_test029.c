@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test029.c
+
+	@brief
+	Verify the following scenario:
+	1. Get table sizing advice for a carrier grade NAT like workload,
+	   many hosts talking to one server over strided public ports
+	2. Verify the default split is among the candidates and the best
+	   one loses no more rules than it
+	3. Add rules to the table and get advice for what is in it
+	4. Apply the advice, verify a new table is split as advised, and
+	   go back to the default split
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#undef  NUM_TUPLES
+#define NUM_TUPLES 2048
+
+#undef  NUM_LIVE
+#define NUM_LIVE 64
+
+static ipa_nat_ipv4_rule tuples[NUM_TUPLES];
+
+static int check_advice(
+	const ipa_table_advice* adv_ptr,
+	u32                     num_tuples)
+{
+	u32 i, t, failed[2] = { 0, 0 };
+
+	if ( adv_ptr->num_tuples != num_tuples ||
+		 adv_ptr->num_splits == 0 ||
+		 adv_ptr->dflt >= adv_ptr->num_splits ||
+		 adv_ptr->best >= adv_ptr->num_splits )
+	{
+		return -1;
+	}
+
+	for ( i = 0; i < adv_ptr->num_splits; i++ )
+	{
+		for ( t = 0; t < adv_ptr->num_tbls; t++ )
+		{
+			const ipa_table_split_stats* s = &adv_ptr->splits[i][t];
+
+			IPAINFO("split %u tbl %u: base(%u) expn(%u) placed(%u) failed(%u) "
+					"max_chain(%u) avg_probe(%f)\n",
+					i, t,
+					s->table_entries, s->expn_table_entries,
+					s->placed, s->failed,
+					s->max_chain, s->avg_probe);
+
+			if ( s->placed + s->failed != num_tuples )
+			{
+				return -1;
+			}
+
+			if ( i == adv_ptr->dflt )
+			{
+				failed[0] += s->failed;
+			}
+
+			if ( i == adv_ptr->best )
+			{
+				failed[1] += s->failed;
+			}
+		}
+	}
+
+	IPAINFO("default split %u, best split %u\n", adv_ptr->dflt, adv_ptr->best);
+
+	return ( failed[1] <= failed[0] ) ? 0 : -1;
+}
+
+int ipa_nat_test029(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_table_advice   adv;
+	ipa_nati_tbl_stats nstats, istats;
+	u32                rule_hdls[NUM_LIVE];
+	u32                i, num_live = 0;
+	u32                server = inet_addr("203.0.113.53");
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	for ( i = 0; i < NUM_TUPLES; i++ )
+	{
+		memset(&tuples[i], 0, sizeof(tuples[i]));
+
+		tuples[i].protocol     = IPPROTO_UDP;
+		tuples[i].target_ip    = server;
+		tuples[i].target_port  = 53;
+		tuples[i].private_ip   = htonl(0x0A000000 | (i + 1));
+		tuples[i].private_port = RAN_PORT;
+		tuples[i].public_port  = 1024 + (i * 64) % 64512;
+	}
+
+	ret = ipa_nat_advise_ipv4_tbl(
+		pub_ip_add, nat_mem_type, total_entries, tuples, NUM_TUPLES, &adv);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = check_advice(&adv, NUM_TUPLES);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * Now advice for what is in the table...
+	 */
+	for ( i = 0; i < NUM_LIVE; i++ )
+	{
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &tuples[i], &rule_hdls[i]) )
+		{
+			break;
+		}
+
+		num_live++;
+	}
+
+	ret = ipa_nat_advise_live_ipv4_tbl(tbl_hdl, total_entries, &adv);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("%u rules added, advice on %u\n", num_live, adv.num_tuples);
+
+	ret = ( adv.num_tuples >= num_live ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = check_advice(&adv, adv.num_tuples);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < num_live; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	if ( ! sep )
+	{
+		goto done;
+	}
+
+	/*
+	 * A table made after the advice is applied should be split the
+	 * advised way, unless hybrid mode put it in SRAM...
+	 */
+	ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+	*tbl_hdl_ptr = 0;
+	CHECK_ERR(ret);
+
+	tbl_hdl = 0;
+
+	ret = ipa_nat_apply_ipv4_tbl_advice(nat_mem_type, &adv);
+	CHECK_ERR(ret);
+
+	ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+	CHECK_ERR(ret);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("New %s table: base(%u) expn(%u)\n",
+			ipa3_nat_mem_in_as_str(nstats.nmi),
+			nstats.tot_base_ents,
+			nstats.tot_expn_ents);
+
+	if ( strcasecmp(nat_mem_type, "HYBRID") )
+	{
+		ret = ( nstats.tot_base_ents ==
+				adv.splits[adv.best][0].table_entries &&
+				nstats.tot_expn_ents ==
+				adv.splits[adv.best][0].expn_table_entries ) ? 0 : -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+done:
+	ret = ipa_nat_apply_ipv4_tbl_advice(nat_mem_type, NULL);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
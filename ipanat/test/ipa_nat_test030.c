@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test030.c
+
+	@brief
+	Benchmark rule adds with the trace disabled and enabled:
+	1. Time adding and deleting rules with the trace disabled
+	2. Enable the trace and do the same
+	3. Verify the trace holds an add record for each rule added and
+	   that the records decode
+	4. Disable the trace
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <errno.h>
+
+#undef  NUM_RULES
+#define NUM_RULES 512
+
+#undef  NUM_RECS
+#define NUM_RECS 8192
+
+static ipa_nat_trace_rec recs[NUM_RECS];
+
+/*
+ * Adds up to NUM_RULES rules, then deletes them, and reports how many
+ * adds were done per second.
+ */
+static int time_adds(
+	u32       tbl_hdl,
+	u32*      num_added_ptr,
+	uint64_t* adds_per_sec_ptr)
+{
+	ipa_nat_ipv4_rule ipv4_rule;
+	u32               rule_hdls[NUM_RULES];
+	uint64_t          start, end;
+	u32               i, num_added = 0;
+
+	int ret;
+
+	*num_added_ptr = *adds_per_sec_ptr = 0;
+
+	ret = currTimeAs(TimeAsNanSecs, &start);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	for ( i = 0; i < NUM_RULES; i++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[i]) )
+		{
+			break;
+		}
+
+		num_added++;
+	}
+
+	ret = currTimeAs(TimeAsNanSecs, &end);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	for ( i = 0; i < num_added; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+
+		if ( ret )
+		{
+			return ret;
+		}
+	}
+
+	*num_added_ptr = num_added;
+
+	if ( end > start )
+	{
+		*adds_per_sec_ptr =
+			(uint64_t) num_added * NANOS_PER_SEC / (end - start);
+	}
+
+	return 0;
+}
+
+int ipa_nat_test030(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	uint64_t cursor, off_rate, on_rate;
+	u32      off_added, on_added, num_recs, i, num_adds = 0;
+	char     buf[1024];
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = time_adds(tbl_hdl, &off_added, &off_rate);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_trace_enable(NUM_RECS);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	/*
+	 * Start reading at the oldest record still in the ring...
+	 */
+	cursor = 0;
+
+	ret = ipa_nat_trace_read(&cursor, recs, 0, &num_recs);
+
+	if ( ret == -EOVERFLOW )
+	{
+		ret = 0;
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = time_adds(tbl_hdl, &on_added, &on_rate);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("%s: %u adds at %llu/s with the trace disabled, "
+			"%u adds at %llu/s with it enabled\n",
+			nat_mem_type,
+			off_added, (unsigned long long) off_rate,
+			on_added, (unsigned long long) on_rate);
+
+	ret = ipa_nat_trace_read(&cursor, recs, NUM_RECS, &num_recs);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < num_recs; i++ )
+	{
+		if ( recs[i].ev == IPA_NAT_TRC_ADD_RULE )
+		{
+			num_adds++;
+		}
+	}
+
+	if ( num_recs )
+	{
+		IPAINFO("%u records, first: %s\n",
+				num_recs, ipa_nat_trace_format(&recs[0], buf, sizeof(buf)));
+	}
+
+	ret = ( num_adds >= on_added ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_trace_enable(0);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ( ipa_nat_trace_read(&cursor, recs, NUM_RECS, &num_recs) == -EPERM ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
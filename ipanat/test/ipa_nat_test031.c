@@ -0,0 +1,703 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test031.c
+
+	@brief
+	Stress the table with churn and time it:
+	1. Fill the table to three quarters of its entries
+	2. Churn: a random mix of adds, deletes and timestamp queries that
+	   keeps the table about three quarters full
+	3. Collide: the same churn, with every add aimed at one of a few
+	   base entries of both the rule and the index table
+	4. Drain the table
+	After each phase, walk both tables and verify every chain and
+	count, then report operations per second and latency percentiles
+	per operation. Phases 2 and 3 run -s operations between them.
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <errno.h>
+
+#undef  NUM_HOT
+#define NUM_HOT 8 /* base entries the collide phase aims at */
+
+/*
+ * Latencies are kept in a log-linear histogram: eight buckets per
+ * power of two nanoseconds, which keeps percentiles within 12.5
+ * percent.
+ */
+#undef  LAT_SUB_BITS
+#define LAT_SUB_BITS 3
+
+#undef  LAT_BUCKETS
+#define LAT_BUCKETS  (64 << LAT_SUB_BITS)
+
+typedef enum
+{
+	OP_ADD = 0,
+	OP_DEL = 1,
+	OP_QRY = 2,
+
+	OP_MAX
+} stress_op;
+
+static const char* op_names[OP_MAX] = { "add", "del", "query" };
+
+typedef struct
+{
+	uint64_t ops;
+	uint64_t full;     /* adds that found no room */
+	uint64_t max_ns;
+	uint32_t hist[LAT_BUCKETS];
+} op_stats;
+
+typedef struct
+{
+	u32               tbl_hdl;
+	bool              exact;      /* the walk sees every rule, ie. not HYBRID */
+	u32               max_live;
+	u32               num_live;
+	u32*              rule_hdls;
+	u32               other_live[USE_MAX]; /* rules in the table before the test */
+	ipa_nat_ipv4_rule hot[NUM_HOT];
+	op_stats          stats[OP_MAX];
+} stress_ctx;
+
+typedef struct
+{
+	WhichTbl2Use which;
+	u32          base_filled;
+	u32          expn_filled;
+	u32          expn_reached;
+	u32          dead_heads;
+	u32          max_chain;
+} chain_check;
+
+/* Expansion entries already reached through a chain */
+static uint8_t reached[IPA_TABLE_MAX_ENTRIES];
+
+static void lat_record(
+	op_stats* st_ptr,
+	uint64_t  ns)
+{
+	uint32_t bucket, msb;
+
+	if ( ns < (1 << LAT_SUB_BITS) )
+	{
+		bucket = ns;
+	}
+	else
+	{
+		msb = 63 - __builtin_clzll(ns);
+
+		bucket =
+			((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) +
+			((ns >> (msb - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1));
+	}
+
+	st_ptr->hist[bucket]++;
+	st_ptr->ops++;
+
+	if ( ns > st_ptr->max_ns )
+	{
+		st_ptr->max_ns = ns;
+	}
+}
+
+/*
+ * The per_mille'th latency recorded above, rounded up to the top of
+ * its bucket, but never above the largest one seen.
+ */
+static uint64_t lat_pct(
+	const op_stats* st_ptr,
+	u32             per_mille)
+{
+	uint64_t rank = (st_ptr->ops * per_mille + 999) / 1000;
+	uint64_t seen = 0, top;
+	uint32_t b, shift;
+
+	for ( b = 0; b < LAT_BUCKETS && rank; b++ )
+	{
+		seen += st_ptr->hist[b];
+
+		if ( seen < rank )
+		{
+			continue;
+		}
+
+		if ( b < (1 << LAT_SUB_BITS) )
+		{
+			top = b;
+		}
+		else
+		{
+			shift = (b >> LAT_SUB_BITS) - 1;
+
+			top = (((uint64_t) (1 << LAT_SUB_BITS) +
+					(b & ((1 << LAT_SUB_BITS) - 1))) << shift) +
+				((uint64_t) 1 << shift) - 1;
+		}
+
+		return (top < st_ptr->max_ns) ? top : st_ptr->max_ns;
+	}
+
+	return 0;
+}
+
+/*
+ * Follows the chain hanging off each filled base entry and checks
+ * that it stays in the expansion table, never reaches an entry twice
+ * (which also catches cycles), only goes through filled entries, and
+ * that each entry's prev index names the entry before it.
+ */
+static int chain_check_cb(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	chain_check*               cc_ptr = (chain_check*) arb_data_ptr;
+	ipa_table_entry_interface* ei_ptr = table_ptr->entry_interface;
+
+	uint16_t head = record_index, prev = record_index, index, back;
+	u32      len  = 1;
+
+	if ( record_index >= table_ptr->table_entries )
+	{
+		cc_ptr->expn_filled++;
+		return 0;
+	}
+
+	cc_ptr->base_filled++;
+
+	if ( cc_ptr->which == USE_NAT_TABLE &&
+		 ((struct ipa_nat_rule*) record_ptr)->protocol ==
+		 IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE )
+	{
+		cc_ptr->dead_heads++;
+	}
+
+	index = ei_ptr->entry_get_next_index(record_ptr);
+
+	while ( VALID_INDEX(index) )
+	{
+		if ( index <  table_ptr->table_entries ||
+			 index >= table_ptr->table_entries + table_ptr->expn_table_entries )
+		{
+			IPAERR("%s: entry %u in the chain of %u links to %u, "
+				   "outside the expansion table\n",
+				   table_ptr->name, prev, head, index);
+			return -EINVAL;
+		}
+
+		if ( reached[index - table_ptr->table_entries]++ )
+		{
+			IPAERR("%s: entry %u reached twice, the second time "
+				   "from %u in the chain of %u\n",
+				   table_ptr->name, index, prev, head);
+			return -EINVAL;
+		}
+
+		record_ptr = GOTO_REC(table_ptr, index);
+
+		if ( ! ei_ptr->entry_is_valid(record_ptr) )
+		{
+			IPAERR("%s: empty entry %u in the chain of %u\n",
+				   table_ptr->name, index, head);
+			return -EINVAL;
+		}
+
+		back = ei_ptr->entry_get_prev_index(
+			record_ptr, index, table_ptr->meta, table_ptr->table_entries);
+
+		if ( back != prev )
+		{
+			IPAERR("%s: entry %u follows %u in the chain of %u, "
+				   "but its prev index is %u\n",
+				   table_ptr->name, index, prev, head, back);
+			return -EINVAL;
+		}
+
+		cc_ptr->expn_reached++;
+		len++;
+
+		prev  = index;
+		index = ei_ptr->entry_get_next_index(record_ptr);
+	}
+
+	if ( len > cc_ptr->max_chain )
+	{
+		cc_ptr->max_chain = len;
+	}
+
+	return 0;
+}
+
+/*
+ * Walks the rule and index tables, checks their chains, and checks
+ * the walk against the table's counts and the rules the test holds.
+ * When live_ptr is passed, it gets the rules found instead.
+ */
+static int check_tables(
+	stress_ctx* ctx_ptr,
+	const char* phase,
+	u32*        live_ptr)
+{
+	ipa_nati_tbl_stats stats[USE_MAX];
+	chain_check        cc;
+	u32                which, live;
+
+	int ret;
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX; which++ )
+	{
+		memset(reached, 0, sizeof(reached));
+		memset(&cc, 0, sizeof(cc));
+
+		cc.which = which;
+
+		ret = ipa_nati_walk_ipv4_tbl(
+			ctx_ptr->tbl_hdl, which, chain_check_cb, &cc);
+
+		if ( ret )
+		{
+			IPAERR("%s: chain check of table %u failed\n", phase, which);
+			return -1;
+		}
+
+		/*
+		 * Only now that the chains are known to end...
+		 */
+		ret = ipa_nati_ipv4_tbl_stats(
+			ctx_ptr->tbl_hdl, &stats[USE_NAT_TABLE], &stats[USE_INDEX_TABLE]);
+
+		if ( ret )
+		{
+			return ret;
+		}
+
+		IPAINFO("%s %s table: base(%u/%u) expn(%u/%u) dead heads(%u) "
+				"longest chain(%u)\n",
+				phase,
+				(which == USE_NAT_TABLE) ? "rule" : "index",
+				cc.base_filled, stats[which].tot_base_ents,
+				cc.expn_filled, stats[which].tot_expn_ents,
+				cc.dead_heads, cc.max_chain);
+
+		if ( cc.base_filled != stats[which].tot_base_ents_filled ||
+			 cc.expn_filled != stats[which].tot_expn_ents_filled )
+		{
+			IPAERR("%s: walk found %u base and %u expn entries, "
+				   "table counts %u and %u\n",
+				   phase,
+				   cc.base_filled, cc.expn_filled,
+				   stats[which].tot_base_ents_filled,
+				   stats[which].tot_expn_ents_filled);
+			return -1;
+		}
+
+		if ( cc.expn_reached != cc.expn_filled )
+		{
+			IPAERR("%s: %u expn entries filled, %u on a chain\n",
+				   phase, cc.expn_filled, cc.expn_reached);
+			return -1;
+		}
+
+		live = cc.base_filled + cc.expn_filled - cc.dead_heads;
+
+		if ( live_ptr )
+		{
+			live_ptr[which] = live;
+			continue;
+		}
+
+		/*
+		 * In HYBRID mode, rules can be in the table not walked...
+		 */
+		if ( ctx_ptr->exact ?
+			 live != ctx_ptr->other_live[which] + ctx_ptr->num_live :
+			 live >  ctx_ptr->other_live[which] + ctx_ptr->num_live )
+		{
+			IPAERR("%s: %u rules in the table, expected %u\n",
+				   phase, live, ctx_ptr->other_live[which] + ctx_ptr->num_live);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void make_flow(
+	ipa_nat_ipv4_rule* rule_ptr)
+{
+	memset(rule_ptr, 0, sizeof(*rule_ptr));
+
+	rule_ptr->protocol     = (rand() & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+	rule_ptr->private_ip   = htonl(0x0A000000 | (rand() & 0xFFFF));
+	rule_ptr->private_port = RAN_PORT;
+	rule_ptr->target_ip    = RAN_ADDR;
+	rule_ptr->target_port  = RAN_PORT;
+	rule_ptr->public_port  = RAN_PORT;
+}
+
+/*
+ * dst_hash() folds the target port into the public port and
+ * src_hash() folds it into the private port, so xoring one value into
+ * all three ports leaves both hashes, whatever the table size, where
+ * the hot flow's are.
+ */
+static void make_collider(
+	stress_ctx*        ctx_ptr,
+	ipa_nat_ipv4_rule* rule_ptr)
+{
+	u16 d = (u16) rand();
+
+	*rule_ptr = ctx_ptr->hot[rand() % NUM_HOT];
+
+	rule_ptr->target_port  ^= d;
+	rule_ptr->public_port  ^= d;
+	rule_ptr->private_port ^= d;
+}
+
+static int do_add(
+	stress_ctx*        ctx_ptr,
+	ipa_nat_ipv4_rule* rule_ptr)
+{
+	uint64_t start, end;
+	u32      rule_hdl;
+
+	int ret;
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	ret = ipa_nat_add_ipv4_rule(ctx_ptr->tbl_hdl, rule_ptr, &rule_hdl);
+
+	currTimeAs(TimeAsNanSecs, &end);
+
+	lat_record(&ctx_ptr->stats[OP_ADD], end - start);
+
+	if ( ret )
+	{
+		ctx_ptr->stats[OP_ADD].full++;
+		return 0;
+	}
+
+	ctx_ptr->rule_hdls[ctx_ptr->num_live++] = rule_hdl;
+
+	return 0;
+}
+
+static int do_del(
+	stress_ctx* ctx_ptr)
+{
+	uint64_t start, end;
+	u32      i = rand() % ctx_ptr->num_live;
+
+	int ret;
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	ret = ipa_nat_del_ipv4_rule(ctx_ptr->tbl_hdl, ctx_ptr->rule_hdls[i]);
+
+	currTimeAs(TimeAsNanSecs, &end);
+
+	if ( ret )
+	{
+		IPAERR("Delete of rule hdl(0x%08X) failed (%d)\n",
+			   ctx_ptr->rule_hdls[i], ret);
+		return ret;
+	}
+
+	lat_record(&ctx_ptr->stats[OP_DEL], end - start);
+
+	ctx_ptr->rule_hdls[i] = ctx_ptr->rule_hdls[--ctx_ptr->num_live];
+
+	return 0;
+}
+
+static int do_query(
+	stress_ctx* ctx_ptr)
+{
+	uint64_t start, end;
+	u32      i = rand() % ctx_ptr->num_live;
+	u32      time_stamp;
+
+	int ret;
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	ret = ipa_nat_query_timestamp(
+		ctx_ptr->tbl_hdl, ctx_ptr->rule_hdls[i], &time_stamp);
+
+	currTimeAs(TimeAsNanSecs, &end);
+
+	if ( ret )
+	{
+		IPAERR("Query of rule hdl(0x%08X) failed (%d)\n",
+			   ctx_ptr->rule_hdls[i], ret);
+		return ret;
+	}
+
+	lat_record(&ctx_ptr->stats[OP_QRY], end - start);
+
+	return 0;
+}
+
+/*
+ * Three in ten operations query a live rule. The rest add with a
+ * likelihood of 1 - 2/3 of the table's occupancy and delete
+ * otherwise, which settles at three quarters of max_live.
+ */
+static int churn_step(
+	stress_ctx* ctx_ptr,
+	bool        collide)
+{
+	ipa_nat_ipv4_rule rule;
+
+	if ( ctx_ptr->num_live && rand() % 10 < 3 )
+	{
+		return do_query(ctx_ptr);
+	}
+
+	if ( ctx_ptr->num_live == 0
+		 ||
+		 ( ctx_ptr->num_live < ctx_ptr->max_live
+		   &&
+		   (u32) (rand() % ctx_ptr->max_live) * 3 >= ctx_ptr->num_live * 2 ) )
+	{
+		if ( collide )
+		{
+			make_collider(ctx_ptr, &rule);
+		}
+		else
+		{
+			make_flow(&rule);
+		}
+
+		return do_add(ctx_ptr, &rule);
+	}
+
+	return do_del(ctx_ptr);
+}
+
+static void report_phase(
+	stress_ctx* ctx_ptr,
+	const char* nat_mem_type,
+	const char* phase,
+	uint64_t    ns)
+{
+	const op_stats* st_ptr;
+	uint64_t        tot = 0;
+	u32             op;
+
+	for ( op = 0; op < OP_MAX; op++ )
+	{
+		tot += ctx_ptr->stats[op].ops;
+	}
+
+	IPAINFO("%s %s: %llu ops in %llu ms, %llu ops/s, %u rules live\n",
+			nat_mem_type, phase,
+			(unsigned long long) tot,
+			(unsigned long long) (ns / 1000000),
+			(unsigned long long) ((ns) ? tot * NANOS_PER_SEC / ns : 0),
+			ctx_ptr->num_live);
+
+	for ( op = 0; op < OP_MAX; op++ )
+	{
+		st_ptr = &ctx_ptr->stats[op];
+
+		if ( ! st_ptr->ops )
+		{
+			continue;
+		}
+
+		IPAINFO("%s %s %s: %llu ops (%llu full) ns p50(%llu) p90(%llu) "
+				"p99(%llu) p99.9(%llu) max(%llu)\n",
+				nat_mem_type, phase, op_names[op],
+				(unsigned long long) st_ptr->ops,
+				(unsigned long long) st_ptr->full,
+				(unsigned long long) lat_pct(st_ptr, 500),
+				(unsigned long long) lat_pct(st_ptr, 900),
+				(unsigned long long) lat_pct(st_ptr, 990),
+				(unsigned long long) lat_pct(st_ptr, 999),
+				(unsigned long long) st_ptr->max_ns);
+	}
+}
+
+typedef enum
+{
+	PHASE_FILL    = 0,
+	PHASE_CHURN   = 1,
+	PHASE_COLLIDE = 2,
+	PHASE_DRAIN   = 3,
+
+	PHASE_MAX
+} stress_phase;
+
+static const char* phase_names[PHASE_MAX] = { "fill", "churn", "collide", "drain" };
+
+static int run_phase(
+	stress_ctx*  ctx_ptr,
+	const char*  nat_mem_type,
+	stress_phase phase,
+	u32          num_ops)
+{
+	ipa_nat_ipv4_rule rule;
+	uint64_t          start, end;
+	u32               i;
+
+	int ret = 0;
+
+	memset(ctx_ptr->stats, 0, sizeof(ctx_ptr->stats));
+
+	currTimeAs(TimeAsNanSecs, &start);
+
+	switch ( phase )
+	{
+	case PHASE_FILL:
+		while ( ret == 0
+				&&
+				ctx_ptr->num_live < ctx_ptr->max_live * 3 / 4
+				&&
+				! ctx_ptr->stats[OP_ADD].full )
+		{
+			make_flow(&rule);
+			ret = do_add(ctx_ptr, &rule);
+		}
+		break;
+	case PHASE_CHURN:
+	case PHASE_COLLIDE:
+		for ( i = 0; i < num_ops && ret == 0; i++ )
+		{
+			ret = churn_step(ctx_ptr, phase == PHASE_COLLIDE);
+		}
+		break;
+	case PHASE_DRAIN:
+		while ( ret == 0 && ctx_ptr->num_live )
+		{
+			ret = do_del(ctx_ptr);
+		}
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	currTimeAs(TimeAsNanSecs, &end);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	report_phase(ctx_ptr, nat_mem_type, phase_names[phase], end - start);
+
+	return check_tables(ctx_ptr, phase_names[phase], NULL);
+}
+
+int ipa_nat_test031(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	stress_ctx ctx;
+	u32        i, phase;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	ctx.tbl_hdl   = tbl_hdl;
+	ctx.exact     = strcasecmp(nat_mem_type, "HYBRID") != 0;
+	ctx.max_live  = total_entries;
+	ctx.rule_hdls = calloc(ctx.max_live, sizeof(u32));
+
+	ret = ( ctx.rule_hdls ) ? 0 : -ENOMEM;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	for ( i = 0; i < NUM_HOT; i++ )
+	{
+		make_flow(&ctx.hot[i]);
+	}
+
+	ret = check_tables(&ctx, "start", ctx.other_live);
+
+	IPAINFO("%s: %u ops of churn over up to %u rules\n",
+			nat_mem_type, nat_stress_ops, ctx.max_live);
+
+	for ( phase = PHASE_FILL; phase < PHASE_MAX && ret == 0; phase++ )
+	{
+		ret = run_phase(&ctx, nat_mem_type, phase, nat_stress_ops / 2);
+	}
+
+	/*
+	 * A phase that failed may have left rules behind...
+	 */
+	while ( ctx.num_live )
+	{
+		ipa_nat_del_ipv4_rule(tbl_hdl, ctx.rule_hdls[--ctx.num_live]);
+	}
+
+	free(ctx.rule_hdls);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
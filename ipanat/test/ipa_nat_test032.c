@@ -0,0 +1,726 @@
+/*
+ * Copyright (c) 2023 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test032.c
+
+	@brief
+	Verify the table and repair it:
+	1. Add random rules, delete half of them, then add colliders
+	   that share a chain in both the rule and the index table, and
+	   check that the verify finds nothing wrong
+	2. Break a prev index in the index table, a count in the rule
+	   table, and make the rule table's chain loop back on itself; for
+	   each, check that the verify finds it, repairs it and then finds
+	   nothing wrong
+	3. Cut the chain in both tables ahead of the last colliders and
+	   check that the entries cut off are found and released
+	4. Delete the rules left, check the counts are back where they
+	   started, and let the background scrub run over the table
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#undef  NUM_RAND
+#define NUM_RAND 24 /* random rules, half of them deleted again */
+
+#undef  NUM_COLL
+#define NUM_COLL 6  /* rules sharing one chain */
+
+#undef  NUM_CUT
+#define NUM_CUT  2  /* colliders cut off the end of the chain */
+
+typedef struct
+{
+	u32                tbl_hdl;
+	u32                rand_hdls[NUM_RAND];
+	u32                num_rand;
+	ipa_nat_ipv4_rule  coll[NUM_COLL];
+	u32                coll_hdls[NUM_COLL];
+	bool               live[NUM_COLL];
+	/*
+	 * Filled in by locate(): where each live collider sits in the
+	 * rule and the index table, and the colliders in chain order
+	 */
+	WhichTbl2Use       which;
+	ipa_table*         table_ptr[USE_MAX];
+	uint16_t           rec[USE_MAX][NUM_COLL];
+	u32                chain[USE_MAX][NUM_COLL];
+	u32                len[USE_MAX];
+} verify_ctx;
+
+static int locate_cb(
+	ipa_table*      table_ptr,
+	uint32_t        rule_hdl,
+	void*           record_ptr,
+	uint16_t        record_index,
+	void*           meta_record_ptr,
+	uint16_t        meta_record_index,
+	void*           arb_data_ptr )
+{
+	verify_ctx*          ctx_ptr  = (verify_ctx*) arb_data_ptr;
+	struct ipa_nat_rule* rule_ptr = (struct ipa_nat_rule*) record_ptr;
+	ipa_nat_ipv4_rule*   coll_ptr;
+	u32                  i;
+
+	ctx_ptr->table_ptr[ctx_ptr->which] = table_ptr;
+
+	if ( ctx_ptr->which != USE_NAT_TABLE )
+	{
+		return 0;
+	}
+
+	for ( i = 0; i < NUM_COLL; i++ )
+	{
+		coll_ptr = &ctx_ptr->coll[i];
+
+		if ( rule_ptr->protocol     == coll_ptr->protocol     &&
+			 rule_ptr->private_ip   == coll_ptr->private_ip   &&
+			 rule_ptr->private_port == coll_ptr->private_port &&
+			 rule_ptr->target_ip    == coll_ptr->target_ip    &&
+			 rule_ptr->target_port  == coll_ptr->target_port  &&
+			 rule_ptr->public_port  == coll_ptr->public_port )
+		{
+			ctx_ptr->rec[USE_NAT_TABLE][i]   = record_index;
+			ctx_ptr->rec[USE_INDEX_TABLE][i] = rule_ptr->indx_tbl_entry;
+			ctx_ptr->live[i]                 = true;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Finds the colliders still in the table, then goes back from one of
+ * them to the base entry of their chain in each table and lists them
+ * in the order the chain reaches them.
+ */
+static int locate(
+	verify_ctx* ctx_ptr)
+{
+	ipa_table_entry_interface* ei_ptr;
+	ipa_table*                 t_ptr;
+	uint16_t                   index;
+	u32                        which, i, first, steps;
+
+	int ret;
+
+	memset(ctx_ptr->live, 0, sizeof(ctx_ptr->live));
+	memset(ctx_ptr->len,  0, sizeof(ctx_ptr->len));
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX; which++ )
+	{
+		ctx_ptr->which = which;
+
+		ret = ipa_nati_walk_ipv4_tbl(
+			ctx_ptr->tbl_hdl, which, locate_cb, ctx_ptr);
+
+		if ( ret )
+		{
+			return ret;
+		}
+	}
+
+	for ( first = 0; first < NUM_COLL && ! ctx_ptr->live[first]; first++ );
+
+	if ( first == NUM_COLL )
+	{
+		return 0;
+	}
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX; which++ )
+	{
+		t_ptr  = ctx_ptr->table_ptr[which];
+		ei_ptr = t_ptr->entry_interface;
+		index  = ctx_ptr->rec[which][first];
+
+		for ( steps = 0;
+			  index >= t_ptr->table_entries && steps < t_ptr->tot_tbl_ents;
+			  steps++ )
+		{
+			index = ei_ptr->entry_get_prev_index(
+				GOTO_REC(t_ptr, index), index, t_ptr->meta, t_ptr->table_entries);
+		}
+
+		for ( steps = 0;
+			  VALID_INDEX(index) && steps < t_ptr->tot_tbl_ents;
+			  steps++ )
+		{
+			for ( i = 0; i < NUM_COLL; i++ )
+			{
+				if ( ctx_ptr->live[i] && ctx_ptr->rec[which][i] == index )
+				{
+					ctx_ptr->chain[which][ctx_ptr->len[which]++] = i;
+				}
+			}
+
+			index = ei_ptr->entry_get_next_index(GOTO_REC(t_ptr, index));
+		}
+	}
+
+	return 0;
+}
+
+static void show_report(
+	const char*                    step,
+	const char*                    tbl,
+	const ipa_table_verify_report* r_ptr)
+{
+	IPAINFO("%s %s table: filled(%u/%u) chains(%u) longest(%u) errors(%u) "
+			"bad links(%u) cycles(%u) bad prevs(%u) orphans(%u) bad counts(%u) "
+			"repaired(%u) deferred(%u)\n",
+			step, tbl,
+			r_ptr->base_filled, r_ptr->expn_filled,
+			r_ptr->chains, r_ptr->max_chain, r_ptr->errors,
+			r_ptr->bad_links, r_ptr->cycles, r_ptr->bad_prevs,
+			r_ptr->orphans, r_ptr->bad_cnts,
+			r_ptr->repaired, r_ptr->deferred);
+}
+
+static int verify(
+	verify_ctx*              ctx_ptr,
+	const char*              step,
+	bool                     repair,
+	ipa_table_verify_report* nat_ptr,
+	ipa_table_verify_report* idx_ptr)
+{
+	int ret;
+
+	ret = ipa_nat_verify_ipv4_tbl(ctx_ptr->tbl_hdl, repair, nat_ptr, idx_ptr);
+
+	if ( ret == 0 )
+	{
+		show_report(step, "rule",  nat_ptr);
+		show_report(step, "index", idx_ptr);
+	}
+
+	return ret;
+}
+
+static int verify_clean(
+	verify_ctx* ctx_ptr,
+	const char* step)
+{
+	ipa_table_verify_report nat, idx;
+
+	int ret = verify(ctx_ptr, step, false, &nat, &idx);
+
+	if ( ret == 0 && (nat.errors || idx.errors) )
+	{
+		IPAERR("%s: verify found %u rule and %u index table errors\n",
+			   step, nat.errors, idx.errors);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+/*
+ * Checks that the verify finds what was broken, that repairing fixes
+ * it, and that a second verify finds nothing left to fix.
+ */
+static int verify_repair(
+	verify_ctx*  ctx_ptr,
+	const char*  step,
+	WhichTbl2Use which,
+	size_t       offset,
+	u32          expected)
+{
+	ipa_table_verify_report rep[USE_MAX];
+	u32                     found;
+
+	int ret;
+
+	ret = verify(ctx_ptr, step, false, &rep[USE_NAT_TABLE], &rep[USE_INDEX_TABLE]);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	found = *(u32*) ((uint8_t*) &rep[which] + offset);
+
+	if ( found != expected || rep[which].errors != expected ||
+		 rep[which].repaired || rep[! which].errors )
+	{
+		IPAERR("%s: expected %u errors, found %u of %u\n",
+			   step, expected, found, rep[which].errors);
+		return -1;
+	}
+
+	ret = verify(ctx_ptr, step, true, &rep[USE_NAT_TABLE], &rep[USE_INDEX_TABLE]);
+
+	if ( ret == 0 && (rep[which].repaired < expected || rep[which].deferred) )
+	{
+		IPAERR("%s: repaired %u of %u, deferred %u\n",
+			   step, rep[which].repaired, expected, rep[which].deferred);
+		ret = -1;
+	}
+
+	return ( ret ) ? ret : verify_clean(ctx_ptr, step);
+}
+
+static void set_next(
+	ipa_table*   t_ptr,
+	WhichTbl2Use which,
+	uint16_t     index,
+	uint16_t     next_index)
+{
+	void* rec_ptr = GOTO_REC(t_ptr, index);
+
+	if ( which == USE_NAT_TABLE )
+	{
+		((struct ipa_nat_rule*) rec_ptr)->next_index = next_index;
+	}
+	else
+	{
+		((struct ipa_nat_indx_tbl_rule*) rec_ptr)->next_index = next_index;
+	}
+}
+
+static int add_rules(
+	verify_ctx* ctx_ptr)
+{
+	ipa_nat_ipv4_rule rule;
+	u32               i;
+	u16               d;
+
+	int ret;
+
+	for ( i = 0; i < NUM_RAND; i++ )
+	{
+		memset(&rule, 0, sizeof(rule));
+
+		rule.protocol     = IPPROTO_TCP;
+		rule.private_ip   = RAN_ADDR;
+		rule.private_port = RAN_PORT;
+		rule.target_ip    = RAN_ADDR;
+		rule.target_port  = RAN_PORT;
+		rule.public_port  = RAN_PORT;
+
+		ret = ipa_nat_add_ipv4_rule(
+			ctx_ptr->tbl_hdl, &rule, &ctx_ptr->rand_hdls[ctx_ptr->num_rand]);
+
+		CHECK_ERR(ret);
+
+		ctx_ptr->num_rand++;
+	}
+
+	for ( i = 0; i < ctx_ptr->num_rand; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(ctx_ptr->tbl_hdl, ctx_ptr->rand_hdls[i]);
+
+		CHECK_ERR(ret);
+
+		ctx_ptr->rand_hdls[i] = ctx_ptr->rand_hdls[--ctx_ptr->num_rand];
+	}
+
+	/*
+	 * Xoring one value into all three ports leaves both hashes where
+	 * the first collider's are, see ipa_nat_test031
+	 */
+	for ( i = 0; i < NUM_COLL; i++ )
+	{
+		d = (i) ? (u16) rand() | 1 : 0;
+
+		ctx_ptr->coll[i] = ctx_ptr->coll[0];
+
+		ctx_ptr->coll[i].target_port  ^= d;
+		ctx_ptr->coll[i].public_port  ^= d;
+		ctx_ptr->coll[i].private_port ^= d;
+
+		ret = ipa_nat_add_ipv4_rule(
+			ctx_ptr->tbl_hdl, &ctx_ptr->coll[i], &ctx_ptr->coll_hdls[i]);
+
+		CHECK_ERR(ret);
+
+		ctx_ptr->live[i] = true;
+	}
+
+	return 0;
+}
+
+static int break_and_repair(
+	verify_ctx* ctx_ptr)
+{
+	ipa_table_verify_report    rep[USE_MAX];
+	ipa_table*                 t_ptr;
+	ipa_table_entry_interface* ei_ptr;
+	uint16_t                   index, prev, tail;
+	u32                        which, i, *chain, len;
+
+	int ret;
+
+	ret = verify_clean(ctx_ptr, "added");
+
+	if ( ret == 0 )
+	{
+		ret = locate(ctx_ptr);
+	}
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	if ( ctx_ptr->len[USE_NAT_TABLE]   != NUM_COLL ||
+		 ctx_ptr->len[USE_INDEX_TABLE] != NUM_COLL )
+	{
+		IPAERR("colliders on %u rule and %u index table chain entries, "
+			   "expected %u\n",
+			   ctx_ptr->len[USE_NAT_TABLE], ctx_ptr->len[USE_INDEX_TABLE],
+			   NUM_COLL);
+		return -1;
+	}
+
+	/*
+	 * A prev index naming an entry further up the chain
+	 */
+	t_ptr  = ctx_ptr->table_ptr[USE_INDEX_TABLE];
+	ei_ptr = t_ptr->entry_interface;
+	chain  = ctx_ptr->chain[USE_INDEX_TABLE];
+	index  = ctx_ptr->rec[USE_INDEX_TABLE][chain[2]];
+
+	ei_ptr->entry_set_prev_index(
+		GOTO_REC(t_ptr, index), index,
+		ctx_ptr->rec[USE_INDEX_TABLE][chain[0]],
+		t_ptr->meta, t_ptr->table_entries);
+
+	ret = verify_repair(
+		ctx_ptr, "bad prev", USE_INDEX_TABLE,
+		offsetof(ipa_table_verify_report, bad_prevs), 1);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	/*
+	 * A count that is off
+	 */
+	ctx_ptr->table_ptr[USE_NAT_TABLE]->cur_expn_tbl_cnt++;
+
+	ret = verify_repair(
+		ctx_ptr, "bad count", USE_NAT_TABLE,
+		offsetof(ipa_table_verify_report, bad_cnts), 1);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	/*
+	 * The tail linking back to the second collider
+	 */
+	t_ptr  = ctx_ptr->table_ptr[USE_NAT_TABLE];
+	ei_ptr = t_ptr->entry_interface;
+	chain  = ctx_ptr->chain[USE_NAT_TABLE];
+	tail   = ctx_ptr->rec[USE_NAT_TABLE][chain[NUM_COLL - 1]];
+
+	if ( VALID_INDEX(ei_ptr->entry_get_next_index(GOTO_REC(t_ptr, tail))) )
+	{
+		IPAERR("last collider %u is not the tail of its chain\n", tail);
+		return -1;
+	}
+
+	set_next(t_ptr, USE_NAT_TABLE, tail, ctx_ptr->rec[USE_NAT_TABLE][chain[1]]);
+
+	ret = verify_repair(
+		ctx_ptr, "cycle", USE_NAT_TABLE,
+		offsetof(ipa_table_verify_report, cycles), 1);
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	/*
+	 * Cutting both chains ahead of the last NUM_CUT colliders leaves
+	 * their rules and index entries unreachable, so they have to be
+	 * the same colliders in both tables.
+	 */
+	for ( i = NUM_COLL - NUM_CUT; i < NUM_COLL; i++ )
+	{
+		if ( ctx_ptr->chain[USE_NAT_TABLE][i] != ctx_ptr->chain[USE_INDEX_TABLE][i] )
+		{
+			IPAINFO("Chains end in different colliders, not cutting them\n");
+			return 0;
+		}
+	}
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX; which++ )
+	{
+		t_ptr  = ctx_ptr->table_ptr[which];
+		ei_ptr = t_ptr->entry_interface;
+		index  = ctx_ptr->rec[which][ctx_ptr->chain[which][NUM_COLL - NUM_CUT]];
+		prev   = ei_ptr->entry_get_prev_index(
+			GOTO_REC(t_ptr, index), index, t_ptr->meta, t_ptr->table_entries);
+
+		set_next(t_ptr, which, prev, 0);
+	}
+
+	ret = verify(ctx_ptr, "cut", false, &rep[USE_NAT_TABLE], &rep[USE_INDEX_TABLE]);
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX && ret == 0; which++ )
+	{
+		if ( rep[which].orphans != NUM_CUT || rep[which].errors != NUM_CUT )
+		{
+			IPAERR("cut: expected %u orphans, found %u of %u errors\n",
+				   NUM_CUT, rep[which].orphans, rep[which].errors);
+			ret = -1;
+		}
+	}
+
+	if ( ret == 0 )
+	{
+		ret = verify(ctx_ptr, "cut", true, &rep[USE_NAT_TABLE], &rep[USE_INDEX_TABLE]);
+	}
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX && ret == 0; which++ )
+	{
+		if ( rep[which].repaired < NUM_CUT || rep[which].deferred )
+		{
+			IPAERR("cut: repaired %u of %u, deferred %u\n",
+				   rep[which].repaired, NUM_CUT, rep[which].deferred);
+			ret = -1;
+		}
+	}
+
+	if ( ret == 0 )
+	{
+		ret = verify_clean(ctx_ptr, "cut");
+	}
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	ret = locate(ctx_ptr);
+
+	if ( ret == 0 )
+	{
+		len = ctx_ptr->len[USE_NAT_TABLE];
+
+		if ( len != NUM_COLL - NUM_CUT || ctx_ptr->len[USE_INDEX_TABLE] != len )
+		{
+			IPAERR("%u colliders left after the cut, expected %u\n",
+				   len, NUM_COLL - NUM_CUT);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Puts right whatever a step that failed left broken, then deletes
+ * the rules still in the table. Rules a repair released are gone
+ * already and must not be deleted again.
+ */
+static void del_rules(
+	verify_ctx* ctx_ptr)
+{
+	ipa_table_verify_report nat, idx;
+	u32                     i;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		if ( ipa_nat_verify_ipv4_tbl(ctx_ptr->tbl_hdl, true, &nat, &idx) ||
+			 (nat.errors == 0 && idx.errors == 0) )
+		{
+			break;
+		}
+	}
+
+	if ( locate(ctx_ptr) == 0 )
+	{
+		for ( i = 0; i < NUM_COLL; i++ )
+		{
+			if ( ctx_ptr->live[i] )
+			{
+				ipa_nat_del_ipv4_rule(ctx_ptr->tbl_hdl, ctx_ptr->coll_hdls[i]);
+			}
+		}
+	}
+
+	while ( ctx_ptr->num_rand )
+	{
+		ipa_nat_del_ipv4_rule(ctx_ptr->tbl_hdl, ctx_ptr->rand_hdls[--ctx_ptr->num_rand]);
+	}
+}
+
+#undef  SCRUB_MS
+#define SCRUB_MS 10
+
+static int check_scrub(
+	verify_ctx*               ctx_ptr,
+	const ipa_nati_tbl_stats* start_ptr)
+{
+	ipa_nati_tbl_stats stats[USE_MAX];
+	u32                which;
+
+	int ret;
+
+	ret = verify_clean(ctx_ptr, "deleted");
+
+	if ( ret == 0 )
+	{
+		ret = ipa_nat_set_scrub(SCRUB_MS, false);
+	}
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	usleep(SCRUB_MS * 10 * 1000);
+
+	ret = ipa_nat_set_scrub(0, false);
+
+	if ( ret == 0 )
+	{
+		ret = ipa_nati_ipv4_tbl_stats(
+			ctx_ptr->tbl_hdl, &stats[USE_NAT_TABLE], &stats[USE_INDEX_TABLE]);
+	}
+
+	if ( ret )
+	{
+		return ret;
+	}
+
+	IPAINFO("scrub: %u runs, %u errors, %u repaired\n",
+			stats[USE_NAT_TABLE].scrub_runs,
+			stats[USE_NAT_TABLE].scrub_errors,
+			stats[USE_NAT_TABLE].scrub_repaired);
+
+	if ( stats[USE_NAT_TABLE].scrub_runs   <= start_ptr[USE_NAT_TABLE].scrub_runs ||
+		 stats[USE_NAT_TABLE].scrub_errors != start_ptr[USE_NAT_TABLE].scrub_errors )
+	{
+		IPAERR("scrub did not run, or found errors\n");
+		return -1;
+	}
+
+	for ( which = USE_NAT_TABLE; which < USE_MAX; which++ )
+	{
+		if ( stats[which].tot_base_ents_filled != start_ptr[which].tot_base_ents_filled ||
+			 stats[which].tot_expn_ents_filled != start_ptr[which].tot_expn_ents_filled )
+		{
+			IPAERR("table %u holds %u base and %u expn entries, %u and %u "
+				   "before the test\n",
+				   which,
+				   stats[which].tot_base_ents_filled,
+				   stats[which].tot_expn_ents_filled,
+				   start_ptr[which].tot_base_ents_filled,
+				   start_ptr[which].tot_expn_ents_filled);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int ipa_nat_test032(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nati_tbl_stats start[USE_MAX];
+	verify_ctx         ctx;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	ctx.tbl_hdl = tbl_hdl;
+
+	ctx.coll[0].protocol     = IPPROTO_UDP;
+	ctx.coll[0].private_ip   = RAN_ADDR;
+	ctx.coll[0].private_port = RAN_PORT;
+	ctx.coll[0].target_ip    = RAN_ADDR;
+	ctx.coll[0].target_port  = RAN_PORT;
+	ctx.coll[0].public_port  = RAN_PORT;
+
+	ret = verify_clean(&ctx, "start");
+
+	if ( ret == 0 )
+	{
+		ret = ipa_nati_ipv4_tbl_stats(
+			tbl_hdl, &start[USE_NAT_TABLE], &start[USE_INDEX_TABLE]);
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = add_rules(&ctx);
+
+	if ( ret == 0 )
+	{
+		ret = break_and_repair(&ctx);
+	}
+
+	del_rules(&ctx);
+
+	if ( ret == 0 )
+	{
+		ret = check_scrub(&ctx, start);
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -309,7 +309,7 @@ _dispUsage(
 	const char* progNamePtr )
 {
 	printf(
-		"Usage: %s [-d -r N -i N -e N -m mt]\n"
+		"Usage: %s [-d -r N -i N -e N -m mt -s N]\n"
 		"Where:\n"
 		"  -d     Each test is discrete (create table, add rules, destroy table)\n"
 		"         If not specified, only one table create and destroy for all tests\n"
@@ -318,12 +318,15 @@ _dispUsage(
 		"  -e N   Where N is the number of entries in the NAT\n"
 		"  -m mt  Where mt is the type of memory to use for the NAT\n"
 		"         Legal mt's: DDR, SRAM, or HYBRID (ie. use SRAM and DDR)\n"
-		"  -g M-N Run tests M through N only\n",
+		"  -g M-N Run tests M through N only\n"
+		"  -s N   Where N is the number of operations in the stress test\n",
 		progNamePtr);
 
 	fflush(stdout);
 }
 
+u32 nat_stress_ops = 100000;
+
 static NatTests nt_array[] = {
 	NAT_TEST_ENTRY(ipa_nat_test000, 1, 0),
 	NAT_TEST_ENTRY(ipa_nat_test001, 1, 0),
@@ -351,6 +354,13 @@ static NatTests nt_array[] = {
 	NAT_TEST_ENTRY(ipa_nat_test023, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test024, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test025, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test026, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test027, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test028, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test029, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test030, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test031, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test032, IPA_NAT_TEST_PRE_COND_TE, 0),
 	/*
 	 * Add new tests just above this comment. Keep the following two
 	 * at the end...
@@ -386,7 +396,7 @@ int main(
 
 	IPADBG("Testing user space nat driver\n");
 
-	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:?")) != -1 )
+	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:s:?")) != -1 )
 	{
 		switch (c)
 		{
@@ -413,6 +423,9 @@ int main(
 		case 'h':
 			ht = atoi(optarg);
 			break;
+		case 's':
+			nat_stress_ops = atoi(optarg);
+			break;
 		case 'g':
 			if ( sscanf(optarg, "%u-%u", &start, &end) != 2
 				 ||
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "TestBase.h"
+#include "TestsUtils.h"
+#include "linux/msm_ipa.h"
+#include "ipa_odl_uapi.h"
+
+#define ADPL_DEV_NAME "/dev/ipa_adpl"
+/* data area size, requested through the mmap() length */
+#define ADPL_RING_DATA_SZ (1024 * 1024)
+#define ADPL_RING_RUN_SEC 10
+#define ADPL_RING_POLL_MSEC 100
+
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Consumes DPL packets from the mmap()ed ADPL ring for a fixed period,
+ * checks every record is well formed and reports the delivery rate.
+ * Needs DPL logging enabled on the modem and DIAG not holding the device.
+ */
+class AdplRingReadTest: public TestBase {
+public:
+	AdplRingReadTest() :
+		m_fd(-1),
+		m_map(MAP_FAILED),
+		m_mapSize(0)
+	{
+		m_name = "AdplRingReadTest";
+		m_description = "Read ADPL packets through the mmap ring and "
+				"measure packets per second";
+		m_testSuiteName.push_back("Adpl");
+		m_runInRegression = false;
+		Claim(ADPL_DEV_NAME);
+		m_minIPAHwType = IPA_HW_v4_1;
+		Register(*this);
+	}
+
+	bool Setup()
+	{
+		m_fd = open(ADPL_DEV_NAME, O_RDWR);
+		if (m_fd < 0) {
+			LOG_MSG_ERROR("Failed to open %s\n", ADPL_DEV_NAME);
+			return false;
+		}
+
+		m_mapSize = sysconf(_SC_PAGESIZE) + ADPL_RING_DATA_SZ;
+		m_map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED, m_fd, 0);
+		if (m_map == MAP_FAILED) {
+			LOG_MSG_ERROR("Failed to mmap the ADPL ring\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Teardown()
+	{
+		if (m_map != MAP_FAILED)
+			munmap(m_map, m_mapSize);
+		m_map = MAP_FAILED;
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+		return true;
+	}
+
+	bool Run()
+	{
+		struct ipa_odl_ring_ctrl *ctrl = (struct ipa_odl_ring_ctrl *)m_map;
+		uint8_t *data;
+		uint64_t head, tail, mask;
+		uint64_t pkts = 0, bytes = 0, dropped;
+		struct pollfd pfd;
+		struct timespec start, now;
+		double secs;
+
+		if (ctrl->magic != IPA_ODL_RING_MAGIC ||
+			ctrl->version != IPA_ODL_RING_VERSION ||
+			ctrl->data_size != ADPL_RING_DATA_SZ) {
+			LOG_MSG_ERROR("Bad ring header magic 0x%x version %u size %u\n",
+				ctrl->magic, ctrl->version, ctrl->data_size);
+			return false;
+		}
+
+		data = (uint8_t *)m_map + ctrl->data_offset;
+		mask = ctrl->data_size - 1;
+		dropped = ctrl->dropped_pkts;
+		tail = ctrl->tail;
+
+		pfd.fd = m_fd;
+		pfd.events = POLLIN;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do {
+			if (poll(&pfd, 1, ADPL_RING_POLL_MSEC) < 0) {
+				LOG_MSG_ERROR("poll failed\n");
+				return false;
+			}
+
+			head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+			if (head - tail > ctrl->data_size) {
+				LOG_MSG_ERROR("Bad head %llu tail %llu\n",
+					(unsigned long long)head,
+					(unsigned long long)tail);
+				return false;
+			}
+
+			while (tail != head) {
+				uint64_t ofst = tail & mask;
+				struct ipa_odl_ring_rec *rec =
+					(struct ipa_odl_ring_rec *)(data + ofst);
+				uint64_t recLen = sizeof(*rec) + rec->len;
+
+				if (ofst + recLen > ctrl->data_size ||
+					tail + recLen > head) {
+					LOG_MSG_ERROR("Bad record at %llu len %u\n",
+						(unsigned long long)tail, rec->len);
+					return false;
+				}
+
+				if (!(rec->flags & IPA_ODL_RING_REC_F_PAD)) {
+					pkts++;
+					bytes += rec->len;
+				}
+				tail += (recLen + IPA_ODL_RING_REC_ALIGN - 1) &
+					~(uint64_t)(IPA_ODL_RING_REC_ALIGN - 1);
+			}
+			__atomic_store_n(&ctrl->tail, tail, __ATOMIC_RELEASE);
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			secs = (now.tv_sec - start.tv_sec) +
+				(now.tv_nsec - start.tv_nsec) / 1e9;
+		} while (secs < ADPL_RING_RUN_SEC);
+
+		dropped = ctrl->dropped_pkts - dropped;
+		LOG_MSG_INFO("ADPL ring: %llu pkts %llu bytes in %.2f sec, "
+			"%.0f pkts/s %.0f bytes/s, %llu dropped\n",
+			(unsigned long long)pkts, (unsigned long long)bytes, secs,
+			pkts / secs, bytes / secs, (unsigned long long)dropped);
+		if (!pkts) {
+			LOG_MSG_ERROR("No DPL traffic seen, is DPL logging enabled?\n");
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	int m_fd;
+	void *m_map;
+	size_t m_mapSize;
+};
+
+static AdplRingReadTest adplRingReadTest;
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                  EOF                                      ////
+/////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+#include "RoutingDriverWrapper.h"
+#include "HeaderInsertion.h"
+#include "Filtering.h"
+#include "TestBase.h"
+#include "TestsUtils.h"
+#include "linux/msm_ipa.h"
+#include "ipa_batch_uapi.h"
+
+#define BATCH_DEV_NAME "/dev/ipa"
+#define BATCH_HDR_NAME "BatchHdr"
+#define BATCH_RT_TBL_NAME "Batch0"
+#define BATCH_BAD_RT_TBL_NAME "Batch1"
+/* no handle the driver hands out */
+#define BATCH_BAD_HDR_HDL 0xFFFFFFF0
+
+enum {
+	BATCH_OP_HDR,
+	BATCH_OP_RT,
+	BATCH_OP_FLT,
+	BATCH_OP_BAD_RT,
+	BATCH_OP_MAX
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Builds the batch both tests use: a header, a routing rule that takes the
+ * header by referring to its op, and a filtering rule on the producer pipe
+ * that takes the routing rule's table by referring to that op. Traffic
+ * from INTERFACE0 then reaches INTERFACE1 with the header in front, which
+ * only happens when both references resolved.
+ */
+class IpaBatchTestFixture: public TestBase {
+public:
+	IpaBatchTestFixture() :
+		m_fd(-1),
+		m_sendSize(0)
+	{
+		memset(m_sendBuffer, 0, sizeof(m_sendBuffer));
+		m_testSuiteName.push_back("Batch");
+		Claim(TEST_RES_SCENARIO);
+		Claim(TEST_RES_RT_FLT);
+	}
+
+	bool Setup()
+	{
+		ConfigureScenario(PHASE_FIVE_TEST_CONFIGURATION);
+
+		m_producer.Open(INTERFACE0_TO_IPA_DATA_PATH,
+				INTERFACE0_FROM_IPA_DATA_PATH);
+		m_consumer.Open(INTERFACE1_TO_IPA_DATA_PATH,
+				INTERFACE1_FROM_IPA_DATA_PATH);
+
+		if (!m_headerInsertion.DeviceNodeIsOpened()) {
+			LOG_MSG_ERROR("Header Insertion block is not ready for immediate commands!\n");
+			return false;
+		}
+
+		m_fd = open(BATCH_DEV_NAME, O_RDWR);
+		if (m_fd < 0) {
+			LOG_MSG_ERROR("Failed to open %s\n", BATCH_DEV_NAME);
+			return false;
+		}
+
+		/* resets the routing and filtering tables too */
+		m_headerInsertion.Reset();
+
+		return true;
+	}
+
+	bool Teardown()
+	{
+		m_headerInsertion.Reset();
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+		m_producer.Close();
+		m_consumer.Close();
+		return true;
+	}
+
+protected:
+	static const size_t BUFF_MAX_SIZE = 1024;
+
+	void BuildOps(struct ipa_ioc_batch_op *ops)
+	{
+		memset(ops, 0, BATCH_OP_MAX * sizeof(*ops));
+		memset(&m_hdr, 0, sizeof(m_hdr));
+		memset(&m_rt, 0, sizeof(m_rt));
+		memset(&m_flt, 0, sizeof(m_flt));
+		memset(&m_badRt, 0, sizeof(m_badRt));
+
+		strlcpy(m_hdr.name, BATCH_HDR_NAME, sizeof(m_hdr.name));
+		memcpy(m_hdr.hdr, s_header, sizeof(s_header));
+		m_hdr.hdr_len = sizeof(s_header);
+		m_hdr.is_partial = false;
+		ops[BATCH_OP_HDR].type = IPA_BATCH_OP_ADD_HDR;
+		ops[BATCH_OP_HDR].ref = IPA_BATCH_NO_REF;
+		ops[BATCH_OP_HDR].pyld_size = sizeof(m_hdr);
+		ops[BATCH_OP_HDR].pyld = (uintptr_t)&m_hdr;
+
+		/* hdr_hdl comes from the header op */
+		m_rt.at_rear = 1;
+		m_rt.rule.dst = IPA_CLIENT_TEST2_CONS;
+		m_rt.rule.attrib.attrib_mask = 0;
+		ops[BATCH_OP_RT].type = IPA_BATCH_OP_ADD_RT_RULE;
+		ops[BATCH_OP_RT].ip = IPA_IP_v4;
+		ops[BATCH_OP_RT].ref = BATCH_OP_HDR;
+		strlcpy(ops[BATCH_OP_RT].rt_tbl_name, BATCH_RT_TBL_NAME,
+			sizeof(ops[BATCH_OP_RT].rt_tbl_name));
+		ops[BATCH_OP_RT].pyld_size = sizeof(m_rt);
+		ops[BATCH_OP_RT].pyld = (uintptr_t)&m_rt;
+
+		/* rt_tbl_hdl comes from the routing op */
+		m_flt.at_rear = 1;
+		m_flt.rule.action = IPA_PASS_TO_ROUTING;
+		m_flt.rule.attrib.attrib_mask = 0;
+		ops[BATCH_OP_FLT].type = IPA_BATCH_OP_ADD_FLT_RULE;
+		ops[BATCH_OP_FLT].ip = IPA_IP_v4;
+		ops[BATCH_OP_FLT].ref = BATCH_OP_RT;
+		ops[BATCH_OP_FLT].ep = IPA_CLIENT_TEST_PROD;
+		ops[BATCH_OP_FLT].pyld_size = sizeof(m_flt);
+		ops[BATCH_OP_FLT].pyld = (uintptr_t)&m_flt;
+
+		/* well formed, but the driver finds no such header */
+		m_badRt.at_rear = 1;
+		m_badRt.rule.dst = IPA_CLIENT_TEST2_CONS;
+		m_badRt.rule.hdr_hdl = BATCH_BAD_HDR_HDL;
+		ops[BATCH_OP_BAD_RT].type = IPA_BATCH_OP_ADD_RT_RULE;
+		ops[BATCH_OP_BAD_RT].ip = IPA_IP_v4;
+		ops[BATCH_OP_BAD_RT].ref = IPA_BATCH_NO_REF;
+		strlcpy(ops[BATCH_OP_BAD_RT].rt_tbl_name, BATCH_BAD_RT_TBL_NAME,
+			sizeof(ops[BATCH_OP_BAD_RT].rt_tbl_name));
+		ops[BATCH_OP_BAD_RT].pyld_size = sizeof(m_badRt);
+		ops[BATCH_OP_BAD_RT].pyld = (uintptr_t)&m_badRt;
+	}
+
+	int RunBatch(struct ipa_ioc_batch_op *ops, uint32_t numOps,
+		struct ipa_ioc_batch *batch)
+	{
+		memset(batch, 0, sizeof(*batch));
+		batch->num_ops = numOps;
+		batch->ops = (uintptr_t)ops;
+
+		return ioctl(m_fd, IPA_IOC_BATCH, batch);
+	}
+
+	bool HeaderExists()
+	{
+		struct ipa_ioc_get_hdr getHdr;
+
+		memset(&getHdr, 0, sizeof(getHdr));
+		strlcpy(getHdr.name, BATCH_HDR_NAME, sizeof(getHdr.name));
+
+		return m_headerInsertion.GetHeaderHandle(&getHdr);
+	}
+
+	bool RoutingTableExists(const char *name, uint32_t *hdl)
+	{
+		struct ipa_ioc_get_rt_tbl getTbl;
+
+		memset(&getTbl, 0, sizeof(getTbl));
+		getTbl.ip = IPA_IP_v4;
+		strlcpy(getTbl.name, name, sizeof(getTbl.name));
+		if (!m_routing.GetRoutingTable(&getTbl))
+			return false;
+
+		if (hdl)
+			*hdl = getTbl.hdl;
+		return true;
+	}
+
+	int m_fd;
+	RoutingDriverWrapper m_routing;
+	HeaderInsertion m_headerInsertion;
+	InterfaceAbstraction m_producer;
+	InterfaceAbstraction m_consumer;
+	struct ipa_hdr_add m_hdr;
+	struct ipa_rt_rule_add_v2 m_rt;
+	struct ipa_flt_rule_add_v2 m_flt;
+	struct ipa_rt_rule_add_v2 m_badRt;
+	uint8_t m_sendBuffer[BUFF_MAX_SIZE];
+	size_t m_sendSize;
+	static const uint8_t s_header[6];
+};
+
+const uint8_t IpaBatchTestFixture::s_header[6] = {
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+};
+
+/*---------------------------------------------------------------------------*/
+/* Test001: a header, a routing rule and a filtering rule in one batch       */
+/*---------------------------------------------------------------------------*/
+class IpaBatchTest001: public IpaBatchTestFixture {
+public:
+	IpaBatchTest001()
+	{
+		m_name = "IpaBatchTest001";
+		m_description =
+			"Batch Test 001 - header, routing and filtering in one batch\
+			1. Add a header, a routing rule referring to the header and a \
+			filtering rule referring to the routing rule in one IPA_IOC_BATCH. \
+			2. Check every op is applied and has a handle. \
+			3. Send a packet and check it arrives with the header.";
+		Register(*this);
+	}
+
+	bool Run()
+	{
+		struct ipa_ioc_batch_op ops[BATCH_OP_MAX];
+		struct ipa_ioc_batch batch;
+		uint8_t expected[BUFF_MAX_SIZE + sizeof(s_header)];
+		uint32_t tblHdl;
+		int i;
+
+		BuildOps(ops);
+
+		if (RunBatch(ops, BATCH_OP_BAD_RT, &batch)) {
+			LOG_MSG_ERROR("IPA_IOC_BATCH failed at op %u\n",
+				batch.failed_op);
+			return false;
+		}
+
+		if (batch.failed_op != IPA_BATCH_NO_REF) {
+			LOG_MSG_ERROR("Batch succeeded but reports op %u failed\n",
+				batch.failed_op);
+			return false;
+		}
+
+		for (i = 0; i < BATCH_OP_BAD_RT; i++) {
+			if (ops[i].status || !ops[i].hdl) {
+				LOG_MSG_ERROR("Op %d status %d hdl 0x%x\n",
+					i, ops[i].status, ops[i].hdl);
+				return false;
+			}
+		}
+
+		if (!HeaderExists() ||
+			!RoutingTableExists(BATCH_RT_TBL_NAME, &tblHdl)) {
+			LOG_MSG_ERROR("Header or routing table missing after the batch\n");
+			return false;
+		}
+
+		m_sendSize = BUFF_MAX_SIZE;
+		if (!LoadDefaultPacket(IPA_IP_v4, m_sendBuffer, m_sendSize)) {
+			LOG_MSG_ERROR("Failed default Packet\n");
+			return false;
+		}
+
+		/* the header only shows when both references resolved */
+		memcpy(expected, s_header, sizeof(s_header));
+		memcpy(expected + sizeof(s_header), m_sendBuffer, m_sendSize);
+		if (!SendReceiveAndCompare(&m_producer, m_sendBuffer, m_sendSize,
+			&m_consumer, expected, m_sendSize + sizeof(s_header))) {
+			LOG_MSG_ERROR("SendReceiveAndCompare failed.\n");
+			return false;
+		}
+
+		return true;
+	}
+};
+
+/*---------------------------------------------------------------------------*/
+/* Test002: an op that fails rolls back the ops applied before it            */
+/*---------------------------------------------------------------------------*/
+class IpaBatchTest002: public IpaBatchTestFixture {
+public:
+	IpaBatchTest002()
+	{
+		m_name = "IpaBatchTest002";
+		m_description =
+			"Batch Test 002 - roll back on a failed op\
+			1. Send the batch of test 001 followed by a routing rule \
+			naming a header that does not exist. \
+			2. Check the batch fails at that op and no op is left applied. \
+			3. Check the header and the routing table are gone.";
+		Register(*this);
+	}
+
+	bool Run()
+	{
+		struct ipa_ioc_batch_op ops[BATCH_OP_MAX];
+		struct ipa_ioc_batch batch;
+		int i;
+
+		BuildOps(ops);
+
+		if (!RunBatch(ops, BATCH_OP_MAX, &batch)) {
+			LOG_MSG_ERROR("IPA_IOC_BATCH succeeded with a bad op\n");
+			return false;
+		}
+
+		if (batch.failed_op != BATCH_OP_BAD_RT) {
+			LOG_MSG_ERROR("Batch reports op %u failed, expected %d\n",
+				batch.failed_op, BATCH_OP_BAD_RT);
+			return false;
+		}
+
+		for (i = 0; i < BATCH_OP_MAX; i++) {
+			if (!ops[i].status || ops[i].hdl) {
+				LOG_MSG_ERROR("Op %d left applied, status %d hdl 0x%x\n",
+					i, ops[i].status, ops[i].hdl);
+				return false;
+			}
+		}
+
+		/* the filtering rule went first, so the table lost its last user */
+		if (HeaderExists() ||
+			RoutingTableExists(BATCH_RT_TBL_NAME, NULL) ||
+			RoutingTableExists(BATCH_BAD_RT_TBL_NAME, NULL)) {
+			LOG_MSG_ERROR("Header or routing table left after roll back\n");
+			return false;
+		}
+
+		return true;
+	}
+};
+
+static IpaBatchTest001 ipaBatchTest001;
+static IpaBatchTest002 ipaBatchTest002;
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                  EOF                                      ////
+/////////////////////////////////////////////////////////////////////////////////
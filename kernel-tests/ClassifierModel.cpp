@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <string.h>
+#include "ClassifierModel.h"
+
+#define IPV4_MF_FLAG 0x20
+#define IPV4_FRAG_OFST_MASK 0x1fff
+#define IPV6_FRAG_NEXT_HDR 44
+#define TCP_SYN_FLAG 0x02
+
+/* attributes Match() knows how to evaluate, per IP family */
+#define MODEL_COMMON_ATTRIBS (IPA_FLT_SRC_ADDR | IPA_FLT_DST_ADDR | \
+	IPA_FLT_SRC_PORT | IPA_FLT_DST_PORT | IPA_FLT_SRC_PORT_RANGE | \
+	IPA_FLT_DST_PORT_RANGE | IPA_FLT_TYPE | IPA_FLT_CODE | IPA_FLT_SPI | \
+	IPA_FLT_TCP_SYN | IPA_FLT_FRAGMENT | IPA_FLT_META_DATA)
+#define MODEL_V4_ATTRIBS (MODEL_COMMON_ATTRIBS | IPA_FLT_TOS | \
+	IPA_FLT_TOS_MASKED | IPA_FLT_PROTOCOL)
+#define MODEL_V6_ATTRIBS (MODEL_COMMON_ATTRIBS | IPA_FLT_TC | \
+	IPA_FLT_FLOW_LABEL | IPA_FLT_NEXT_HDR)
+
+/*Fields of the packet the HW equations look at, in host order.*/
+struct ClassifierModel::Packet {
+	enum ipa_ip_type ip;
+	bool valid;
+	uint8_t tos;
+	uint8_t proto;
+	uint32_t flowLabel;
+	bool frag;
+	uint32_t src[4];
+	uint32_t dst[4];
+	const uint8_t *l4;
+	size_t l4Len;
+	uint32_t metadata;
+};
+
+static uint32_t GetBe32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t GetBe16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+ClassifierModel::ClassifierModel() :
+	m_hashable(true),
+	m_defaultClient(IPA_CLIENT_APPS_LAN_CONS),
+	m_nextHdl(0x80000000)
+{
+}
+
+ClassifierModel::RtTable &ClassifierModel::GetRtTable(enum ipa_ip_type ip,
+	const string &name)
+{
+	list < RtTable >::iterator it;
+	RtTable tbl;
+
+	for (it = m_rtTables.begin(); it != m_rtTables.end(); it++)
+		if (it->ip == ip && it->name == name)
+			return *it;
+
+	tbl.ip = ip;
+	tbl.name = name;
+	tbl.hdl = 0;
+	m_rtTables.push_back(tbl);
+	return m_rtTables.back();
+}
+
+template <typename T>
+void ClassifierModel::AddRtRule(RtTable &tbl, const T &add)
+{
+	Rule r;
+
+	/* the driver refused it, so does the HW */
+	if (add.status)
+		return;
+
+	memset(&r, 0, sizeof(r));
+	r.hdl = add.rt_rule_hdl ? add.rt_rule_hdl : m_nextHdl++;
+	r.attrib = add.rule.attrib;
+	r.hashable = m_hashable && add.rule.hashable;
+	r.maxPrio = add.rule.max_prio;
+	r.ruleId = add.rule.rule_id;
+	r.dst = add.rule.dst;
+	r.hdrHdl = add.rule.hdr_hdl;
+
+	if (add.at_rear)
+		tbl.rules.push_back(r);
+	else
+		tbl.rules.push_front(r);
+}
+
+void ClassifierModel::AddRoutingRules(const struct ipa_ioc_add_rt_rule *ruleTable)
+{
+	RtTable &tbl = GetRtTable(ruleTable->ip, ruleTable->rt_tbl_name);
+
+	for (int i = 0; i < ruleTable->num_rules; i++)
+		AddRtRule(tbl, ruleTable->rules[i]);
+}
+
+void ClassifierModel::AddRoutingRules(const struct ipa_ioc_add_rt_rule_v2 *ruleTable)
+{
+	RtTable &tbl = GetRtTable(ruleTable->ip, ruleTable->rt_tbl_name);
+	const struct ipa_rt_rule_add_v2 *rules =
+		(const struct ipa_rt_rule_add_v2 *)ruleTable->rules;
+
+	for (int i = 0; i < ruleTable->num_rules; i++)
+		AddRtRule(tbl, rules[i]);
+}
+
+void ClassifierModel::DeleteRoutingRules(const struct ipa_ioc_del_rt_rule *ruleTable)
+{
+	list < RtTable >::iterator tbl;
+	list < Rule >::iterator r;
+
+	for (int i = 0; i < ruleTable->num_hdls; i++) {
+		if (ruleTable->hdl[i].status)
+			continue;
+		for (tbl = m_rtTables.begin(); tbl != m_rtTables.end(); tbl++)
+			for (r = tbl->rules.begin(); r != tbl->rules.end(); r++)
+				if (r->hdl == ruleTable->hdl[i].hdl) {
+					tbl->rules.erase(r);
+					break;
+				}
+	}
+}
+
+void ClassifierModel::ResetRouting(enum ipa_ip_type ip)
+{
+	list < RtTable >::iterator it = m_rtTables.begin();
+
+	while (it != m_rtTables.end()) {
+		if (it->ip == ip)
+			it = m_rtTables.erase(it);
+		else
+			it++;
+	}
+}
+
+bool ClassifierModel::GetRoutingTable(struct ipa_ioc_get_rt_tbl *routingTable,
+	bool fromDriver)
+{
+	list < RtTable >::iterator it;
+
+	for (it = m_rtTables.begin(); it != m_rtTables.end(); it++) {
+		if (it->ip != routingTable->ip || it->name != routingTable->name)
+			continue;
+		if (fromDriver)
+			it->hdl = routingTable->hdl;
+		else if (!it->hdl)
+			it->hdl = m_nextHdl++;
+		routingTable->hdl = it->hdl;
+		return true;
+	}
+
+	return false;
+}
+
+template <typename T>
+void ClassifierModel::AddFltRule(enum ipa_ip_type ip, enum ipa_client_type ep,
+	const T &add)
+{
+	list < Rule > &tbl = m_fltTables[make_pair((int)ip, (int)ep)];
+	Rule r;
+
+	if (add.status)
+		return;
+
+	memset(&r, 0, sizeof(r));
+	r.hdl = add.flt_rule_hdl ? add.flt_rule_hdl : m_nextHdl++;
+	r.attrib = add.rule.attrib;
+	r.eqAttrib = add.rule.eq_attrib_type;
+	r.hashable = m_hashable && add.rule.hashable;
+	r.maxPrio = add.rule.max_prio;
+	r.ruleId = add.rule.rule_id;
+	r.action = add.rule.action;
+	r.rtTblHdl = add.rule.rt_tbl_hdl;
+
+	if (add.at_rear)
+		tbl.push_back(r);
+	else
+		tbl.push_front(r);
+}
+
+void ClassifierModel::AddFilteringRules(const struct ipa_ioc_add_flt_rule *ruleTable)
+{
+	for (int i = 0; i < ruleTable->num_rules; i++)
+		AddFltRule(ruleTable->ip, ruleTable->ep, ruleTable->rules[i]);
+}
+
+void ClassifierModel::AddFilteringRules(const struct ipa_ioc_add_flt_rule_v2 *ruleTable)
+{
+	const struct ipa_flt_rule_add_v2 *rules =
+		(const struct ipa_flt_rule_add_v2 *)ruleTable->rules;
+
+	for (int i = 0; i < ruleTable->num_rules; i++)
+		AddFltRule(ruleTable->ip, ruleTable->ep, rules[i]);
+}
+
+void ClassifierModel::DeleteFilteringRules(const struct ipa_ioc_del_flt_rule *ruleTable)
+{
+	map < pair < int, int >, list < Rule > >::iterator tbl;
+	list < Rule >::iterator r;
+
+	for (int i = 0; i < ruleTable->num_hdls; i++) {
+		if (ruleTable->hdl[i].status)
+			continue;
+		for (tbl = m_fltTables.begin(); tbl != m_fltTables.end(); tbl++)
+			for (r = tbl->second.begin(); r != tbl->second.end(); r++)
+				if (r->hdl == ruleTable->hdl[i].hdl) {
+					tbl->second.erase(r);
+					break;
+				}
+	}
+}
+
+void ClassifierModel::ResetFiltering(enum ipa_ip_type ip)
+{
+	map < pair < int, int >, list < Rule > >::iterator it = m_fltTables.begin();
+
+	while (it != m_fltTables.end()) {
+		if (it->first.first == ip)
+			m_fltTables.erase(it++);
+		else
+			it++;
+	}
+}
+
+/*One attribute set against one packet, mirroring the equations of
+ *ipa_fltrt_generate_hw_rule_bdy_ip4/ip6(). Fields beyond the end of
+ *the packet never match.
+ */
+bool ClassifierModel::Match(const struct ipa_rule_attrib &attrib,
+	const Packet &p, bool &supported)
+{
+	uint32_t mask = attrib.attrib_mask;
+	uint32_t known = (p.ip == IPA_IP_v4) ? MODEL_V4_ATTRIBS : MODEL_V6_ATTRIBS;
+	uint16_t port;
+	int i;
+
+	if ((mask & ~known) || attrib.ext_attrib_mask) {
+		supported = false;
+		return false;
+	}
+
+	if ((mask & IPA_FLT_TOS) && p.tos != attrib.u.v4.tos)
+		return false;
+	if ((mask & IPA_FLT_TOS_MASKED) &&
+		(p.tos & attrib.tos_mask) != attrib.tos_value)
+		return false;
+	if ((mask & IPA_FLT_PROTOCOL) && p.proto != attrib.u.v4.protocol)
+		return false;
+	if ((mask & IPA_FLT_TC) && p.tos != attrib.u.v6.tc)
+		return false;
+	if ((mask & IPA_FLT_FLOW_LABEL) && p.flowLabel != attrib.u.v6.flow_label)
+		return false;
+	if ((mask & IPA_FLT_NEXT_HDR) && p.proto != attrib.u.v6.next_hdr)
+		return false;
+
+	if (p.ip == IPA_IP_v4) {
+		if ((mask & IPA_FLT_SRC_ADDR) &&
+			(p.src[0] & attrib.u.v4.src_addr_mask) != attrib.u.v4.src_addr)
+			return false;
+		if ((mask & IPA_FLT_DST_ADDR) &&
+			(p.dst[0] & attrib.u.v4.dst_addr_mask) != attrib.u.v4.dst_addr)
+			return false;
+	} else {
+		for (i = 0; i < 4; i++) {
+			if ((mask & IPA_FLT_SRC_ADDR) &&
+				(p.src[i] & attrib.u.v6.src_addr_mask[i]) !=
+				attrib.u.v6.src_addr[i])
+				return false;
+			if ((mask & IPA_FLT_DST_ADDR) &&
+				(p.dst[i] & attrib.u.v6.dst_addr_mask[i]) !=
+				attrib.u.v6.dst_addr[i])
+				return false;
+		}
+	}
+
+	if ((mask & IPA_FLT_FRAGMENT) && !p.frag)
+		return false;
+	if ((mask & IPA_FLT_META_DATA) &&
+		(p.metadata & attrib.meta_data_mask) != attrib.meta_data)
+		return false;
+
+	if (mask & (IPA_FLT_SRC_PORT | IPA_FLT_SRC_PORT_RANGE)) {
+		if (p.l4Len < 2)
+			return false;
+		port = GetBe16(p.l4);
+		if ((mask & IPA_FLT_SRC_PORT) && port != attrib.src_port)
+			return false;
+		if ((mask & IPA_FLT_SRC_PORT_RANGE) &&
+			(port < attrib.src_port_lo || port > attrib.src_port_hi))
+			return false;
+	}
+	if (mask & (IPA_FLT_DST_PORT | IPA_FLT_DST_PORT_RANGE)) {
+		if (p.l4Len < 4)
+			return false;
+		port = GetBe16(p.l4 + 2);
+		if ((mask & IPA_FLT_DST_PORT) && port != attrib.dst_port)
+			return false;
+		if ((mask & IPA_FLT_DST_PORT_RANGE) &&
+			(port < attrib.dst_port_lo || port > attrib.dst_port_hi))
+			return false;
+	}
+	if ((mask & IPA_FLT_TYPE) && (p.l4Len < 1 || p.l4[0] != attrib.type))
+		return false;
+	if ((mask & IPA_FLT_CODE) && (p.l4Len < 2 || p.l4[1] != attrib.code))
+		return false;
+	if ((mask & IPA_FLT_SPI) && (p.l4Len < 4 || GetBe32(p.l4) != attrib.spi))
+		return false;
+	if ((mask & IPA_FLT_TCP_SYN) &&
+		(p.l4Len < 14 || !(p.l4[13] & TCP_SYN_FLAG)))
+		return false;
+
+	return true;
+}
+
+/*Returns the list index of the winning rule or -1.*/
+int ClassifierModel::Lookup(const list < Rule > &rules, const Packet &p,
+	bool &supported, const Rule **winner, uint16_t &prio)
+{
+	list < Rule >::const_iterator r;
+	uint16_t cur = 0;
+	int idx, best = -1;
+	uint16_t rulePrio;
+
+	*winner = NULL;
+	for (r = rules.begin(), idx = 0; r != rules.end(); r++, idx++) {
+		rulePrio = r->maxPrio ? 0 : ++cur;
+		if (r->eqAttrib) {
+			supported = false;
+			continue;
+		}
+		if (!Match(r->attrib, p, supported))
+			continue;
+		/* rules come in list order, so only a better priority or a
+		 * hashable rule tying a non-hashable one replaces the winner
+		 */
+		if (*winner && (rulePrio > prio || (rulePrio == prio &&
+			((*winner)->hashable || !r->hashable))))
+			continue;
+		*winner = &(*r);
+		prio = rulePrio;
+		best = idx;
+	}
+
+	return best;
+}
+
+ClassifierResult ClassifierModel::Classify(enum ipa_ip_type ip,
+	enum ipa_client_type src, const uint8_t *pkt, size_t len,
+	uint32_t metadata)
+{
+	ClassifierResult res;
+	map < pair < int, int >, list < Rule > >::iterator flt;
+	list < RtTable >::iterator tbl;
+	const Rule *winner;
+	Packet p;
+	size_t hdrLen;
+	int i;
+
+	res.supported = true;
+	res.fltIndex = -1;
+	res.fltPrio = 0;
+	res.fltHashable = false;
+	res.fltRuleId = 0;
+	res.action = IPA_PASS_TO_ROUTING;
+	res.rtIndex = -1;
+	res.rtPrio = 0;
+	res.rtHashable = false;
+	res.rtRuleId = 0;
+	res.hdrHdl = 0;
+	res.dst = m_defaultClient;
+
+	memset(&p, 0, sizeof(p));
+	p.ip = ip;
+	p.metadata = metadata;
+	if (ip == IPA_IP_v4) {
+		hdrLen = (len >= 1) ? (pkt[0] & 0xf) * 4 : 0;
+		if (len < 20 || (pkt[0] >> 4) != 4 || hdrLen < 20 || hdrLen > len) {
+			res.supported = false;
+			res.reason = "bad IPv4 header";
+			return res;
+		}
+		p.tos = pkt[1];
+		p.proto = pkt[9];
+		p.frag = (pkt[6] & IPV4_MF_FLAG) ||
+			(GetBe16(pkt + 6) & IPV4_FRAG_OFST_MASK);
+		p.src[0] = GetBe32(pkt + 12);
+		p.dst[0] = GetBe32(pkt + 16);
+	} else {
+		hdrLen = 40;
+		if (len < hdrLen || (pkt[0] >> 4) != 6) {
+			res.supported = false;
+			res.reason = "bad IPv6 header";
+			return res;
+		}
+		p.tos = (uint8_t)(((pkt[0] & 0xf) << 4) | (pkt[1] >> 4));
+		p.flowLabel = ((pkt[1] & 0xf) << 16) | GetBe16(pkt + 2);
+		p.proto = pkt[6];
+		p.frag = (p.proto == IPV6_FRAG_NEXT_HDR);
+		for (i = 0; i < 4; i++) {
+			p.src[i] = GetBe32(pkt + 8 + 4 * i);
+			p.dst[i] = GetBe32(pkt + 24 + 4 * i);
+		}
+	}
+	p.l4 = pkt + hdrLen;
+	p.l4Len = len - hdrLen;
+
+	flt = m_fltTables.find(make_pair((int)ip, (int)src));
+	if (flt == m_fltTables.end()) {
+		res.reason = "no filtering table";
+		return res;
+	}
+	res.fltIndex = Lookup(flt->second, p, res.supported, &winner,
+		res.fltPrio);
+	if (!winner) {
+		res.reason = "filtering miss";
+		return res;
+	}
+	res.fltHashable = winner->hashable;
+	res.fltRuleId = winner->ruleId;
+	res.action = winner->action;
+
+	if (res.action == IPA_PASS_TO_EXCEPTION) {
+		res.reason = "filtering exception";
+		return res;
+	}
+	if (res.action != IPA_PASS_TO_ROUTING) {
+		res.supported = false;
+		res.reason = "NAT action";
+		return res;
+	}
+
+	for (tbl = m_rtTables.begin(); tbl != m_rtTables.end(); tbl++)
+		if (tbl->ip == ip && tbl->hdl && tbl->hdl == winner->rtTblHdl)
+			break;
+	if (tbl == m_rtTables.end()) {
+		res.supported = false;
+		res.reason = "unknown routing table handle";
+		return res;
+	}
+	res.rtTblName = tbl->name;
+
+	res.rtIndex = Lookup(tbl->rules, p, res.supported, &winner, res.rtPrio);
+	if (!winner) {
+		res.reason = "routing miss";
+		return res;
+	}
+	res.rtHashable = winner->hashable;
+	res.rtRuleId = winner->ruleId;
+	res.hdrHdl = winner->hdrHdl;
+	res.dst = winner->dst;
+	res.reason = "routed";
+
+	return res;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#ifndef _CLASSIFIER_MODEL_H_
+#define _CLASSIFIER_MODEL_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include "linux/msm_ipa.h"
+
+using namespace std;
+
+/*Outcome of ClassifierModel::Classify() for a single packet.
+ *Indexes are positions in the model's rule lists (after at_rear
+ *placement), -1 when nothing matched.
+ */
+struct ClassifierResult {
+	/* false when a rule or the packet used something the model can't
+	 * evaluate, the rest of the result is then meaningless
+	 */
+	bool supported;
+	int fltIndex;
+	uint16_t fltPrio;
+	bool fltHashable;
+	uint16_t fltRuleId;
+	enum ipa_flt_action action;
+	string rtTblName;
+	int rtIndex;
+	uint16_t rtPrio;
+	bool rtHashable;
+	uint16_t rtRuleId;
+	uint32_t hdrHdl;
+	/* where the packet ends up, m_defaultClient on a miss */
+	enum ipa_client_type dst;
+	string reason;
+};
+
+/*Software model of the IPA filtering and routing lookup.
+ *
+ *It consumes the same ipa_ioc_add_flt_rule / ipa_ioc_add_rt_rule
+ *structures the tests hand to Filtering and RoutingDriverWrapper, and
+ *attaching it to those wrappers with SetModel() mirrors every
+ *successful add, delete, reset and table lookup. It can also be fed
+ *directly as a host only simulator.
+ *
+ *Priorities follow the driver: rules are kept in list order (at_rear
+ *appends, otherwise prepends), max_prio rules get the top priority
+ *and every other rule the next lower one in list order. The HW picks
+ *the matching rule with the best priority across the hashable and
+ *non-hashable parts of a table; on a tie (several max_prio rules) the
+ *model prefers the hashable part, then list order.
+ *
+ *Attribute matching follows the equations the driver generates, e.g.
+ *address rules compare (addr & mask) == value without masking the
+ *value, ports and ICMP type/code are read at the L4 offset whatever
+ *the protocol. IPv6 L4 fields are read right after the fixed header.
+ *Rules given as equations, NAT actions, and attributes not listed in
+ *ClassifierModel.cpp make the result unsupported.
+ */
+class ClassifierModel
+{
+public:
+	ClassifierModel();
+
+	/* IPA versions without hash support treat every rule as non-hashable */
+	void SetHashable(bool enable) { m_hashable = enable; }
+	/* pipe that takes filtering and routing misses and exceptions */
+	void SetDefaultClient(enum ipa_client_type client) { m_defaultClient = client; }
+
+	void AddRoutingRules(const struct ipa_ioc_add_rt_rule *ruleTable);
+	void AddRoutingRules(const struct ipa_ioc_add_rt_rule_v2 *ruleTable);
+	void DeleteRoutingRules(const struct ipa_ioc_del_rt_rule *ruleTable);
+	void ResetRouting(enum ipa_ip_type ip);
+	/* record the handle the driver gave the table, or make one up */
+	bool GetRoutingTable(struct ipa_ioc_get_rt_tbl *routingTable,
+		bool fromDriver = false);
+
+	void AddFilteringRules(const struct ipa_ioc_add_flt_rule *ruleTable);
+	void AddFilteringRules(const struct ipa_ioc_add_flt_rule_v2 *ruleTable);
+	void DeleteFilteringRules(const struct ipa_ioc_del_flt_rule *ruleTable);
+	void ResetFiltering(enum ipa_ip_type ip);
+
+	/* pkt is an IP packet as it enters filtering on pipe src */
+	ClassifierResult Classify(enum ipa_ip_type ip, enum ipa_client_type src,
+		const uint8_t *pkt, size_t len, uint32_t metadata = 0);
+
+private:
+	struct Rule {
+		uint32_t hdl;
+		struct ipa_rule_attrib attrib;
+		bool eqAttrib;
+		bool hashable;
+		bool maxPrio;
+		uint16_t ruleId;
+		/* filtering only */
+		enum ipa_flt_action action;
+		uint32_t rtTblHdl;
+		/* routing only */
+		enum ipa_client_type dst;
+		uint32_t hdrHdl;
+	};
+	struct RtTable {
+		enum ipa_ip_type ip;
+		string name;
+		uint32_t hdl;
+		list < Rule > rules;
+	};
+	struct Packet;
+
+	template <typename T> void AddRtRule(RtTable &tbl, const T &add);
+	template <typename T> void AddFltRule(enum ipa_ip_type ip,
+		enum ipa_client_type ep, const T &add);
+	RtTable &GetRtTable(enum ipa_ip_type ip, const string &name);
+	int Lookup(const list < Rule > &rules, const Packet &p,
+		bool &supported, const Rule **winner, uint16_t &prio);
+	bool Match(const struct ipa_rule_attrib &attrib, const Packet &p,
+		bool &supported);
+
+	bool m_hashable;
+	enum ipa_client_type m_defaultClient;
+	uint32_t m_nextHdl;
+	list < RtTable > m_rtTables;
+	/* filtering tables, one per (ip, ep) */
+	map < pair < int, int >, list < Rule > > m_fltTables;
+};
+
+#endif
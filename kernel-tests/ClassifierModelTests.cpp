@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <string>
+
+#include "InterfaceAbstraction.h"
+#include "Constants.h"
+#include "Logger.h"
+#include "TestsUtils.h"
+#include "RoutingDriverWrapper.h"
+#include "Filtering.h"
+#include "IPAFilteringTable.h"
+#include "ClassifierModel.h"
+
+#define DIFF_RT_TBL_A "DIFF_A"
+#define DIFF_RT_TBL_B "DIFF_B"
+#define DIFF_MAX_PKT 64
+#define DIFF_PAYLOAD_LEN 16
+#define DIFF_SRC_NET 0x0A000000 /* 10.0.x.x */
+#define DIFF_DST_NET 0xC0A80000 /* 192.168.x.x */
+#define DIFF_SRC_PORT_BASE 2000
+#define DIFF_DST_PORT_BASE 1000
+#define DIFF_RX_TIMEOUT_USEC (200 * 1000)
+#define DIFF_POLL_USEC 1000
+
+extern Logger g_Logger;
+
+static const uint8_t s_tosValues[] = { 0x00, 0x10, 0x28 };
+
+/*
+ * Differential test of the HW classifier against ClassifierModel.
+ *
+ * Random filtering and routing rules are added through wrappers that
+ * have the model attached, then random IPv4 packets are sent from
+ * TEST_PROD and each one must come out of the consumer the model
+ * predicts. Rules and packets are drawn from small address and port
+ * pools so that overlapping rules, priorities and at_rear placement
+ * are exercised. Every table ends with a catch-all rule so that
+ * nothing leaves the three test consumers. The seed is printed, set
+ * m_seed to replay a failure.
+ */
+class ClassifierModelDiffTest : public TestBase
+{
+public:
+	ClassifierModelDiffTest() :
+		m_seed(0x1A5EED),
+		m_numFltRules(24),
+		m_numRtRules(48),
+		m_numPackets(2000)
+	{
+		m_name = "ClassifierModelDiffTest";
+		m_description = "Classifier model differential test - "
+			"random filtering and routing rules, random IPv4 "
+			"packets from TEST_PROD, every packet must reach the "
+			"consumer predicted by the software model";
+		m_minIPAHwType = IPA_HW_v3_0;
+		m_testSuiteName.push_back("Routing");
+		m_runInRegression = false;
+		Claim(TEST_RES_SCENARIO);
+		Claim(TEST_RES_RT_FLT);
+		Register(*this);
+	}
+
+	bool Setup()
+	{
+		if (!SetupKernelModule())
+			return false;
+
+		m_producer.Open(INTERFACE0_TO_IPA_DATA_PATH, INTERFACE0_FROM_IPA_DATA_PATH);
+		m_consumers[0].Open(INTERFACE1_TO_IPA_DATA_PATH, INTERFACE1_FROM_IPA_DATA_PATH);
+		m_consumers[1].Open(INTERFACE2_TO_IPA_DATA_PATH, INTERFACE2_FROM_IPA_DATA_PATH);
+		m_consumers[2].Open(INTERFACE3_TO_IPA_DATA_PATH, INTERFACE3_FROM_IPA_DATA_PATH);
+
+		if (!m_routing.DeviceNodeIsOpened()) {
+			printf("Routing block is not ready for immediate commands!\n");
+			return false;
+		}
+		if (!m_filtering.DeviceNodeIsOpened()) {
+			printf("Filtering block is not ready for immediate commands!\n");
+			return false;
+		}
+
+		m_routing.Reset(IPA_IP_v4);
+		m_filtering.Reset(IPA_IP_v4);
+		m_routing.SetModel(&m_model);
+		m_filtering.SetModel(&m_model);
+
+		return true;
+	}
+
+	bool Teardown()
+	{
+		m_routing.SetModel(NULL);
+		m_filtering.SetModel(NULL);
+		m_model.ResetRouting(IPA_IP_v4);
+		m_model.ResetFiltering(IPA_IP_v4);
+
+		m_producer.Close();
+		for (int i = 0; i < 3; i++)
+			m_consumers[i].Close();
+
+		return true;
+	}
+
+	bool Run()
+	{
+		Byte pkt[DIFF_MAX_PKT];
+		Byte rx[0x400];
+		size_t len;
+		int got, received;
+		unsigned int mismatches = 0, unsupported = 0;
+		ClassifierResult res;
+
+		printf("%s: seed 0x%x, %u filtering rules, %u routing rules "
+			"per table, %u packets\n", m_name.c_str(), m_seed,
+			m_numFltRules, m_numRtRules, m_numPackets);
+		srand(m_seed);
+
+		if (!AddRoutingTable(DIFF_RT_TBL_A) ||
+			!AddRoutingTable(DIFF_RT_TBL_B) ||
+			!AddFilteringTable())
+			return false;
+
+		for (int i = 0; i < 3; i++)
+			m_consumers[i].setReadNoBlock();
+		/* nothing may be left over from a previous test */
+		for (int i = 0; i < 3; i++)
+			while (m_consumers[i].ReceiveSingleDataChunk(rx, sizeof(rx)) > 0)
+				;
+
+		for (unsigned int n = 0; n < m_numPackets; n++) {
+			len = BuildPacket(pkt, n);
+			res = m_model.Classify(IPA_IP_v4, IPA_CLIENT_TEST_PROD,
+				pkt, len);
+			if (!res.supported) {
+				printf("packet %u: model can't predict it (%s)\n",
+					n, res.reason.c_str());
+				unsupported++;
+				continue;
+			}
+
+			if ((size_t)m_producer.SendData(pkt, len) != len) {
+				printf("packet %u: SendData failure\n", n);
+				return false;
+			}
+			received = ReceiveAny(rx, sizeof(rx), got);
+
+			if (received < 0 || ToClient(received) != res.dst ||
+				(size_t)got != len || memcmp(rx, pkt, len)) {
+				mismatches++;
+				printf("packet %u: expected client %d (%s, flt rule %d "
+					"prio %u, rt table %s rule %d prio %u), got %s "
+					"(%d bytes)\n", n, res.dst, res.reason.c_str(),
+					res.fltIndex, res.fltPrio,
+					res.rtTblName.c_str(), res.rtIndex, res.rtPrio,
+					received < 0 ? "nothing" :
+					m_consumers[received].m_fromChannelName.c_str(),
+					got);
+				PrintPacket(pkt, len);
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+			m_consumers[i].clearReadNoBlock();
+
+		printf("%s: %u packets, %u mismatches, %u not predictable\n",
+			m_name.c_str(), m_numPackets, mismatches, unsupported);
+
+		return mismatches == 0;
+	}
+
+	unsigned int m_seed;
+	unsigned int m_numFltRules;
+	unsigned int m_numRtRules;
+	unsigned int m_numPackets;
+
+private:
+	bool SetupKernelModule()
+	{
+		struct ipa_channel_config from_ipa_channels[3];
+		struct test_ipa_ep_cfg from_ipa_cfg[3];
+		struct ipa_channel_config to_ipa_channels[1];
+		struct test_ipa_ep_cfg to_ipa_cfg[1];
+		struct ipa_test_config_header header = {0};
+		struct ipa_channel_config *to_ipa_array[1];
+		struct ipa_channel_config *from_ipa_array[3];
+		static const enum ipa_client_type cons[3] = {
+			IPA_CLIENT_TEST2_CONS,
+			IPA_CLIENT_TEST3_CONS,
+			IPA_CLIENT_TEST4_CONS
+		};
+
+		for (int i = 0; i < 3; i++) {
+			memset(&from_ipa_cfg[i], 0, sizeof(from_ipa_cfg[i]));
+			prepare_channel_struct(&from_ipa_channels[i],
+				header.from_ipa_channels_num++, cons[i],
+				(void *)&from_ipa_cfg[i],
+				sizeof(from_ipa_cfg[i]));
+			from_ipa_array[i] = &from_ipa_channels[i];
+		}
+
+		memset(&to_ipa_cfg[0], 0, sizeof(to_ipa_cfg[0]));
+		prepare_channel_struct(&to_ipa_channels[0],
+			header.to_ipa_channels_num++, IPA_CLIENT_TEST_PROD,
+			(void *)&to_ipa_cfg[0], sizeof(to_ipa_cfg[0]));
+		to_ipa_array[0] = &to_ipa_channels[0];
+
+		prepare_header_struct(&header, from_ipa_array, to_ipa_array);
+
+		return GenericConfigureScenario(&header);
+	}
+
+	static enum ipa_client_type ToClient(int consumer)
+	{
+		switch (consumer) {
+		case 0:
+			return IPA_CLIENT_TEST2_CONS;
+		case 1:
+			return IPA_CLIENT_TEST3_CONS;
+		case 2:
+			return IPA_CLIENT_TEST4_CONS;
+		default:
+			return IPA_CLIENT_MAX;
+		}
+	}
+
+	static uint32_t RandMask()
+	{
+		static const uint32_t masks[] = {
+			0xFFFFFFFF, 0xFFFFFF00, 0xFFFFFFF0, 0xFFFF0000
+		};
+
+		return masks[rand() % 4];
+	}
+
+	static uint32_t RandAddr(uint32_t net)
+	{
+		return net | ((rand() % 4) << 8) | (rand() % 16);
+	}
+
+	/* one to three attributes out of the pools BuildPacket() draws from */
+	static void RandAttrib(struct ipa_rule_attrib &attrib)
+	{
+		int n = 1 + rand() % 3;
+
+		memset(&attrib, 0, sizeof(attrib));
+		while (n--) {
+			switch (rand() % 5) {
+			case 0:
+				attrib.attrib_mask |= IPA_FLT_DST_ADDR;
+				attrib.u.v4.dst_addr_mask = RandMask();
+				attrib.u.v4.dst_addr = RandAddr(DIFF_DST_NET);
+				/* mostly matchable values, sometimes one with
+				 * bits outside the mask that never matches
+				 */
+				if (rand() % 16)
+					attrib.u.v4.dst_addr &= attrib.u.v4.dst_addr_mask;
+				break;
+			case 1:
+				attrib.attrib_mask |= IPA_FLT_SRC_ADDR;
+				attrib.u.v4.src_addr_mask = RandMask();
+				attrib.u.v4.src_addr = RandAddr(DIFF_SRC_NET) &
+					attrib.u.v4.src_addr_mask;
+				break;
+			case 2:
+				attrib.attrib_mask |= IPA_FLT_PROTOCOL;
+				attrib.u.v4.protocol = (rand() % 2) ?
+					IPPROTO_TCP : IPPROTO_UDP;
+				break;
+			case 3:
+				attrib.attrib_mask |= IPA_FLT_DST_PORT_RANGE;
+				attrib.dst_port_lo = DIFF_DST_PORT_BASE + rand() % 64;
+				attrib.dst_port_hi = attrib.dst_port_lo + rand() % 16;
+				break;
+			default:
+				if (rand() % 2) {
+					attrib.attrib_mask |= IPA_FLT_SRC_PORT;
+					attrib.src_port = DIFF_SRC_PORT_BASE + rand() % 16;
+				} else {
+					attrib.attrib_mask |= IPA_FLT_TOS;
+					attrib.u.v4.tos = s_tosValues[rand() % 3];
+				}
+				break;
+			}
+		}
+	}
+
+	/*
+	 * Only one max_prio rule per table: several of them tie on priority
+	 * and the HW then resolves the tie by the hashable/non-hashable split,
+	 * which depends on ipa_fltrt_not_hashable and is not visible here.
+	 */
+	bool AddRoutingTable(const char *name)
+	{
+		struct ipa_ioc_add_rt_rule *rt_rule;
+		struct ipa_rt_rule_add *rt_rule_entry;
+		static const enum ipa_client_type cons[2] = {
+			IPA_CLIENT_TEST2_CONS,
+			IPA_CLIENT_TEST3_CONS
+		};
+		bool maxPrioUsed = false;
+
+		rt_rule = (struct ipa_ioc_add_rt_rule *)calloc(1,
+			sizeof(struct ipa_ioc_add_rt_rule) +
+			(m_numRtRules + 1) * sizeof(struct ipa_rt_rule_add));
+		if (!rt_rule) {
+			printf("fail\n");
+			return false;
+		}
+
+		rt_rule->commit = 1;
+		rt_rule->ip = IPA_IP_v4;
+		strlcpy(rt_rule->rt_tbl_name, name, sizeof(rt_rule->rt_tbl_name));
+		rt_rule->num_rules = m_numRtRules;
+		for (unsigned int i = 0; i < m_numRtRules; i++) {
+			rt_rule_entry = &rt_rule->rules[i];
+			rt_rule_entry->at_rear = (rand() % 4) != 0;
+			rt_rule_entry->rule.dst = cons[rand() % 2];
+			rt_rule_entry->rule.hashable = rand() % 2;
+			if (!maxPrioUsed && rand() % 32 == 0) {
+				rt_rule_entry->rule.max_prio = 1;
+				maxPrioUsed = true;
+			}
+			RandAttrib(rt_rule_entry->rule.attrib);
+		}
+		if (!m_routing.AddRoutingRule(rt_rule)) {
+			printf("Routing rule addition(rt_rule) failed!\n");
+			free(rt_rule);
+			return false;
+		}
+
+		/* catch-all goes in last so that it stays at the rear */
+		memset(rt_rule->rules, 0, sizeof(rt_rule->rules[0]));
+		rt_rule->num_rules = 1;
+		rt_rule->rules[0].at_rear = 1;
+		rt_rule->rules[0].rule.dst = IPA_CLIENT_TEST4_CONS;
+		if (!m_routing.AddRoutingRule(rt_rule)) {
+			printf("Routing rule addition(catch-all) failed!\n");
+			free(rt_rule);
+			return false;
+		}
+		free(rt_rule);
+
+		return true;
+	}
+
+	bool AddFilteringTable()
+	{
+		IPAFilteringTable fltTable;
+		struct ipa_ioc_get_rt_tbl rt_tbl[2];
+		struct ipa_flt_rule_add flt_rule_entry;
+		bool maxPrioUsed = false;
+
+		memset(rt_tbl, 0, sizeof(rt_tbl));
+		rt_tbl[0].ip = IPA_IP_v4;
+		strlcpy(rt_tbl[0].name, DIFF_RT_TBL_A, sizeof(rt_tbl[0].name));
+		rt_tbl[1].ip = IPA_IP_v4;
+		strlcpy(rt_tbl[1].name, DIFF_RT_TBL_B, sizeof(rt_tbl[1].name));
+		if (!m_routing.GetRoutingTable(&rt_tbl[0]) ||
+			!m_routing.GetRoutingTable(&rt_tbl[1])) {
+			printf("m_routing.GetRoutingTable() Failed.\n");
+			return false;
+		}
+
+		if (!fltTable.Init(IPA_IP_v4, IPA_CLIENT_TEST_PROD, false,
+			m_numFltRules + 1)) {
+			printf("Failed to initialize filtering table\n");
+			return false;
+		}
+		for (unsigned int i = 0; i < m_numFltRules; i++) {
+			memset(&flt_rule_entry, 0, sizeof(flt_rule_entry));
+			flt_rule_entry.at_rear = (rand() % 4) != 0;
+			flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
+			flt_rule_entry.rule.rt_tbl_hdl = rt_tbl[rand() % 2].hdl;
+			flt_rule_entry.rule.hashable = rand() % 2;
+			if (!maxPrioUsed && rand() % 32 == 0) {
+				flt_rule_entry.rule.max_prio = 1;
+				maxPrioUsed = true;
+			}
+			RandAttrib(flt_rule_entry.rule.attrib);
+			if (fltTable.AddRuleToTable(flt_rule_entry) == (uint8_t)-1) {
+				printf("Failed adding filtering rule %u\n", i);
+				return false;
+			}
+		}
+		/* at_rear and added last, so it stays behind the random rules */
+		memset(&flt_rule_entry, 0, sizeof(flt_rule_entry));
+		flt_rule_entry.at_rear = 1;
+		flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
+		flt_rule_entry.rule.rt_tbl_hdl = rt_tbl[0].hdl;
+		if (fltTable.AddRuleToTable(flt_rule_entry) == (uint8_t)-1) {
+			printf("Failed adding filtering catch-all rule\n");
+			return false;
+		}
+
+		if (!m_filtering.AddFilteringRule(fltTable.GetFilteringTable())) {
+			printf("Filtering rule addition failed!\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	/* IPv4 + TCP/UDP, fields drawn from the same pools as the rules */
+	size_t BuildPacket(Byte *pkt, unsigned int n)
+	{
+		uint8_t proto = (rand() % 2) ? IPPROTO_TCP : IPPROTO_UDP;
+		size_t l4Len = (proto == IPPROTO_TCP) ? 20 : 8;
+		size_t len = 20 + l4Len + DIFF_PAYLOAD_LEN;
+		uint32_t src = RandAddr(DIFF_SRC_NET);
+		uint32_t dst = RandAddr(DIFF_DST_NET);
+		uint16_t sport = DIFF_SRC_PORT_BASE + rand() % 20;
+		uint16_t dport = DIFF_DST_PORT_BASE + rand() % 100;
+		uint32_t sum = 0;
+		Byte *l4 = pkt + 20;
+
+		memset(pkt, 0, len);
+		pkt[0] = 0x45;
+		pkt[1] = s_tosValues[rand() % 3];
+		pkt[2] = (Byte)(len >> 8);
+		pkt[3] = (Byte)len;
+		pkt[8] = 64;
+		pkt[9] = proto;
+		PutBe32(pkt + 12, src);
+		PutBe32(pkt + 16, dst);
+		for (int i = 0; i < 20; i += 2)
+			sum += (pkt[i] << 8) | pkt[i + 1];
+		while (sum >> 16)
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		pkt[10] = (Byte)(~sum >> 8);
+		pkt[11] = (Byte)~sum;
+
+		l4[0] = (Byte)(sport >> 8);
+		l4[1] = (Byte)sport;
+		l4[2] = (Byte)(dport >> 8);
+		l4[3] = (Byte)dport;
+		if (proto == IPPROTO_TCP) {
+			l4[12] = 0x50;
+			l4[13] = 0x10; /* ACK */
+		} else {
+			l4[4] = (Byte)((l4Len + DIFF_PAYLOAD_LEN) >> 8);
+			l4[5] = (Byte)(l4Len + DIFF_PAYLOAD_LEN);
+		}
+		PutBe32(l4 + l4Len, n);
+
+		return len;
+	}
+
+	static void PutBe32(Byte *p, uint32_t v)
+	{
+		p[0] = (Byte)(v >> 24);
+		p[1] = (Byte)(v >> 16);
+		p[2] = (Byte)(v >> 8);
+		p[3] = (Byte)v;
+	}
+
+	/* index of the consumer the packet came out of, -1 on timeout */
+	int ReceiveAny(Byte *buf, size_t size, int &got)
+	{
+		struct timespec start, now;
+		long elapsed;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		got = 0;
+		do {
+			for (int i = 0; i < 3; i++) {
+				got = m_consumers[i].ReceiveSingleDataChunk(buf, size);
+				if (got > 0)
+					return i;
+			}
+			usleep(DIFF_POLL_USEC);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			elapsed = (now.tv_sec - start.tv_sec) * 1000000L +
+				(now.tv_nsec - start.tv_nsec) / 1000;
+		} while (elapsed < DIFF_RX_TIMEOUT_USEC);
+
+		got = 0;
+		return -1;
+	}
+
+	static void PrintPacket(const Byte *pkt, size_t len)
+	{
+		for (size_t i = 0; i < len; i++)
+			printf("%02X%s", pkt[i], (i % 16 == 15) ? "\n" : " ");
+		printf("\n");
+	}
+
+	InterfaceAbstraction m_producer;
+	InterfaceAbstraction m_consumers[3];
+	ClassifierModel m_model;
+	static RoutingDriverWrapper m_routing;
+	static Filtering m_filtering;
+};
+
+RoutingDriverWrapper ClassifierModelDiffTest::m_routing;
+Filtering ClassifierModelDiffTest::m_filtering;
+
+static ClassifierModelDiffTest classifierModelDiffTest;
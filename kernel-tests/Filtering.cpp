@@ -68,6 +68,7 @@
 #include <stdio.h>
 
 #include "Filtering.h"
+#include "ClassifierModel.h"
 
 bool Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const * ruleTable)
 {
@@ -80,6 +81,8 @@ bool Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const * ruleTable)
 	}
 
 	printf("%s(), Added Filtering rule to table %p\n", __FUNCTION__, ruleTable);
+	if (m_model)
+		m_model->AddFilteringRules(ruleTable);
 	return true;
 }
 
@@ -94,6 +97,8 @@ bool Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule_v2 const * ruleTabl
 	}
 
 	printf("%s(), Added Filtering rule to table %p\n", __FUNCTION__, ruleTable);
+	if (m_model)
+		m_model->AddFilteringRules(ruleTable);
 	return true;
 }
 
@@ -108,6 +113,8 @@ bool Filtering::DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable)
 	}
 
 	printf("%s(), Deleted Filtering rule in table %p\n", __FUNCTION__, ruleTable);
+	if (m_model)
+		m_model->DeleteFilteringRules(ruleTable);
 	return true;
 }
 
@@ -137,6 +144,8 @@ bool Filtering::Reset(enum ipa_ip_type ip)
 	}
 
 	printf("%s(), Reset command issued to IPA Filtering block.\n", __FUNCTION__);
+	if (m_model)
+		m_model->ResetFiltering(ip);
 	return true;
 }
 
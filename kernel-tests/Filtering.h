@@ -68,14 +68,22 @@
 #include "linux/msm_ipa.h"
 #include "Feature.h"
 
+class ClassifierModel;
+
 class Filtering: public Feature
 {
 public:
+	Filtering() : m_model(NULL) {}
+	/* mirror successful table changes into a software model, NULL stops */
+	void SetModel(ClassifierModel *model) { m_model = model; }
 	bool AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTable);
 	bool AddFilteringRule(ipa_ioc_add_flt_rule_v2 const *ruleTable);
 	bool DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable);
 	bool Commit(enum ipa_ip_type ip);
 	bool Reset(enum ipa_ip_type ip);
+
+private:
+	ClassifierModel *m_model;
 };
 
 #endif
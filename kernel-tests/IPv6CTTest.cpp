@@ -112,6 +112,10 @@ public:
 		memset(m_sendBuffer3, 0, sizeof(m_sendBuffer3));	// Third input file (default) / IP packet
 		m_minIPAHwType = IPA_HW_v4_0;
 		m_testSuiteName.push_back("IPv6CT");
+		Claim("/dev/" IPA_IPV6CT_DEV_NAME);
+		Claim(TEST_RES_NAT_MEM);
+		Claim(TEST_RES_SCENARIO);
+		Claim(TEST_RES_RT_FLT);
 	}
 
 	static int SetupKernelModule(bool en_status = false, bool ct_suppress = false)
@@ -32,6 +32,7 @@
 #include <errno.h>
 #include <iostream>
 #include "InterfaceAbstraction.h"
+#include "TestManager.h"
 
 #define MAX_OPEN_RETRY 10000
 
@@ -123,6 +124,7 @@ long InterfaceAbstraction::SendData(unsigned char *buf, size_t size)
 	}
 
 	cout << "bytesWritten = " << bytesWritten << endl;
+	TestManager::GetInstance()->DumpPacket(m_toChannelName.c_str(), buf, bytesWritten);
 
 	return bytesWritten;
 }
@@ -139,6 +141,8 @@ int InterfaceAbstraction::ReceiveData(unsigned char *buf, size_t size)
 
 		bytesRead = read(m_fromIPADescriptor, (void*)buf, size);
 		printf("Read %zu bytes.\n", bytesRead);
+		if ((ssize_t)bytesRead > 0)
+			TestManager::GetInstance()->DumpPacket(m_fromChannelName.c_str(), buf, bytesRead);
 		totalBytesRead += bytesRead;
 		if (bytesRead == size)
 			continueRead = true;
@@ -154,6 +158,8 @@ int InterfaceAbstraction::ReceiveSingleDataChunk(unsigned char *buf, size_t size
 	printf("Trying to read %zu bytes from %d.\n", size, m_fromIPADescriptor);
 	bytesRead = read(m_fromIPADescriptor, (void*)buf, size);
 	printf("Read %zu bytes.\n", bytesRead);
+	if ((ssize_t)bytesRead > 0)
+		TestManager::GetInstance()->DumpPacket(m_fromChannelName.c_str(), buf, bytesRead);
 	return bytesRead;
 }
 
@@ -82,6 +82,10 @@ public:
 		memset(m_sendBuffer2, 0, sizeof(m_sendBuffer2));	// Second input file / IP packet
 		memset(m_sendBuffer3, 0, sizeof(m_sendBuffer3));	// Third input file (default) / IP packet
 		m_testSuiteName.push_back("Nat");
+		Claim("/dev/" IPA_NAT_DEV_NAME);
+		Claim(TEST_RES_NAT_MEM);
+		Claim(TEST_RES_SCENARIO);
+		Claim(TEST_RES_RT_FLT);
 	}
 
 	static int SetupKernelModule(bool en_status = 0, bool nat_suppress = 0)
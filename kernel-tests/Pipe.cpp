@@ -29,6 +29,7 @@
 
 #include "Pipe.h"
 #include "TestsUtils.h"
+#include "network_traffic/PcapFile.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 //Do not change those default values due to the fact that some test may relay on those default values.
@@ -109,11 +110,51 @@ int Pipe::Send(unsigned char * pBuffer, size_t nBytesToSend) {
 	}
 	size_t nBytesWritten = 0;
 	nBytesWritten = write(m_Fd, pBuffer, nBytesToSend);
+	if ((ssize_t)nBytesWritten > 0)
+		TestManager::GetInstance()->DumpPacket(m_pInodePath, pBuffer, nBytesWritten);
 	return nBytesWritten;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+int Pipe::ReplayPcap(const char *szPcapPath, size_t nFirstPacket, size_t nMaxPackets) {
+	PcapReader reader;
+	PcapPacket packet;
+	int nPacketsSent = 0;
+	size_t nSkipped = 0;
+
+	if (false == m_bInitialized) {
+		LOG_MSG_ERROR("Pipe is being used without being initialized!");
+		return -1;
+	}
+	if (!reader.open(szPcapPath)) {
+		LOG_MSG_ERROR("Failed to open %s: %s", szPcapPath, reader.error().c_str());
+		return -1;
+	}
+
+	//The packets are written straight out of the file mapping
+	while ((!nMaxPackets || (size_t)nPacketsSent < nMaxPackets) && reader.next(packet)) {
+		if (nSkipped < nFirstPacket) {
+			nSkipped++;
+			continue;
+		}
+		if (Send((unsigned char *)packet.data, packet.capLen) != (int)packet.capLen) {
+			LOG_MSG_ERROR("Failed to send packet %d of %s", nPacketsSent, szPcapPath);
+			return -1;
+		}
+		nPacketsSent++;
+	}
+	if (!reader.error().empty()) {
+		LOG_MSG_ERROR("%s is corrupted after %d packets: %s", szPcapPath,
+			nPacketsSent, reader.error().c_str());
+		return -1;
+	}
+
+	return nPacketsSent;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int Pipe::AddHeaderAndSend(unsigned char * pIpPacket, size_t nIpPacketSize) {
 	int retval;
 
@@ -150,6 +191,8 @@ int Pipe::Receive(unsigned char *pBuffer, size_t nBytesToReceive) {
 	}
 	size_t nBytesRead = 0;
 	nBytesRead = read(m_Fd, (void*) pBuffer, nBytesToReceive);
+	if ((ssize_t)nBytesRead > 0)
+		TestManager::GetInstance()->DumpPacket(m_pInodePath, pBuffer, nBytesRead);
 	return nBytesRead;
 }
 
@@ -727,3 +770,17 @@ bool Pipe::DisableHolb() {
 	return ConfigureHolb(0, 0);
 }
 
+
+int Pipe::SetReadNoBlock() {
+	int flags = fcntl(m_Fd, F_GETFL, 0);
+	if (flags == -1)
+		return -1;
+	return fcntl(m_Fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int Pipe::ClearReadNoBlock() {
+	int flags = fcntl(m_Fd, F_GETFL, 0);
+	if (flags == -1)
+		return -1;
+	return fcntl(m_Fd, F_SETFL, flags & ~O_NONBLOCK);
+}
@@ -79,6 +79,13 @@ public:
 			unsigned char *pBuffer,
 			size_t nBytesToSend);
 
+	/*Send the packets of a pcap/pcapng file as is, starting at
+	 *packet nFirstPacket and at most nMaxPackets of them (0 for
+	 *all). The packets are not copied on the way.
+	 *Returns the number sent or -1.*/
+	int ReplayPcap(const char *szPcapPath, size_t nFirstPacket = 0,
+			size_t nMaxPackets = 0);
+
 	/*Receive data from the IPA and remove its header*/
 	int  ReceiveAndRemoveHeader(
 			unsigned char *pBuffer,
@@ -106,6 +113,11 @@ public:
 	bool EnableHolb(unsigned timerValue);
 	bool DisableHolb();
 
+	/*Make Receive() return -1/EAGAIN instead of blocking
+	 *when no packet is pending (and back).*/
+	int SetReadNoBlock();
+	int ClearReadNoBlock();
+
 private:
 	void SetSpecificClientParameters(
 			enum ipa_client_type nClientType,
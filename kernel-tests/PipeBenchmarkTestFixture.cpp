@@ -0,0 +1,600 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <string>
+
+#include "hton.h" // for htonl
+#include "PipeBenchmarkTestFixture.h"
+#include "IPAFilteringTable.h"
+
+#define BENCH_MAGIC 0x42454e43 /* "BENC" */
+#define BENCH_IP_UDP_HDR_LEN 28
+#define BENCH_SRC_ADDR 0xC0A80213 /* 192.168.2.19 */
+#define BENCH_DST_ADDR 0xC0A80268 /* 192.168.2.104 */
+#define BENCH_MISS_ADDR_BASE 0x0A000000 /* 10.0.0.0/8, never sent to */
+#define BENCH_SRC_PORT_BASE 1024
+#define BENCH_DST_PORT 5001
+#define BENCH_RULES_PER_IOCTL 64
+/* give up on the packets in flight after this long without progress */
+#define BENCH_DRAIN_NSEC (500 * 1000 * 1000ULL)
+#define BENCH_POLL_USEC 20
+
+extern Logger g_Logger;
+
+RoutingDriverWrapper PipeBenchmarkTestFixture::m_routing;
+Filtering PipeBenchmarkTestFixture::m_filtering;
+
+PipeBenchmarkTestFixture::PipeBenchmarkTestFixture() :
+	m_numSenders(1),
+	m_numReceivers(1),
+	m_numRules(0),
+	m_pktsPerSender(100000),
+	m_window(256),
+	m_maxLossPpm(0),
+	m_producer(IPA_CLIENT_TEST_PROD, IPA_TEST_CONFIFURATION_1),
+	m_consumer(IPA_CLIENT_TEST_CONS, IPA_TEST_CONFIFURATION_1),
+	m_txPkts(0),
+	m_rxPkts(0),
+	m_lastRxNs(0),
+	m_sendDone(false)
+{
+	m_pktSizes.push_back(64);
+	m_pktSizes.push_back(512);
+	m_pktSizes.push_back(1400);
+	m_testSuiteName.push_back("Benchmark");
+	m_runInRegression = false;
+	Claim(TEST_RES_SCENARIO);
+	Claim(TEST_RES_RT_FLT);
+}
+
+/*Same channels as PipeTestFixture, minus the DMA mode when the
+ *packets should go through filtering and routing.
+ */
+static int SetupKernelModule(bool dma)
+{
+	int retval;
+	struct ipa_channel_config from_ipa_0 = {0};
+	struct test_ipa_ep_cfg from_ipa_0_cfg;
+	struct ipa_channel_config to_ipa_0 = {0};
+	struct test_ipa_ep_cfg to_ipa_0_cfg;
+
+	struct ipa_test_config_header header = {0};
+	struct ipa_channel_config *to_ipa_array[1];
+	struct ipa_channel_config *from_ipa_array[1];
+
+	memset(&from_ipa_0_cfg, 0 , sizeof(from_ipa_0_cfg));
+	prepare_channel_struct(&from_ipa_0,
+			header.from_ipa_channels_num++,
+			IPA_CLIENT_TEST_CONS,
+			(void *)&from_ipa_0_cfg,
+			sizeof(from_ipa_0_cfg));
+	from_ipa_array[0] = &from_ipa_0;
+
+	memset(&to_ipa_0_cfg, 0 , sizeof(to_ipa_0_cfg));
+	if (dma) {
+		to_ipa_0_cfg.mode.mode = IPA_DMA;
+		to_ipa_0_cfg.mode.dst = IPA_CLIENT_TEST_CONS;
+	}
+	prepare_channel_struct(&to_ipa_0,
+			header.to_ipa_channels_num++,
+			IPA_CLIENT_TEST_PROD,
+			(void *)&to_ipa_0_cfg,
+			sizeof(to_ipa_0_cfg));
+	to_ipa_array[0] = &to_ipa_0;
+
+	prepare_header_struct(&header, from_ipa_array, to_ipa_array);
+
+	retval = GenericConfigureScenario(&header);
+
+	return retval;
+}
+
+bool PipeBenchmarkTestFixture::Setup()
+{
+	bool bRetVal = true;
+
+	if (m_numSenders < 1 || m_numSenders > BENCH_MAX_THREADS ||
+		m_numReceivers < 1 || m_numReceivers > BENCH_MAX_THREADS) {
+		LOG_MSG_ERROR("Bad thread count %u senders %u receivers\n",
+			m_numSenders, m_numReceivers);
+		return false;
+	}
+
+	if (SetupKernelModule(m_numRules == 0) == false)
+		return false;
+
+	bRetVal &= m_producer.Init();
+	bRetVal &= m_consumer.Init();
+	if (!bRetVal)
+		return false;
+
+	/* receivers poll so they can notice the end of a run */
+	if (m_consumer.SetReadNoBlock()) {
+		LOG_MSG_ERROR("Failed to make the consumer pipe non blocking\n");
+		return false;
+	}
+
+	if (!m_numRules)
+		return true;
+
+	if (!m_routing.DeviceNodeIsOpened()) {
+		LOG_MSG_ERROR("Routing block is not ready for immediate commands!\n");
+		return false;
+	}
+	if (!m_filtering.DeviceNodeIsOpened()) {
+		LOG_MSG_ERROR("Filtering block is not ready for immediate commands!\n");
+		return false;
+	}
+	m_routing.Reset(IPA_IP_v4);
+	m_filtering.Reset(IPA_IP_v4);
+
+	return AddRoutingRules();
+}
+
+bool PipeBenchmarkTestFixture::Teardown()
+{
+	m_producer.Destroy();
+	m_consumer.Destroy();
+
+	/* do not leave a large table behind for the next test */
+	if (m_numRules) {
+		m_filtering.Reset(IPA_IP_v4);
+		m_routing.Reset(IPA_IP_v4);
+	}
+
+	return true;
+}
+
+/*m_numRules - 1 rules which never match, then a catch-all one to the
+ *consumer. The rules are not hashable so every packet walks the whole
+ *table, which is what the rule-table size benchmarks are after.
+ */
+bool PipeBenchmarkTestFixture::AddRoutingRules()
+{
+	struct ipa_ioc_add_rt_rule *rt_rule;
+	struct ipa_rt_rule_add *rt_rule_entry;
+	struct ipa_ioc_get_rt_tbl st_rt_tbl;
+	struct ipa_flt_rule_add flt_rule_entry;
+	IPAFilteringTable fltTable;
+	size_t allocSize;
+	unsigned int added = 0, batch, i;
+
+	allocSize = sizeof(struct ipa_ioc_add_rt_rule) +
+		BENCH_RULES_PER_IOCTL * sizeof(struct ipa_rt_rule_add);
+	rt_rule = (struct ipa_ioc_add_rt_rule *)calloc(1, allocSize);
+	if (!rt_rule) {
+		LOG_MSG_ERROR("Failed memory allocation for rt_rule\n");
+		return false;
+	}
+
+	while (added < m_numRules) {
+		batch = m_numRules - added;
+		if (batch > BENCH_RULES_PER_IOCTL)
+			batch = BENCH_RULES_PER_IOCTL;
+
+		memset(rt_rule, 0, allocSize);
+		rt_rule->commit = (added + batch == m_numRules);
+		rt_rule->num_rules = batch;
+		rt_rule->ip = IPA_IP_v4;
+		strlcpy(rt_rule->rt_tbl_name, "LAN", sizeof(rt_rule->rt_tbl_name));
+
+		for (i = 0; i < batch; i++, added++) {
+			rt_rule_entry = &rt_rule->rules[i];
+			rt_rule_entry->at_rear = 1;
+			rt_rule_entry->rule.dst = IPA_CLIENT_TEST_CONS;
+			if (added == m_numRules - 1)
+				continue;
+			rt_rule_entry->rule.attrib.attrib_mask = IPA_FLT_DST_ADDR;
+			rt_rule_entry->rule.attrib.u.v4.dst_addr =
+				BENCH_MISS_ADDR_BASE + added;
+			rt_rule_entry->rule.attrib.u.v4.dst_addr_mask = 0xFFFFFFFF;
+		}
+
+		if (false == m_routing.AddRoutingRule(rt_rule)) {
+			LOG_MSG_ERROR("Routing rule addition failed at rule %u\n", added);
+			free(rt_rule);
+			return false;
+		}
+	}
+	free(rt_rule);
+
+	memset(&st_rt_tbl, 0, sizeof(st_rt_tbl));
+	memset(&flt_rule_entry, 0, sizeof(flt_rule_entry));
+	strlcpy(st_rt_tbl.name, "LAN", sizeof(st_rt_tbl.name));
+	st_rt_tbl.ip = IPA_IP_v4;
+	if (!m_routing.GetRoutingTable(&st_rt_tbl)) {
+		LOG_MSG_ERROR("Failed getting the LAN routing table\n");
+		return false;
+	}
+	fltTable.Init(IPA_IP_v4, IPA_CLIENT_TEST_PROD, false, 1);
+	flt_rule_entry.rule.rt_tbl_hdl = st_rt_tbl.hdl;
+	fltTable.AddRuleToTable(flt_rule_entry);
+
+	return m_filtering.AddFilteringRule(fltTable.GetFilteringTable());
+}
+
+uint64_t PipeBenchmarkTestFixture::NowNs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void PipeBenchmarkTestFixture::BuildPacket(unsigned char *pkt,
+	size_t pktSize, unsigned int sender)
+{
+	uint32_t addr, sum = 0;
+	size_t i;
+
+	memset(pkt, 0, pktSize);
+
+	/* IPv4 header */
+	pkt[0] = 0x45;
+	pkt[2] = pktSize >> 8;
+	pkt[3] = pktSize & 0xff;
+	pkt[8] = 64; /* TTL */
+	pkt[9] = 17; /* UDP */
+	addr = htonl(BENCH_SRC_ADDR);
+	memcpy(&pkt[12], &addr, sizeof(addr));
+	addr = htonl(BENCH_DST_ADDR);
+	memcpy(&pkt[16], &addr, sizeof(addr));
+	for (i = 0; i < 20; i += 2)
+		sum += (pkt[i] << 8) | pkt[i + 1];
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	sum = ~sum & 0xffff;
+	pkt[10] = sum >> 8;
+	pkt[11] = sum & 0xff;
+
+	/* UDP header, no checksum, one source port per sender */
+	pkt[20] = (BENCH_SRC_PORT_BASE + sender) >> 8;
+	pkt[21] = (BENCH_SRC_PORT_BASE + sender) & 0xff;
+	pkt[22] = BENCH_DST_PORT >> 8;
+	pkt[23] = BENCH_DST_PORT & 0xff;
+	pkt[24] = (pktSize - 20) >> 8;
+	pkt[25] = (pktSize - 20) & 0xff;
+
+	/* the BenchStamp goes right after, then a pattern */
+	for (i = BENCH_IP_UDP_HDR_LEN + sizeof(BenchStamp); i < pktSize; i++)
+		pkt[i] = (unsigned char)i;
+}
+
+void PipeBenchmarkTestFixture::SenderLoop(BenchThreadCtx *ctx)
+{
+	unsigned char pkt[BENCH_RX_BUFF_SIZE];
+	BenchStamp stamp;
+	uint64_t seq, waitNs, lastRxNs;
+	int ret;
+
+	BuildPacket(pkt, ctx->pktSize, ctx->id);
+	memset(&stamp, 0, sizeof(stamp));
+	stamp.magic = BENCH_MAGIC;
+	stamp.sender = ctx->id;
+	stamp.size = ctx->pktSize;
+
+	for (seq = 0; seq < m_pktsPerSender; seq++) {
+		/* keep at most m_window packets in flight */
+		waitNs = NowNs();
+		while (m_window &&
+			__atomic_load_n(&m_txPkts, __ATOMIC_RELAXED) -
+			__atomic_load_n(&m_rxPkts, __ATOMIC_RELAXED) >= m_window) {
+			lastRxNs = __atomic_load_n(&m_lastRxNs, __ATOMIC_RELAXED);
+			if (lastRxNs < waitNs)
+				lastRxNs = waitNs;
+			if (NowNs() - lastRxNs > BENCH_DRAIN_NSEC) {
+				LOG_MSG_ERROR("Sender %u stalled at seq %llu, "
+					"packets in flight were lost\n", ctx->id,
+					(unsigned long long)seq);
+				return;
+			}
+			usleep(BENCH_POLL_USEC);
+		}
+
+		stamp.seq = seq;
+		stamp.txNs = NowNs();
+		memcpy(pkt + BENCH_IP_UDP_HDR_LEN, &stamp, sizeof(stamp));
+
+		/* count it first so a receiver never sees rx > tx */
+		__atomic_fetch_add(&m_txPkts, 1, __ATOMIC_RELAXED);
+		ret = m_producer.Send(pkt, ctx->pktSize);
+		if (ret != (int)ctx->pktSize) {
+			__atomic_fetch_sub(&m_txPkts, 1, __ATOMIC_RELAXED);
+			LOG_MSG_ERROR("Sender %u failed sending seq %llu (%d)\n",
+				ctx->id, (unsigned long long)seq, ret);
+			ctx->errors++;
+			return;
+		}
+		ctx->pkts++;
+		ctx->bytes += ctx->pktSize;
+	}
+}
+
+void PipeBenchmarkTestFixture::ReceiverLoop(BenchThreadCtx *ctx)
+{
+	unsigned char buf[BENCH_RX_BUFF_SIZE];
+	BenchStamp stamp;
+	uint64_t now, lat, us;
+	unsigned int bucket;
+	int len;
+
+	while (true) {
+		len = m_consumer.Receive(buf, sizeof(buf));
+		now = NowNs();
+
+		if (len <= 0) {
+			if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				LOG_MSG_ERROR("Receiver %u read failed, errno %d\n",
+					ctx->id, errno);
+				ctx->errors++;
+				return;
+			}
+			if (__atomic_load_n(&m_sendDone, __ATOMIC_ACQUIRE)) {
+				if (__atomic_load_n(&m_rxPkts, __ATOMIC_RELAXED) >=
+					__atomic_load_n(&m_txPkts, __ATOMIC_RELAXED))
+					return;
+				if (now - __atomic_load_n(&m_lastRxNs, __ATOMIC_RELAXED) >
+					BENCH_DRAIN_NSEC)
+					return;
+			}
+			usleep(BENCH_POLL_USEC);
+			continue;
+		}
+
+		if (len < (int)(BENCH_IP_UDP_HDR_LEN + sizeof(stamp))) {
+			ctx->errors++;
+			continue;
+		}
+		memcpy(&stamp, buf + BENCH_IP_UDP_HDR_LEN, sizeof(stamp));
+
+		/* a straggler of the previous size, already counted as lost */
+		if (stamp.magic == BENCH_MAGIC && stamp.size != ctx->pktSize &&
+			stamp.size == len)
+			continue;
+
+		__atomic_fetch_add(&m_rxPkts, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&m_lastRxNs, now, __ATOMIC_RELAXED);
+
+		if (stamp.magic != BENCH_MAGIC || stamp.size != len ||
+			stamp.sender >= m_numSenders || stamp.txNs > now) {
+			ctx->errors++;
+			continue;
+		}
+
+		lat = now - stamp.txNs;
+		if (lat < ctx->latMinNs)
+			ctx->latMinNs = lat;
+		if (lat > ctx->latMaxNs)
+			ctx->latMaxNs = lat;
+		ctx->latSumNs += lat;
+		for (bucket = 0, us = lat / 1000;
+			us > 1 && bucket < BENCH_LAT_BUCKETS - 1; us >>= 1)
+			bucket++;
+		ctx->hist[bucket]++;
+		ctx->pkts++;
+		ctx->bytes += len;
+		ctx->lastRxNs = now;
+	}
+}
+
+static void *BenchSender(void *arg)
+{
+	BenchThreadCtx *ctx = (BenchThreadCtx *)arg;
+
+	ctx->fixture->SenderLoop(ctx);
+	return NULL;
+}
+
+static void *BenchReceiver(void *arg)
+{
+	BenchThreadCtx *ctx = (BenchThreadCtx *)arg;
+
+	ctx->fixture->ReceiverLoop(ctx);
+	return NULL;
+}
+
+/*Upper bound in usec of the histogram bucket holding the pct
+ *percentile, capped by the largest latency actually seen.
+ */
+static double HistPercentile(const uint64_t *hist, uint64_t total,
+	double pct, double maxUs)
+{
+	uint64_t target = (uint64_t)(total * pct / 100.0 + 0.5);
+	uint64_t cum = 0;
+	unsigned int b;
+
+	if (!target)
+		target = 1;
+	for (b = 0; b < BENCH_LAT_BUCKETS; b++) {
+		cum += hist[b];
+		if (cum >= target)
+			break;
+	}
+	if (b >= BENCH_LAT_BUCKETS - 1)
+		return maxUs;
+
+	return ((double)(2ULL << b) < maxUs) ? (double)(2ULL << b) : maxUs;
+}
+
+bool PipeBenchmarkTestFixture::RunSize(size_t pktSize)
+{
+	BenchThreadCtx tx[BENCH_MAX_THREADS];
+	BenchThreadCtx rx[BENCH_MAX_THREADS];
+	pthread_t txThreads[BENCH_MAX_THREADS];
+	pthread_t rxThreads[BENCH_MAX_THREADS];
+	unsigned int numTx = 0, numRx = 0, i, b;
+	uint64_t sent = 0, received = 0, rxBytes = 0, errors = 0, lost = 0;
+	uint64_t latMin = UINT64_MAX, latMax = 0, latSum = 0;
+	uint64_t hist[BENCH_LAT_BUCKETS];
+	uint64_t start, end = 0;
+	double secs, pps, gbps, avgUs, maxUs, p50Us, p99Us;
+	string prefix;
+	bool ok = true;
+
+	memset(tx, 0, sizeof(tx));
+	memset(rx, 0, sizeof(rx));
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < BENCH_MAX_THREADS; i++) {
+		tx[i].fixture = rx[i].fixture = this;
+		tx[i].id = rx[i].id = i;
+		tx[i].pktSize = rx[i].pktSize = pktSize;
+		rx[i].latMinNs = UINT64_MAX;
+	}
+
+	m_txPkts = 0;
+	m_rxPkts = 0;
+	m_sendDone = false;
+	start = NowNs();
+	m_lastRxNs = start;
+
+	for (; numRx < m_numReceivers; numRx++) {
+		if (pthread_create(&rxThreads[numRx], NULL, BenchReceiver,
+			&rx[numRx])) {
+			LOG_MSG_ERROR("Failed creating receiver %u\n", numRx);
+			ok = false;
+			break;
+		}
+	}
+	for (; ok && numTx < m_numSenders; numTx++) {
+		if (pthread_create(&txThreads[numTx], NULL, BenchSender,
+			&tx[numTx])) {
+			LOG_MSG_ERROR("Failed creating sender %u\n", numTx);
+			ok = false;
+			break;
+		}
+	}
+
+	for (i = 0; i < numTx; i++)
+		pthread_join(txThreads[i], NULL);
+	/* the drain timeout of the receivers starts now */
+	__atomic_store_n(&m_lastRxNs, NowNs(), __ATOMIC_RELAXED);
+	__atomic_store_n(&m_sendDone, true, __ATOMIC_RELEASE);
+	for (i = 0; i < numRx; i++)
+		pthread_join(rxThreads[i], NULL);
+
+	for (i = 0; i < numTx; i++) {
+		sent += tx[i].pkts;
+		errors += tx[i].errors;
+	}
+	for (i = 0; i < numRx; i++) {
+		received += rx[i].pkts;
+		rxBytes += rx[i].bytes;
+		errors += rx[i].errors;
+		latSum += rx[i].latSumNs;
+		if (rx[i].latMinNs < latMin)
+			latMin = rx[i].latMinNs;
+		if (rx[i].latMaxNs > latMax)
+			latMax = rx[i].latMaxNs;
+		if (rx[i].lastRxNs > end)
+			end = rx[i].lastRxNs;
+		for (b = 0; b < BENCH_LAT_BUCKETS; b++)
+			hist[b] += rx[i].hist[b];
+	}
+	if (received < sent)
+		lost = sent - received;
+	if (!received) {
+		latMin = 0;
+		end = NowNs();
+	}
+
+	secs = (end - start) / 1e9;
+	pps = secs > 0 ? received / secs : 0;
+	gbps = secs > 0 ? rxBytes * 8 / secs / 1e9 : 0;
+	avgUs = received ? latSum / 1000.0 / received : 0;
+	maxUs = latMax / 1000.0;
+	p50Us = received ? HistPercentile(hist, received, 50, maxUs) : 0;
+	p99Us = received ? HistPercentile(hist, received, 99, maxUs) : 0;
+
+	LOG_MSG_INFO("%zu bytes, %u senders %u receivers %u rules: "
+		"%llu sent %llu received %llu lost %llu errors in %.3f sec\n",
+		pktSize, m_numSenders, m_numReceivers, m_numRules,
+		(unsigned long long)sent, (unsigned long long)received,
+		(unsigned long long)lost, (unsigned long long)errors, secs);
+	LOG_MSG_INFO("%.0f pps %.3f Gbps, latency usec min %.1f avg %.1f "
+		"p50 <%.0f p99 <%.0f max %.1f\n", pps, gbps, latMin / 1000.0,
+		avgUs, p50Us, p99Us, maxUs);
+	for (b = 0; b < BENCH_LAT_BUCKETS; b++) {
+		if (!hist[b])
+			continue;
+		LOG_MSG_INFO("  [%8llu, %8llu) usec: %llu\n",
+			b ? 1ULL << b : 0ULL, 2ULL << b,
+			(unsigned long long)hist[b]);
+	}
+
+	prefix = to_string(pktSize) + "B_";
+	AddMetric(prefix + "pps", pps);
+	AddMetric(prefix + "Gbps", gbps);
+	AddMetric(prefix + "lat_avg_us", avgUs);
+	AddMetric(prefix + "lat_p50_us", p50Us);
+	AddMetric(prefix + "lat_p99_us", p99Us);
+	AddMetric(prefix + "lat_max_us", maxUs);
+	AddMetric(prefix + "lost", lost);
+	AddMetric(prefix + "errors", errors);
+
+	if (!received) {
+		LOG_MSG_ERROR("Nothing received for %zu byte packets\n", pktSize);
+		ok = false;
+	}
+	if (errors)
+		ok = false;
+	if (lost * 1000000 > sent * m_maxLossPpm) {
+		LOG_MSG_ERROR("Lost %llu of %llu packets, more than %llu ppm\n",
+			(unsigned long long)lost, (unsigned long long)sent,
+			(unsigned long long)m_maxLossPpm);
+		ok = false;
+	}
+
+	return ok;
+}
+
+bool PipeBenchmarkTestFixture::Run()
+{
+	bool pass = true;
+	size_t i;
+
+	for (i = 0; i < m_pktSizes.size(); i++) {
+		if (m_pktSizes[i] < BENCH_IP_UDP_HDR_LEN + sizeof(BenchStamp) ||
+			m_pktSizes[i] > BENCH_RX_BUFF_SIZE) {
+			LOG_MSG_ERROR("Unsupported packet size %zu\n", m_pktSizes[i]);
+			pass = false;
+			continue;
+		}
+		pass &= RunSize(m_pktSizes[i]);
+	}
+
+	return pass;
+}
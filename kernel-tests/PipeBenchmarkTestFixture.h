@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#ifndef _PIPE_BENCHMARK_TEST_FIXTURE_H_
+#define _PIPE_BENCHMARK_TEST_FIXTURE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Constants.h"
+#include "Logger.h"
+#include "linux/msm_ipa.h"
+#include "TestsUtils.h"
+#include "TestBase.h"
+#include "Pipe.h"
+#include "RoutingDriverWrapper.h"
+#include "Filtering.h"
+
+#define BENCH_MAX_THREADS 8
+/* log2 buckets of microseconds, the last one takes everything above */
+#define BENCH_LAT_BUCKETS 24
+#define BENCH_RX_BUFF_SIZE 2048
+
+/*Written by the sender right after the IPv4/UDP header of every
+ *packet and checked by the receiver.
+ */
+struct BenchStamp {
+	uint32_t magic;
+	uint16_t sender;
+	uint16_t size;
+	uint64_t seq;
+	uint64_t txNs;
+};
+
+/*Per thread counters, merged by the fixture once all threads joined.*/
+struct BenchThreadCtx {
+	class PipeBenchmarkTestFixture *fixture;
+	unsigned int id;
+	size_t pktSize;
+	uint64_t pkts;
+	uint64_t bytes;
+	uint64_t errors;
+	uint64_t latMinNs;
+	uint64_t latMaxNs;
+	uint64_t latSumNs;
+	uint64_t lastRxNs;
+	uint64_t hist[BENCH_LAT_BUCKETS];
+};
+
+/*Base class of the datapath benchmarks.
+ *
+ *One producer pipe feeds one consumer pipe, either in DMA mode
+ *(m_numRules == 0) or through a routing table of m_numRules rules of
+ *which only the last one matches. For every packet size in m_pktSizes
+ *m_numSenders threads write m_pktsPerSender packets to the producer
+ *while m_numReceivers threads drain the consumer. Each packet carries
+ *a BenchStamp with the send time so the receivers can build a latency
+ *histogram. Senders keep at most m_window packets in flight so the
+ *numbers reflect sustained rather than burst throughput; set it to 0
+ *to send open loop and measure loss instead.
+ *
+ *Results are reported through AddMetric() and end up in the xUnit
+ *report, e.g. "1400B_pps", "1400B_Gbps", "1400B_lat_p99_us",
+ *"1400B_lost".
+ */
+class PipeBenchmarkTestFixture:public TestBase
+{
+public:
+	PipeBenchmarkTestFixture();
+
+	virtual bool Setup();
+	virtual bool Teardown();
+	virtual bool Run();
+
+	void SenderLoop(BenchThreadCtx *ctx);
+	void ReceiverLoop(BenchThreadCtx *ctx);
+
+protected:
+	bool RunSize(size_t pktSize);
+	bool AddRoutingRules();
+	void BuildPacket(unsigned char *pkt, size_t pktSize,
+		unsigned int sender);
+	static uint64_t NowNs();
+
+	unsigned int m_numSenders;
+	unsigned int m_numReceivers;
+	unsigned int m_numRules;
+	uint64_t m_pktsPerSender;
+	uint64_t m_window;
+	/* Fail when more than this many packets per million are lost */
+	uint64_t m_maxLossPpm;
+	vector < size_t > m_pktSizes;
+
+	Pipe m_producer;
+	Pipe m_consumer;
+	static RoutingDriverWrapper m_routing;
+	static Filtering m_filtering;
+
+	/* shared between the threads of one RunSize() */
+	uint64_t m_txPkts;
+	uint64_t m_rxPkts;
+	uint64_t m_lastRxNs;
+	bool m_sendDone;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include "PipeBenchmarkTestFixture.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Raw DMA throughput and latency, one sender and one receiver.
+ */
+class PipeBenchmarkDma: public PipeBenchmarkTestFixture {
+public:
+	PipeBenchmarkDma()
+	{
+		m_name = "PipeBenchmarkDma";
+		m_description = "Benchmark - DMA from TEST_PROD to TEST_CONS, "
+				"1 sender 1 receiver, 64/512/1400 byte packets";
+		Register(*this);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Same as PipeBenchmarkDma with several threads on each pipe.
+ */
+class PipeBenchmarkDmaMultiThread: public PipeBenchmarkTestFixture {
+public:
+	PipeBenchmarkDmaMultiThread()
+	{
+		m_name = "PipeBenchmarkDmaMultiThread";
+		m_description = "Benchmark - DMA from TEST_PROD to TEST_CONS, "
+				"4 senders 4 receivers, 64/512/1400 byte packets";
+		m_numSenders = 4;
+		m_numReceivers = 4;
+		m_pktsPerSender = 25000;
+		m_window = 1024;
+		Register(*this);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Open loop DMA: senders do not wait for the receivers, so the
+ * interesting number is the loss rather than the latency.
+ */
+class PipeBenchmarkDmaOpenLoop: public PipeBenchmarkTestFixture {
+public:
+	PipeBenchmarkDmaOpenLoop()
+	{
+		m_name = "PipeBenchmarkDmaOpenLoop";
+		m_description = "Benchmark - DMA from TEST_PROD to TEST_CONS "
+				"without flow control, reports loss";
+		m_numReceivers = 2;
+		m_window = 0;
+		m_maxLossPpm = 1000000;
+		Register(*this);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Filtering and routing through a table of numRules non-hashable
+ * rules, only the last one matching.
+ */
+class PipeBenchmarkRouting: public PipeBenchmarkTestFixture {
+public:
+	PipeBenchmarkRouting(unsigned int numRules)
+	{
+		m_name = "PipeBenchmarkRouting" + to_string(numRules);
+		m_description = "Benchmark - TEST_PROD to TEST_CONS through a "
+				"routing table of " + to_string(numRules) +
+				" rules, 64/512/1400 byte packets";
+		m_numRules = numRules;
+		Register(*this);
+	}
+};
+
+static PipeBenchmarkDma pipeBenchmarkDma;
+static PipeBenchmarkDmaMultiThread pipeBenchmarkDmaMultiThread;
+static PipeBenchmarkDmaOpenLoop pipeBenchmarkDmaOpenLoop;
+static PipeBenchmarkRouting pipeBenchmarkRouting1(1);
+static PipeBenchmarkRouting pipeBenchmarkRouting32(32);
+static PipeBenchmarkRouting pipeBenchmarkRouting128(128);
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                  EOF                                      ////
+/////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +38,7 @@ Pipe PipeTestFixture::m_UsbToIpaPipe(IPA_CLIENT_TEST_PROD, IPA_TEST_CONFIFURATIO
 PipeTestFixture::PipeTestFixture()
 {
 	m_testSuiteName.push_back("Pipes");
+	Claim(TEST_RES_SCENARIO);
 	Register(*this);
 }
 
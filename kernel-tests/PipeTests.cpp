@@ -37,6 +37,11 @@
 #include "Constants.h"
 #include "TestsUtils.h"
 #include "linux/msm_ipa.h"
+#include "network_traffic/PcapFile.h"
+
+#define PIPE_PCAP_REPLAY_PATH "pipe_replay.pcapng"
+#define PIPE_PCAP_REPLAY_PACKETS 256
+#define PIPE_PCAP_REPLAY_BATCH 8
 
 /////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////
@@ -460,6 +465,85 @@ public:
 /////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////
 
+//This test will write a capture of random packets, replay it through the Pipe
+//straight from the file mapping and check that every packet comes back as captured.
+class PipeTestPcapReplay: public PipeTestFixture {
+public:
+
+	/////////////////////////////////////////////////////////////////////////////////
+
+	PipeTestPcapReplay() {
+		m_name = "PipeTestPcapReplay";
+		m_description = "Replay a pcapng capture through the Pipe and compare every packet";
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////
+
+	bool Run() {
+		PcapWriter writer;
+		PcapReader reader;
+		PcapPacket packet;
+		Byte pIpPacket[1500];
+		Byte pIpPacketReceive[sizeof(pIpPacket)];
+		int nPacketByteSize;
+		int nSent;
+		size_t i, j;
+
+		srand(123); //set some constant seed value in order to be able to reproduce problems.
+		if (!writer.open(PIPE_PCAP_REPLAY_PATH)) {
+			LOG_MSG_ERROR("%s", writer.error().c_str());
+			return false;
+		}
+		for (i = 0; i < PIPE_PCAP_REPLAY_PACKETS; i++) {
+			nPacketByteSize = (rand() % (sizeof(pIpPacket) - 20)) + 20;
+			for (j = 0; j < (size_t)nPacketByteSize; j++)
+				pIpPacket[j] = rand() % 0x100;
+			if (!writer.write(pIpPacket, nPacketByteSize)) {
+				LOG_MSG_ERROR("%s", writer.error().c_str());
+				return false;
+			}
+		}
+		writer.close();
+
+		if (!reader.open(PIPE_PCAP_REPLAY_PATH)) {
+			LOG_MSG_ERROR("%s", reader.error().c_str());
+			return false;
+		}
+
+		//Replay in batches so the consumer FIFO never fills up
+		for (i = 0; i < PIPE_PCAP_REPLAY_PACKETS; i += nSent) {
+			nSent = m_UsbToIpaPipe.ReplayPcap(PIPE_PCAP_REPLAY_PATH, i,
+					PIPE_PCAP_REPLAY_BATCH);
+			if (nSent <= 0) {
+				LOG_MSG_ERROR("Replay stopped at packet %zu\n", i);
+				return false;
+			}
+			for (j = 0; j < (size_t)nSent; j++) {
+				if (!reader.next(packet)) {
+					LOG_MSG_ERROR("Capture ended at packet %zu\n", i + j);
+					return false;
+				}
+				int nBytesReceived = m_IpaToUsbPipe.Receive(pIpPacketReceive,
+						packet.capLen);
+				if (!CompareResultVsGolden((Byte *)packet.data, packet.capLen,
+						pIpPacketReceive, nBytesReceived)) {
+					LOG_MSG_ERROR("Packet %zu: sent %u bytes, received %d\n",
+							i + j, packet.capLen, nBytesReceived);
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+
 //Those tests should be run with configuration number 1 which has one input pipe and
 //one output pipe.
 //Please look at the Fixture for more configurations update.
@@ -467,6 +551,7 @@ static PipeTestRawTransfer pipeTestRawTransfer;
 static PipeTestAddHeader pipeTestAddHeader;
 static PipeTestAddAndRemoveHeader pipeTestAddAndRemoveHeader;
 static PipeTestHolb pipeTestHolb;
+static PipeTestPcapReplay pipeTestPcapReplay;
 
 //DO NOT UNCOMMENT THOSE LINES UNLESS YOU KNOW WHAT YOU ARE DOING!!!
 //those test takes 4ever and should be use for specific usecase!
@@ -68,6 +68,7 @@
 
 #include "RoutingDriverWrapper.h"
 #include "TestsUtils.h"
+#include "ClassifierModel.h"
 
 bool RoutingDriverWrapper::AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable)
 {
@@ -83,6 +84,8 @@ bool RoutingDriverWrapper::AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable)
 	}
 
 	printf("%s(), Added routing rule table %p\n", __FUNCTION__, ruleTable);
+	if (m_model)
+		m_model->AddRoutingRules(ruleTable);
 	return true;
 }
 
@@ -100,6 +103,8 @@ bool RoutingDriverWrapper::AddRoutingRule(struct ipa_ioc_add_rt_rule_v2 *ruleTab
 	}
 
 	printf("%s(), Added routing rule table %p\n", __FUNCTION__, ruleTable_v2);
+	if (m_model)
+		m_model->AddRoutingRules(ruleTable_v2);
 	return true;
 }
 
@@ -117,6 +122,8 @@ bool RoutingDriverWrapper::DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTab
 	}
 
 	printf("%s(), Deleted routing rule table %p\n", __FUNCTION__, ruleTable);
+	if (m_model)
+		m_model->DeleteRoutingRules(ruleTable);
 	return true;
 }
 
@@ -152,6 +159,8 @@ bool RoutingDriverWrapper::Reset(enum ipa_ip_type ip)
 	}
 
 	printf("%s(), Reset command issued to IPA routing block.\n", __FUNCTION__);
+	if (m_model)
+		m_model->ResetRouting(ip);
 	return true;
 }
 
@@ -169,6 +178,8 @@ bool RoutingDriverWrapper::GetRoutingTable(struct ipa_ioc_get_rt_tbl *routingTab
 	}
 
 	printf("%s(), IPA_IOCTL_GET_RT_TBL ioctl issued to IPA routing block.\n", __FUNCTION__);
+	if (m_model)
+		m_model->GetRoutingTable(routingTable, true);
 	return true;
 }
 
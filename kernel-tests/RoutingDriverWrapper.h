@@ -70,9 +70,14 @@
 
 using namespace std;
 
+class ClassifierModel;
+
 class RoutingDriverWrapper: public Feature
 {
 public:
+	RoutingDriverWrapper() : m_model(NULL) {}
+	/* mirror successful table changes into a software model, NULL stops */
+	void SetModel(ClassifierModel *model) { m_model = model; }
 	bool AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable);
 	bool AddRoutingRule(ipa_ioc_add_rt_rule_v2 *ruleTable_v2);
 	bool DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable);
@@ -81,6 +86,9 @@ public:
 	bool GetRoutingTable(struct ipa_ioc_get_rt_tbl *routingTable);
 	bool PutRoutingTable(uint32_t routingTableHandle);
 	bool SetNatConntrackExcRoutingTable(uint32_t routingTableHandle, bool nat_or_conntrack);
+
+private:
+	ClassifierModel *m_model;
 };
 
 #endif
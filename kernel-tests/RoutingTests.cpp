@@ -114,6 +114,8 @@ public:
 		memset(m_sendBuffer2, 0, sizeof(m_sendBuffer2));
 		memset(m_sendBuffer3, 0, sizeof(m_sendBuffer3));
 		m_testSuiteName.push_back("Routing");
+		Claim(TEST_RES_SCENARIO);
+		Claim(TEST_RES_RT_FLT);
 	}
 
 	static int SetupKernelModule(bool en_status = false)
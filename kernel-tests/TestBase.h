@@ -32,9 +32,19 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 
 #define DFLT_NAT_MEM_TYPE "HYBRID"
 
+/* Shared resources for TestBase::Claim(), besides device node paths.
+ * Any GenericConfigureScenario() call replaces the whole ipa_test
+ * configuration, so tests using different IPATestConfiguration values
+ * still share TEST_RES_SCENARIO.
+ */
+#define TEST_RES_SCENARIO "ipa_test_scenario"
+#define TEST_RES_RT_FLT "rt_flt_hdr_tables"
+#define TEST_RES_NAT_MEM "nat_mem"
+
 using namespace std;
 
 class TestBase
@@ -53,6 +63,15 @@ public:
 	void Register(TestBase & test);
 	virtual ~TestBase();
 	TestBase();
+	void AddMetric(const string &name, double value)
+	{
+		m_metrics.push_back(make_pair(name, value));
+	}
+	void Claim(const char *resource)
+	{
+		if (resource)
+			m_resources.push_back(resource);
+	}
 	void SetMemType(
 		const char* mem_type = DFLT_NAT_MEM_TYPE)
 	{
@@ -70,5 +89,12 @@ public:
 	/* The minimal IPA HW version which this test can run on */
 	int m_maxIPAHwType;
 	/* The maximal IPA HW version which this test can run on */
+	vector < pair < string, double > > m_metrics;
+	/* Numbers a test reports besides pass/fail, cleared before Setup() */
+	vector < string > m_resources;
+	/* What the test holds from Setup() to Teardown(). With --jobs, tests
+	 * whose claims don't overlap run at the same time; a test that
+	 * claims nothing always runs alone.
+	 */
 };
 #endif
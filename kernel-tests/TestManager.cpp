@@ -36,6 +36,7 @@
 #include <sstream>
 #include "TestManager.h"
 #include "TestsUtils.h"
+#include "network_traffic/PcapFile.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include "ipa_test_module.h"
@@ -121,9 +122,10 @@ xmlNodePtr TestsXMLResult::GetSuiteElement(const string& suite_name)
  * Creates new testcase element
  */
 void TestsXMLResult::AddTestcase(const string &suite_nm, const string &test_nm,
-	double runtime, bool pass)
+	double runtime, bool pass,
+	const vector < pair < string, double > > &metrics)
 {
-	xmlNodePtr suite_node, new_testcase, fail_node;
+	xmlNodePtr suite_node, new_testcase, fail_node, props_node, prop_node;
 	ostringstream runtime_str;
 
 	if (!suite_nm.size() || !test_nm.size()) {
@@ -149,6 +151,27 @@ void TestsXMLResult::AddTestcase(const string &suite_nm, const string &test_nm,
 	runtime_str << runtime;
 	xmlSetProp(new_testcase, BAD_CAST "time", BAD_CAST runtime_str.str().c_str());
 
+	/* Benchmark numbers go in as xUnit properties of the testcase */
+	if (metrics.size()) {
+		props_node = xmlNewChild(new_testcase, NULL, BAD_CAST "properties", NULL);
+		if (!props_node) {
+			printf("failed creating properties node\n");
+			exit(-1);
+		}
+		for (size_t i = 0; i < metrics.size(); i++) {
+			ostringstream value_str;
+
+			prop_node = xmlNewChild(props_node, NULL, BAD_CAST "property", NULL);
+			if (!prop_node) {
+				printf("failed creating property node\n");
+				exit(-1);
+			}
+			value_str << metrics[i].second;
+			xmlSetProp(prop_node, BAD_CAST "name", BAD_CAST metrics[i].first.c_str());
+			xmlSetProp(prop_node, BAD_CAST "value", BAD_CAST value_str.str().c_str());
+		}
+	}
+
 	if (!pass) {
 		fail_node = xmlNewChild(new_testcase, NULL, BAD_CAST "failure", NULL);
 		if (!fail_node) {
@@ -176,7 +199,8 @@ void TestsXMLResult::GenerateXMLReport(void)
 TestsXMLResult::TestsXMLResult() {}
 TestsXMLResult::~TestsXMLResult() {}
 void TestsXMLResult::AddTestcase(const string &suite_nm, const string &test_nm,
-	double runtime, bool pass) {}
+	double runtime, bool pass,
+	const vector < pair < string, double > > &metrics) {}
 void TestsXMLResult::GenerateXMLReport(void)
 {
 	printf("No XML support\n");
@@ -193,6 +217,14 @@ TestManager::TestManager(
 	m_numTestsRun = 0;
 	FetchIPAHwType();
 	m_nat_mem_type_ptr = nat_mem_type_ptr;
+	m_jobs = 1;
+	m_shardIndex = 0;
+	m_shardCount = 1;
+	m_xmlRes = NULL;
+	m_pcapDump = NULL;
+	pthread_mutex_init(&m_lock, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	pthread_mutex_init(&m_pcapLock, NULL);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -200,6 +232,54 @@ TestManager::TestManager(
 TestManager::~TestManager()
 {
 	m_testList.clear();
+	delete m_pcapDump;
+	pthread_mutex_destroy(&m_pcapLock);
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TestManager::SetPcapDump(const char *path)
+{
+	PcapWriter *dump = new PcapWriter();
+
+	if (!dump->open(path)) {
+		printf("Failed to create %s: %s\n", path, dump->error().c_str());
+		delete dump;
+		return false;
+	}
+
+	pthread_mutex_lock(&m_pcapLock);
+	delete m_pcapDump;
+	m_pcapDump = dump;
+	m_pcapIfaces.clear();
+	pthread_mutex_unlock(&m_pcapLock);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestManager::DumpPacket(const char *iface, const unsigned char *buf, size_t len)
+{
+	map < string, int >::iterator it;
+	int id;
+
+	if (!m_pcapDump || !iface)
+		return;
+
+	pthread_mutex_lock(&m_pcapLock);
+	it = m_pcapIfaces.find(iface);
+	if (it == m_pcapIfaces.end()) {
+		id = m_pcapDump->addInterface(iface);
+		m_pcapIfaces[iface] = id;
+	} else {
+		id = it->second;
+	}
+	if (id >= 0 && !m_pcapDump->write(buf, len, id))
+		printf("pcap dump of %s failed: %s\n", iface, m_pcapDump->error().c_str());
+	pthread_mutex_unlock(&m_pcapLock);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -222,15 +302,157 @@ void TestManager::Register(TestBase &test)
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+static double ElapsedSec(const struct timespec &begin)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Setup(), Run() and Teardown() of a single test, then its bookkeeping */
+bool TestManager::RunTest(TestBase *test)
+{
+	bool pass = true;
+	struct timespec begin_test;
+	double test_runtime_sec;
+
+	printf("\n\nExecuting test %s\n", test->m_name.c_str());
+	printf("Description: %s\n", test->m_description.c_str());
+
+	printf("Setup()\n");
+	clock_gettime(CLOCK_MONOTONIC, &begin_test);
+	test->m_metrics.clear();
+	test->SetMemType(GetMemType());
+	pass &= test->Setup();
+
+	//In case the test's setup did not go well it will be a bad idea to try and run it.
+	if (true == pass)
+	{
+		printf("Run()\n");
+		pass &= test->Run();
+	}
+
+	printf("Teardown()\n");
+	pass &= test->Teardown();
+
+	test_runtime_sec = ElapsedSec(begin_test);
+
+	pthread_mutex_lock(&m_lock);
+	m_numTestsRun++;
+	if (pass)
+	{
+		PrintSeparator(test->m_name.size());
+		printf("Test %s PASSED ! time:%g\n", test->m_name.c_str(), test_runtime_sec);
+		PrintSeparator(test->m_name.size());
+	}
+	else
+	{
+		m_numTestsFailed++;
+		m_failedTestsNames.push_back(test->m_name);
+		PrintSeparator(test->m_name.size());
+		printf("Test %s FAILED ! time:%g\n", test->m_name.c_str(), test_runtime_sec);
+		PrintSeparator(test->m_name.size());
+	}
+
+	for (size_t j = 0; j < test->m_metrics.size(); j++)
+		printf("%s %s = %g\n", test->m_name.c_str(),
+			test->m_metrics[j].first.c_str(), test->m_metrics[j].second);
+
+	m_xmlRes->AddTestcase(test->m_testSuiteName[0], test->m_name, test_runtime_sec, pass,
+		test->m_metrics);
+	pthread_mutex_unlock(&m_lock);
+
+	return pass;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TestManager::Conflicts(const TestBase *a, const TestBase *b)
+{
+	if (a->m_resources.empty() || b->m_resources.empty())
+		return true;
+
+	for (size_t i = 0; i < a->m_resources.size(); i++)
+		if (find(b->m_resources.begin(), b->m_resources.end(),
+			a->m_resources[i]) != b->m_resources.end())
+			return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * First pending test that conflicts neither with a running test nor with
+ * a pending test ahead of it, so conflicting tests keep their order and
+ * a test that runs alone is not starved. Called with m_lock held.
+ */
+TestBase *TestManager::NextRunnable()
+{
+	TestBase *test;
+	bool runnable;
+
+	for (size_t i = 0; i < m_pending.size(); i++) {
+		test = m_pending[i];
+		runnable = true;
+		for (size_t j = 0; runnable && j < m_running.size(); j++)
+			runnable = !Conflicts(test, m_running[j]);
+		for (size_t j = 0; runnable && j < i; j++)
+			runnable = !Conflicts(test, m_pending[j]);
+		if (runnable) {
+			m_pending.erase(m_pending.begin() + i);
+			return test;
+		}
+	}
+
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void *TestManager::WorkerThread(void *arg)
+{
+	TestManager *mgr = (TestManager *)arg;
+	TestBase *test;
+
+	pthread_mutex_lock(&mgr->m_lock);
+	while (!mgr->m_pending.empty()) {
+		test = mgr->NextRunnable();
+		if (!test) {
+			pthread_cond_wait(&mgr->m_cond, &mgr->m_lock);
+			continue;
+		}
+		mgr->m_running.push_back(test);
+		pthread_mutex_unlock(&mgr->m_lock);
+
+		mgr->RunTest(test);
+
+		pthread_mutex_lock(&mgr->m_lock);
+		mgr->m_running.erase(find(mgr->m_running.begin(),
+			mgr->m_running.end(), test));
+		pthread_cond_broadcast(&mgr->m_cond);
+	}
+	pthread_mutex_unlock(&mgr->m_lock);
+
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 bool TestManager::Run(vector<string> testSuiteList, vector<string> testNameList)
 {
 	TestBase *test = NULL;
-	bool pass = true;
 	vector<string>::iterator testIter;
 	vector<string>::iterator testSuiteIter;
 	bool runTest = false;
-	clock_t begin_test_clk, end_test_clk;
-	double test_runtime_sec = 0, total_time_sec = 0;
+	unsigned int selected = 0;
+	struct timespec begin_run;
+	double total_time_sec;
+	vector<pthread_t> workers;
+	pthread_t worker;
 	TestsXMLResult xml_res;
 
 	if (m_testList.size() == 0)
@@ -238,8 +460,8 @@ bool TestManager::Run(vector<string> testSuiteList, vector<string> testNameList)
 
 	/* PrintRegisteredTests(); */
 
+	m_pending.clear();
 	for (unsigned int i = 0 ; i < m_testList.size() ; i++ , runTest = false) {
-		pass = true;
 		test = m_testList[i];
 
 		// Run only tests from the list of test suites which is stated in the command
@@ -260,56 +482,46 @@ bool TestManager::Run(vector<string> testSuiteList, vector<string> testNameList)
 				runTest = true;
 		}
 
+		// Shard before the HW check so every device splits the same list
+		if (runTest && m_shardCount > 1)
+			runTest = (selected++ % m_shardCount) == m_shardIndex;
+
 		// Run the test only if it's applicable to the current IPA HW type / version
 		if (runTest) {
 			if (!(m_IPAHwType >= test->m_minIPAHwType && m_IPAHwType <= test->m_maxIPAHwType))
 				runTest = false;
 		}
 
-		if (!runTest)
-			continue;
-
-		printf("\n\nExecuting test %s\n", test->m_name.c_str());
-		printf("Description: %s\n", test->m_description.c_str());
-
-		printf("Setup()\n");
-		begin_test_clk = clock();
-		test->SetMemType(GetMemType());
-		pass &= test->Setup();
-
-		//In case the test's setup did not go well it will be a bad idea to try and run it.
-		if (true == pass)
-		{
-			printf("Run()\n");
-			pass &= test->Run();
-		}
-
-		printf("Teardown()\n");
-		pass &= test->Teardown();
-
-		end_test_clk = clock();
-		test_runtime_sec = double(end_test_clk - begin_test_clk) / CLOCKS_PER_SEC;
-		total_time_sec += test_runtime_sec;
+		if (runTest)
+			m_pending.push_back(test);
+	} // for
 
-		if (pass)
-		{
-			m_numTestsRun++;
-			PrintSeparator(test->m_name.size());
-			printf("Test %s PASSED ! time:%g\n", test->m_name.c_str(), test_runtime_sec);
-			PrintSeparator(test->m_name.size());
-		}
-		else
-		{
-			m_numTestsRun++;
-			m_numTestsFailed++;
-			m_failedTestsNames.push_back(test->m_name);
-			PrintSeparator(test->m_name.size());
-			printf("Test %s FAILED ! time:%g\n", test->m_name.c_str(), test_runtime_sec);
-			PrintSeparator(test->m_name.size());
+	if (m_shardCount > 1)
+		printf("Shard %u/%u: %zu tests\n", m_shardIndex + 1, m_shardCount,
+			m_pending.size());
+
+	m_xmlRes = &xml_res;
+	clock_gettime(CLOCK_MONOTONIC, &begin_run);
+	if (m_jobs <= 1) {
+		for (size_t i = 0; i < m_pending.size(); i++)
+			RunTest(m_pending[i]);
+		m_pending.clear();
+	} else {
+		for (unsigned int i = 0; i < m_jobs && i < m_pending.size(); i++) {
+			if (pthread_create(&worker, NULL, WorkerThread, this)) {
+				printf("Failed to create test worker %u\n", i);
+				break;
+			}
+			workers.push_back(worker);
 		}
-
-		xml_res.AddTestcase(test->m_testSuiteName[0], test->m_name, test_runtime_sec, pass);
-	} // for
+		/* without workers the tests still run, one at a time */
+		if (workers.empty())
+			WorkerThread(this);
+		for (size_t i = 0; i < workers.size(); i++)
+			pthread_join(workers[i], NULL);
+	}
+	total_time_sec = ElapsedSec(begin_run);
+	m_xmlRes = NULL;
 
 	// Print summary
 	printf("\n\n");
@@ -324,8 +536,10 @@ bool TestManager::Run(vector<string> testSuiteList, vector<string> testNameList)
 	}
 	printf("=============================================================\n");
 	xml_res.GenerateXMLReport();
+	if (m_pcapDump)
+		m_pcapDump->flush();
 
-	return pass;
+	return m_numTestsFailed == 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -33,6 +33,8 @@
 #include "TestBase.h"
 #include <vector>
 #include <string>
+#include <map>
+#include <pthread.h>
 #include "linux/msm_ipa.h"
 
 #ifdef HAVE_LIBXML
@@ -42,6 +44,7 @@
 
 using namespace std;
 
+class PcapWriter;
 
 class TestsXMLResult
 {
@@ -49,7 +52,8 @@ public:
 	TestsXMLResult();
 	~TestsXMLResult();
 	void AddTestcase(const string &suite_nm, const string &test_nm,
-		double runtime, bool pass);
+		double runtime, bool pass,
+		const vector < pair < string, double > > &metrics);
 	void GenerateXMLReport(void);
 private:
 #ifdef HAVE_LIBXML
@@ -79,6 +83,19 @@ public:
 
 	enum ipa_hw_type GetIPAHwType() {return m_IPAHwType;}
 	const char* GetMemType() { return m_nat_mem_type_ptr; }
+	/* Number of tests Run() may have in flight, see TestBase::Claim() */
+	void SetJobs(unsigned int jobs) { m_jobs = jobs ? jobs : 1; }
+	/* Run only every count-th selected test starting at index (0 based) */
+	void SetShard(unsigned int index, unsigned int count)
+	{
+		m_shardIndex = index;
+		m_shardCount = count;
+	}
+	/* Record every packet the tests send or receive in a pcapng file,
+	 * one interface per device node.
+	 */
+	bool SetPcapDump(const char *path);
+	void DumpPacket(const char *iface, const unsigned char *buf, size_t len);
 
 private:
 	TestManager(
@@ -89,6 +106,10 @@ private:
 	void PrintRegisteredTests();
 	void BuildRegressionTestSuite();
 	void FetchIPAHwType();
+	bool RunTest(TestBase *test);
+	static bool Conflicts(const TestBase *a, const TestBase *b);
+	TestBase *NextRunnable();
+	static void *WorkerThread(void *arg);
 
 	static TestManager *m_instance;
 
@@ -98,6 +119,20 @@ private:
 	const char* m_nat_mem_type_ptr;
 
 	vector < string > m_failedTestsNames;
+
+	unsigned int m_jobs;
+	unsigned int m_shardIndex;
+	unsigned int m_shardCount;
+	/* protects everything below, the counters above and m_xmlRes */
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_cond;
+	vector < TestBase * > m_pending;
+	vector < TestBase * > m_running;
+	TestsXMLResult *m_xmlRes;
+
+	PcapWriter *m_pcapDump;
+	map < string, int > m_pcapIfaces;
+	pthread_mutex_t m_pcapLock;
 };
 
 #endif
@@ -1248,11 +1248,15 @@ void prepare_header_struct(struct ipa_test_config_header *header,
 bool CompareResultVsGolden(Byte *goldenBuffer,   unsigned int goldenSize,
 			   Byte *receivedBuffer, unsigned int receivedSize)
 {
-	if (receivedSize != goldenSize) {
+	bool match = (receivedSize == goldenSize) &&
+		!memcmp((void*)receivedBuffer, (void*)goldenBuffer, goldenSize);
+
+	if (receivedSize != goldenSize)
 		g_Logger.AddMessage(LOG_VERBOSE,  "%s File sizes are different.\n", __FUNCTION__);
-		return false;
-	}
-	return !memcmp((void*)receivedBuffer, (void*)goldenBuffer, goldenSize);
+	/* with --pcap the expected packet lands next to the received one */
+	if (!match)
+		TestManager::GetInstance()->DumpPacket("golden", goldenBuffer, goldenSize);
+	return match;
 }
 
 size_t GetPacketStatusSize(void)
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "TestBase.h"
+#include "TestsUtils.h"
+#include "linux/msm_ipa.h"
+#include "ipa_xsk_uapi.h"
+
+#define XSK_DEV_NAME "/dev/ipa_xsk"
+#define XSK_NUM_FRAMES 2048
+#define XSK_RUN_SEC 10
+#define XSK_POLL_MSEC 100
+/* traffic must be steered to this pipe by routing rules */
+#define XSK_CLIENT IPA_CLIENT_TEST_CONS
+
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Sample zero-copy consumer: registers a UMEM, hands every frame to the
+ * driver through the fill ring, binds a consumer pipe and then receives
+ * for a fixed period, returning each frame as soon as it is consumed.
+ * Reports packets per second. Needs traffic routed to XSK_CLIENT.
+ */
+class XskRxTest: public TestBase {
+public:
+	XskRxTest() :
+		m_fd(-1),
+		m_umem(MAP_FAILED),
+		m_umemSize(0),
+		m_map(MAP_FAILED),
+		m_mapSize(0)
+	{
+		m_name = "XskRxTest";
+		m_description = "Receive through a zero-copy XSK UMEM and "
+				"measure packets per second";
+		m_testSuiteName.push_back("Xsk");
+		m_runInRegression = false;
+		Claim(XSK_DEV_NAME);
+		/* XSK_CLIENT is one of the ipa_test pipes */
+		Claim(TEST_RES_SCENARIO);
+		m_minIPAHwType = IPA_HW_v4_5;
+		Register(*this);
+	}
+
+	bool Setup()
+	{
+		struct ipa_xsk_umem_reg reg;
+		struct ipa_xsk_bind bind;
+		struct ipa_xsk_ctrl *ctrl;
+		uint32_t *fill;
+		uint32_t i;
+
+		m_fd = open(XSK_DEV_NAME, O_RDWR);
+		if (m_fd < 0) {
+			LOG_MSG_ERROR("Failed to open %s\n", XSK_DEV_NAME);
+			return false;
+		}
+
+		m_umemSize = (size_t)XSK_NUM_FRAMES * sysconf(_SC_PAGESIZE);
+		m_umem = mmap(NULL, m_umemSize, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (m_umem == MAP_FAILED) {
+			LOG_MSG_ERROR("Failed to allocate the UMEM\n");
+			return false;
+		}
+
+		memset(&reg, 0, sizeof(reg));
+		reg.addr = (uintptr_t)m_umem;
+		reg.num_frames = XSK_NUM_FRAMES;
+		if (ioctl(m_fd, IPA_XSK_IOC_REG_UMEM, &reg)) {
+			LOG_MSG_ERROR("Failed to register the UMEM\n");
+			return false;
+		}
+
+		m_mapSize = reg.mmap_size;
+		m_map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED, m_fd, 0);
+		if (m_map == MAP_FAILED) {
+			LOG_MSG_ERROR("Failed to mmap the XSK rings\n");
+			return false;
+		}
+
+		ctrl = (struct ipa_xsk_ctrl *)m_map;
+		if (ctrl->magic != IPA_XSK_MAGIC ||
+			ctrl->version != IPA_XSK_VERSION ||
+			ctrl->num_frames != XSK_NUM_FRAMES) {
+			LOG_MSG_ERROR("Bad ring header magic 0x%x version %u frames %u\n",
+				ctrl->magic, ctrl->version, ctrl->num_frames);
+			return false;
+		}
+
+		/* the driver owns every frame until it shows up on the RX ring */
+		fill = (uint32_t *)((uint8_t *)m_map + ctrl->fill_offset);
+		for (i = 0; i < XSK_NUM_FRAMES; i++)
+			fill[i & (ctrl->ring_size - 1)] = i;
+		__atomic_store_n(&ctrl->fill_prod, XSK_NUM_FRAMES,
+			__ATOMIC_RELEASE);
+
+		bind.client = XSK_CLIENT;
+		bind.desc_fifo_sz = 0;
+		if (ioctl(m_fd, IPA_XSK_IOC_BIND, &bind)) {
+			LOG_MSG_ERROR("Failed to bind client %u\n", bind.client);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Teardown()
+	{
+		if (m_map != MAP_FAILED)
+			munmap(m_map, m_mapSize);
+		m_map = MAP_FAILED;
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+		/* the driver unpins the UMEM on close */
+		if (m_umem != MAP_FAILED)
+			munmap(m_umem, m_umemSize);
+		m_umem = MAP_FAILED;
+		return true;
+	}
+
+	bool Run()
+	{
+		struct ipa_xsk_ctrl *ctrl = (struct ipa_xsk_ctrl *)m_map;
+		uint32_t *fill = (uint32_t *)((uint8_t *)m_map + ctrl->fill_offset);
+		struct ipa_xsk_rx_desc *rx = (struct ipa_xsk_rx_desc *)
+			((uint8_t *)m_map + ctrl->rx_offset);
+		uint64_t mask = ctrl->ring_size - 1;
+		uint64_t rxProd, rxCons, fillProd;
+		uint64_t pkts = 0, bytes = 0, dropped, csum = 0;
+		struct pollfd pfd;
+		struct timespec start, now;
+		double secs;
+
+		dropped = ctrl->rx_dropped;
+		rxCons = ctrl->rx_cons;
+		fillProd = ctrl->fill_prod;
+
+		pfd.fd = m_fd;
+		pfd.events = POLLIN;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do {
+			if (poll(&pfd, 1, XSK_POLL_MSEC) < 0) {
+				LOG_MSG_ERROR("poll failed\n");
+				return false;
+			}
+
+			rxProd = __atomic_load_n(&ctrl->rx_prod, __ATOMIC_ACQUIRE);
+			if (rxProd - rxCons > ctrl->ring_size) {
+				LOG_MSG_ERROR("Bad rx prod %llu cons %llu\n",
+					(unsigned long long)rxProd,
+					(unsigned long long)rxCons);
+				return false;
+			}
+
+			while (rxCons != rxProd) {
+				struct ipa_xsk_rx_desc *desc = &rx[rxCons & mask];
+				uint8_t *pkt;
+
+				if (desc->frame >= ctrl->num_frames ||
+					desc->len > ctrl->frame_size) {
+					LOG_MSG_ERROR("Bad descriptor frame %u len %u\n",
+						desc->frame, desc->len);
+					return false;
+				}
+
+				/* touch the payload in place, no copy */
+				pkt = (uint8_t *)m_umem +
+					(size_t)desc->frame * ctrl->frame_size;
+				csum += pkt[0];
+				pkts++;
+				bytes += desc->len;
+
+				fill[fillProd & mask] = desc->frame;
+				fillProd++;
+				rxCons++;
+			}
+			__atomic_store_n(&ctrl->rx_cons, rxCons, __ATOMIC_RELEASE);
+			__atomic_store_n(&ctrl->fill_prod, fillProd, __ATOMIC_RELEASE);
+
+			if (__atomic_load_n(&ctrl->flags, __ATOMIC_ACQUIRE) &
+				IPA_XSK_F_NEED_WAKEUP) {
+				if (ioctl(m_fd, IPA_XSK_IOC_WAKEUP)) {
+					LOG_MSG_ERROR("wakeup failed\n");
+					return false;
+				}
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			secs = (now.tv_sec - start.tv_sec) +
+				(now.tv_nsec - start.tv_nsec) / 1e9;
+		} while (secs < XSK_RUN_SEC);
+
+		dropped = ctrl->rx_dropped - dropped;
+		LOG_MSG_INFO("XSK: %llu pkts %llu bytes in %.2f sec, "
+			"%.0f pkts/s %.0f bytes/s, %llu dropped (csum %llu)\n",
+			(unsigned long long)pkts, (unsigned long long)bytes, secs,
+			pkts / secs, bytes / secs, (unsigned long long)dropped,
+			(unsigned long long)csum);
+		if (!pkts) {
+			LOG_MSG_ERROR("No traffic seen, is it routed to the XSK pipe?\n");
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	int m_fd;
+	void *m_umem;
+	size_t m_umemSize;
+	void *m_map;
+	size_t m_mapSize;
+};
+
+static XskRxTest xskRxTest;
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                  EOF                                      ////
+/////////////////////////////////////////////////////////////////////////////////
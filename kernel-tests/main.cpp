@@ -82,7 +82,11 @@ string sFormat = "ip_accelerator <control_flag> <suit/name>, ..., <suit/name>\n"
 							"ip_accelerator " SHOW_TEST_FLAG  "\n"
 							"ip_accelerator " SHOW_SUIT_FLAG  "\n"
 							"or ip_accelerator --chooser "
-							"for menu chooser interface\n";
+							"for menu chooser interface\n"
+							"run options: --jobs <n> run tests with disjoint claims "
+							"in parallel, --shard <i>/<n> run the i-th of n "
+							"slices (1 based), --pcap <file> record all test "
+							"traffic in a pcapng file\n";
 #define MAX_SUITES 19
 
 #undef strcasesame
@@ -351,6 +355,9 @@ int main(int argc, char* argv[])
 	string nat_mem_type = DFLT_NAT_MEM_TYPE;
 
 	int c, result = 0, what = 0;
+	unsigned int jobs = 1, shard_index = 1, shard_count = 1;
+	char tail;
+	const char *pcap_path = NULL;
 
 	int opt_idx = 0;
 
@@ -362,6 +369,9 @@ int main(int argc, char* argv[])
 		{"test",        no_argument,       &what, 4},
 		{"suite",       no_argument,       &what, 5},
 		{"mem",         required_argument, 0,    'm'},
+		{"jobs",        required_argument, 0,    'j'},
+		{"shard",       required_argument, 0,    's'},
+		{"pcap",        required_argument, 0,    'p'},
 		{0, 0, 0, 0}
 	};
 
@@ -387,6 +397,24 @@ int main(int argc, char* argv[])
 				exit(1);
 			}
 			break;
+		case 'j':
+			if ( sscanf(optarg, "%u%c", &jobs, &tail) != 1 || jobs == 0 )
+			{
+				fprintf(stderr, "Illegal: --jobs %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 's':
+			if ( sscanf(optarg, "%u/%u%c", &shard_index, &shard_count, &tail) != 2 ||
+				 shard_index == 0 || shard_index > shard_count )
+			{
+				fprintf(stderr, "Illegal: --shard %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 'p':
+			pcap_path = optarg;
+			break;
 		default:
 			fprintf(stderr, "Illegal command line argument passed\n");
 			printf("please use correct format:\n%s", sFormat.c_str());
@@ -424,6 +452,10 @@ int main(int argc, char* argv[])
 	}
 
 	testmanager = TestManager::GetInstance(nat_mem_type.c_str());
+	testmanager->SetJobs(jobs);
+	testmanager->SetShard(shard_index - 1, shard_count);
+	if ( pcap_path && !testmanager->SetPcapDump(pcap_path) )
+		exit(1);
 
 	string sControlFlag = argv[1];
 
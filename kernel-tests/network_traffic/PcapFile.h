@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+#ifndef NETWORK_TRAFFIC_PCAPFILE_H
+#define NETWORK_TRAFFIC_PCAPFILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Streaming pcap/pcapng reader and writer, shared by kernel-tests and network_traffic.
+ *
+ * PcapReader maps the whole capture read only and hands out pointers into the mapping, so
+ * packets go from the page cache to Pipe::Send() without a copy and a capture of any size
+ * costs only address space. PcapWriter appends records through a buffered FILE, pcapng
+ * by default so every pipe can get its own named interface in Wireshark.
+ */
+
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr uint32_t LINKTYPE_RAW = 101; // raw IPv4/IPv6, no link layer
+
+struct PcapPacket {
+    const uint8_t* data; // inside the reader's mapping, valid until close()
+    uint32_t capLen;
+    uint32_t origLen;
+    uint64_t tsNsec;
+    uint32_t linkType;
+    uint32_t interface; // pcapng interface id, 0 for pcap
+};
+
+class PcapReader {
+
+private:
+
+    static constexpr uint32_t pcapMagicUsec = 0xa1b2c3d4;
+    static constexpr uint32_t pcapMagicNsec = 0xa1b23c4d;
+    static constexpr uint32_t pcapngShb = 0x0a0d0d0a;
+    static constexpr uint32_t pcapngIdb = 1;
+    static constexpr uint32_t pcapngSpb = 3;
+    static constexpr uint32_t pcapngEpb = 6;
+    static constexpr uint32_t pcapngBom = 0x1a2b3c4d;
+    static constexpr uint16_t optIfTsresol = 9;
+
+    struct Interface {
+        uint32_t linkType;
+        uint32_t snapLen;
+        uint64_t unitsPerSec;
+    };
+
+    const uint8_t* mMap {nullptr};
+    size_t mSize {0};
+    size_t mPos {0};
+    bool mIsPcapng {false};
+    bool mSwapped {false};
+    uint32_t mLinkType {0};
+    uint64_t mUnitsPerSec {1000000};
+    std::vector<Interface> mInterfaces;
+    std::string mError;
+
+    static uint32_t swap32(uint32_t v) {
+        return __builtin_bswap32(v);
+    }
+
+    uint16_t rd16(size_t offset) const {
+        uint16_t v;
+        memcpy(&v, mMap + offset, sizeof(v));
+        return mSwapped ? __builtin_bswap16(v) : v;
+    }
+
+    uint32_t rd32(size_t offset) const {
+        uint32_t v;
+        memcpy(&v, mMap + offset, sizeof(v));
+        return mSwapped ? swap32(v) : v;
+    }
+
+    static uint64_t toNsec(uint64_t ts, uint64_t unitsPerSec) {
+        if (unitsPerSec == 1000000000ULL)
+            return ts;
+        if (unitsPerSec <= 1000000000ULL && 1000000000ULL % unitsPerSec == 0)
+            return ts * (1000000000ULL / unitsPerSec);
+        return ts / unitsPerSec * 1000000000ULL +
+            static_cast<uint64_t>(static_cast<long double>(ts % unitsPerSec) * 1e9L / unitsPerSec);
+    }
+
+    bool fail(const std::string& error) {
+        mError = error;
+        return false;
+    }
+
+    bool parseHeader() {
+        uint32_t magic;
+
+        if (mSize < 4)
+            return fail("file too short");
+        memcpy(&magic, mMap, sizeof(magic));
+        if (magic == pcapngShb) {
+            mIsPcapng = true;
+            return true;
+        }
+
+        mIsPcapng = false;
+        mSwapped = (magic == swap32(pcapMagicUsec) || magic == swap32(pcapMagicNsec));
+        magic = mSwapped ? swap32(magic) : magic;
+        if (magic != pcapMagicUsec && magic != pcapMagicNsec)
+            return fail("not a pcap or pcapng file");
+        if (mSize < 24)
+            return fail("truncated pcap header");
+        mUnitsPerSec = (magic == pcapMagicNsec) ? 1000000000ULL : 1000000ULL;
+        mLinkType = rd32(20) & 0x0fffffff; // upper bits carry FCS info
+        return true;
+    }
+
+    // Section header: byte order and a fresh interface list.
+    bool parseShb(size_t block) {
+        uint32_t bom;
+
+        memcpy(&bom, mMap + block + 8, sizeof(bom));
+        if (bom == pcapngBom)
+            mSwapped = false;
+        else if (bom == swap32(pcapngBom))
+            mSwapped = true;
+        else
+            return fail("bad byte order magic");
+        mInterfaces.clear();
+        return true;
+    }
+
+    bool parseIdb(size_t block, uint32_t blockLen) {
+        Interface iface {0, 0, 1000000};
+        size_t opt = block + 16, end = block + blockLen - 4;
+
+        if (blockLen < 20)
+            return fail("bad interface description block");
+        iface.linkType = rd16(block + 8);
+        iface.snapLen = rd32(block + 12);
+        while (opt + 4 <= end) {
+            uint16_t code = rd16(opt), len = rd16(opt + 2);
+
+            if (code == 0 || opt + 4 + len > end)
+                break;
+            if (code == optIfTsresol && len >= 1) {
+                uint8_t res = mMap[opt + 4];
+                uint64_t units = 1;
+
+                // base 10 unless the top bit says base 2
+                for (uint8_t i = 0; i < (res & 0x7f) && units < (1ULL << 62); i++)
+                    units *= (res & 0x80) ? 2 : 10;
+                iface.unitsPerSec = units;
+            }
+            opt += 4 + ((len + 3) & ~3u);
+        }
+        mInterfaces.push_back(iface);
+        return true;
+    }
+
+    bool nextPcap(PcapPacket& pkt) {
+        uint32_t capLen;
+
+        if (mPos == mSize)
+            return false;
+        if (mPos + 16 > mSize)
+            return fail("truncated packet record");
+        capLen = rd32(mPos + 8);
+        if (mPos + 16 + capLen > mSize)
+            return fail("truncated packet record");
+        pkt.tsNsec = toNsec(static_cast<uint64_t>(rd32(mPos)) * mUnitsPerSec + rd32(mPos + 4),
+            mUnitsPerSec);
+        pkt.capLen = capLen;
+        pkt.origLen = rd32(mPos + 12);
+        pkt.data = mMap + mPos + 16;
+        pkt.linkType = mLinkType;
+        pkt.interface = 0;
+        mPos += 16 + capLen;
+        return true;
+    }
+
+    bool nextPcapng(PcapPacket& pkt) {
+        while (mPos + 12 <= mSize) {
+            size_t block = mPos;
+            uint32_t type, blockLen;
+
+            // a section header sets the byte order its own length is read with
+            memcpy(&type, mMap + block, sizeof(type));
+            if (type == pcapngShb) {
+                if (!parseShb(block))
+                    return false;
+            } else {
+                type = rd32(block);
+            }
+            blockLen = rd32(block + 4);
+            if (blockLen < 12 || (blockLen & 3) || block + blockLen > mSize)
+                return fail("bad block length");
+            if (type == pcapngShb && blockLen < 28)
+                return fail("bad section header block");
+            mPos += blockLen;
+
+            if (type == pcapngIdb) {
+                if (!parseIdb(block, blockLen))
+                    return false;
+            } else if (type == pcapngEpb) {
+                uint32_t id, capLen;
+
+                if (blockLen < 32)
+                    return fail("bad enhanced packet block");
+                id = rd32(block + 8);
+                capLen = rd32(block + 20);
+                if (id >= mInterfaces.size())
+                    return fail("packet on an undeclared interface");
+                if (28 + capLen + 4 > blockLen)
+                    return fail("truncated enhanced packet block");
+                pkt.tsNsec = toNsec((static_cast<uint64_t>(rd32(block + 12)) << 32) | rd32(block + 16),
+                    mInterfaces[id].unitsPerSec);
+                pkt.capLen = capLen;
+                pkt.origLen = rd32(block + 24);
+                pkt.data = mMap + block + 28;
+                pkt.linkType = mInterfaces[id].linkType;
+                pkt.interface = id;
+                return true;
+            } else if (type == pcapngSpb) {
+                uint32_t origLen;
+
+                if (blockLen < 16 || mInterfaces.empty())
+                    return fail("bad simple packet block");
+                origLen = rd32(block + 8);
+                pkt.tsNsec = 0;
+                pkt.origLen = origLen;
+                pkt.capLen = std::min<uint32_t>(origLen, blockLen - 16);
+                if (mInterfaces[0].snapLen)
+                    pkt.capLen = std::min(pkt.capLen, mInterfaces[0].snapLen);
+                pkt.data = mMap + block + 12;
+                pkt.linkType = mInterfaces[0].linkType;
+                pkt.interface = 0;
+                return true;
+            }
+            // statistics, name resolution, custom blocks etc. are skipped
+        }
+        if (mPos != mSize)
+            return fail("truncated block");
+        return false;
+    }
+
+public:
+
+    PcapReader() = default;
+    PcapReader(const PcapReader&) = delete;
+    PcapReader& operator=(const PcapReader&) = delete;
+
+    ~PcapReader() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        struct stat st;
+        void* map;
+        int fd;
+
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return fail("cannot open " + path);
+        if (fstat(fd, &st) || st.st_size <= 0) {
+            ::close(fd);
+            return fail("cannot size " + path);
+        }
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return fail("cannot map " + path);
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        mMap = static_cast<const uint8_t*>(map);
+        mSize = st.st_size;
+        if (!parseHeader()) {
+            close();
+            return false;
+        }
+        rewind();
+        return true;
+    }
+
+    /**
+     * Next packet, false at the end of the capture or on a malformed record (error() is
+     * set then). pkt.data stays valid until close().
+     */
+    bool next(PcapPacket& pkt) {
+        if (!mMap)
+            return false;
+        return mIsPcapng ? nextPcapng(pkt) : nextPcap(pkt);
+    }
+
+    void rewind() {
+        mPos = mIsPcapng ? 0 : 24;
+        mInterfaces.clear();
+        mError.clear();
+    }
+
+    void close() {
+        if (mMap)
+            munmap(const_cast<uint8_t*>(mMap), mSize);
+        mMap = nullptr;
+        mSize = 0;
+        mPos = 0;
+        mInterfaces.clear();
+    }
+
+    bool isPcapng() const {
+        return mIsPcapng;
+    }
+
+    const std::string& error() const {
+        return mError;
+    }
+};
+
+class PcapWriter {
+
+public:
+
+    enum Format {PCAP, PCAPNG};
+
+private:
+
+    static constexpr size_t bufferSize = 1 << 20;
+
+    FILE* mFile {nullptr};
+    Format mFormat {PCAPNG};
+    uint32_t mLinkType {LINKTYPE_RAW};
+    uint32_t mSnapLen {0};
+    int mNumInterfaces {0};
+    std::vector<char> mBuffer;
+    std::string mError;
+
+    bool fail(const std::string& error) {
+        mError = error;
+        return false;
+    }
+
+    bool put(const void* data, size_t len) {
+        if (fwrite(data, 1, len, mFile) != len)
+            return fail("write failed");
+        return true;
+    }
+
+    bool put16(uint16_t v) {
+        return put(&v, sizeof(v));
+    }
+
+    bool put32(uint32_t v) {
+        return put(&v, sizeof(v));
+    }
+
+    bool pad(size_t len) {
+        static const uint8_t zeros[4] = {0};
+
+        return put(zeros, (4 - (len & 3)) & 3);
+    }
+
+    static uint64_t now() {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+
+public:
+
+    PcapWriter() = default;
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    ~PcapWriter() {
+        close();
+    }
+
+    /**
+     * Creates path and writes the file header, nanosecond timestamps, host byte order.
+     * linkType is the link type of the single pcap interface, or of the interface pcapng
+     * files get on the first write() if addInterface() was never called.
+     */
+    bool open(const std::string& path, Format format = PCAPNG,
+              uint32_t linkType = LINKTYPE_RAW, uint32_t snapLen = 262144) {
+        close();
+        mFile = fopen(path.c_str(), "wb");
+        if (!mFile)
+            return fail("cannot create " + path);
+        mBuffer.resize(bufferSize);
+        setvbuf(mFile, mBuffer.data(), _IOFBF, mBuffer.size());
+        mFormat = format;
+        mLinkType = linkType;
+        mSnapLen = snapLen;
+        mNumInterfaces = 0;
+        mError.clear();
+
+        if (mFormat == PCAP) {
+            mNumInterfaces = 1;
+            return put32(0xa1b23c4d) && put16(2) && put16(4) && put32(0) && put32(0) &&
+                put32(mSnapLen) && put32(mLinkType);
+        }
+
+        // section header block, no options, unknown section length
+        return put32(0x0a0d0d0a) && put32(28) && put32(0x1a2b3c4d) && put16(1) && put16(0) &&
+            put32(0xffffffff) && put32(0xffffffff) && put32(28);
+    }
+
+    /**
+     * Declares a pcapng interface (shown as name in Wireshark) and returns its id for
+     * write(), -1 on error. A pcap file only has interface 0.
+     */
+    int addInterface(const std::string& name, uint32_t linkType = LINKTYPE_RAW) {
+        size_t nameLen = std::min<size_t>(name.size(), 0xffff);
+        uint32_t blockLen = 20 + 4 + ((nameLen + 3) & ~3u) + 8 + 4;
+
+        if (!mFile)
+            return -1;
+        if (mFormat == PCAP)
+            return 0;
+        if (!put32(1) || !put32(blockLen) || !put16(linkType) || !put16(0) ||
+            !put32(mSnapLen) ||
+            !put16(2) || !put16(nameLen) || !put(name.data(), nameLen) || !pad(nameLen) ||
+            !put16(9) || !put16(1) || !put("\x09\0\0", 4) || // if_tsresol: nanoseconds
+            !put16(0) || !put16(0) || !put32(blockLen))
+            return -1;
+        return mNumInterfaces++;
+    }
+
+    /**
+     * Appends one packet, truncated to the snap length. tsNsec 0 stands for now.
+     */
+    bool write(const uint8_t* data, size_t len, int interface = 0, uint64_t tsNsec = 0) {
+        uint32_t capLen = static_cast<uint32_t>(std::min<size_t>(len, mSnapLen));
+
+        if (!mFile)
+            return fail("not open");
+        if (!tsNsec)
+            tsNsec = now();
+        if (mNumInterfaces == 0 && addInterface("ipa", mLinkType) < 0)
+            return false;
+        if (interface < 0 || interface >= mNumInterfaces)
+            return fail("bad interface");
+
+        if (mFormat == PCAP)
+            return put32(tsNsec / 1000000000ULL) && put32(tsNsec % 1000000000ULL) &&
+                put32(capLen) && put32(len) && put(data, capLen);
+
+        uint32_t blockLen = 28 + ((capLen + 3) & ~3u) + 4;
+        return put32(6) && put32(blockLen) && put32(interface) &&
+            put32(tsNsec >> 32) && put32(static_cast<uint32_t>(tsNsec)) &&
+            put32(capLen) && put32(len) && put(data, capLen) && pad(capLen) && put32(blockLen);
+    }
+
+    bool flush() {
+        if (mFile && fflush(mFile))
+            return fail("flush failed");
+        return true;
+    }
+
+    void close() {
+        if (mFile)
+            fclose(mFile);
+        mFile = nullptr;
+        mNumInterfaces = 0;
+    }
+
+    bool isOpen() const {
+        return mFile != nullptr;
+    }
+
+    const std::string& error() const {
+        return mError;
+    }
+};
+
+#endif //NETWORK_TRAFFIC_PCAPFILE_H
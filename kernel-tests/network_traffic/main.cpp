@@ -30,6 +30,7 @@
 #include <string>
 #include <cstring>
 #include "UlsoPacket.h"
+#include "PcapFile.h"
 
 using std::cout;
 using std::endl;
@@ -189,6 +190,53 @@ bool testPacketConstruction(struct Packet packet, size_t segmentSize=20){
     return true;
 }
 
+bool testPcapRoundTrip(PcapWriter::Format format, const string& path){
+    vector<vector<uint8_t>> golden;
+    UlsoPacket<UdpHeader, IPv4Header> p(19, 100, false);
+    PcapWriter writer;
+    PcapReader reader;
+    PcapPacket pkt;
+    int ifaces[2];
+
+    for(auto& seg: p.segment()){
+        golden.emplace_back(seg.size());
+        seg.asArray(golden.back().data());
+    }
+    if(!writer.open(path, format)){
+        cout << "Error: " << writer.error() << endl;
+        return false;
+    }
+    ifaces[0] = writer.addInterface("to_ipa");
+    ifaces[1] = writer.addInterface("from_ipa");
+    for(unsigned int i=0; i<golden.size(); i++){
+        if(!writer.write(golden[i].data(), golden[i].size(), ifaces[i % 2], 1000000000ULL + i)){
+            cout << "Error: " << writer.error() << endl;
+            return false;
+        }
+    }
+    writer.close();
+
+    if(!reader.open(path)){
+        cout << "Error: " << reader.error() << endl;
+        return false;
+    }
+    for(unsigned int i=0; i<golden.size(); i++){
+        if(!reader.next(pkt) || pkt.capLen != golden[i].size() ||
+           memcmp(pkt.data, golden[i].data(), pkt.capLen) || pkt.tsNsec != 1000000000ULL + i ||
+           pkt.linkType != LINKTYPE_RAW || pkt.interface != static_cast<uint32_t>(ifaces[i % 2])){
+            cout << "Error: packet " << i << " differs after the round trip " << reader.error() << endl;
+            return false;
+        }
+    }
+    if(reader.next(pkt) || !reader.error().empty()){
+        cout << "Error: unexpected data at the end " << reader.error() << endl;
+        return false;
+    }
+    cout << (format == PcapWriter::PCAP ? "pcap" : "pcapng") << " round trip of " << golden.size()
+         << " packets OK" << endl;
+    return true;
+}
+
 int main() {
 
     uint8_t arr[UlsoPacket<>::maxSize] = {0};
@@ -201,5 +249,9 @@ int main() {
         cout << pSeg << endl;
     }
 
+    if(!testPcapRoundTrip(PcapWriter::PCAP, "network_traffic.pcap") ||
+       !testPcapRoundTrip(PcapWriter::PCAPNG, "network_traffic.pcapng"))
+        return 1;
+
     return 0;
 }